@@ -97,8 +97,15 @@ TclGetCStackPtr(void)
 #endif
 }
 
+/*
+ * Initial sizes of evaluation stacks, in words. That of coroutines is what a
+ * coroutine running a simple procedure needs, and keeps the stack in a
+ * 1024-byte block of the allocator. Stacks that are too small grow, and the
+ * stacks of ended coroutines are reused (see TclNewCoroutineExecEnv).
+ */
+
 #define INTERP_STACK_INITIAL_SIZE 2000
-#define CORO_STACK_INITIAL_SIZE    200
+#define CORO_STACK_INITIAL_SIZE    120
 
 /*
  * Determine whether we're using IEEE floating point
@@ -417,6 +424,8 @@ static const UnsupportedCmdInfo unsupportedCmds[] = {
     {"assemble",	Tcl_AssembleObjCmd,	TclCompileAssembleCmd,	TclNRAssembleObjCmd, NULL},
     {"corotype",	CoroTypeObjCmd,		NULL,			NULL,	NULL},
     {"loadIcu",		TclLoadIcuObjCmd,	NULL,			NULL,	NULL},
+    {"regexpcache",	TclRegexpCacheObjCmd,	NULL,			NULL,	NULL},
+    {"pmap",		TclPMapObjCmd,		NULL,			NULL,	NULL},
     {NULL, NULL, NULL, NULL, NULL}
 };
 
@@ -891,6 +900,7 @@ Tcl_CreateInterp(void)
     Tcl_InitHashTable(iPtr->lineLAPtr, TCL_ONE_WORD_KEYS);
     Tcl_InitHashTable(iPtr->lineLABCPtr, TCL_ONE_WORD_KEYS);
     iPtr->scriptCLLocPtr = NULL;
+    iPtr->compCachePtr = NULL;
 
     iPtr->activeVarTracePtr = NULL;
 
@@ -1000,6 +1010,8 @@ Tcl_CreateInterp(void)
      */
 
     iPtr->execEnvPtr = TclCreateExecEnv(interp, INTERP_STACK_INITIAL_SIZE);
+    iPtr->execEnvPool = NULL;
+    iPtr->numPooledExecEnvs = 0;
 
     /*
      * TIP #219, Tcl Channel Reflection API support.
@@ -2077,6 +2089,7 @@ DeleteInterpProc(
     while (iPtr->tracePtr != NULL) {
 	Tcl_DeleteTrace((Tcl_Interp *) iPtr, (Tcl_Trace) iPtr->tracePtr);
     }
+    TclDeleteExecEnvPool(iPtr);
     if (iPtr->execEnvPtr != NULL) {
 	TclDeleteExecEnv(iPtr->execEnvPtr);
     }
@@ -2095,6 +2108,15 @@ DeleteInterpProc(
 	resPtr = nextResPtr;
     }
 
+    /*
+     * Free the bytecode cache, which may hold on to procedures, before the
+     * literals their bodies use.
+     */
+
+    if (iPtr->compCachePtr) {
+	TclCompCacheDelete(iPtr);
+    }
+
     /*
      * Free up literal objects created for scripts compiled by the
      * interpreter.
@@ -4487,6 +4509,7 @@ TclNREvalObjv(
 	TclNRAddCallback(interp, NRCommand, NULL, NULL, NULL, NULL);
     }
 
+    TclLimitEnterMemory(iPtr);
     iPtr->numLevels++;
     TclNRAddCallback(interp, EvalObjvCore, cmdPtr, INT2PTR(flags),
 	    INT2PTR(objc), objv);
@@ -4731,6 +4754,9 @@ NRCommand(
     Tcl_Obj *listPtr;
 
     iPtr->numLevels--;
+    if ((iPtr->numLevels == 0) && (iPtr->limit.active & TCL_LIMIT_MEMORY)) {
+	result = TclLimitLeaveMemory(interp, result);
+    }
 
     /*
      * If there is a tailcall, schedule it next
@@ -4754,7 +4780,7 @@ NRCommand(
     if ((result == TCL_OK) && TclCanceled(iPtr)) {
 	result = Tcl_Canceled(interp, TCL_LEAVE_ERR_MSG);
     }
-    if (result == TCL_OK && TclLimitReady(iPtr->limit)) {
+    if (result == TCL_OK && TclLimitReady(iPtr)) {
 	result = Tcl_LimitCheck(interp);
     }
 
@@ -6283,6 +6309,7 @@ TclNREvalObjEx(
 	    iPtr->varFramePtr = iPtr->rootFramePtr;
 	}
 	Tcl_IncrRefCount(objPtr);
+	TclLimitEnterMemory(iPtr);
 	codePtr = TclCompileObj(interp, objPtr, invoker, word);
 
 	TclNRAddCallback(interp, TEOEx_ByteCodeCallback,
@@ -6347,6 +6374,9 @@ TEOEx_ByteCodeCallback(
     bool allowExceptions = PTR2INT(data[2]) != 0;
 
     if (iPtr->numLevels == 0) {
+	if (iPtr->limit.active & TCL_LIMIT_MEMORY) {
+	    result = TclLimitLeaveMemory(interp, result);
+	}
 	if (result == TCL_RETURN) {
 	    result = TclUpdateReturnInfo(iPtr);
 	}
@@ -9507,7 +9537,7 @@ NRCoroutineExitCallback(
     TclCleanupCommandMacro(cmdPtr);
 
     corPtr->eePtr->corPtr = NULL;
-    TclDeleteExecEnv(corPtr->eePtr);
+    TclFreeCoroutineExecEnv(corPtr->eePtr);
     corPtr->eePtr = NULL;
 
     corPtr->stackLevel = NULL;
@@ -10115,7 +10145,7 @@ TclNRCoroutineObjCmd(
      * command callbacks, then switch back.
      */
 
-    corPtr->eePtr = TclCreateExecEnv(interp, CORO_STACK_INITIAL_SIZE);
+    corPtr->eePtr = TclNewCoroutineExecEnv(interp, CORO_STACK_INITIAL_SIZE);
     corPtr->callerEEPtr = iPtr->execEnvPtr;
     corPtr->eePtr->corPtr = corPtr;
 
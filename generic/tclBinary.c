@@ -52,17 +52,62 @@ enum GetFormatSpecFlags {
 
 #define BINARY_SCAN_MAX_CACHE	260
 
+/*
+ * The format string of "binary format" and "binary scan" is parsed once into
+ * an array of fields, kept as the internal rep of the format value, so that
+ * calling the commands again with the same format does not parse it again.
+ */
+
+typedef struct {
+    char cmd;			/* Format character. */
+    unsigned char flags;	/* Format field flags. */
+    unsigned char size;		/* Number of bytes of one element of a
+				 * numeric field, 0 for other fields. */
+    unsigned char kind;		/* One of the FieldKind values below. */
+    unsigned char reverse;	/* Result of NeedReversing for integer
+				 * fields. */
+    Tcl_UniChar errorChar;	/* Character reported when the command does
+				 * not know the field: the first one of its
+				 * text, blanks included. */
+    Tcl_Size count;		/* Count of the field, BINARY_ALL or
+				 * BINARY_NOCOUNT. */
+} FormatField;
+
+enum FieldKind {
+    FIELD_OTHER,		/* Strings, positioning and bad fields. */
+    FIELD_INTEGER,		/* Integers of 1, 2, 4 or 8 bytes, packed
+				 * and unpacked by FormatInteger and
+				 * ScanInteger. */
+    FIELD_FLOAT			/* Floating point numbers. */
+};
+
+typedef struct {
+    size_t refCount;		/* Number of values and running commands
+				 * using the program. */
+    Tcl_Size numFields;		/* Number of fields in the program. */
+    FormatField fields[TCLFLEXARRAY];
+				/* The fields, in the order of the format
+				 * string. Parsing stops after a bad field. */
+} FormatProgram;
+
 /*
  * Prototypes for local procedures defined in this file:
  */
 
+static void		DupFormatProgramInternalRep(Tcl_Obj *srcPtr,
+			    Tcl_Obj *copyPtr);
 static void		DupProperByteArrayInternalRep(Tcl_Obj *srcPtr,
 			    Tcl_Obj *copyPtr);
 static int		FormatNumber(Tcl_Interp *interp, int type,
 			    Tcl_Obj *src, unsigned char **cursorPtr);
+static void		FreeFormatProgramInternalRep(Tcl_Obj *objPtr);
 static void		FreeProperByteArrayInternalRep(Tcl_Obj *objPtr);
+static FormatProgram *	GetFormatProgram(Tcl_Obj *formatPtr);
 static int		GetFormatSpec(const char **formatPtr, char *cmdPtr,
 			    Tcl_Size *countPtr, int *flagsPtr);
+static void		ReleaseFormatProgram(FormatProgram *progPtr);
+static Tcl_Obj *	ScanCachedNumber(long value,
+			    Tcl_HashTable **numberCachePtr);
 static Tcl_Obj *	ScanNumber(unsigned char *buffer, int type,
 			    int flags, Tcl_HashTable **numberCachePtr);
 static int		SetByteArrayFromAny(Tcl_Interp *interp, Tcl_Size limit,
@@ -70,6 +115,8 @@ static int		SetByteArrayFromAny(Tcl_Interp *interp, Tcl_Size limit,
 static void		UpdateStringOfByteArray(Tcl_Obj *listPtr);
 static void		DeleteScanNumberCache(Tcl_HashTable *numberCachePtr);
 static int		NeedReversing(int format);
+static int		ParseFormatField(const char **formatPtr,
+			    FormatField *fieldPtr);
 static void		CopyNumber(const void *from, void *to,
 			    size_t length, int type);
 /* Binary ensemble commands */
@@ -167,6 +214,20 @@ static const Tcl_ObjType properByteArrayType = {
     TCL_OBJTYPE_V0
 };
 
+/*
+ * The following Tcl_ObjType holds the FormatProgram of a format string. The
+ * string rep is never invalidated, so there is no UpdateStringProc.
+ */
+
+static const Tcl_ObjType formatProgramType = {
+    "binaryformat",
+    FreeFormatProgramInternalRep,
+    DupFormatProgramInternalRep,
+    NULL,			// UpdateString
+    NULL,			// SetFromAny
+    TCL_OBJTYPE_V0
+};
+
 /*
  * The following structure is the internal rep for a ByteArray object. Keeps
  * track of how much memory has been used and how much has been allocated for
@@ -785,6 +846,334 @@ TclAppendBytesToByteArray(
     TclInvalidateStringRep(objPtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParseFormatField --
+ *
+ *	Parses the next field of a format string with GetFormatSpec and works
+ *	out what the commands need to know about it.
+ *
+ * Results:
+ *	Returns 1 and fills in the field, or 0 at the end of the string.
+ *
+ * Side effects:
+ *	Moves the formatPtr to the start of the next field.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParseFormatField(
+    const char **formatPtr,	/* Pointer to format string. */
+    FormatField *fieldPtr)	/* Field to fill in. */
+{
+    const char *str = *formatPtr;
+    char cmd;
+    Tcl_Size count;
+    int flags = 0;
+
+    if (!GetFormatSpec(formatPtr, &cmd, &count, &flags)) {
+	return 0;
+    }
+    fieldPtr->cmd = cmd;
+    fieldPtr->flags = (unsigned char) flags;
+    fieldPtr->size = 0;
+    fieldPtr->kind = FIELD_OTHER;
+    fieldPtr->reverse = 0;
+    fieldPtr->errorChar = 0;
+    fieldPtr->count = count;
+    TclUtfToUniChar(str, &fieldPtr->errorChar);
+
+    switch (cmd) {
+    case 'c':
+	fieldPtr->size = 1;
+	fieldPtr->kind = FIELD_INTEGER;
+	break;
+    case 't':
+    case 's':
+    case 'S':
+	fieldPtr->size = 2;
+	fieldPtr->kind = FIELD_INTEGER;
+	break;
+    case 'n':
+    case 'i':
+    case 'I':
+	fieldPtr->size = 4;
+	fieldPtr->kind = FIELD_INTEGER;
+	break;
+    case 'm':
+    case 'w':
+    case 'W':
+	fieldPtr->size = 8;
+	fieldPtr->kind = FIELD_INTEGER;
+	break;
+    case 'r':
+    case 'R':
+    case 'f':
+	fieldPtr->size = sizeof(float);
+	fieldPtr->kind = FIELD_FLOAT;
+	break;
+    case 'q':
+    case 'Q':
+    case 'd':
+	fieldPtr->size = sizeof(double);
+	fieldPtr->kind = FIELD_FLOAT;
+	break;
+    }
+    if ((fieldPtr->kind == FIELD_INTEGER) && (fieldPtr->size > 1)) {
+	fieldPtr->reverse = (unsigned char) NeedReversing(cmd);
+    }
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetFormatProgram --
+ *
+ *	Returns the fields of the format string of "binary format" or "binary
+ *	scan", parsing it if it does not have them yet. Parsing never fails:
+ *	bad field specifiers are kept in the program and reported by the
+ *	commands when they reach them, after the fields before them have been
+ *	done.
+ *
+ * Results:
+ *	The program, with a reference the caller must give back with
+ *	ReleaseFormatProgram. Holding it keeps the program alive should the
+ *	format value lose its internal rep while the command runs, for
+ *	instance when it is also one of the arguments.
+ *
+ * Side effects:
+ *	The internal rep of formatPtr may change.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static FormatProgram *
+GetFormatProgram(
+    Tcl_Obj *formatPtr)		/* Format string value. */
+{
+    const Tcl_ObjInternalRep *irPtr;
+    FormatProgram *progPtr;
+
+    irPtr = TclFetchInternalRep(formatPtr, &formatProgramType);
+    if (irPtr != NULL) {
+	progPtr = (FormatProgram *) irPtr->twoPtrValue.ptr1;
+    } else {
+	const char *start = TclGetString(formatPtr);
+	const char *format = start;
+	FormatField field;
+	Tcl_Size i, numFields = 0;
+	Tcl_ObjInternalRep ir;
+
+	/*
+	 * Count the fields, up to the first character that no command knows,
+	 * then parse them again into the program.
+	 */
+
+	while (ParseFormatField(&format, &field)) {
+	    numFields++;
+	    if (strchr("aACbBhHctsSniImwWrRfqQdxX@", field.cmd) == NULL) {
+		break;
+	    }
+	}
+	progPtr = (FormatProgram *) Tcl_Alloc(offsetof(FormatProgram, fields)
+		+ numFields * sizeof(FormatField));
+	progPtr->refCount = 1;
+	progPtr->numFields = numFields;
+	format = start;
+	for (i = 0; i < numFields; i++) {
+	    ParseFormatField(&format, &progPtr->fields[i]);
+	}
+
+	ir.twoPtrValue.ptr1 = progPtr;
+	ir.twoPtrValue.ptr2 = NULL;
+	Tcl_StoreInternalRep(formatPtr, &formatProgramType, &ir);
+    }
+    progPtr->refCount++;
+    return progPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseFormatProgram, FreeFormatProgramInternalRep,
+ * DupFormatProgramInternalRep --
+ *
+ *	Reference counting of the FormatProgram shared by format values and
+ *	running commands.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The program is freed when its last reference is released.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ReleaseFormatProgram(
+    FormatProgram *progPtr)	/* Program to release. */
+{
+    if (progPtr->refCount-- <= 1) {
+	Tcl_Free(progPtr);
+    }
+}
+
+static void
+FreeFormatProgramInternalRep(
+    Tcl_Obj *objPtr)		/* Object with internal rep to free. */
+{
+    ReleaseFormatProgram((FormatProgram *)
+	    TclFetchInternalRep(objPtr, &formatProgramType)->twoPtrValue.ptr1);
+}
+
+static void
+DupFormatProgramInternalRep(
+    Tcl_Obj *srcPtr,		/* Object with internal rep to copy. */
+    Tcl_Obj *copyPtr)		/* Object with internal rep to set. */
+{
+    FormatProgram *progPtr = (FormatProgram *)
+	    TclFetchInternalRep(srcPtr, &formatProgramType)->twoPtrValue.ptr1;
+    Tcl_ObjInternalRep ir;
+
+    progPtr->refCount++;
+    ir.twoPtrValue.ptr1 = progPtr;
+    ir.twoPtrValue.ptr2 = NULL;
+    Tcl_StoreInternalRep(copyPtr, &formatProgramType, &ir);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FormatInteger, ScanInteger --
+ *
+ *	Pack and unpack the integer fields of a format program: the byte order
+ *	and width come from the field, with the stores and loads of each width
+ *	written out.
+ *
+ * Results:
+ *	ScanInteger returns the value, sign extended unless the field has the
+ *	BINARY_UNSIGNED flag. Unsigned 64-bit values above WIDE_MAX come back
+ *	negative; those go through ScanNumber instead.
+ *
+ * Side effects:
+ *	FormatInteger writes fieldPtr->size bytes at cursor.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline void
+FormatInteger(
+    unsigned char *cursor,	/* Where to put the bytes. */
+    Tcl_WideUInt value,		/* Bits of the value. */
+    const FormatField *fieldPtr)
+{
+    if (fieldPtr->reverse) {
+	switch (fieldPtr->size) {
+	case 8:
+	    cursor[7] = UCHAR(value >> 56);
+	    cursor[6] = UCHAR(value >> 48);
+	    cursor[5] = UCHAR(value >> 40);
+	    cursor[4] = UCHAR(value >> 32);
+	    /* FALLTHRU */
+	case 4:
+	    cursor[3] = UCHAR(value >> 24);
+	    cursor[2] = UCHAR(value >> 16);
+	    /* FALLTHRU */
+	case 2:
+	    cursor[1] = UCHAR(value >> 8);
+	    /* FALLTHRU */
+	default:
+	    cursor[0] = UCHAR(value);
+	}
+	return;
+    }
+    switch (fieldPtr->size) {
+    case 8:
+	cursor[0] = UCHAR(value >> 56);
+	cursor[1] = UCHAR(value >> 48);
+	cursor[2] = UCHAR(value >> 40);
+	cursor[3] = UCHAR(value >> 32);
+	cursor[4] = UCHAR(value >> 24);
+	cursor[5] = UCHAR(value >> 16);
+	cursor[6] = UCHAR(value >> 8);
+	cursor[7] = UCHAR(value);
+	break;
+    case 4:
+	cursor[0] = UCHAR(value >> 24);
+	cursor[1] = UCHAR(value >> 16);
+	cursor[2] = UCHAR(value >> 8);
+	cursor[3] = UCHAR(value);
+	break;
+    case 2:
+	cursor[0] = UCHAR(value >> 8);
+	cursor[1] = UCHAR(value);
+	break;
+    default:
+	cursor[0] = UCHAR(value);
+    }
+}
+
+static inline Tcl_WideInt
+ScanInteger(
+    const unsigned char *buffer,	/* Where to take the bytes from. */
+    const FormatField *fieldPtr)
+{
+    Tcl_WideUInt value = 0, signBit;
+
+    if (fieldPtr->reverse) {
+	switch (fieldPtr->size) {
+	case 8:
+	    value = ((Tcl_WideUInt) buffer[7] << 56)
+		    | ((Tcl_WideUInt) buffer[6] << 48)
+		    | ((Tcl_WideUInt) buffer[5] << 40)
+		    | ((Tcl_WideUInt) buffer[4] << 32);
+	    /* FALLTHRU */
+	case 4:
+	    value |= ((Tcl_WideUInt) buffer[3] << 24)
+		    | ((Tcl_WideUInt) buffer[2] << 16);
+	    /* FALLTHRU */
+	case 2:
+	    value |= (Tcl_WideUInt) buffer[1] << 8;
+	    /* FALLTHRU */
+	default:
+	    value |= buffer[0];
+	}
+    } else {
+	switch (fieldPtr->size) {
+	case 8:
+	    value = ((Tcl_WideUInt) buffer[0] << 56)
+		    | ((Tcl_WideUInt) buffer[1] << 48)
+		    | ((Tcl_WideUInt) buffer[2] << 40)
+		    | ((Tcl_WideUInt) buffer[3] << 32)
+		    | ((Tcl_WideUInt) buffer[4] << 24)
+		    | ((Tcl_WideUInt) buffer[5] << 16)
+		    | ((Tcl_WideUInt) buffer[6] << 8)
+		    | buffer[7];
+	    break;
+	case 4:
+	    value = ((Tcl_WideUInt) buffer[0] << 24)
+		    | ((Tcl_WideUInt) buffer[1] << 16)
+		    | ((Tcl_WideUInt) buffer[2] << 8)
+		    | buffer[3];
+	    break;
+	case 2:
+	    value = ((Tcl_WideUInt) buffer[0] << 8) | buffer[1];
+	    break;
+	default:
+	    value = buffer[0];
+	}
+    }
+    if ((fieldPtr->size < 8) && !(fieldPtr->flags & BINARY_UNSIGNED)) {
+	signBit = (Tcl_WideUInt) 1 << (8 * fieldPtr->size - 1);
+	value = (value ^ signBit) - signBit;
+    }
+    return (Tcl_WideInt) value;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -814,9 +1203,9 @@ BinaryFormatCmd(
     char cmd;			/* Current format character. */
     Tcl_Size count;		/* Count associated with current format
 				 * character. */
-    int flags;			/* Format field flags */
-    const char *format;		/* Pointer to current position in format
-				 * string. */
+    FormatProgram *progPtr;	/* Fields of the format string. */
+    const FormatField *fieldPtr;/* Current field. */
+    const FormatField *lastPtr;	/* End of the fields. */
     Tcl_Obj *resultPtr = NULL;	/* Object holding result buffer. */
     unsigned char *buffer;	/* Start of result buffer. */
     unsigned char *cursor;	/* Current position within result buffer. */
@@ -825,6 +1214,7 @@ BinaryFormatCmd(
     const char *errorString;
     const char *errorValue, *str;
     Tcl_Size offset, size, length;
+    int result = TCL_ERROR;
 
     if (objc < 2) {
 	Tcl_WrongNumArgs(interp, 1, objv, "formatString ?arg ...?");
@@ -837,16 +1227,14 @@ BinaryFormatCmd(
      * places the formatted data into the buffer.
      */
 
-    format = TclGetString(objv[1]);
+    progPtr = GetFormatProgram(objv[1]);
+    lastPtr = progPtr->fields + progPtr->numFields;
     arg = 2;
     offset = 0;
     length = 0;
-    while (*format != '\0') {
-	str = format;
-	flags = 0;
-	if (!GetFormatSpec(&format, &cmd, &count, &flags)) {
-	    break;
-	}
+    for (fieldPtr = progPtr->fields; fieldPtr < lastPtr; fieldPtr++) {
+	cmd = fieldPtr->cmd;
+	count = fieldPtr->count;
 	switch (cmd) {
 	case 'a':
 	case 'A':
@@ -879,34 +1267,22 @@ BinaryFormatCmd(
 	    }
 	    break;
 	case 'c':
-	    size = 1;
-	    goto doNumbers;
 	case 't':
 	case 's':
 	case 'S':
-	    size = 2;
-	    goto doNumbers;
 	case 'n':
 	case 'i':
 	case 'I':
-	    size = 4;
-	    goto doNumbers;
 	case 'm':
 	case 'w':
 	case 'W':
-	    size = 8;
-	    goto doNumbers;
 	case 'r':
 	case 'R':
 	case 'f':
-	    size = sizeof(float);
-	    goto doNumbers;
 	case 'q':
 	case 'Q':
 	case 'd':
-	    size = sizeof(double);
-
-	doNumbers:
+	    size = fieldPtr->size;
 	    if (arg >= objc) {
 		goto badIndex;
 	    }
@@ -930,7 +1306,7 @@ BinaryFormatCmd(
 		 */
 
 		if (TclListObjLength(interp, objv[arg], &listc) != TCL_OK) {
-		    return TCL_ERROR;
+		    goto cleanup;
 		}
 
 		if (count == BINARY_ALL) {
@@ -939,11 +1315,11 @@ BinaryFormatCmd(
 		    Tcl_SetObjResult(interp, Tcl_NewStringObj(
 			    "number of elements in list does not match count",
 			    -1));
-		    return TCL_ERROR;
+		    goto cleanup;
 		}
 		if (TclListObjGetElements(interp, objv[arg], &listc,
 			&listv) != TCL_OK) {
-		    return TCL_ERROR;
+		    goto cleanup;
 		}
 		arg++;
 	    }
@@ -954,7 +1330,7 @@ BinaryFormatCmd(
 	    if (count == BINARY_ALL) {
 		Tcl_SetObjResult(interp, Tcl_NewStringObj(
 			"cannot use \"*\" in format string with \"x\"", -1));
-		return TCL_ERROR;
+		goto cleanup;
 	    } else if (count == BINARY_NOCOUNT) {
 		count = 1;
 	    }
@@ -985,7 +1361,6 @@ BinaryFormatCmd(
 	    }
 	    break;
 	default:
-	    errorString = str;
 	    goto badField;
 	}
     }
@@ -993,7 +1368,8 @@ BinaryFormatCmd(
 	length = offset;
     }
     if (length == 0) {
-	return TCL_OK;
+	result = TCL_OK;
+	goto cleanup;
     }
 
     /*
@@ -1007,21 +1383,18 @@ BinaryFormatCmd(
 
     /*
      * Pack the data into the result object. Note that we can skip the error
-     * checking during this pass, since we have already parsed the string
-     * once.
+     * checking during this pass, since we have already been through the
+     * fields once.
      */
 
     arg = 2;
-    format = TclGetString(objv[1]);
     cursor = buffer;
     maxPos = cursor;
-    while (*format != 0) {
-	flags = 0;
-	if (!GetFormatSpec(&format, &cmd, &count, &flags)) {
-	    break;
-	}
+    for (fieldPtr = progPtr->fields; fieldPtr < lastPtr; fieldPtr++) {
+	cmd = fieldPtr->cmd;
+	count = fieldPtr->count;
 	if ((count == 0) && (cmd != '@')) {
-	    if (cmd != 'x') {
+	    if ((cmd != 'x') && (cmd != 'X')) {
 		arg++;
 	    }
 	    continue;
@@ -1222,10 +1595,24 @@ BinaryFormatCmd(
 		}
 	    }
 	    arg++;
+	    if (fieldPtr->kind == FIELD_INTEGER) {
+		for (i = 0; i < count; i++) {
+		    Tcl_WideInt wvalue;
+
+		    if (TclGetWideBitsFromObj(interp, listv[i],
+			    &wvalue) != TCL_OK) {
+			Tcl_DecrRefCount(resultPtr);
+			goto cleanup;
+		    }
+		    FormatInteger(cursor, (Tcl_WideUInt) wvalue, fieldPtr);
+		    cursor += fieldPtr->size;
+		}
+		break;
+	    }
 	    for (i = 0; i < count; i++) {
 		if (FormatNumber(interp, cmd, listv[i], &cursor) != TCL_OK) {
 		    Tcl_DecrRefCount(resultPtr);
-		    return TCL_ERROR;
+		    goto cleanup;
 		}
 	    }
 	    break;
@@ -1263,14 +1650,15 @@ BinaryFormatCmd(
 	}
     }
     Tcl_SetObjResult(interp, resultPtr);
-    return TCL_OK;
+    result = TCL_OK;
+    goto cleanup;
 
   badValue:
     Tcl_ResetResult(interp);
     Tcl_SetObjResult(interp, Tcl_ObjPrintf(
 	    "expected %s string but got \"%s\" instead",
 	    errorString, errorValue));
-    return TCL_ERROR;
+    goto cleanup;
 
   badCount:
     errorString = "missing count for \"@\" field specifier";
@@ -1282,19 +1670,20 @@ BinaryFormatCmd(
 
   badField:
     {
-	Tcl_UniChar ch = 0;
 	char buf[5] = "";
 
-	TclUtfToUniChar(errorString, &ch);
-	buf[Tcl_UniCharToUtf(ch, buf)] = '\0';
+	buf[Tcl_UniCharToUtf(fieldPtr->errorChar, buf)] = '\0';
 	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
 		"bad field specifier \"%s\"", buf));
-	return TCL_ERROR;
+	goto cleanup;
     }
 
   error:
     Tcl_SetObjResult(interp, Tcl_NewStringObj(errorString, -1));
-    return TCL_ERROR;
+
+  cleanup:
+    ReleaseFormatProgram(progPtr);
+    return result;
 }
 
 /*
@@ -1327,38 +1716,44 @@ BinaryScanCmd(
     Tcl_Size count;		/* Count associated with current format
 				 * character. */
     int flags;			/* Format field flags */
-    const char *format;		/* Pointer to current position in format
-				 * string. */
+    FormatProgram *progPtr;	/* Fields of the format string. */
+    const FormatField *fieldPtr;/* Current field. */
+    const FormatField *lastPtr;	/* End of the fields. */
     Tcl_Obj *resultPtr = NULL;	/* Object holding result buffer. */
     unsigned char *buffer;	/* Start of result buffer. */
     const char *errorString;
-    const char *str;
     Tcl_Size offset, size, length = 0, i;
+    int result = TCL_ERROR;
 
     Tcl_Obj *valuePtr, *elementPtr;
     Tcl_HashTable numberCacheHash;
-    Tcl_HashTable *numberCachePtr;
+    Tcl_HashTable *numberCachePtr = NULL;
+    int numberCacheMade = 0;	/* The cache is only made for the first
+				 * list of small integers. */
 
     if (objc < 3) {
 	Tcl_WrongNumArgs(interp, 1, objv,
 		"value formatString ?varName ...?");
 	return TCL_ERROR;
     }
+
+    /*
+     * Get the program before the bytes, which must be those of the final
+     * internal rep should the value and the format be the same object.
+     */
+
+    progPtr = GetFormatProgram(objv[2]);
     buffer = Tcl_GetBytesFromObj(interp, objv[1], &length);
     if (buffer == NULL) {
-	return TCL_ERROR;
+	goto cleanup;
     }
-    numberCachePtr = &numberCacheHash;
-    Tcl_InitHashTable(numberCachePtr, TCL_ONE_WORD_KEYS);
-    format = TclGetString(objv[2]);
+    lastPtr = progPtr->fields + progPtr->numFields;
     arg = 3;
     offset = 0;
-    while (*format != '\0') {
-	str = format;
-	flags = 0;
-	if (!GetFormatSpec(&format, &cmd, &count, &flags)) {
-	    goto done;
-	}
+    for (fieldPtr = progPtr->fields; fieldPtr < lastPtr; fieldPtr++) {
+	cmd = fieldPtr->cmd;
+	count = fieldPtr->count;
+	flags = fieldPtr->flags;
 	switch (cmd) {
 	case 'a':
 	case 'A':
@@ -1366,7 +1761,6 @@ BinaryScanCmd(
 	    unsigned char *src;
 
 	    if (arg >= objc) {
-		DeleteScanNumberCache(numberCachePtr);
 		goto badIndex;
 	    }
 	    if (count == BINARY_ALL) {
@@ -1421,8 +1815,7 @@ BinaryScanCmd(
 		    TCL_LEAVE_ERR_MSG);
 	    arg++;
 	    if (resultPtr == NULL) {
-		DeleteScanNumberCache(numberCachePtr);
-		return TCL_ERROR;
+		goto cleanup;
 	    }
 	    offset += count;
 	    break;
@@ -1433,7 +1826,6 @@ BinaryScanCmd(
 	    char *dest;
 
 	    if (arg >= objc) {
-		DeleteScanNumberCache(numberCachePtr);
 		goto badIndex;
 	    }
 	    if (count == BINARY_ALL) {
@@ -1475,8 +1867,7 @@ BinaryScanCmd(
 		    TCL_LEAVE_ERR_MSG);
 	    arg++;
 	    if (resultPtr == NULL) {
-		DeleteScanNumberCache(numberCachePtr);
-		return TCL_ERROR;
+		goto cleanup;
 	    }
 	    offset += (count + 7) / 8;
 	    break;
@@ -1488,7 +1879,6 @@ BinaryScanCmd(
 	    static const char hexdigit[] = "0123456789abcdef";
 
 	    if (arg >= objc) {
-		DeleteScanNumberCache(numberCachePtr);
 		goto badIndex;
 	    }
 	    if (count == BINARY_ALL) {
@@ -1530,54 +1920,56 @@ BinaryScanCmd(
 		    TCL_LEAVE_ERR_MSG);
 	    arg++;
 	    if (resultPtr == NULL) {
-		DeleteScanNumberCache(numberCachePtr);
-		return TCL_ERROR;
+		goto cleanup;
 	    }
 	    offset += (count + 1) / 2;
 	    break;
 	}
 	case 'c':
-	    size = 1;
-	    goto scanNumber;
 	case 't':
 	case 's':
 	case 'S':
-	    size = 2;
-	    goto scanNumber;
 	case 'n':
 	case 'i':
 	case 'I':
-	    size = 4;
-	    goto scanNumber;
 	case 'm':
 	case 'w':
 	case 'W':
-	    size = 8;
-	    goto scanNumber;
 	case 'r':
 	case 'R':
 	case 'f':
-	    size = sizeof(float);
-	    goto scanNumber;
 	case 'q':
 	case 'Q':
 	case 'd': {
 	    unsigned char *src;
+	    int isInteger, isCached;
 
-	    size = sizeof(double);
-	    /* fall through */
+	    /*
+	     * Integers are unpacked by ScanInteger, except unsigned 64-bit
+	     * ones that may need a bignum. Those of 1 and 2 bytes and signed
+	     * ones of 4 bytes in lists go through the number cache.
+	     */
+
+	    size = fieldPtr->size;
+	    isInteger = (fieldPtr->kind == FIELD_INTEGER)
+		    && ((size < 8) || !(flags & BINARY_UNSIGNED));
+	    isCached = isInteger && ((size < 4)
+		    || ((size == 4) && !(flags & BINARY_UNSIGNED)));
 
-	scanNumber:
 	    if (arg >= objc) {
-		DeleteScanNumberCache(numberCachePtr);
 		goto badIndex;
 	    }
 	    if (count == BINARY_NOCOUNT) {
 		if (length < (size + offset)) {
 		    goto done;
 		}
-		valuePtr = ScanNumber(buffer+offset, cmd, flags,
-			&numberCachePtr);
+		if (isInteger) {
+		    TclNewIntObj(valuePtr, ScanInteger(buffer + offset,
+			    fieldPtr));
+		} else {
+		    valuePtr = ScanNumber(buffer+offset, cmd, flags,
+			    &numberCachePtr);
+		}
 		offset += size;
 	    } else {
 		if (count == BINARY_ALL) {
@@ -1586,12 +1978,44 @@ BinaryScanCmd(
 		if ((length - offset) < (count * size)) {
 		    goto done;
 		}
-		TclNewObj(valuePtr);
+		if (isCached && !numberCacheMade) {
+		    numberCacheMade = 1;
+		    numberCachePtr = &numberCacheHash;
+		    Tcl_InitHashTable(numberCachePtr, TCL_ONE_WORD_KEYS);
+		}
 		src = buffer + offset;
-		for (i = 0; i < count; i++) {
-		    elementPtr = ScanNumber(src, cmd, flags, &numberCachePtr);
-		    src += size;
-		    Tcl_ListObjAppendElement(NULL, valuePtr, elementPtr);
+		if (count == 0) {
+		    TclNewObj(valuePtr);
+		} else {
+		    ListRep listRep;
+		    Tcl_Obj **elemPtrs;
+
+		    valuePtr = Tcl_NewListObj(count, NULL);
+		    ListObjGetRep(valuePtr, &listRep);
+		    elemPtrs = ListRepElementsBase(&listRep);
+		    for (i = 0; i < count; i++) {
+			if (isCached) {
+			    elementPtr = ScanCachedNumber(
+				    (long) ScanInteger(src, fieldPtr),
+				    &numberCachePtr);
+			} else if (isInteger) {
+			    TclNewIntObj(elementPtr,
+				    ScanInteger(src, fieldPtr));
+			} else {
+			    elementPtr = ScanNumber(src, cmd, flags,
+				    &numberCachePtr);
+			}
+			src += size;
+			elemPtrs[i] = elementPtr;
+			Tcl_IncrRefCount(elementPtr);
+		    }
+		    listRep.storePtr->numUsed = count;
+		    if (listRep.spanPtr) {
+			listRep.spanPtr->spanStart =
+				listRep.storePtr->firstUsed;
+			listRep.spanPtr->spanLength =
+				listRep.storePtr->numUsed;
+		    }
 		}
 		offset += count * size;
 	    }
@@ -1600,8 +2024,7 @@ BinaryScanCmd(
 		    TCL_LEAVE_ERR_MSG);
 	    arg++;
 	    if (resultPtr == NULL) {
-		DeleteScanNumberCache(numberCachePtr);
-		return TCL_ERROR;
+		goto cleanup;
 	    }
 	    break;
 	}
@@ -1627,7 +2050,6 @@ BinaryScanCmd(
 	    break;
 	case '@':
 	    if (count == BINARY_NOCOUNT) {
-		DeleteScanNumberCache(numberCachePtr);
 		goto badCount;
 	    }
 	    if ((count == BINARY_ALL) || (count > length)) {
@@ -1637,8 +2059,6 @@ BinaryScanCmd(
 	    }
 	    break;
 	default:
-	    DeleteScanNumberCache(numberCachePtr);
-	    errorString = str;
 	    goto badField;
 	}
     }
@@ -1649,9 +2069,8 @@ BinaryScanCmd(
 
   done:
     Tcl_SetObjResult(interp, Tcl_NewWideIntObj(arg - 3));
-    DeleteScanNumberCache(numberCachePtr);
-
-    return TCL_OK;
+    result = TCL_OK;
+    goto cleanup;
 
   badCount:
     errorString = "missing count for \"@\" field specifier";
@@ -1663,19 +2082,21 @@ BinaryScanCmd(
 
   badField:
     {
-	Tcl_UniChar ch = 0;
 	char buf[5] = "";
 
-	TclUtfToUniChar(errorString, &ch);
-	buf[Tcl_UniCharToUtf(ch, buf)] = '\0';
+	buf[Tcl_UniCharToUtf(fieldPtr->errorChar, buf)] = '\0';
 	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
 		"bad field specifier \"%s\"", buf));
-	return TCL_ERROR;
+	goto cleanup;
     }
 
   error:
     Tcl_SetObjResult(interp, Tcl_NewStringObj(errorString, -1));
-    return TCL_ERROR;
+
+  cleanup:
+    DeleteScanNumberCache(numberCachePtr);
+    ReleaseFormatProgram(progPtr);
+    return result;
 }
 
 /*
@@ -2220,39 +2641,7 @@ ScanNumber(
 	}
 
     returnNumericObject:
-	if (*numberCachePtrPtr == NULL) {
-	    return Tcl_NewWideIntObj(value);
-	} else {
-	    Tcl_HashTable *tablePtr = *numberCachePtrPtr;
-	    Tcl_HashEntry *hPtr;
-	    int isNew;
-
-	    hPtr = Tcl_CreateHashEntry(tablePtr, INT2PTR(value), &isNew);
-	    if (!isNew) {
-		return (Tcl_Obj *)Tcl_GetHashValue(hPtr);
-	    }
-	    if (tablePtr->numEntries <= BINARY_SCAN_MAX_CACHE) {
-		Tcl_Obj *objPtr;
-
-		TclNewIntObj(objPtr, value);
-		Tcl_IncrRefCount(objPtr);
-		Tcl_SetHashValue(hPtr, objPtr);
-		return objPtr;
-	    }
-
-	    /*
-	     * We've overflowed the cache! Someone's parsing a LOT of varied
-	     * binary data in a single call! Bail out by switching back to the
-	     * old behaviour for the rest of the scan.
-	     *
-	     * Note that anyone just using the 'c' conversion (for bytes)
-	     * cannot trigger this.
-	     */
-
-	    DeleteScanNumberCache(tablePtr);
-	    *numberCachePtrPtr = NULL;
-	    return Tcl_NewWideIntObj(value);
-	}
+	return ScanCachedNumber(value, numberCachePtrPtr);
 
 	/*
 	 * Do not cache wide (64-bit) values; they are already too large to
@@ -2321,6 +2710,67 @@ ScanNumber(
     return NULL;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ScanCachedNumber --
+ *
+ *	Returns the object for an integer scanned by "binary scan", sharing
+ *	one object between equal values through the number cache.
+ *
+ * Results:
+ *	The object, with a ref count of zero unless it is in the cache.
+ *
+ * Side effects:
+ *	Might place a new object in the cache, or delete the cache and set the
+ *	reference to it to NULL.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+ScanCachedNumber(
+    long value,			/* Value of the number. */
+    Tcl_HashTable **numberCachePtrPtr)
+				/* Place to look for cache of scanned value
+				 * objects, or NULL if too many different
+				 * numbers have been scanned. */
+{
+    Tcl_HashTable *tablePtr = *numberCachePtrPtr;
+    Tcl_HashEntry *hPtr;
+    int isNew;
+
+    if (tablePtr == NULL) {
+	return Tcl_NewWideIntObj(value);
+    }
+
+    hPtr = Tcl_CreateHashEntry(tablePtr, INT2PTR(value), &isNew);
+    if (!isNew) {
+	return (Tcl_Obj *)Tcl_GetHashValue(hPtr);
+    }
+    if (tablePtr->numEntries <= BINARY_SCAN_MAX_CACHE) {
+	Tcl_Obj *objPtr;
+
+	TclNewIntObj(objPtr, value);
+	Tcl_IncrRefCount(objPtr);
+	Tcl_SetHashValue(hPtr, objPtr);
+	return objPtr;
+    }
+
+    /*
+     * We've overflowed the cache! Someone's parsing a LOT of varied binary
+     * data in a single call! Bail out by switching back to the old behaviour
+     * for the rest of the scan.
+     *
+     * Note that anyone just using the 'c' conversion (for bytes) cannot
+     * trigger this.
+     */
+
+    DeleteScanNumberCache(tablePtr);
+    *numberCachePtrPtr = NULL;
+    return Tcl_NewWideIntObj(value);
+}
+
 /*
  *----------------------------------------------------------------------
  *
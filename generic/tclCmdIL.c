@@ -24,8 +24,9 @@
 
 /*
  * During execution of the "lsort" command, structures of the following type
- * are used to arrange the objects being sorted into a collection of linked
- * lists.
+ * are used to hold the objects being sorted, together with the key each one
+ * is sorted by. They are kept in a contiguous array, which is sorted in place
+ * with the help of a second array of the same size.
  */
 
 typedef struct SortElement {
@@ -39,10 +40,42 @@ typedef struct SortElement {
 	Tcl_Obj *objPtr;
 	size_t index;
     } payload;
-    struct SortElement *nextPtr;/* Next element in the list, or NULL for end
-				 * of list. */
 } SortElement;
 
+/*
+ * Runs of this many elements are put in order by insertion sort before the
+ * merge passes start, and lists with at least RADIX_THRESHOLD elements are
+ * sorted by radix sort when sorting by -integer or -real.
+ */
+
+#define SORT_RUN_LENGTH 8
+#define RADIX_THRESHOLD 64
+
+/*
+ * With -threads, each thread of the task pool merge sorts at least
+ * PARALLEL_SORT_MIN elements; shorter lists are sorted by the calling thread
+ * alone.
+ */
+
+#define PARALLEL_SORT_MIN 16384
+#define MAX_SORT_THREADS 256
+
+/*
+ * A part of a parallel sort, run as a task of the task pool: either sorting
+ * the elements from lo to hi, or merging the sorted runs from lo to mid and
+ * from mid to hi of srcPtr into dstPtr.
+ */
+
+typedef struct SortInfo SortInfo;
+
+typedef struct {
+    SortElement *srcPtr;	/* Elements to sort or merge. */
+    SortElement *dstPtr;	/* Where to put them. */
+    Tcl_Size lo, mid, hi;	/* Bounds of the runs. */
+    SortInfo *infoPtr;		/* Information needed by the comparison
+				 * operator. */
+} SortTask;
+
 /*
  * These function pointer types are used with the "lsearch" and "lsort"
  * commands to facilitate the "-nocase" option.
@@ -58,7 +91,7 @@ typedef int (*SortMemCmpFn_t) (const void *, const void *, Tcl_Size);
  * The following structure is used to pass this information.
  */
 
-typedef struct {
+struct SortInfo {
     int isIncreasing;		/* Nonzero means sort in increasing order. */
     int sortMode;		/* The sort mode. One of SORTMODE_* values
 				 * defined below. */
@@ -81,7 +114,7 @@ typedef struct {
     int resultCode;		/* Completion code for the lsort command. If
 				 * an error occurs during the sort this is
 				 * changed from TCL_OK to TCL_ERROR. */
-} SortInfo;
+};
 
 /*
  * The "sortMode" field of the SortInfo structure can take on any of the
@@ -137,10 +170,22 @@ static Tcl_ObjCmdProc2	InfoScriptCmd;
 static Tcl_ObjCmdProc2	InfoSharedlibCmd;
 static Tcl_ObjCmdProc2	InfoCmdTypeCmd;
 static Tcl_ObjCmdProc2	InfoTclVersionCmd;
-static SortElement *	MergeLists(SortElement *leftPtr, SortElement *rightPtr,
+static void		MergeRuns(SortElement *srcPtr, SortElement *dstPtr,
+			    Tcl_Size lo, Tcl_Size mid, Tcl_Size hi,
+			    SortInfo *infoPtr);
+static Tcl_TaskProc	MergeRunsTask;
+static SortElement *	MergeSort(SortElement *elementArray,
+			    SortElement *spareArray, Tcl_Size length,
+			    SortInfo *infoPtr);
+static SortElement *	ParallelMergeSort(SortElement *elementArray,
+			    SortElement *spareArray, Tcl_Size length,
+			    int threads, SortInfo *infoPtr);
+static SortElement *	RadixSort(SortElement *elementArray,
+			    SortElement *spareArray, Tcl_Size length,
 			    SortInfo *infoPtr);
 static int		SortCompare(SortElement *firstPtr, SortElement *second,
 			    SortInfo *infoPtr);
+static Tcl_TaskProc	SortRunTask;
 static Tcl_Obj *	SelectObjFromSublist(Tcl_Obj *firstPtr,
 			    SortInfo *infoPtr);
 
@@ -4349,7 +4394,7 @@ Tcl_LsortObjCmd(
 {
     int indices, nocase = 0;
     int sortMode = SORTMODE_ASCII;
-    int group, allocatedIndexVector = 0;
+    int group, allocatedIndexVector = 0, threads = 1;
     Tcl_Size j, idx, groupOffset, length, indexc;
     Tcl_WideInt wide, groupSize;
     Tcl_Obj *resultPtr, *cmdPtr, **listObjPtrs, *listObj, *indexPtr;
@@ -4358,21 +4403,15 @@ Tcl_LsortObjCmd(
     SortInfo sortInfo;		/* Information about this sort that needs to
 				 * be passed to the comparison function. */
 #   define MAXCALLOC 1024000
-#   define NUM_LISTS 30
-    SortElement *subList[NUM_LISTS+1];
-				/* This array holds pointers to temporary
-				 * lists built during the merge sort. Element
-				 * i of the array holds a list of length
-				 * 2**i. */
     static const char *const switches[] = {
 	"-ascii", "-command", "-decreasing", "-dictionary", "-increasing",
 	"-index", "-indices", "-integer", "-nocase", "-real", "-stride",
-	"-unique", NULL
+	"-threads", "-unique", NULL
     };
     enum Lsort_Switches {
 	LSORT_ASCII, LSORT_COMMAND, LSORT_DECREASING, LSORT_DICTIONARY,
 	LSORT_INCREASING, LSORT_INDEX, LSORT_INDICES, LSORT_INTEGER,
-	LSORT_NOCASE, LSORT_REAL, LSORT_STRIDE, LSORT_UNIQUE
+	LSORT_NOCASE, LSORT_REAL, LSORT_STRIDE, LSORT_THREADS, LSORT_UNIQUE
     } index;
 
     if (objc < 2) {
@@ -4518,6 +4557,31 @@ Tcl_LsortObjCmd(
 	    group = 1;
 	    i++;
 	    break;
+	case LSORT_THREADS:
+	    if (i == objc-2) {
+		Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			"\"-threads\" option must be followed by thread count",
+			-1));
+		Tcl_SetErrorCode(interp, "TCL", "ARGUMENT", "MISSING", (char *)NULL);
+		sortInfo.resultCode = TCL_ERROR;
+		goto done;
+	    }
+	    if (TclGetIntFromObj(interp, objv[i+1], &threads) != TCL_OK) {
+		sortInfo.resultCode = TCL_ERROR;
+		goto done;
+	    }
+	    if (threads < 0 || threads > MAX_SORT_THREADS) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"number of threads must be 0 to %d", MAX_SORT_THREADS));
+		Tcl_SetErrorCode(interp, "TCL", "VALUE", "THREADS", (char *)NULL);
+		sortInfo.resultCode = TCL_ERROR;
+		goto done;
+	    }
+	    if (threads == 0) {
+		threads = Tcl_GetTaskPoolSize();
+	    }
+	    i++;
+	    break;
 	default:
 	    TCL_UNREACHABLE();
 	}
@@ -4671,21 +4735,12 @@ Tcl_LsortObjCmd(
     }
 
     /*
-     * Initialize the sublists. After the following loop, subList[i] will
-     * contain a sorted sublist of length 2**i. Use one extra subList at the
-     * end, always at NULL, to indicate the end of the lists.
-     */
-
-    for (j=0 ; j<=NUM_LISTS ; j++) {
-	subList[j] = NULL;
-    }
-
-    /*
-     * The following loop creates a SortElement for each list element and
-     * begins sorting it into the sublists as it appears.
+     * The following loop creates a SortElement for each list element. The
+     * array gets room for twice that many, as the sort needs a second array
+     * to move the elements into.
      */
 
-    elmArrSize = length * sizeof(SortElement);
+    elmArrSize = 2 * length * sizeof(SortElement);
     if (elmArrSize <= MAXCALLOC) {
 	elementArray = (SortElement *)Tcl_Alloc(elmArrSize);
     } else {
@@ -4749,31 +4804,47 @@ Tcl_LsortObjCmd(
 	} else {
 	    elementArray[i].payload.objPtr = listObjPtrs[idx];
 	}
+    }
 
-	/*
-	 * Merge this element in the preexisting sublists (and merge together
-	 * sublists when we have two of the same size).
-	 */
+    /*
+     * Sort the elements. Numeric keys of large lists are sorted by their
+     * bits, which needs no comparisons at all; everything else is merge
+     * sorted. With -threads, long lists are merge sorted on the task pool,
+     * unless comparing them runs a command in the interpreter. The keys
+     * were all fetched above, so comparing them touches no Tcl_Obj.
+     */
 
-	elementArray[i].nextPtr = NULL;
-	elementPtr = &elementArray[i];
-	for (j=0 ; subList[j] ; j++) {
-	    elementPtr = MergeLists(subList[j], elementPtr, &sortInfo);
-	    subList[j] = NULL;
-	}
-	if (j >= NUM_LISTS) {
-	    j = NUM_LISTS-1;
+    if ((sortMode == SORTMODE_INTEGER || sortMode == SORTMODE_REAL)
+	    && length >= RADIX_THRESHOLD) {
+	elementPtr = RadixSort(elementArray, elementArray + length, length,
+		&sortInfo);
+    } else if (threads > 1 && sortMode != SORTMODE_COMMAND
+	    && length >= 2 * PARALLEL_SORT_MIN) {
+	if (threads > length / PARALLEL_SORT_MIN) {
+	    threads = (int) (length / PARALLEL_SORT_MIN);
 	}
-	subList[j] = elementPtr;
+	elementPtr = ParallelMergeSort(elementArray, elementArray + length,
+		length, threads, &sortInfo);
+    } else {
+	elementPtr = MergeSort(elementArray, elementArray + length, length,
+		&sortInfo);
     }
 
     /*
-     * Merge all sublists
+     * Elements that compare equal are now next to each other, in their
+     * original order. For -unique, keep only the last of each such run.
      */
 
-    elementPtr = subList[0];
-    for (j=1 ; j<NUM_LISTS ; j++) {
-	elementPtr = MergeLists(subList[j], elementPtr, &sortInfo);
+    if (sortInfo.unique && sortInfo.resultCode == TCL_OK) {
+	Tcl_Size k = 0;
+
+	for (i = 0; i < length - 1; i++) {
+	    if (SortCompare(&elementPtr[i], &elementPtr[i+1], &sortInfo)) {
+		elementPtr[k++] = elementPtr[i];
+	    }
+	}
+	elementPtr[k++] = elementPtr[length - 1];
+	sortInfo.numElements = k;
     }
 
     /*
@@ -4788,7 +4859,9 @@ Tcl_LsortObjCmd(
 	ListObjGetRep(resultPtr, &listRep);
 	newArray = ListRepElementsBase(&listRep);
 	if (group) {
-	    for (i=0; elementPtr!=NULL ; elementPtr=elementPtr->nextPtr) {
+	    SortElement *endPtr = elementPtr + sortInfo.numElements;
+
+	    for (i=0; elementPtr < endPtr ; elementPtr++) {
 		idx = elementPtr->payload.index;
 		for (j = 0; j < groupSize; j++) {
 		    if (indices) {
@@ -4803,15 +4876,15 @@ Tcl_LsortObjCmd(
 		}
 	    }
 	} else if (indices) {
-	    for (i=0; elementPtr != NULL ; elementPtr = elementPtr->nextPtr) {
-		TclNewIndexObj(objPtr, elementPtr->payload.index);
-		newArray[i++] = objPtr;
+	    for (i=0; i < sortInfo.numElements ; i++) {
+		TclNewIndexObj(objPtr, elementPtr[i].payload.index);
+		newArray[i] = objPtr;
 		Tcl_IncrRefCount(objPtr);
 	    }
 	} else {
-	    for (i=0; elementPtr != NULL ; elementPtr = elementPtr->nextPtr) {
-		objPtr = elementPtr->payload.objPtr;
-		newArray[i++] = objPtr;
+	    for (i=0; i < sortInfo.numElements ; i++) {
+		objPtr = elementPtr[i].payload.objPtr;
+		newArray[i] = objPtr;
 		Tcl_IncrRefCount(objPtr);
 	    }
 	}
@@ -4954,101 +5027,333 @@ Tcl_LeditObjCmd(
 /*
  *----------------------------------------------------------------------
  *
- * MergeLists -
+ * MergeRuns --
  *
- *	This procedure combines two sorted lists of SortElement structures
- *	into a single sorted list.
+ *	This procedure merges two adjacent sorted runs of SortElements, from
+ *	lo to mid and from mid to hi, from one array into the same positions
+ *	of another. Runs that are already in order are copied without
+ *	merging.
  *
  * Results:
- *	The unified list of SortElement structures.
+ *	None.
  *
  * Side effects:
- *	If infoPtr->unique is set then infoPtr->numElements may be updated.
- *	Possibly others, if a user-defined comparison command does something
- *	weird.
- *
- * Note:
- *	If infoPtr->unique is set, the merge assumes that there are no
- *	"repeated" elements in each of the left and right lists. In that case,
- *	if any element of the left list is equivalent to one in the right list
- *	it is omitted from the merged list.
- *
- *	This simplified mechanism works because of the special way our
- *	MergeSort creates the sublists to be merged and will fail to eliminate
- *	all repeats in the general case where they are already present in
- *	either the left or right list. A general code would need to skip
- *	adjacent initial repeats in the left and right lists before comparing
- *	their initial elements, at each step.
+ *	The elements from lo to hi of dstPtr are overwritten. Possibly others,
+ *	if a user-defined comparison command does something weird.
  *
  *----------------------------------------------------------------------
  */
 
-static SortElement *
-MergeLists(
-    SortElement *leftPtr,	/* First list to be merged; may be NULL. */
-    SortElement *rightPtr,	/* Second list to be merged; may be NULL. */
+static void
+MergeRuns(
+    SortElement *srcPtr,	/* Array holding the runs. */
+    SortElement *dstPtr,	/* Array to merge them into. */
+    Tcl_Size lo,		/* Start of the first run. */
+    Tcl_Size mid,		/* Start of the second run. */
+    Tcl_Size hi,		/* End of the second run. */
     SortInfo *infoPtr)		/* Information needed by the comparison
 				 * operator. */
 {
-    SortElement *headPtr, *tailPtr;
-    int cmp;
+    Tcl_Size i, j, k;
 
-    if (leftPtr == NULL) {
-	return rightPtr;
+    if (mid == hi
+	    || SortCompare(&srcPtr[mid-1], &srcPtr[mid], infoPtr) <= 0) {
+	memcpy(dstPtr + lo, srcPtr + lo, (hi - lo) * sizeof(SortElement));
+	return;
     }
-    if (rightPtr == NULL) {
-	return leftPtr;
-    }
-    cmp = SortCompare(leftPtr, rightPtr, infoPtr);
-    if (cmp > 0 || (cmp == 0 && infoPtr->unique)) {
-	if (cmp == 0) {
-	    infoPtr->numElements--;
-	    leftPtr = leftPtr->nextPtr;
+
+    /*
+     * Take from the left run on ties, to keep the sort stable.
+     */
+
+    i = lo;
+    j = mid;
+    k = lo;
+    while (i < mid && j < hi) {
+	if (SortCompare(&srcPtr[i], &srcPtr[j], infoPtr) <= 0) {
+	    dstPtr[k++] = srcPtr[i++];
+	} else {
+	    dstPtr[k++] = srcPtr[j++];
 	}
-	tailPtr = rightPtr;
-	rightPtr = rightPtr->nextPtr;
+    }
+    if (i < mid) {
+	memcpy(dstPtr + k, srcPtr + i, (mid - i) * sizeof(SortElement));
     } else {
-	tailPtr = leftPtr;
-	leftPtr = leftPtr->nextPtr;
-    }
-    headPtr = tailPtr;
-    if (!infoPtr->unique) {
-	while ((leftPtr != NULL) && (rightPtr != NULL)) {
-	    cmp = SortCompare(leftPtr, rightPtr, infoPtr);
-	    if (cmp > 0) {
-		tailPtr->nextPtr = rightPtr;
-		tailPtr = rightPtr;
-		rightPtr = rightPtr->nextPtr;
-	    } else {
-		tailPtr->nextPtr = leftPtr;
-		tailPtr = leftPtr;
-		leftPtr = leftPtr->nextPtr;
+	memcpy(dstPtr + k, srcPtr + j, (hi - j) * sizeof(SortElement));
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MergeSort --
+ *
+ *	This procedure sorts an array of SortElement structures with a stable
+ *	bottom-up merge sort. Short runs are first put in order by insertion
+ *	sort; after that, each pass merges pairs of sorted runs from one array
+ *	into the other, doubling the run length. Pairs of runs that are
+ *	already in order are copied without merging, so that sorted input
+ *	costs only one comparison per run.
+ *
+ * Results:
+ *	The array, either elementArray or spareArray, that holds the sorted
+ *	elements.
+ *
+ * Side effects:
+ *	Both arrays are overwritten. Possibly others, if a user-defined
+ *	comparison command does something weird.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static SortElement *
+MergeSort(
+    SortElement *elementArray,	/* Elements to sort. */
+    SortElement *spareArray,	/* Scratch space for as many elements. */
+    Tcl_Size length,		/* Number of elements in each array. */
+    SortInfo *infoPtr)		/* Information needed by the comparison
+				 * operator. */
+{
+    SortElement *srcPtr = elementArray, *dstPtr = spareArray, *tmpPtr;
+    SortElement elem;
+    Tcl_Size width, lo, mid, hi, i, j;
+
+    for (lo = 0; lo < length; lo += SORT_RUN_LENGTH) {
+	hi = lo + SORT_RUN_LENGTH;
+	if (hi > length) {
+	    hi = length;
+	}
+	for (i = lo + 1; i < hi; i++) {
+	    elem = srcPtr[i];
+	    for (j = i; j > lo && SortCompare(&srcPtr[j-1], &elem,
+		    infoPtr) > 0; j--) {
+		srcPtr[j] = srcPtr[j-1];
 	    }
+	    srcPtr[j] = elem;
 	}
-    } else {
-	while ((leftPtr != NULL) && (rightPtr != NULL)) {
-	    cmp = SortCompare(leftPtr, rightPtr, infoPtr);
-	    if (cmp >= 0) {
-		if (cmp == 0) {
-		    infoPtr->numElements--;
-		    leftPtr = leftPtr->nextPtr;
-		}
-		tailPtr->nextPtr = rightPtr;
-		tailPtr = rightPtr;
-		rightPtr = rightPtr->nextPtr;
-	    } else {
-		tailPtr->nextPtr = leftPtr;
-		tailPtr = leftPtr;
-		leftPtr = leftPtr->nextPtr;
+    }
+
+    for (width = SORT_RUN_LENGTH; width < length; width *= 2) {
+	for (lo = 0; lo < length; lo += 2 * width) {
+	    mid = lo + width;
+	    hi = mid + width;
+	    if (mid > length) {
+		mid = length;
 	    }
+	    if (hi > length) {
+		hi = length;
+	    }
+	    MergeRuns(srcPtr, dstPtr, lo, mid, hi, infoPtr);
+	}
+	tmpPtr = srcPtr;
+	srcPtr = dstPtr;
+	dstPtr = tmpPtr;
+    }
+    return srcPtr;
+}
+
+/*
+ * The tasks of ParallelMergeSort: sorting one run, which is left in srcPtr,
+ * and merging one pair of runs.
+ */
+
+static void
+SortRunTask(
+    void *clientData)
+{
+    SortTask *taskPtr = (SortTask *)clientData;
+    SortElement *runPtr = taskPtr->srcPtr + taskPtr->lo;
+    Tcl_Size length = taskPtr->hi - taskPtr->lo;
+
+    if (MergeSort(runPtr, taskPtr->dstPtr + taskPtr->lo, length,
+	    taskPtr->infoPtr) != runPtr) {
+	memcpy(runPtr, taskPtr->dstPtr + taskPtr->lo,
+		length * sizeof(SortElement));
+    }
+}
+
+static void
+MergeRunsTask(
+    void *clientData)
+{
+    SortTask *taskPtr = (SortTask *)clientData;
+
+    MergeRuns(taskPtr->srcPtr, taskPtr->dstPtr, taskPtr->lo, taskPtr->mid,
+	    taskPtr->hi, taskPtr->infoPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelMergeSort --
+ *
+ *	This procedure sorts an array of SortElement structures like
+ *	MergeSort, using up to the given number of threads of the task pool.
+ *	The array is cut into that many runs, which are merge sorted at once;
+ *	the pairs of runs of each following pass are merged at once too. Only
+ *	the last pass, which merges two halves, is left to a single thread.
+ *	The comparisons must not use the interpreter.
+ *
+ * Results:
+ *	The array, either elementArray or spareArray, that holds the sorted
+ *	elements.
+ *
+ * Side effects:
+ *	Both arrays are overwritten.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static SortElement *
+ParallelMergeSort(
+    SortElement *elementArray,	/* Elements to sort. */
+    SortElement *spareArray,	/* Scratch space for as many elements. */
+    Tcl_Size length,		/* Number of elements in each array. */
+    int threads,		/* Number of runs to sort at once. */
+    SortInfo *infoPtr)		/* Information needed by the comparison
+				 * operator. */
+{
+    SortElement *srcPtr = elementArray, *dstPtr = spareArray, *tmpPtr;
+    SortTask *tasks = (SortTask *)Tcl_Alloc(threads * sizeof(SortTask));
+    Tcl_TaskGroup group = Tcl_CreateTaskGroup();
+    Tcl_Size width = (length + threads - 1) / threads, lo;
+    int n;
+
+    /*
+     * Sort the runs in place; a run whose sort ends in the spare array is
+     * copied back, so that all of them are in elementArray afterwards.
+     */
+
+    for (lo = 0, n = 0; lo < length; lo += width, n++) {
+	tasks[n].srcPtr = srcPtr;
+	tasks[n].dstPtr = dstPtr;
+	tasks[n].lo = lo;
+	tasks[n].hi = (lo + width < length) ? lo + width : length;
+	tasks[n].infoPtr = infoPtr;
+	Tcl_TaskPoolSubmit(group, SortRunTask, &tasks[n]);
+    }
+    Tcl_TaskGroupWait(group);
+
+    for (; width < length; width *= 2) {
+	for (lo = 0, n = 0; lo < length; lo += 2 * width, n++) {
+	    tasks[n].srcPtr = srcPtr;
+	    tasks[n].dstPtr = dstPtr;
+	    tasks[n].lo = lo;
+	    tasks[n].mid = (lo + width < length) ? lo + width : length;
+	    tasks[n].hi = (lo + 2 * width < length) ? lo + 2 * width : length;
+	    tasks[n].infoPtr = infoPtr;
+	    Tcl_TaskPoolSubmit(group, MergeRunsTask, &tasks[n]);
 	}
+	Tcl_TaskGroupWait(group);
+	tmpPtr = srcPtr;
+	srcPtr = dstPtr;
+	dstPtr = tmpPtr;
     }
-    if (leftPtr != NULL) {
-	tailPtr->nextPtr = leftPtr;
+
+    Tcl_DeleteTaskGroup(group);
+    Tcl_Free(tasks);
+    return srcPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RadixSort --
+ *
+ *	This procedure sorts an array of SortElement structures with -integer
+ *	or -real keys by a least significant digit radix sort. The keys are
+ *	mapped to unsigned 64-bit values that order the same way as the keys
+ *	do (in the requested direction), and the elements are then distributed
+ *	on each byte of those values in turn. Bytes that are the same for all
+ *	elements are skipped. Like MergeSort, this sort is stable.
+ *
+ * Results:
+ *	The array, either elementArray or spareArray, that holds the sorted
+ *	elements.
+ *
+ * Side effects:
+ *	Both arrays are overwritten.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline uint64_t
+RadixKey(
+    SortElement *elemPtr,
+    SortInfo *infoPtr)
+{
+    uint64_t key;
+
+    if (infoPtr->sortMode == SORTMODE_INTEGER) {
+	key = (uint64_t) elemPtr->collationKey.wideValue ^ (UINT64_C(1) << 63);
     } else {
-	tailPtr->nextPtr = rightPtr;
+	double d = elemPtr->collationKey.doubleValue;
+
+	/*
+	 * Map -0.0 onto 0.0, as they compare equal. The sign bit is flipped
+	 * for positive values and all bits are for negative ones, which puts
+	 * IEEE doubles in numeric order. NaN cannot get this far.
+	 */
+
+	if (d == 0.0) {
+	    d = 0.0;
+	}
+	memcpy(&key, &d, sizeof(key));
+	if (key & (UINT64_C(1) << 63)) {
+	    key = ~key;
+	} else {
+	    key |= UINT64_C(1) << 63;
+	}
+    }
+    return infoPtr->isIncreasing ? key : ~key;
+}
+
+static SortElement *
+RadixSort(
+    SortElement *elementArray,	/* Elements to sort. */
+    SortElement *spareArray,	/* Scratch space for as many elements. */
+    Tcl_Size length,		/* Number of elements in each array. */
+    SortInfo *infoPtr)		/* Information about the sort. */
+{
+    SortElement *srcPtr = elementArray, *dstPtr = spareArray, *tmpPtr;
+    Tcl_Size (*counts)[256], offset, count, i;
+    uint64_t key;
+    int digit, b;
+
+    counts = (Tcl_Size (*)[256])Tcl_Alloc(8 * sizeof(*counts));
+    memset(counts, 0, 8 * sizeof(*counts));
+    for (i = 0; i < length; i++) {
+	key = RadixKey(&srcPtr[i], infoPtr);
+	for (digit = 0; digit < 8; digit++) {
+	    counts[digit][(key >> (8 * digit)) & 0xFF]++;
+	}
+    }
+
+    for (digit = 0; digit < 8; digit++) {
+	/*
+	 * Skip the byte if every element has the same value in it; the pass
+	 * would not change the order.
+	 */
+
+	key = RadixKey(&srcPtr[0], infoPtr);
+	if (counts[digit][(key >> (8 * digit)) & 0xFF] == length) {
+	    continue;
+	}
+	for (offset = 0, b = 0; b < 256; b++) {
+	    count = counts[digit][b];
+	    counts[digit][b] = offset;
+	    offset += count;
+	}
+	for (i = 0; i < length; i++) {
+	    key = RadixKey(&srcPtr[i], infoPtr);
+	    dstPtr[counts[digit][(key >> (8 * digit)) & 0xFF]++] = srcPtr[i];
+	}
+	tmpPtr = srcPtr;
+	srcPtr = dstPtr;
+	dstPtr = tmpPtr;
     }
-    return headPtr;
+    Tcl_Free(counts);
+    return srcPtr;
 }
 
 /*
@@ -5056,7 +5361,7 @@ MergeLists(
  *
  * SortCompare --
  *
- *	This procedure is invoked by MergeLists to determine the proper
+ *	This procedure is invoked by MergeSort to determine the proper
  *	ordering between two elements.
  *
  * Results:
@@ -1322,6 +1322,28 @@ Tcl_SplitObjCmd(
 	}
 	TclNewStringObj(objPtr, stringPtr, end - stringPtr);
 	Tcl_ListObjAppendElement(NULL, listPtr, objPtr);
+    } else if (TclAsciiLength(splitChars, splitCharLen) == splitCharLen) {
+	const char *p;
+	TclByteSet splitSet;
+
+	/*
+	 * Split on a set of ASCII characters. Only the bytes of those
+	 * characters can match them, so search for the bytes with no need to
+	 * decode the string.
+	 */
+
+	TclByteSetInit(&splitSet);
+	for (p = splitChars; p < splitChars + splitCharLen; p++) {
+	    TclByteSetAdd(&splitSet, *p);
+	}
+	while ((p = TclMemSearchSet(stringPtr, end - stringPtr,
+		&splitSet)) != NULL) {
+	    TclNewStringObj(objPtr, stringPtr, p - stringPtr);
+	    Tcl_ListObjAppendElement(NULL, listPtr, objPtr);
+	    stringPtr = p + 1;
+	}
+	TclNewStringObj(objPtr, stringPtr, end - stringPtr);
+	Tcl_ListObjAppendElement(NULL, listPtr, objPtr);
     } else {
 	const char *element, *p, *splitEnd;
 	Tcl_Size splitLen;
@@ -2132,6 +2154,13 @@ StringMapCmd(
     } else {
 	sourceObj = objv[objc-1];
     }
+    if (!nocase) {
+	resultPtr = TclStringMapAscii(sourceObj, mapElemc, mapElemv);
+	if (resultPtr != NULL) {
+	    Tcl_SetObjResult(interp, resultPtr);
+	    goto done;
+	}
+    }
     ustring1 = Tcl_GetUnicodeFromObj(sourceObj, &length1);
     if (length1 == 0) {
 	/*
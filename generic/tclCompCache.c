@@ -0,0 +1,2390 @@
+/*
+ * tclCompCache.c --
+ *
+ *	This file implements a cache of compiled scripts on disk. When the
+ *	environment variable TCL_BYTECODE_CACHE names a directory, every file
+ *	evaluated by [source] (and so every package index, package and Tcl
+ *	module loaded with it) gets a companion file in that directory. It
+ *	holds the bytecode of the file's top level script and of the bodies
+ *	of the procedures the file creates and calls while it is evaluated.
+ *	A later interpreter that sources the same, unchanged, file with the
+ *	same build of Tcl takes the bytecode from there instead of compiling
+ *	it again.
+ *
+ *	A compiled script does not only depend on its text: the compiler
+ *	inlines commands such as [set] or [string length] when it finds them
+ *	with a compileProc in the namespace the script is compiled in. Each
+ *	cached script therefore carries the context it was compiled in and
+ *	the list of commands the compiler resolved, and it is only used when
+ *	all of these resolve the same way again. Otherwise the script is just
+ *	compiled as usual.
+ *
+ * See the file "license.terms" for information on usage and redistribution of
+ * this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#include "tclInt.h"
+#include "tclCompile.h"
+
+/*
+ * A cache file starts with CACHE_MAGIC and the checksum of the rest of the
+ * file, as 8 bytes in little-endian order. The rest, the payload, is made of
+ * unsigned LEB128 numbers, zigzag encoded numbers for the signed values and
+ * strings written as their length followed by their bytes:
+ *
+ *	build identity, normalized path of the sourced file, its mtime and
+ *	size, hash of its decoded text, number of units, units...
+ *
+ * A unit is one compiled script: its compile context (see EncodeContext),
+ * its text and the compiled form (see EncodeUnit). CACHE_VERSION must change
+ * whenever any of this does.
+ */
+
+#define CACHE_MAGIC	"\x89TclBC\r\n"
+#define CACHE_MAGIC_LEN	8
+#define CACHE_HEADER_LEN (CACHE_MAGIC_LEN + 8)
+#define CACHE_VERSION	1
+#define CACHE_SEED	UINT64_C(0x74636c2d62797465)
+#define CACHE_EXT	".tclbc"
+
+/*
+ * Kinds of units, literals and dependencies in a cache file.
+ */
+
+enum CacheUnitKind {
+    UNIT_SCRIPT,		/* Top level script of the sourced file. */
+    UNIT_PROC			/* Body of a procedure. */
+};
+
+enum CacheLiteralKind {
+    LITERAL_PRIVATE,		/* Not in the interp's literal table. */
+    LITERAL_SHARED,		/* Shared by all namespaces. */
+    LITERAL_COMMAND		/* Command name, see TclRegisterLiteral. */
+};
+
+#define DEP_COMMAND	'c'	/* The compiler found a compilable command. */
+#define DEP_ENSEMBLE	'e'	/* It expanded an ensemble's subcommand. */
+
+/*
+ * A cache file read from disk. The units taken from it point into its
+ * bytes, which are kept until the last of them is used.
+ */
+
+typedef struct CacheFile {
+    unsigned char *bytes;	/* Contents of the file. */
+    Tcl_Size refCount;		/* Number of units still in the index. */
+} CacheFile;
+
+/*
+ * A compiled script read from a cache file and not used yet.
+ */
+
+typedef struct CacheUnit {
+    struct CacheUnit *nextPtr;	/* Next unit with the same text. */
+    CacheFile *filePtr;		/* File holding the bytes below. */
+    const unsigned char *ctx;	/* Compile context, see EncodeContext. */
+    size_t ctxLen;
+    const unsigned char *data;	/* Compiled script, see EncodeUnit. */
+    size_t dataLen;
+} CacheUnit;
+
+/*
+ * A file being sourced. If no valid cache file was found for it, it records
+ * the scripts compiled for it, to write them to the cache once the file
+ * has been evaluated.
+ */
+
+typedef struct CacheSource {
+    struct CacheSource *nextPtr;/* File that sourced this one, or that is
+				 * being sourced in another coroutine. */
+    int recording;		/* Whether the compiled scripts are recorded
+				 * for a new cache file. */
+    int scriptDone;		/* Whether the top level script has been
+				 * recorded. */
+    Tcl_Obj *scriptObj;		/* Text of the file. */
+    Tcl_Obj *pathObj;		/* Normalized path of the file. */
+    Tcl_Obj *dirObj;		/* The cache directory. */
+    Tcl_Obj *cacheFileObj;	/* Path of the cache file. */
+    long long mtime;		/* Modification time of the file. */
+    unsigned long long size;	/* Size of the file. */
+    uint64_t hash;		/* Hash of the text of the file. */
+    Tcl_HashTable procs;	/* The procedures created while the file was
+				 * evaluated: Proc * -> 1, or NULL once their
+				 * body has been recorded. Each holds a
+				 * reference to the Proc. */
+    Tcl_DString units;		/* The units recorded. */
+    Tcl_Size numUnits;		/* Number of units recorded. */
+} CacheSource;
+
+/*
+ * The state of the cache for an interpreter, in Interp.compCachePtr.
+ */
+
+typedef struct CompCache {
+    Tcl_HashTable index;	/* The units not used yet, by their text:
+				 * Tcl_Obj * -> CacheUnit *. */
+    CacheSource *sourcePtr;	/* The files being sourced, innermost
+				 * first. */
+} CompCache;
+
+/*
+ * What the compiler relied on while compiling a script that is recorded,
+ * hung from CompileEnv.cacheDepsPtr.
+ */
+
+typedef struct CompCacheDeps {
+    CacheSource *sourcePtr;	/* Where the script is recorded. */
+    Tcl_HashTable seen;		/* The dependencies noted so far. */
+    Tcl_DString records;	/* Their encoding. */
+    Tcl_Size numRecords;	/* Their number. */
+} CompCacheDeps;
+
+/*
+ * Decoding state.
+ */
+
+typedef struct Reader {
+    const unsigned char *p;	/* Next byte to read. */
+    const unsigned char *end;	/* End of the bytes. */
+    int failed;			/* Whether the bytes ran out or were not
+				 * well formed. */
+} Reader;
+
+/*
+ * The identity of this build of Tcl, computed once.
+ */
+
+static char buildId[256];
+static int buildIdInitialized = 0;
+TCL_DECLARE_MUTEX(buildIdMutex)
+
+/*
+ * Static functions defined in this file.
+ */
+
+static int		CacheUsable(Interp *iPtr);
+static int		DecodeUnit(Interp *iPtr, Reader *rPtr,
+			    CompileEnv *envPtr);
+static void		DropCompiledLocals(Proc *procPtr);
+static void		EncodeContext(Interp *iPtr, Tcl_Obj *objPtr,
+			    Proc *procPtr, Tcl_DString *dsPtr);
+static int		EncodeUnit(Interp *iPtr, CompileEnv *envPtr,
+			    Tcl_DString *dsPtr);
+static uint64_t		EnsembleFingerprint(Tcl_Command ensemble);
+static void		FreeCacheSource(CacheSource *sourcePtr);
+static const char *	GetBuildId(void);
+static int		LoadCacheFile(CompCache *cachePtr,
+			    CacheSource *sourcePtr);
+static int		PrivateToUser(const Tcl_StatBuf *statBufPtr,
+			    int mode);
+static int		ProcUsable(Interp *iPtr, Proc *procPtr);
+static void		ReleaseUnit(CacheUnit *unitPtr);
+static int		ValidateDeps(Interp *iPtr, Reader *rPtr);
+static int		VerifyUnit(CompileEnv *envPtr, Tcl_Size numLocals);
+static void		WriteCacheFile(CacheSource *sourcePtr);
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PutUInt, PutInt, PutBytes, PutString --
+ *
+ *	Append a number or a string to an encoding.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PutUInt(
+    Tcl_DString *dsPtr,
+    uint64_t value)
+{
+    unsigned char buf[10];
+    int n = 0;
+
+    while (value >= 0x80) {
+	buf[n++] = (unsigned char) (value | 0x80);
+	value >>= 7;
+    }
+    buf[n++] = (unsigned char) value;
+    Tcl_DStringAppend(dsPtr, (char *) buf, n);
+}
+
+static inline void
+PutInt(
+    Tcl_DString *dsPtr,
+    int64_t value)
+{
+    PutUInt(dsPtr, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+static inline void
+PutBytes(
+    Tcl_DString *dsPtr,
+    const void *bytes,
+    size_t length)
+{
+    PutUInt(dsPtr, length);
+    Tcl_DStringAppend(dsPtr, (const char *) bytes, length);
+}
+
+static inline void
+PutString(
+    Tcl_DString *dsPtr,
+    const char *string)
+{
+    PutBytes(dsPtr, string, strlen(string));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetUInt, GetInt, GetSize, GetCount, GetBytes --
+ *
+ *	Read a number or a string from an encoding. Reading past its end or a
+ *	malformed number sets the failed flag of the reader, after which all
+ *	reads give 0 or an empty string.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static uint64_t
+GetUInt(
+    Reader *rPtr)
+{
+    uint64_t value = 0;
+    int shift = 0;
+
+    while (rPtr->p < rPtr->end && shift < 64) {
+	unsigned char c = *rPtr->p++;
+
+	value |= (uint64_t) (c & 0x7F) << shift;
+	if (!(c & 0x80)) {
+	    return value;
+	}
+	shift += 7;
+    }
+    rPtr->failed = 1;
+    rPtr->p = rPtr->end;
+    return 0;
+}
+
+static inline int64_t
+GetInt(
+    Reader *rPtr)
+{
+    uint64_t value = GetUInt(rPtr);
+
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static Tcl_Size
+GetSize(
+    Reader *rPtr)
+{
+    uint64_t value = GetUInt(rPtr);
+
+    if (value > (uint64_t) TCL_SIZE_MAX) {
+	rPtr->failed = 1;
+	rPtr->p = rPtr->end;
+	return 0;
+    }
+    return (Tcl_Size) value;
+}
+
+/*
+ * A number of items each encoded in at least one byte, so bounded by the
+ * bytes left; this keeps a damaged file from asking for huge allocations.
+ */
+
+static Tcl_Size
+GetCount(
+    Reader *rPtr)
+{
+    uint64_t value = GetUInt(rPtr);
+
+    if (value > (uint64_t) (rPtr->end - rPtr->p)) {
+	rPtr->failed = 1;
+	rPtr->p = rPtr->end;
+	return 0;
+    }
+    return (Tcl_Size) value;
+}
+
+static const unsigned char *
+GetBytes(
+    Reader *rPtr,
+    size_t *lengthPtr)
+{
+    uint64_t length = GetUInt(rPtr);
+    const unsigned char *bytes = rPtr->p;
+
+    if (length > (uint64_t) (rPtr->end - rPtr->p)) {
+	rPtr->failed = 1;
+	rPtr->p = rPtr->end;
+	*lengthPtr = 0;
+	return (const unsigned char *) "";
+    }
+    rPtr->p += length;
+    *lengthPtr = (size_t) length;
+    return bytes;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetBuildId --
+ *
+ *	Describe this build of Tcl for the header of the cache files: cached
+ *	bytecode is only used by the build that compiled it. Besides the
+ *	build information of [tcl::build-info], this covers the instruction
+ *	set and the distances between a few functions of the compiler, which
+ *	tell apart two builds of modified sources with the same version
+ *	identity. The distances of compileProcs to TclCompileScript identify
+ *	them in the dependencies.
+ *
+ * Results:
+ *	The identity, valid for the life of the process.
+ *
+ * Side effects:
+ *	Computes it on first use.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static const char *
+GetBuildId(void)
+{
+    if (!buildIdInitialized) {
+	Tcl_MutexLock(&buildIdMutex);
+	if (!buildIdInitialized) {
+	    Tcl_DString ds;
+	    const InstructionDesc *instPtr;
+	    uint32_t one = 1;
+	    uintptr_t base = (uintptr_t) TclCompileScript;
+	    uint64_t hash;
+	    int i;
+
+	    Tcl_DStringInit(&ds);
+	    PutUInt(&ds, CACHE_VERSION);
+	    PutUInt(&ds, sizeof(Tcl_Size));
+	    PutUInt(&ds, sizeof(void *));
+	    PutUInt(&ds, *(unsigned char *) &one);
+	    for (instPtr = tclInstructionTable; instPtr->name; instPtr++) {
+		PutString(&ds, instPtr->name);
+		PutInt(&ds, instPtr->numBytes);
+		PutInt(&ds, instPtr->stackEffect);
+		PutInt(&ds, instPtr->numOperands);
+		for (i = 0; i < instPtr->numOperands; i++) {
+		    PutInt(&ds, instPtr->opTypes[i]);
+		}
+	    }
+	    PutInt(&ds, (int64_t) ((uintptr_t) TclInitByteCode - base));
+	    PutInt(&ds, (int64_t) ((uintptr_t) TclSetByteCodeFromAny - base));
+	    PutInt(&ds, (int64_t) ((uintptr_t) TclCompileEnsemble - base));
+	    PutInt(&ds, (int64_t) ((uintptr_t) TclCreateProc - base));
+	    hash = TclHashBytes(Tcl_DStringValue(&ds), Tcl_DStringLength(&ds),
+		    CACHE_SEED);
+	    Tcl_DStringFree(&ds);
+
+	    snprintf(buildId, sizeof(buildId), "%016" TCL_LL_MODIFIER "x/%s",
+		    (unsigned long long) hash, TclGetBuildInfo());
+	    buildIdInitialized = 1;
+	}
+	Tcl_MutexUnlock(&buildIdMutex);
+    }
+    return buildId;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CacheUsable, ProcUsable --
+ *
+ *	Whether a script compiled in the current context of the interpreter
+ *	may be taken from the cache or recorded for it. The compiler output
+ *	also depends on variable and command resolvers, and on whether the
+ *	interpreter is safe or compiles commands inline at all; none of these
+ *	is recorded, so the cache keeps out of their way. Procedure bodies
+ *	are only handled when compiled for the command that created them.
+ *
+ * Results:
+ *	1 if the cache may be used, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CacheUsable(
+    Interp *iPtr)
+{
+    Namespace *nsPtr = iPtr->varFramePtr->nsPtr;
+
+    return !(iPtr->flags & (SAFE_INTERP | DONT_COMPILE_CMDS_INLINE))
+	    && (iPtr->resolverPtr == NULL) && (nsPtr->cmdResProc == NULL)
+	    && (nsPtr->varResProc == NULL)
+	    && (nsPtr->compiledVarResProc == NULL);
+}
+
+static int
+ProcUsable(
+    Interp *iPtr,
+    Proc *procPtr)
+{
+    Command *cmdPtr = procPtr->cmdPtr;
+
+    return (procPtr->iPtr == iPtr) && (cmdPtr != NULL)
+	    && (TclIsProc(cmdPtr) == procPtr)
+	    && (cmdPtr->nsPtr == iPtr->varFramePtr->nsPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EncodeContext --
+ *
+ *	Describe the context a script is compiled in, other than the commands
+ *	it refers to: whether it is a procedure body, the current namespace,
+ *	whether the compiler may drop INST_START_CMD (see
+ *	TclSetByteCodeFromAny), the arguments of the procedure, which are its
+ *	first compiled locals, and the invisible continuation lines of the
+ *	script. A unit is only used where its context is the same.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Appends to the DString.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+EncodeContext(
+    Interp *iPtr,
+    Tcl_Obj *objPtr,		/* The script. */
+    Proc *procPtr,		/* Procedure it is the body of, or NULL. */
+    Tcl_DString *dsPtr)
+{
+    Tcl_Interp *interp = (Tcl_Interp *) iPtr;
+    ContLineLoc *clLocPtr = TclContinuationsGet(objPtr);
+    Tcl_Size i;
+
+    PutUInt(dsPtr, procPtr ? UNIT_PROC : UNIT_SCRIPT);
+    PutString(dsPtr, iPtr->varFramePtr->nsPtr->fullName);
+    PutUInt(dsPtr, (Tcl_GetParent(interp) == NULL) &&
+	    !Tcl_LimitTypeEnabled(interp, TCL_LIMIT_COMMANDS|TCL_LIMIT_TIME));
+    if (procPtr) {
+	CompiledLocal *localPtr = procPtr->firstLocalPtr;
+
+	PutUInt(dsPtr, procPtr->numArgs);
+	for (i = 0; i < procPtr->numArgs; i++) {
+	    PutUInt(dsPtr, (unsigned) localPtr->flags);
+	    PutBytes(dsPtr, localPtr->name, localPtr->nameLength);
+	    localPtr = localPtr->nextPtr;
+	}
+    }
+    if (clLocPtr) {
+	PutUInt(dsPtr, clLocPtr->num);
+	for (i = 0; i < clLocPtr->num; i++) {
+	    PutUInt(dsPtr, clLocPtr->loc[i]);
+	}
+    } else {
+	PutUInt(dsPtr, 0);
+    }
+}
+
+/*
+ * The compileProc of a command, as its distance to TclCompileScript, which is
+ * the same in all processes running the same build. The target of an
+ * ensemble subcommand may have none: that is 0.
+ */
+
+static inline int64_t
+CompileProcId(
+    Command *cmdPtr)
+{
+    if (cmdPtr->compileProc == NULL) {
+	return 0;
+    }
+    return (int64_t)
+	    ((uintptr_t) cmdPtr->compileProc - (uintptr_t) TclCompileScript);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompCacheNoteCommand, TclCompCacheNoteEnsemble --
+ *
+ *	Called by the compiler while it compiles a script that is recorded
+ *	for the cache, when it is about to inline a command found under the
+ *	given name, or to expand the subcommand of an ensemble. The cached
+ *	script will only be used where the name finds a command with the same
+ *	compileProc and the ensemble is configured the same.
+ *
+ *	It is not necessary to record the commands that were not found or not
+ *	compiled: those are invoked at runtime, which is right whatever they
+ *	are then.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Adds to the dependencies in envPtr->cacheDepsPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclCompCacheNoteCommand(
+    CompileEnv *envPtr,
+    Tcl_Obj *nameObj,		/* The name the command is found under. */
+    Command *cmdPtr)		/* The command. */
+{
+    CompCacheDeps *depsPtr = envPtr->cacheDepsPtr;
+    Tcl_Size length;
+    const char *name = TclGetStringFromObj(nameObj, &length);
+    Tcl_DString key;
+    Tcl_Obj *fullNameObj;
+    int isNew;
+
+    Tcl_DStringInit(&key);
+    TclDStringAppendLiteral(&key, "c");
+    Tcl_DStringAppend(&key, name, length);
+    Tcl_CreateHashEntry(&depsPtr->seen, Tcl_DStringValue(&key), &isNew);
+    Tcl_DStringFree(&key);
+    if (!isNew) {
+	return;
+    }
+
+    TclNewObj(fullNameObj);
+    Tcl_GetCommandFullName((Tcl_Interp *) envPtr->iPtr, (Tcl_Command) cmdPtr,
+	    fullNameObj);
+    PutUInt(&depsPtr->records, DEP_COMMAND);
+    PutBytes(&depsPtr->records, name, length);
+    PutString(&depsPtr->records, TclGetString(fullNameObj));
+    PutInt(&depsPtr->records, CompileProcId(cmdPtr));
+    depsPtr->numRecords++;
+    Tcl_DecrRefCount(fullNameObj);
+}
+
+void
+TclCompCacheNoteEnsemble(
+    CompileEnv *envPtr,
+    Tcl_Command ensemble)	/* The ensemble. */
+{
+    CompCacheDeps *depsPtr = envPtr->cacheDepsPtr;
+    Tcl_DString key;
+    Tcl_Obj *fullNameObj;
+    int isNew;
+
+    TclNewObj(fullNameObj);
+    Tcl_GetCommandFullName((Tcl_Interp *) envPtr->iPtr, ensemble,
+	    fullNameObj);
+    Tcl_DStringInit(&key);
+    TclDStringAppendLiteral(&key, "e");
+    TclDStringAppendObj(&key, fullNameObj);
+    Tcl_CreateHashEntry(&depsPtr->seen, Tcl_DStringValue(&key), &isNew);
+    Tcl_DStringFree(&key);
+    if (isNew) {
+	PutUInt(&depsPtr->records, DEP_ENSEMBLE);
+	PutString(&depsPtr->records, TclGetString(fullNameObj));
+	PutUInt(&depsPtr->records, EnsembleFingerprint(ensemble));
+	depsPtr->numRecords++;
+    }
+    Tcl_DecrRefCount(fullNameObj);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EnsembleFingerprint --
+ *
+ *	Hash what TclCompileEnsemble looks at in the configuration of an
+ *	ensemble.
+ *
+ * Results:
+ *	The hash, or 0 if the command is not an ensemble.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static uint64_t
+EnsembleFingerprint(
+    Tcl_Command ensemble)
+{
+    Tcl_DString ds;
+    Tcl_Obj *objPtr;
+    int flags = 0;
+    uint64_t hash;
+
+    if (!Tcl_IsEnsemble(ensemble)) {
+	return 0;
+    }
+    Tcl_DStringInit(&ds);
+    Tcl_GetEnsembleMappingDict(NULL, ensemble, &objPtr);
+    PutString(&ds, objPtr ? TclGetString(objPtr) : "\xC0\x80");
+    Tcl_GetEnsembleSubcommandList(NULL, ensemble, &objPtr);
+    PutString(&ds, objPtr ? TclGetString(objPtr) : "\xC0\x80");
+    Tcl_GetEnsembleParameterList(NULL, ensemble, &objPtr);
+    PutString(&ds, objPtr ? TclGetString(objPtr) : "\xC0\x80");
+    Tcl_GetEnsembleFlags(NULL, ensemble, &flags);
+    PutUInt(&ds, flags & TCL_ENSEMBLE_PREFIX);
+    hash = TclHashBytes(Tcl_DStringValue(&ds), Tcl_DStringLength(&ds),
+	    CACHE_SEED) | 1;
+    Tcl_DStringFree(&ds);
+    return hash;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ValidateDeps --
+ *
+ *	Check the dependencies at the start of a unit against the current
+ *	state of the interpreter.
+ *
+ * Results:
+ *	TCL_OK if they all hold, TCL_ERROR otherwise.
+ *
+ * Side effects:
+ *	Advances the reader past them.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ValidateDeps(
+    Interp *iPtr,
+    Reader *rPtr)
+{
+    Tcl_Interp *interp = (Tcl_Interp *) iPtr;
+    Tcl_Size i, numDeps = GetCount(rPtr);
+    Tcl_DString name;
+    Tcl_Obj *fullNameObj;
+    const unsigned char *bytes;
+    size_t length;
+    Tcl_Size fullLength;
+    const char *fullName;
+    int result = TCL_OK;
+
+    Tcl_DStringInit(&name);
+    TclNewObj(fullNameObj);
+    Tcl_IncrRefCount(fullNameObj);
+    for (i = 0; i < numDeps && result == TCL_OK; i++) {
+	Command *cmdPtr;
+	int64_t offset;
+
+	switch (GetUInt(rPtr)) {
+	case DEP_COMMAND:
+	    bytes = GetBytes(rPtr, &length);
+	    Tcl_DStringSetLength(&name, 0);
+	    Tcl_DStringAppend(&name, (const char *) bytes, length);
+	    bytes = GetBytes(rPtr, &length);
+	    offset = GetInt(rPtr);
+	    if (rPtr->failed) {
+		result = TCL_ERROR;
+		break;
+	    }
+	    cmdPtr = (Command *) Tcl_FindCommand(interp,
+		    Tcl_DStringValue(&name), NULL, 0);
+	    if ((cmdPtr == NULL) || (offset != CompileProcId(cmdPtr))
+		    || (cmdPtr->nsPtr->flags & NS_SUPPRESS_COMPILATION)
+		    || (cmdPtr->flags & CMD_HAS_EXEC_TRACES)) {
+		result = TCL_ERROR;
+		break;
+	    }
+	    Tcl_SetObjLength(fullNameObj, 0);
+	    Tcl_GetCommandFullName(interp, (Tcl_Command) cmdPtr, fullNameObj);
+	    fullName = TclGetStringFromObj(fullNameObj, &fullLength);
+	    if (((size_t) fullLength != length)
+		    || memcmp(fullName, bytes, length)) {
+		result = TCL_ERROR;
+	    }
+	    break;
+	case DEP_ENSEMBLE:
+	    bytes = GetBytes(rPtr, &length);
+	    Tcl_DStringSetLength(&name, 0);
+	    Tcl_DStringAppend(&name, (const char *) bytes, length);
+	    offset = (int64_t) GetUInt(rPtr);
+	    if (rPtr->failed) {
+		result = TCL_ERROR;
+		break;
+	    }
+	    cmdPtr = (Command *) Tcl_FindCommand(interp,
+		    Tcl_DStringValue(&name), NULL, TCL_GLOBAL_ONLY);
+	    if ((cmdPtr == NULL) || ((uint64_t) offset
+		    != EnsembleFingerprint((Tcl_Command) cmdPtr))) {
+		result = TCL_ERROR;
+	    }
+	    break;
+	default:
+	    result = TCL_ERROR;
+	}
+    }
+    Tcl_DecrRefCount(fullNameObj);
+    Tcl_DStringFree(&name);
+    return rPtr->failed ? TCL_ERROR : result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EncodeAuxData, DecodeAuxData --
+ *
+ *	Write and read back the auxiliary data items of the core. Items of
+ *	other types make the script uncacheable.
+ *
+ * Results:
+ *	TCL_OK, or TCL_ERROR if the item cannot be written or read back.
+ *
+ * Side effects:
+ *	EncodeAuxData appends to the DString; DecodeAuxData adds the item to
+ *	the CompileEnv.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+EncodeAuxData(
+    const AuxData *auxPtr,
+    Tcl_DString *dsPtr)
+{
+    const AuxDataType *typePtr = auxPtr->type;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+    Tcl_Size i, j;
+
+    if (TclGetAuxDataType(typePtr->name) != typePtr) {
+	return TCL_ERROR;
+    }
+    PutString(dsPtr, typePtr->name);
+    if (typePtr == &tclJumptableInfoType) {
+	JumptableInfo *jtPtr = (JumptableInfo *) auxPtr->clientData;
+
+	PutUInt(dsPtr, jtPtr->hashTable.numEntries);
+	for (hPtr = Tcl_FirstHashEntry(&jtPtr->hashTable, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    PutString(dsPtr,
+		    (const char *) Tcl_GetHashKey(&jtPtr->hashTable, hPtr));
+	    PutInt(dsPtr, PTR2INT(Tcl_GetHashValue(hPtr)));
+	}
+    } else if (typePtr == &tclJumptableNumericInfoType) {
+	JumptableNumInfo *jtnPtr = (JumptableNumInfo *) auxPtr->clientData;
+
+	PutUInt(dsPtr, jtnPtr->hashTable.numEntries);
+	for (hPtr = Tcl_FirstHashEntry(&jtnPtr->hashTable, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    PutInt(dsPtr, PTR2INT(Tcl_GetHashKey(&jtnPtr->hashTable, hPtr)));
+	    PutInt(dsPtr, PTR2INT(Tcl_GetHashValue(hPtr)));
+	}
+    } else if (strcmp(typePtr->name, "DictUpdateInfo") == 0) {
+	DictUpdateInfo *duiPtr = (DictUpdateInfo *) auxPtr->clientData;
+
+	PutUInt(dsPtr, duiPtr->length);
+	for (i = 0; i < duiPtr->length; i++) {
+	    PutInt(dsPtr, duiPtr->varIndices[i]);
+	}
+    } else {
+	/* ForeachInfo and NewForeachInfo */
+	ForeachInfo *infoPtr = (ForeachInfo *) auxPtr->clientData;
+
+	PutUInt(dsPtr, infoPtr->numLists);
+	PutInt(dsPtr, infoPtr->firstValueTemp);
+	PutInt(dsPtr, infoPtr->loopCtTemp);
+	for (i = 0; i < infoPtr->numLists; i++) {
+	    ForeachVarList *listPtr = infoPtr->varLists[i];
+
+	    PutUInt(dsPtr, listPtr->numVars);
+	    for (j = 0; j < listPtr->numVars; j++) {
+		PutInt(dsPtr, listPtr->varIndexes[j]);
+	    }
+	}
+    }
+    return TCL_OK;
+}
+
+static int
+DecodeAuxData(
+    Reader *rPtr,
+    CompileEnv *envPtr)
+{
+    const AuxDataType *typePtr;
+    const unsigned char *bytes;
+    size_t length;
+    void *clientData;
+    Tcl_DString key;
+    Tcl_Size i, j, n;
+
+    bytes = GetBytes(rPtr, &length);
+    Tcl_DStringInit(&key);
+    Tcl_DStringAppend(&key, (const char *) bytes, length);
+    typePtr = TclGetAuxDataType(Tcl_DStringValue(&key));
+    if (typePtr == NULL || rPtr->failed) {
+	Tcl_DStringFree(&key);
+	return TCL_ERROR;
+    }
+    n = GetCount(rPtr);
+    if (typePtr == &tclJumptableInfoType) {
+	JumptableInfo *jtPtr = AllocJumptable();
+
+	for (i = 0; i < n; i++) {
+	    bytes = GetBytes(rPtr, &length);
+	    Tcl_DStringSetLength(&key, 0);
+	    Tcl_DStringAppend(&key, (const char *) bytes, length);
+	    CreateJumptableEntry(jtPtr, Tcl_DStringValue(&key),
+		    (Tcl_Size) GetInt(rPtr));
+	}
+	clientData = jtPtr;
+    } else if (typePtr == &tclJumptableNumericInfoType) {
+	JumptableNumInfo *jtnPtr = AllocJumptableNum();
+
+	for (i = 0; i < n; i++) {
+	    Tcl_Size value = (Tcl_Size) GetInt(rPtr);
+
+	    CreateJumptableNumEntry(jtnPtr, value, (Tcl_Size) GetInt(rPtr));
+	}
+	clientData = jtnPtr;
+    } else if (strcmp(typePtr->name, "DictUpdateInfo") == 0) {
+	DictUpdateInfo *duiPtr = (DictUpdateInfo *) Tcl_Alloc(
+		offsetof(DictUpdateInfo, varIndices) + sizeof(Tcl_Size) * n);
+
+	duiPtr->length = n;
+	for (i = 0; i < n; i++) {
+	    duiPtr->varIndices[i] = (Tcl_Size) GetInt(rPtr);
+	}
+	clientData = duiPtr;
+    } else if ((strcmp(typePtr->name, "ForeachInfo") == 0)
+	    || (strcmp(typePtr->name, "NewForeachInfo") == 0)) {
+	ForeachInfo *infoPtr = (ForeachInfo *) Tcl_Alloc(
+		offsetof(ForeachInfo, varLists) + n * sizeof(ForeachVarList *));
+
+	infoPtr->numLists = n;
+	infoPtr->firstValueTemp = (Tcl_LVTIndex) GetInt(rPtr);
+	infoPtr->loopCtTemp = (Tcl_LVTIndex) GetInt(rPtr);
+	for (i = 0; i < n; i++) {
+	    Tcl_Size numVars = GetCount(rPtr);
+	    ForeachVarList *listPtr = (ForeachVarList *) Tcl_Alloc(
+		    offsetof(ForeachVarList, varIndexes)
+		    + numVars * sizeof(Tcl_LVTIndex));
+
+	    listPtr->numVars = numVars;
+	    for (j = 0; j < numVars; j++) {
+		listPtr->varIndexes[j] = (Tcl_LVTIndex) GetInt(rPtr);
+	    }
+	    infoPtr->varLists[i] = listPtr;
+	}
+	clientData = infoPtr;
+    } else {
+	Tcl_DStringFree(&key);
+	return TCL_ERROR;
+    }
+    Tcl_DStringFree(&key);
+    if (rPtr->failed) {
+	typePtr->freeProc(clientData);
+	return TCL_ERROR;
+    }
+    TclCreateAuxData(clientData, typePtr, envPtr);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EncodeUnit --
+ *
+ *	Write the compiled form of a script, as left in the CompileEnv by the
+ *	compiler: the code, the literals with how they are shared, exception
+ *	ranges, auxiliary data, the command location map, the line numbers of
+ *	TIP #280 relative to the first line of the script, and for procedure
+ *	bodies the compiled locals the compiler added after the arguments.
+ *
+ *	Code that reports a syntax error is not cached: its error message and
+ *	its errorInfo may depend on where it was compiled.
+ *
+ * Results:
+ *	TCL_OK, or TCL_ERROR if the script cannot be cached.
+ *
+ * Side effects:
+ *	Appends to the DString.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+EncodeUnit(
+    Interp *iPtr,
+    CompileEnv *envPtr,
+    Tcl_DString *dsPtr)
+{
+    Namespace *nsPtr = iPtr->varFramePtr->nsPtr;
+    ExtCmdLoc *eclPtr = envPtr->extCmdMapPtr;
+    Proc *procPtr = envPtr->procPtr;
+    const unsigned char *pc;
+    Tcl_Size i, j;
+
+    for (pc = envPtr->codeStart; pc < envPtr->codeNext;
+	    pc += tclInstructionTable[*pc].numBytes) {
+	if (*pc == INST_SYNTAX) {
+	    return TCL_ERROR;
+	}
+    }
+
+    PutUInt(dsPtr, eclPtr->type);
+    PutUInt(dsPtr, envPtr->maxStackDepth);
+    PutUInt(dsPtr, envPtr->maxExceptDepth);
+    PutBytes(dsPtr, envPtr->codeStart, CurrentOffset(envPtr));
+
+    PutUInt(dsPtr, envPtr->literalArrayNext);
+    for (i = 0; i < envPtr->literalArrayNext; i++) {
+	Tcl_Obj *litObj = envPtr->literalArrayPtr[i].objPtr;
+	LiteralEntry *globalPtr =
+		TclLookupLiteralEntry((Tcl_Interp *) iPtr, litObj);
+	ContLineLoc *clLocPtr = TclContinuationsGet(litObj);
+	Tcl_Size length;
+	const char *bytes = TclGetStringFromObj(litObj, &length);
+
+	if (globalPtr == NULL) {
+	    PutUInt(dsPtr, LITERAL_PRIVATE);
+	} else if (globalPtr->nsPtr == NULL) {
+	    PutUInt(dsPtr, LITERAL_SHARED);
+	} else if (globalPtr->nsPtr == ((length >= 2 && bytes[0] == ':'
+		&& bytes[1] == ':') ? iPtr->globalNsPtr : nsPtr)) {
+	    PutUInt(dsPtr, LITERAL_COMMAND);
+	} else {
+	    return TCL_ERROR;
+	}
+	PutBytes(dsPtr, bytes, length);
+	if (clLocPtr) {
+	    PutUInt(dsPtr, clLocPtr->num);
+	    for (j = 0; j < clLocPtr->num; j++) {
+		PutUInt(dsPtr, clLocPtr->loc[j]);
+	    }
+	} else {
+	    PutUInt(dsPtr, 0);
+	}
+    }
+
+    PutUInt(dsPtr, envPtr->exceptArrayNext);
+    for (i = 0; i < envPtr->exceptArrayNext; i++) {
+	ExceptionRange *rangePtr = &envPtr->exceptArrayPtr[i];
+
+	PutUInt(dsPtr, rangePtr->type);
+	PutInt(dsPtr, rangePtr->nestingLevel);
+	PutInt(dsPtr, rangePtr->codeOffset);
+	PutInt(dsPtr, rangePtr->numCodeBytes);
+	PutInt(dsPtr, rangePtr->breakOffset);
+	PutInt(dsPtr, rangePtr->continueOffset);
+	PutInt(dsPtr, rangePtr->catchOffset);
+    }
+
+    PutUInt(dsPtr, envPtr->auxDataArrayNext);
+    for (i = 0; i < envPtr->auxDataArrayNext; i++) {
+	if (EncodeAuxData(&envPtr->auxDataArrayPtr[i], dsPtr) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+
+    PutUInt(dsPtr, envPtr->numCommands);
+    for (i = 0; i < envPtr->numCommands; i++) {
+	CmdLocation *locPtr = &envPtr->cmdMapPtr[i];
+
+	PutUInt(dsPtr, locPtr->codeOffset);
+	PutUInt(dsPtr, locPtr->numCodeBytes);
+	PutUInt(dsPtr, locPtr->srcOffset);
+	PutUInt(dsPtr, locPtr->numSrcBytes);
+    }
+
+    /*
+     * Word lines are stored relative to the first line of the script, plus
+     * one, so that 0 can stand for the -1 of words that are not literals.
+     */
+
+    PutUInt(dsPtr, eclPtr->nuloc);
+    for (i = 0; i < eclPtr->nuloc; i++) {
+	ECL *locPtr = &eclPtr->loc[i];
+
+	PutUInt(dsPtr, locPtr->srcOffset);
+	PutUInt(dsPtr, locPtr->nline);
+	for (j = 0; j < locPtr->nline; j++) {
+	    int line = locPtr->line[j];
+
+	    PutInt(dsPtr, (line < 0) ? 0 : (int64_t) line - eclPtr->start + 1);
+	}
+    }
+
+    if (procPtr) {
+	CompiledLocal *localPtr = procPtr->firstLocalPtr;
+
+	for (i = 0; i < procPtr->numArgs; i++) {
+	    localPtr = localPtr->nextPtr;
+	}
+	PutUInt(dsPtr, procPtr->numCompiledLocals - procPtr->numArgs);
+	for (; localPtr != NULL; localPtr = localPtr->nextPtr) {
+	    if ((localPtr->flags & ~VAR_TEMPORARY) || localPtr->defValuePtr
+		    || localPtr->resolveInfo) {
+		return TCL_ERROR;
+	    }
+	    PutUInt(dsPtr, TclIsVarTemporary(localPtr) ? 1 : 0);
+	    PutBytes(dsPtr, localPtr->name, localPtr->nameLength);
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ * Whether a jump by offset from pc lands on an instruction of the code.
+ */
+
+static inline int
+InstStartsAt(
+    const unsigned char *starts,/* Which bytes of the code start an
+				 * instruction. */
+    Tcl_Size codeLength,
+    Tcl_Size pc,
+    Tcl_Size offset)
+{
+    return (offset >= -pc) && (offset < codeLength - pc)
+	    && starts[pc + offset];
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VerifyUnit --
+ *
+ *	Check the compiled form read back by DecodeUnit before it is used:
+ *	bytecode is executed without further checks, and a cache file is
+ *	only as trustworthy as the directory it is in. Every instruction must
+ *	be known and complete, and every index and jump it holds must stay
+ *	within the code, the literals, the auxiliary data, the exception
+ *	ranges and the local variable table of the script; so must the
+ *	exception ranges and the source ranges of the command location map.
+ *	The depths the code reaches on the stacks are not checked, that would
+ *	take running it abstractly.
+ *
+ * Results:
+ *	TCL_OK if the unit is well formed, TCL_ERROR otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+VerifyUnit(
+    CompileEnv *envPtr,
+    Tcl_Size numLocals)		/* Size of the local variable table the code
+				 * runs with. */
+{
+    const unsigned char *codeStart = envPtr->codeStart;
+    Tcl_Size codeLength = envPtr->codeNext - envPtr->codeStart;
+    unsigned char *starts;
+    Tcl_Size pc, lastPc = 0, i, j;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+    int result = TCL_ERROR;
+
+    /*
+     * Mark where the instructions start, for the jumps to be checked to land
+     * on one. The code must not run off its end.
+     */
+
+    starts = (unsigned char *) Tcl_Alloc(codeLength);
+    memset(starts, 0, codeLength);
+    for (pc = 0; pc < codeLength;
+	    pc += tclInstructionTable[codeStart[pc]].numBytes) {
+	if ((codeStart[pc] >= LAST_INST_OPCODE) || (codeLength - pc
+		< tclInstructionTable[codeStart[pc]].numBytes)) {
+	    goto done;
+	}
+	starts[pc] = 1;
+	lastPc = pc;
+    }
+    if (codeStart[lastPc] != INST_DONE) {
+	goto done;
+    }
+
+    for (pc = 0; pc < codeLength;
+	    pc += tclInstructionTable[codeStart[pc]].numBytes) {
+	const InstructionDesc *instPtr = &tclInstructionTable[codeStart[pc]];
+	const unsigned char *opndPtr = codeStart + pc + 1;
+	const AuxData *auxPtr = NULL;
+	Tcl_Size value;
+
+	for (i = 0; i < instPtr->numOperands; i++) {
+	    switch (instPtr->opTypes[i]) {
+	    case OPERAND_LVT1:
+		value = TclGetUInt1AtPtr(opndPtr);
+		goto checkLocal;
+	    case OPERAND_LVT4:
+		value = TclGetUInt4AtPtr(opndPtr);
+	    checkLocal:
+		if (value >= numLocals) {
+		    goto done;
+		}
+		break;
+	    case OPERAND_LIT1:
+		value = TclGetUInt1AtPtr(opndPtr);
+		goto checkLiteral;
+	    case OPERAND_LIT4:
+		value = TclGetUInt4AtPtr(opndPtr);
+	    checkLiteral:
+		if (value >= envPtr->literalArrayNext) {
+		    goto done;
+		}
+		break;
+	    case OPERAND_AUX4:
+		value = TclGetUInt4AtPtr(opndPtr);
+		if (value >= envPtr->auxDataArrayNext) {
+		    goto done;
+		}
+		auxPtr = &envPtr->auxDataArrayPtr[value];
+		break;
+	    case OPERAND_OFFSET1:
+		value = TclGetInt1AtPtr(opndPtr);
+		goto checkJump;
+	    case OPERAND_OFFSET4:
+		value = TclGetInt4AtPtr(opndPtr);
+	    checkJump:
+		if (!InstStartsAt(starts, codeLength, pc, value)) {
+		    goto done;
+		}
+		break;
+	    case OPERAND_SCLS1:
+		if (TclGetUInt1AtPtr(opndPtr) > STR_CLASS_XDIGIT) {
+		    goto done;
+		}
+		break;
+	    case OPERAND_CLK1:
+		if (TclGetUInt1AtPtr(opndPtr) > CLOCK_READ_MONOTONIC) {
+		    goto done;
+		}
+		break;
+	    case OPERAND_UINT4:
+		if ((codeStart[pc] == INST_BEGIN_CATCH)
+			&& ((Tcl_Size) TclGetUInt4AtPtr(opndPtr)
+			    >= envPtr->exceptArrayNext)) {
+		    goto done;
+		}
+		break;
+	    default:
+		break;
+	    }
+	    switch (instPtr->opTypes[i]) {
+	    case OPERAND_INT1:
+	    case OPERAND_UINT1:
+	    case OPERAND_LVT1:
+	    case OPERAND_OFFSET1:
+	    case OPERAND_LIT1:
+	    case OPERAND_SCLS1:
+	    case OPERAND_UNSF1:
+	    case OPERAND_CLK1:
+	    case OPERAND_LRPL1:
+		opndPtr += 1;
+		break;
+	    default:
+		opndPtr += 4;
+	    }
+	}
+
+	/*
+	 * The auxiliary data must be of the type the instruction expects, and
+	 * the offsets and variables it holds must be in range too.
+	 */
+
+	switch (codeStart[pc]) {
+	case INST_JUMP_TABLE:
+	    if (auxPtr->type != &tclJumptableInfoType) {
+		goto done;
+	    }
+	    for (hPtr = Tcl_FirstHashEntry(
+		    &((JumptableInfo *) auxPtr->clientData)->hashTable,
+		    &search); hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+		if (!InstStartsAt(starts, codeLength, pc,
+			PTR2INT(Tcl_GetHashValue(hPtr)))) {
+		    goto done;
+		}
+	    }
+	    break;
+	case INST_JUMP_TABLE_NUM:
+	    if (auxPtr->type != &tclJumptableNumericInfoType) {
+		goto done;
+	    }
+	    for (hPtr = Tcl_FirstHashEntry(
+		    &((JumptableNumInfo *) auxPtr->clientData)->hashTable,
+		    &search); hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+		if (!InstStartsAt(starts, codeLength, pc,
+			PTR2INT(Tcl_GetHashValue(hPtr)))) {
+		    goto done;
+		}
+	    }
+	    break;
+	case INST_DICT_UPDATE_START:
+	case INST_DICT_UPDATE_END: {
+	    DictUpdateInfo *duiPtr = (DictUpdateInfo *) auxPtr->clientData;
+
+	    if (strcmp(auxPtr->type->name, "DictUpdateInfo") != 0) {
+		goto done;
+	    }
+	    for (i = 0; i < duiPtr->length; i++) {
+		if ((duiPtr->varIndices[i] < 0)
+			|| (duiPtr->varIndices[i] >= numLocals)) {
+		    goto done;
+		}
+	    }
+	    break;
+	}
+	case INST_FOREACH_START: {
+	    ForeachInfo *infoPtr = (ForeachInfo *) auxPtr->clientData;
+
+	    /*
+	     * loopCtTemp holds how far back INST_FOREACH_STEP jumps to the
+	     * start of the body, which follows this instruction.
+	     */
+
+	    if ((strcmp(auxPtr->type->name, "NewForeachInfo") != 0)
+		    || (infoPtr->loopCtTemp > 0)
+		    || !InstStartsAt(starts, codeLength, pc + 5,
+			    -infoPtr->loopCtTemp)
+		    || (codeStart[pc + 5 - infoPtr->loopCtTemp]
+			    != INST_FOREACH_STEP)) {
+		goto done;
+	    }
+	    for (i = 0; i < infoPtr->numLists; i++) {
+		ForeachVarList *listPtr = infoPtr->varLists[i];
+
+		for (j = 0; j < listPtr->numVars; j++) {
+		    if ((listPtr->varIndexes[j] < 0)
+			    || (listPtr->varIndexes[j] >= numLocals)) {
+			goto done;
+		    }
+		}
+	    }
+	    break;
+	}
+	}
+    }
+
+    for (i = 0; i < envPtr->exceptArrayNext; i++) {
+	ExceptionRange *rangePtr = &envPtr->exceptArrayPtr[i];
+
+	/*
+	 * A range the compiler ended up not using never matches a pc.
+	 */
+
+	if (rangePtr->codeOffset == TCL_INDEX_NONE) {
+	    continue;
+	}
+	if ((rangePtr->nestingLevel < 0)
+		|| !InstStartsAt(starts, codeLength, 0, rangePtr->codeOffset)
+		|| (rangePtr->numCodeBytes < 0)
+		|| (rangePtr->numCodeBytes
+			> codeLength - rangePtr->codeOffset)) {
+	    goto done;
+	}
+	if (rangePtr->type == LOOP_EXCEPTION_RANGE) {
+	    if (!InstStartsAt(starts, codeLength, 0, rangePtr->breakOffset)
+		    || ((rangePtr->continueOffset != TCL_INDEX_NONE)
+		    && !InstStartsAt(starts, codeLength, 0,
+			    rangePtr->continueOffset))) {
+		goto done;
+	    }
+	} else if (!InstStartsAt(starts, codeLength, 0,
+		rangePtr->catchOffset)) {
+	    goto done;
+	}
+    }
+
+    /*
+     * The code ranges of commands are only compared with pcs, and may run
+     * past the end of code the optimizer shortened. Their source ranges are
+     * read.
+     */
+
+    for (i = 0; i < envPtr->numCommands; i++) {
+	CmdLocation *locPtr = &envPtr->cmdMapPtr[i];
+
+	if ((locPtr->codeOffset > codeLength)
+		|| (locPtr->srcOffset > envPtr->numSrcBytes)
+		|| (locPtr->numSrcBytes
+			> envPtr->numSrcBytes - locPtr->srcOffset)) {
+	    goto done;
+	}
+    }
+    for (i = 0; i < envPtr->extCmdMapPtr->nuloc; i++) {
+	if (envPtr->extCmdMapPtr->loc[i].srcOffset > envPtr->numSrcBytes) {
+	    goto done;
+	}
+    }
+    result = TCL_OK;
+
+  done:
+    Tcl_Free(starts);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DecodeUnit --
+ *
+ *	Read back what EncodeUnit wrote into a CompileEnv freshly initialized
+ *	for the script, as if the compiler had just produced it.
+ *
+ * Results:
+ *	TCL_OK, or TCL_ERROR if the unit does not fit or is not well formed
+ *	(see VerifyUnit). In that case the CompileEnv must just be freed and
+ *	the script compiled.
+ *
+ * Side effects:
+ *	Fills the CompileEnv, registers the literals and adds the compiled
+ *	locals to the procedure.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+DecodeUnit(
+    Interp *iPtr,
+    Reader *rPtr,
+    CompileEnv *envPtr)
+{
+    ExtCmdLoc *eclPtr = envPtr->extCmdMapPtr;
+    Proc *procPtr = envPtr->procPtr;
+    const unsigned char *bytes;
+    size_t length;
+    uint64_t type;
+    Tcl_Size i, j, n, numLocals;
+    Reader locals;
+
+    /*
+     * The compactible recompile in TclSetByteCodeFromAny no longer sees
+     * TCL_EVAL_FILE, so the top level of a sourced file may have been
+     * compiled with relative lines and no path. Do the same here.
+     */
+
+    type = GetUInt(rPtr);
+    if ((type == TCL_LOCATION_BC) && (eclPtr->type == TCL_LOCATION_SOURCE)
+	    && (envPtr->procPtr == NULL)) {
+	Tcl_DecrRefCount(eclPtr->path);
+	eclPtr->path = NULL;
+	eclPtr->type = TCL_LOCATION_BC;
+    } else if (type != (uint64_t) eclPtr->type) {
+	return TCL_ERROR;
+    }
+    envPtr->maxStackDepth = GetSize(rPtr);
+    envPtr->maxExceptDepth = GetSize(rPtr);
+    bytes = GetBytes(rPtr, &length);
+    if (length == 0) {
+	return TCL_ERROR;
+    }
+    if (length > COMPILEENV_INIT_CODE_BYTES) {
+	envPtr->codeStart = (unsigned char *) Tcl_Alloc(length);
+	envPtr->mallocedCodeArray = true;
+    }
+    memcpy(envPtr->codeStart, bytes, length);
+    envPtr->codeNext = envPtr->codeStart + length;
+    envPtr->codeEnd = envPtr->codeNext;
+
+    n = GetCount(rPtr);
+    for (i = 0; i < n && !rPtr->failed; i++) {
+	uint64_t kind = GetUInt(rPtr);
+	Tcl_Obj *litObj;
+	Namespace *nsPtr;
+	Tcl_Size numCl;
+	int isNew;
+
+	bytes = GetBytes(rPtr, &length);
+	switch (kind) {
+	case LITERAL_PRIVATE:
+	    litObj = Tcl_NewStringObj((const char *) bytes, length);
+	    break;
+	case LITERAL_SHARED:
+	case LITERAL_COMMAND:
+	    nsPtr = NULL;
+	    if (kind == LITERAL_COMMAND) {
+		nsPtr = (length >= 2 && bytes[0] == ':' && bytes[1] == ':')
+			? iPtr->globalNsPtr : iPtr->varFramePtr->nsPtr;
+	    }
+	    litObj = TclCreateLiteral(iPtr, (const char *) bytes, length,
+		    TCL_INDEX_NONE, &isNew, nsPtr, 0, NULL);
+	    if (litObj == NULL) {
+		return TCL_ERROR;
+	    }
+	    break;
+	default:
+	    return TCL_ERROR;
+	}
+	TclAddLiteralObj(envPtr, litObj, NULL);
+
+	numCl = GetCount(rPtr);
+	if (numCl > 0) {
+	    Tcl_Size *locs = (Tcl_Size *) Tcl_Alloc(numCl * sizeof(Tcl_Size));
+
+	    for (j = 0; j < numCl; j++) {
+		locs[j] = GetSize(rPtr);
+	    }
+	    TclContinuationsEnter(litObj, numCl, locs);
+	    Tcl_Free(locs);
+	}
+    }
+
+    n = GetCount(rPtr);
+    for (i = 0; i < n && !rPtr->failed; i++) {
+	ExceptionRange *rangePtr = &envPtr->exceptArrayPtr[
+		TclCreateExceptRange(LOOP_EXCEPTION_RANGE, envPtr)];
+
+	type = GetUInt(rPtr);
+	if (type > CATCH_EXCEPTION_RANGE) {
+	    return TCL_ERROR;
+	}
+	rangePtr->type = (ExceptionRangeType) type;
+	rangePtr->nestingLevel = (Tcl_Size) GetInt(rPtr);
+	rangePtr->codeOffset = (Tcl_Size) GetInt(rPtr);
+	rangePtr->numCodeBytes = (Tcl_Size) GetInt(rPtr);
+	rangePtr->breakOffset = (Tcl_Size) GetInt(rPtr);
+	rangePtr->continueOffset = (Tcl_Size) GetInt(rPtr);
+	rangePtr->catchOffset = (Tcl_Size) GetInt(rPtr);
+    }
+
+    n = GetCount(rPtr);
+    for (i = 0; i < n && !rPtr->failed; i++) {
+	if (DecodeAuxData(rPtr, envPtr) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+
+    n = GetCount(rPtr);
+    if (n > envPtr->cmdMapEnd) {
+	envPtr->cmdMapPtr = (CmdLocation *)
+		Tcl_Alloc(n * sizeof(CmdLocation));
+	envPtr->cmdMapEnd = n;
+	envPtr->mallocedCmdMap = true;
+    }
+    for (i = 0; i < n; i++) {
+	CmdLocation *locPtr = &envPtr->cmdMapPtr[i];
+
+	locPtr->codeOffset = GetSize(rPtr);
+	locPtr->numCodeBytes = GetSize(rPtr);
+	locPtr->srcOffset = GetSize(rPtr);
+	locPtr->numSrcBytes = GetSize(rPtr);
+    }
+    envPtr->numCommands = n;
+
+    n = GetCount(rPtr);
+    if (n > 0) {
+	eclPtr->loc = (ECL *) Tcl_Alloc(n * sizeof(ECL));
+	eclPtr->nloc = n;
+    }
+    for (i = 0; i < n && !rPtr->failed; i++) {
+	ECL *locPtr = &eclPtr->loc[i];
+	Tcl_Size nline;
+
+	locPtr->srcOffset = GetSize(rPtr);
+	nline = GetCount(rPtr);
+	locPtr->nline = nline;
+	locPtr->line = (int *) Tcl_Alloc(nline * sizeof(int));
+	locPtr->next = NULL;
+	eclPtr->nuloc++;
+	for (j = 0; j < nline; j++) {
+	    int64_t line = GetInt(rPtr);
+
+	    locPtr->line[j] = (line == 0) ? -1
+		    : (int) (line - 1 + eclPtr->start);
+	}
+    }
+
+    /*
+     * The compiled locals go last. The code is checked against the local
+     * variable table they make with the arguments before they are added to
+     * the procedure, and they are taken back if they do not get the indices
+     * the code was compiled with.
+     */
+
+    locals = *rPtr;
+    numLocals = 0;
+    if (procPtr) {
+	numLocals = GetCount(rPtr);
+	for (i = 0; i < numLocals; i++) {
+	    GetUInt(rPtr);
+	    GetBytes(rPtr, &length);
+	}
+	numLocals += procPtr->numArgs;
+    }
+    if (rPtr->failed || (rPtr->p != rPtr->end)
+	    || (VerifyUnit(envPtr, numLocals) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    if (procPtr) {
+	n = GetCount(&locals);
+	for (i = 0; i < n; i++) {
+	    int temporary = (int) GetUInt(&locals);
+
+	    bytes = GetBytes(&locals, &length);
+	    if (TclFindCompiledLocal(temporary ? NULL : (const char *) bytes,
+		    temporary ? 0 : (Tcl_Size) length, true, envPtr)
+		    != procPtr->numArgs + i) {
+		DropCompiledLocals(procPtr);
+		return TCL_ERROR;
+	    }
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DropCompiledLocals --
+ *
+ *	Take back the compiled locals DecodeUnit added to a procedure after
+ *	its arguments.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the compiled locals.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DropCompiledLocals(
+    Proc *procPtr)
+{
+    CompiledLocal *localPtr, *nextPtr;
+    Tcl_Size i;
+
+    if (procPtr->numArgs == 0) {
+	localPtr = procPtr->firstLocalPtr;
+	procPtr->firstLocalPtr = procPtr->lastLocalPtr = NULL;
+    } else {
+	CompiledLocal *lastArgPtr = procPtr->firstLocalPtr;
+
+	for (i = 1; i < procPtr->numArgs; i++) {
+	    lastArgPtr = lastArgPtr->nextPtr;
+	}
+	localPtr = lastArgPtr->nextPtr;
+	lastArgPtr->nextPtr = NULL;
+	procPtr->lastLocalPtr = lastArgPtr;
+    }
+    for (; localPtr != NULL; localPtr = nextPtr) {
+	nextPtr = localPtr->nextPtr;
+	Tcl_Free(localPtr);
+    }
+    procPtr->numCompiledLocals = procPtr->numArgs;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompCacheFetch --
+ *
+ *	Called by TclSetByteCodeFromAny before it compiles a script. Looks
+ *	for the script in the units read from the cache files, with the same
+ *	compile context and dependencies that still hold, and if found turns
+ *	the script into its bytecode.
+ *
+ * Results:
+ *	TCL_OK if the script was turned into bytecode, TCL_ERROR if it must
+ *	be compiled.
+ *
+ * Side effects:
+ *	A unit found is taken out of the index, whether it is used or not:
+ *	each is used at most once.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclCompCacheFetch(
+    Tcl_Interp *interp,
+    Tcl_Obj *objPtr)		/* The script to compile. */
+{
+    Interp *iPtr = (Interp *) interp;
+    CompCache *cachePtr = iPtr->compCachePtr;
+    Proc *procPtr = iPtr->compiledProcPtr;
+    Tcl_HashEntry *hPtr;
+    CacheUnit *unitPtr, **unitPtrPtr;
+    CompileEnv compEnv;
+    Tcl_DString ctx;
+    Reader reader;
+    const char *stringPtr;
+    Tcl_Size length;
+    int evalFile, result;
+
+    if (cachePtr->index.numEntries == 0) {
+	return TCL_ERROR;
+    }
+    hPtr = Tcl_FindHashEntry(&cachePtr->index, objPtr);
+    if ((hPtr == NULL) || !CacheUsable(iPtr)) {
+	return TCL_ERROR;
+    }
+    if (procPtr) {
+	if (!ProcUsable(iPtr, procPtr)
+		|| (procPtr->numCompiledLocals != procPtr->numArgs)) {
+	    return TCL_ERROR;
+	}
+    } else if (iPtr->varFramePtr->localCachePtr != NULL) {
+	return TCL_ERROR;
+    }
+
+    Tcl_DStringInit(&ctx);
+    EncodeContext(iPtr, objPtr, procPtr, &ctx);
+    for (unitPtrPtr = (CacheUnit **) &Tcl_GetHashValue(hPtr);
+	    (unitPtr = *unitPtrPtr) != NULL; unitPtrPtr = &unitPtr->nextPtr) {
+	if ((unitPtr->ctxLen == (size_t) Tcl_DStringLength(&ctx))
+		&& !memcmp(unitPtr->ctx, Tcl_DStringValue(&ctx),
+			unitPtr->ctxLen)) {
+	    break;
+	}
+    }
+    Tcl_DStringFree(&ctx);
+    if (unitPtr == NULL) {
+	return TCL_ERROR;
+    }
+    *unitPtrPtr = unitPtr->nextPtr;
+    if (Tcl_GetHashValue(hPtr) == NULL) {
+	Tcl_DeleteHashEntry(hPtr);
+    }
+
+    reader.p = unitPtr->data;
+    reader.end = unitPtr->data + unitPtr->dataLen;
+    reader.failed = 0;
+    if (ValidateDeps(iPtr, &reader) != TCL_OK) {
+	ReleaseUnit(unitPtr);
+	return TCL_ERROR;
+    }
+
+    /*
+     * Set up the CompileEnv as TclSetByteCodeFromAny does, then fill it
+     * from the unit instead of running the compiler. The CompileEnv takes
+     * iPtr->compiledProcPtr and TCL_EVAL_FILE; both must be given back if
+     * the script ends up compiled after all.
+     */
+
+    evalFile = iPtr->evalFlags & TCL_EVAL_FILE;
+    stringPtr = TclGetStringFromObj(objPtr, &length);
+    TclInitCompileEnv(interp, &compEnv, stringPtr, length,
+	    iPtr->invokeCmdFramePtr, iPtr->invokeWord);
+    result = DecodeUnit(iPtr, &reader, &compEnv);
+    ReleaseUnit(unitPtr);
+    if (result != TCL_OK) {
+	TclFreeCompileEnv(&compEnv);
+	iPtr->compiledProcPtr = procPtr;
+	iPtr->evalFlags |= evalFile;
+	return TCL_ERROR;
+    }
+
+    TclInitByteCodeObj(objPtr, &tclByteCodeType, &compEnv);
+    TclDebugPrintByteCodeObj(objPtr);
+    TclFreeCompileEnv(&compEnv);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompCacheWatch, TclCompCacheRecord, TclCompCacheFreeDeps --
+ *
+ *	Called by TclSetByteCodeFromAny. TclCompCacheWatch, once the
+ *	CompileEnv is set up, tells whether the script is one to record: the
+ *	top level script of a file being sourced without a valid cache file,
+ *	or the body of a procedure it created. If so it hangs a CompCacheDeps
+ *	from the CompileEnv, for the compiler to note the commands it inlines
+ *	in. TclCompCacheRecord adds the compiled script to the units of the
+ *	file. TclCompCacheFreeDeps is called by TclFreeCompileEnv.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	See above.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclCompCacheWatch(
+    Tcl_Interp *interp,
+    Tcl_Obj *objPtr,		/* The script being compiled. */
+    CompileEnv *envPtr)		/* Its freshly initialized CompileEnv. */
+{
+    Interp *iPtr = (Interp *) interp;
+    Proc *procPtr = envPtr->procPtr;
+    CacheSource *sourcePtr = iPtr->compCachePtr->sourcePtr;
+    CompCacheDeps *depsPtr;
+
+    if ((sourcePtr == NULL) || !CacheUsable(iPtr)) {
+	return;
+    }
+    if (procPtr == NULL) {
+	if (!sourcePtr->recording || sourcePtr->scriptDone
+		|| (sourcePtr->scriptObj != objPtr)
+		|| (iPtr->varFramePtr->localCachePtr != NULL)) {
+	    return;
+	}
+    } else {
+	Tcl_HashEntry *hPtr = NULL;
+
+	if ((objPtr != procPtr->bodyPtr) || !ProcUsable(iPtr, procPtr)) {
+	    return;
+	}
+	for (; sourcePtr != NULL; sourcePtr = sourcePtr->nextPtr) {
+	    if (sourcePtr->recording) {
+		hPtr = Tcl_FindHashEntry(&sourcePtr->procs, procPtr);
+		if (hPtr != NULL) {
+		    break;
+		}
+	    }
+	}
+	if ((hPtr == NULL) || (Tcl_GetHashValue(hPtr) == NULL)) {
+	    return;
+	}
+    }
+
+    depsPtr = (CompCacheDeps *) Tcl_Alloc(sizeof(CompCacheDeps));
+    depsPtr->sourcePtr = sourcePtr;
+    Tcl_InitHashTable(&depsPtr->seen, TCL_STRING_KEYS);
+    Tcl_DStringInit(&depsPtr->records);
+    depsPtr->numRecords = 0;
+    envPtr->cacheDepsPtr = depsPtr;
+}
+
+void
+TclCompCacheRecord(
+    Tcl_Interp *interp,
+    Tcl_Obj *objPtr,		/* The script compiled. */
+    CompileEnv *envPtr)		/* Its CompileEnv, ready to be turned into
+				 * bytecode. */
+{
+    Interp *iPtr = (Interp *) interp;
+    CompCacheDeps *depsPtr = envPtr->cacheDepsPtr;
+    CacheSource *sourcePtr = depsPtr->sourcePtr;
+    Proc *procPtr = envPtr->procPtr;
+    Tcl_DString ctx, data;
+    Tcl_Size length;
+    const char *bytes;
+
+    /*
+     * The unit is done with whether it can be recorded or not.
+     */
+
+    if (procPtr) {
+	Tcl_HashEntry *hPtr = Tcl_FindHashEntry(&sourcePtr->procs, procPtr);
+
+	Tcl_SetHashValue(hPtr, NULL);
+    } else {
+	sourcePtr->scriptDone = 1;
+    }
+
+    Tcl_DStringInit(&data);
+    PutUInt(&data, depsPtr->numRecords);
+    Tcl_DStringAppend(&data, Tcl_DStringValue(&depsPtr->records),
+	    Tcl_DStringLength(&depsPtr->records));
+    if (EncodeUnit(iPtr, envPtr, &data) == TCL_OK) {
+	Tcl_DStringInit(&ctx);
+	EncodeContext(iPtr, objPtr, procPtr, &ctx);
+	PutBytes(&sourcePtr->units, Tcl_DStringValue(&ctx),
+		Tcl_DStringLength(&ctx));
+	bytes = TclGetStringFromObj(objPtr, &length);
+	PutBytes(&sourcePtr->units, bytes, length);
+	PutBytes(&sourcePtr->units, Tcl_DStringValue(&data),
+		Tcl_DStringLength(&data));
+	sourcePtr->numUnits++;
+	Tcl_DStringFree(&ctx);
+    }
+    Tcl_DStringFree(&data);
+}
+
+void
+TclCompCacheFreeDeps(
+    CompileEnv *envPtr)
+{
+    CompCacheDeps *depsPtr = envPtr->cacheDepsPtr;
+
+    Tcl_DeleteHashTable(&depsPtr->seen);
+    Tcl_DStringFree(&depsPtr->records);
+    Tcl_Free(depsPtr);
+    envPtr->cacheDepsPtr = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseUnit --
+ *
+ *	Free a unit taken out of the index, and the bytes of its cache file
+ *	once none of its units is left.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ReleaseUnit(
+    CacheUnit *unitPtr)
+{
+    CacheFile *filePtr = unitPtr->filePtr;
+
+    if (filePtr->refCount-- <= 1) {
+	Tcl_Free(filePtr->bytes);
+	Tcl_Free(filePtr);
+    }
+    Tcl_Free(unitPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PrivateToUser --
+ *
+ *	Tell whether the cache directory or a cache file belongs to the
+ *	effective user and is closed to everyone else. Cached bytecode is
+ *	run as found, so other users must be able to neither plant nor
+ *	change it. Windows has no such owner and mode: there the directory
+ *	is trusted as given.
+ *
+ * Results:
+ *	1 if so, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+PrivateToUser(
+    const Tcl_StatBuf *statBufPtr,
+    int mode)			/* Type and permissions it must have, such as
+				 * S_IFDIR | 0700. */
+{
+#ifdef _WIN32
+    (void) statBufPtr;
+    (void) mode;
+    return 1;
+#else
+    return (statBufPtr->st_uid == geteuid())
+	    && ((int) (statBufPtr->st_mode & (S_IFMT | 07777)) == mode);
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LoadCacheFile --
+ *
+ *	Read the cache file of a file about to be sourced and add its units
+ *	to the index, if it is valid for the file as it is now and both the
+ *	cache file and the directory are private to the user (see
+ *	PrivateToUser).
+ *
+ * Results:
+ *	TCL_OK if the cache file was used, TCL_ERROR if there is none or it is
+ *	not valid. No error message is left anywhere: a missing or stale
+ *	cache file just means the file is compiled as usual.
+ *
+ * Side effects:
+ *	Reads the cache file.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+LoadCacheFile(
+    CompCache *cachePtr,
+    CacheSource *sourcePtr)
+{
+    Tcl_StatBuf statBuf;
+    Tcl_Channel chan;
+    unsigned char *bytes;
+    CacheFile *filePtr;
+    Reader reader;
+    const unsigned char *units, *p;
+    size_t length, len;
+    Tcl_Size i, numUnits;
+    const char *string;
+    Tcl_Size stringLength;
+
+    if ((Tcl_FSStat(sourcePtr->dirObj, &statBuf) != 0)
+	    || !PrivateToUser(&statBuf, S_IFDIR | 0700)
+	    || (Tcl_FSLstat(sourcePtr->cacheFileObj, &statBuf) != 0)
+	    || !PrivateToUser(&statBuf, S_IFREG | 0600)
+	    || (Tcl_GetSizeFromStat(&statBuf) < CACHE_HEADER_LEN)
+	    || (Tcl_GetSizeFromStat(&statBuf) > (unsigned long long) TCL_SIZE_MAX)) {
+	return TCL_ERROR;
+    }
+    length = (size_t) Tcl_GetSizeFromStat(&statBuf);
+    bytes = (unsigned char *) Tcl_AttemptAlloc(length);
+    if (bytes == NULL) {
+	return TCL_ERROR;
+    }
+    chan = Tcl_FSOpenFileChannel(NULL, sourcePtr->cacheFileObj, "rb", 0);
+    if (chan == NULL) {
+	Tcl_Free(bytes);
+	return TCL_ERROR;
+    }
+    if (Tcl_Read(chan, (char *) bytes, length) != (Tcl_Size) length) {
+	Tcl_CloseEx(NULL, chan, 0);
+	Tcl_Free(bytes);
+	return TCL_ERROR;
+    }
+    Tcl_CloseEx(NULL, chan, 0);
+
+    /*
+     * Check the header and that the file is for this build and for the file
+     * being sourced as it is now.
+     */
+
+    reader.p = bytes + CACHE_HEADER_LEN;
+    reader.end = bytes + length;
+    reader.failed = 0;
+    if (memcmp(bytes, CACHE_MAGIC, CACHE_MAGIC_LEN)) {
+	goto invalid;
+    } else {
+	uint64_t checksum = 0;
+
+	for (i = 0; i < 8; i++) {
+	    checksum |= (uint64_t) bytes[CACHE_MAGIC_LEN + i] << (8 * i);
+	}
+	if (checksum != TclHashBytes(reader.p, reader.end - reader.p,
+		CACHE_SEED)) {
+	    goto invalid;
+	}
+    }
+    string = GetBuildId();
+    p = GetBytes(&reader, &len);
+    if ((len != strlen(string)) || memcmp(p, string, len)) {
+	goto invalid;
+    }
+    string = TclGetStringFromObj(sourcePtr->pathObj, &stringLength);
+    p = GetBytes(&reader, &len);
+    if ((len != (size_t) stringLength) || memcmp(p, string, len)
+	    || (GetInt(&reader) != sourcePtr->mtime)
+	    || (GetUInt(&reader) != sourcePtr->size)
+	    || (GetUInt(&reader) != sourcePtr->hash)) {
+	goto invalid;
+    }
+
+    /*
+     * Check the structure of the units before taking any of them.
+     */
+
+    numUnits = GetCount(&reader);
+    units = reader.p;
+    for (i = 0; i < numUnits; i++) {
+	GetBytes(&reader, &len);
+	GetBytes(&reader, &len);
+	GetBytes(&reader, &len);
+    }
+    if (reader.failed || (reader.p != reader.end) || (numUnits == 0)) {
+	goto invalid;
+    }
+
+    filePtr = (CacheFile *) Tcl_Alloc(sizeof(CacheFile));
+    filePtr->bytes = bytes;
+    filePtr->refCount = numUnits;
+    reader.p = units;
+    for (i = 0; i < numUnits; i++) {
+	CacheUnit *unitPtr = (CacheUnit *) Tcl_Alloc(sizeof(CacheUnit));
+	Tcl_Obj *textObj;
+	Tcl_HashEntry *hPtr;
+	int isNew;
+
+	unitPtr->filePtr = filePtr;
+	unitPtr->ctx = GetBytes(&reader, &unitPtr->ctxLen);
+	p = GetBytes(&reader, &len);
+	unitPtr->data = GetBytes(&reader, &unitPtr->dataLen);
+
+	textObj = Tcl_NewStringObj((const char *) p, len);
+	Tcl_IncrRefCount(textObj);
+	hPtr = Tcl_CreateHashEntry(&cachePtr->index, textObj, &isNew);
+	Tcl_DecrRefCount(textObj);
+	unitPtr->nextPtr = isNew ? NULL : (CacheUnit *) Tcl_GetHashValue(hPtr);
+	Tcl_SetHashValue(hPtr, unitPtr);
+    }
+    return TCL_OK;
+
+  invalid:
+    Tcl_Free(bytes);
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompCacheBegin --
+ *
+ *	Called by [source] once it has read a file and before it evaluates it.
+ *	When the cache is enabled, reads the cache file of the file if there
+ *	is a valid one, or else starts recording the scripts compiled for it.
+ *
+ * Results:
+ *	A token to pass to TclCompCacheEnd once the file has been evaluated,
+ *	or NULL if the cache is not used.
+ *
+ * Side effects:
+ *	Sets up the cache of the interpreter on first use.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void *
+TclCompCacheBegin(
+    Tcl_Interp *interp,
+    Tcl_Obj *pathPtr,		/* The file being sourced. */
+    const Tcl_StatBuf *statBufPtr,
+				/* Its status, from before it was read. */
+    Tcl_Obj *scriptObj)		/* Its text. */
+{
+    Interp *iPtr = (Interp *) interp;
+    CompCache *cachePtr;
+    CacheSource *sourcePtr;
+    Tcl_DString ds;
+    const char *dir, *script;
+    Tcl_Obj *normPathPtr, *nameObj;
+    Tcl_Size length;
+    char name[24];
+
+    if (iPtr->flags & SAFE_INTERP) {
+	return NULL;
+    }
+    dir = TclGetEnv("TCL_BYTECODE_CACHE", &ds);
+    if (dir == NULL) {
+	return NULL;
+    }
+    if (*dir == '\0') {
+	Tcl_DStringFree(&ds);
+	return NULL;
+    }
+    normPathPtr = Tcl_FSGetNormalizedPath(interp, pathPtr);
+    if (normPathPtr == NULL) {
+	Tcl_DStringFree(&ds);
+	return NULL;
+    }
+
+    cachePtr = iPtr->compCachePtr;
+    if (cachePtr == NULL) {
+	cachePtr = (CompCache *) Tcl_Alloc(sizeof(CompCache));
+	Tcl_InitObjHashTable(&cachePtr->index);
+	cachePtr->sourcePtr = NULL;
+	iPtr->compCachePtr = cachePtr;
+    }
+
+    sourcePtr = (CacheSource *) Tcl_Alloc(sizeof(CacheSource));
+    sourcePtr->scriptDone = 0;
+    sourcePtr->scriptObj = scriptObj;
+    Tcl_IncrRefCount(scriptObj);
+    sourcePtr->pathObj = normPathPtr;
+    Tcl_IncrRefCount(normPathPtr);
+    sourcePtr->dirObj = Tcl_NewStringObj(dir, TCL_INDEX_NONE);
+    Tcl_IncrRefCount(sourcePtr->dirObj);
+    Tcl_DStringFree(&ds);
+    script = TclGetStringFromObj(normPathPtr, &length);
+    snprintf(name, sizeof(name), "%016" TCL_LL_MODIFIER "x" CACHE_EXT,
+	    (unsigned long long) TclHashBytes(script, length, CACHE_SEED));
+    nameObj = Tcl_NewStringObj(name, TCL_INDEX_NONE);
+    Tcl_IncrRefCount(nameObj);
+    sourcePtr->cacheFileObj = Tcl_FSJoinToPath(sourcePtr->dirObj, 1, &nameObj);
+    Tcl_IncrRefCount(sourcePtr->cacheFileObj);
+    Tcl_DecrRefCount(nameObj);
+    sourcePtr->mtime = Tcl_GetModificationTimeFromStat(statBufPtr);
+    sourcePtr->size = Tcl_GetSizeFromStat(statBufPtr);
+    script = TclGetStringFromObj(scriptObj, &length);
+    sourcePtr->hash = TclHashBytes(script, length, CACHE_SEED);
+    Tcl_InitHashTable(&sourcePtr->procs, TCL_ONE_WORD_KEYS);
+    Tcl_DStringInit(&sourcePtr->units);
+    sourcePtr->numUnits = 0;
+    sourcePtr->recording = (LoadCacheFile(cachePtr, sourcePtr) != TCL_OK);
+
+    sourcePtr->nextPtr = cachePtr->sourcePtr;
+    cachePtr->sourcePtr = sourcePtr;
+    return sourcePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompCacheNoteProc --
+ *
+ *	Called by [proc] when it creates a procedure. If a file is being
+ *	recorded, the body of the procedure is recorded with it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Keeps a reference to the Proc until the file has been evaluated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclCompCacheNoteProc(
+    Tcl_Interp *interp,
+    Proc *procPtr)
+{
+    CacheSource *sourcePtr = ((Interp *) interp)->compCachePtr->sourcePtr;
+    Tcl_HashEntry *hPtr;
+    int isNew;
+
+    if ((sourcePtr == NULL) || !sourcePtr->recording
+	    || (procPtr->cmdPtr == NULL)) {
+	return;
+    }
+    hPtr = Tcl_CreateHashEntry(&sourcePtr->procs, procPtr, &isNew);
+    if (isNew) {
+	Tcl_SetHashValue(hPtr, INT2PTR(1));
+	procPtr->refCount++;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompCacheEnd --
+ *
+ *	Called by [source] once the file has been evaluated. If it was
+ *	recorded and evaluated without error, writes the cache file with the
+ *	scripts compiled so far. Procedures the file created but did not call
+ *	are left out: compiling them here could cost more than the cache
+ *	saves, and their bodies are compiled as usual when first called.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May write the cache file. Leaves the interpreter result alone.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclCompCacheEnd(
+    Tcl_Interp *interp,
+    void *token,		/* From TclCompCacheBegin. */
+    int result)			/* Result of the evaluation of the file. */
+{
+    Interp *iPtr = (Interp *) interp;
+    CompCache *cachePtr = iPtr->compCachePtr;
+    CacheSource *sourcePtr, **sourcePtrPtr;
+
+    if (cachePtr == NULL) {
+	return;
+    }
+    for (sourcePtrPtr = &cachePtr->sourcePtr; *sourcePtrPtr != token;
+	    sourcePtrPtr = &(*sourcePtrPtr)->nextPtr) {
+	if (*sourcePtrPtr == NULL) {
+	    return;
+	}
+    }
+    sourcePtr = (CacheSource *) token;
+
+    *sourcePtrPtr = sourcePtr->nextPtr;
+    if (sourcePtr->recording && (result == TCL_OK)
+	    && (sourcePtr->numUnits > 0)) {
+	WriteCacheFile(sourcePtr);
+    }
+    FreeCacheSource(sourcePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * WriteCacheFile --
+ *
+ *	Write the units recorded for a file to its cache file. The file is
+ *	written under a temporary name and renamed, so that other processes
+ *	never see it half written. Failures are ignored: the cache is just
+ *	not updated.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May create the cache directory, with permissions 0700, and the cache
+ *	file. Nothing is written to a directory that is not private to the
+ *	user.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+WriteCacheFile(
+    CacheSource *sourcePtr)
+{
+    Tcl_DString payload;
+    Tcl_StatBuf statBuf;
+    Tcl_Channel chan;
+    Tcl_Obj *tmpObj;
+    unsigned char header[CACHE_HEADER_LEN];
+    uint64_t checksum;
+    int i, ok;
+
+    if (Tcl_FSStat(sourcePtr->dirObj, &statBuf) != 0) {
+#ifdef _WIN32
+	if (Tcl_FSCreateDirectory(sourcePtr->dirObj) != TCL_OK) {
+	    return;
+	}
+#else
+	const char *native = (const char *)
+		Tcl_FSGetNativePath(sourcePtr->dirObj);
+
+	if ((native == NULL) || (mkdir(native, 0700) != 0)) {
+	    return;
+	}
+#endif
+	if (Tcl_FSStat(sourcePtr->dirObj, &statBuf) != 0) {
+	    return;
+	}
+    }
+    if (!PrivateToUser(&statBuf, S_IFDIR | 0700)) {
+	return;
+    }
+
+    Tcl_DStringInit(&payload);
+    PutString(&payload, GetBuildId());
+    PutString(&payload, TclGetString(sourcePtr->pathObj));
+    PutInt(&payload, sourcePtr->mtime);
+    PutUInt(&payload, sourcePtr->size);
+    PutUInt(&payload, sourcePtr->hash);
+    PutUInt(&payload, sourcePtr->numUnits);
+    Tcl_DStringAppend(&payload, Tcl_DStringValue(&sourcePtr->units),
+	    Tcl_DStringLength(&sourcePtr->units));
+
+    memcpy(header, CACHE_MAGIC, CACHE_MAGIC_LEN);
+    checksum = TclHashBytes(Tcl_DStringValue(&payload),
+	    Tcl_DStringLength(&payload), CACHE_SEED);
+    for (i = 0; i < 8; i++) {
+	header[CACHE_MAGIC_LEN + i] = (unsigned char) (checksum >> (8 * i));
+    }
+
+    TclNewObj(tmpObj);
+    Tcl_IncrRefCount(tmpObj);
+    chan = TclpOpenTemporaryFile(sourcePtr->dirObj, NULL, NULL, tmpObj);
+    if (chan == NULL) {
+	Tcl_DecrRefCount(tmpObj);
+	Tcl_DStringFree(&payload);
+	return;
+    }
+    ok = (Tcl_SetChannelOption(NULL, chan, "-translation", "binary") == TCL_OK)
+	    && (Tcl_Write(chan, (const char *) header, CACHE_HEADER_LEN)
+		    == CACHE_HEADER_LEN)
+	    && (Tcl_Write(chan, Tcl_DStringValue(&payload),
+		    Tcl_DStringLength(&payload))
+		    == Tcl_DStringLength(&payload));
+    ok = (Tcl_CloseEx(NULL, chan, 0) == TCL_OK) && ok;
+    if (!ok || (Tcl_FSRenameFile(tmpObj, sourcePtr->cacheFileObj) != TCL_OK)) {
+	Tcl_FSDeleteFile(tmpObj);
+    }
+    Tcl_DecrRefCount(tmpObj);
+    Tcl_DStringFree(&payload);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeCacheSource --
+ *
+ *	Free a CacheSource and let go of the procedures it holds.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May free Procs of deleted procedures.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeCacheSource(
+    CacheSource *sourcePtr)
+{
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+
+    for (hPtr = Tcl_FirstHashEntry(&sourcePtr->procs, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	Proc *procPtr = (Proc *) Tcl_GetHashKey(&sourcePtr->procs, hPtr);
+
+	if (procPtr->refCount-- <= 1) {
+	    TclProcCleanupProc(procPtr);
+	}
+    }
+    Tcl_DeleteHashTable(&sourcePtr->procs);
+    Tcl_DStringFree(&sourcePtr->units);
+    Tcl_DecrRefCount(sourcePtr->scriptObj);
+    Tcl_DecrRefCount(sourcePtr->pathObj);
+    Tcl_DecrRefCount(sourcePtr->dirObj);
+    Tcl_DecrRefCount(sourcePtr->cacheFileObj);
+    Tcl_Free(sourcePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompCacheDelete --
+ *
+ *	Free the cache of an interpreter being deleted.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory freed; iPtr->compCachePtr is reset.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclCompCacheDelete(
+    Interp *iPtr)
+{
+    CompCache *cachePtr = iPtr->compCachePtr;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+
+    while (cachePtr->sourcePtr != NULL) {
+	CacheSource *sourcePtr = cachePtr->sourcePtr;
+
+	cachePtr->sourcePtr = sourcePtr->nextPtr;
+	FreeCacheSource(sourcePtr);
+    }
+    for (hPtr = Tcl_FirstHashEntry(&cachePtr->index, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	CacheUnit *unitPtr = (CacheUnit *) Tcl_GetHashValue(hPtr);
+
+	while (unitPtr != NULL) {
+	    CacheUnit *nextPtr = unitPtr->nextPtr;
+
+	    ReleaseUnit(unitPtr);
+	    unitPtr = nextPtr;
+	}
+    }
+    Tcl_DeleteHashTable(&cachePtr->index);
+    Tcl_Free(cachePtr);
+    iPtr->compCachePtr = NULL;
+}
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 4
+ * fill-column: 78
+ * End:
+ */
@@ -1036,6 +1036,51 @@ static void		EnterCmdWordData(ExtCmdLoc *eclPtr, Tcl_Size srcOffset,
 			    CompileEnv *envPtr);
 static void		ReleaseCmdWordData(ExtCmdLoc *eclPtr);
 
+#ifndef TCL_NO_SHARED_BYTECODE
+/*
+ * Once compiled, the instructions and the encoded command location map of a
+ * ByteCode do not refer to its interpreter: literals, AuxData and local
+ * variables are reached through indices into arrays of the ByteCode. So
+ * ByteCodes compiled from the same script to the same instructions, in any
+ * interpreter of any thread, point into one copy of those bytes, kept in a
+ * process-wide table of reference counted blocks. Literal and AuxData arrays
+ * stay in each ByteCode. Blocks smaller than SHARED_CODE_MIN bytes are not
+ * worth the lookup and are kept in the ByteCode as before. Build with
+ * -DTCL_NO_SHARED_BYTECODE to keep all of them there.
+ */
+
+typedef struct SharedCode {
+    size_t refCount;		/* Number of ByteCodes pointing into bytes.
+				 * Guarded by sharedCodeMutex. */
+    Tcl_HashEntry *hPtr;	/* Entry of the block in sharedCodeTable, or
+				 * NULL once the table is finalized. */
+    size_t numBytes;		/* Number of bytes. */
+    unsigned char bytes[TCLFLEXARRAY];
+				/* The code bytes, padded with zeroes to
+				 * TCL_ALIGN, then the command location map. */
+} SharedCode;
+
+#define SHARED_CODE_MIN 64
+
+static size_t		HashSharedCode(Tcl_HashTable *tablePtr, void *keyPtr);
+static int		CompareSharedCode(void *keyPtr, Tcl_HashEntry *hPtr);
+static void		ReleaseSharedCode(ByteCode *codePtr);
+static void		ShareCode(ByteCode *codePtr, SharedCode *sharedPtr);
+
+static const Tcl_HashKeyType sharedCodeKeyType = {
+    TCL_HASH_KEY_TYPE_VERSION,		/* version */
+    0,					/* flags */
+    HashSharedCode,			/* hashKeyProc */
+    CompareSharedCode,			/* compareKeysProc */
+    NULL,				/* allocEntryProc */
+    NULL				/* freeEntryProc */
+};
+
+static Tcl_HashTable sharedCodeTable;
+static int sharedCodeInitialized = 0;
+TCL_DECLARE_MUTEX(sharedCodeMutex)
+#endif /* !TCL_NO_SHARED_BYTECODE */
+
 /*
  * tclByteCodeType provides the standard type management procedures for the
  * bytecode type.
@@ -1126,6 +1171,15 @@ TclSetByteCodeFromAny(
 
     stringPtr = TclGetStringFromObj(objPtr, &length);
 
+    /*
+     * A script of a sourced file may be in the bytecode cache.
+     */
+
+    if (iPtr->compCachePtr && !hookProc
+	    && TclCompCacheFetch(interp, objPtr) == TCL_OK) {
+	return TCL_OK;
+    }
+
     /*
      * TIP #280: Pick up the CmdFrame in which the BC compiler was invoked, and
      * use to initialize the tracking in the compiler. This information was
@@ -1150,6 +1204,9 @@ TclSetByteCodeFromAny(
     if (clLocPtr) {
 	compEnv.clNext = &clLocPtr->loc[0];
     }
+    if (iPtr->compCachePtr && !hookProc) {
+	TclCompCacheWatch(interp, objPtr, &compEnv);
+    }
 
     TclCompileScript(interp, stringPtr, length, &compEnv);
 
@@ -1177,6 +1234,9 @@ TclSetByteCodeFromAny(
 	if (clLocPtr) {
 	    compEnv.clNext = &clLocPtr->loc[0];
 	}
+	if (iPtr->compCachePtr && !hookProc) {
+	    TclCompCacheWatch(interp, objPtr, &compEnv);
+	}
 	compEnv.atCmdStart = 2;		/* The disabling magic. */
 	TclCompileScript(interp, stringPtr, length, &compEnv);
 	assert (compEnv.atCmdStart > 1);
@@ -1223,6 +1283,9 @@ TclSetByteCodeFromAny(
 #endif /*TCL_COMPILE_DEBUG*/
 
     if (result == TCL_OK) {
+	if (compEnv.cacheDepsPtr) {
+	    TclCompCacheRecord(interp, objPtr, &compEnv);
+	}
 	(void) TclInitByteCodeObj(objPtr, &tclByteCodeType, &compEnv);
 	TclDebugPrintByteCodeObj(objPtr);
     }
@@ -1469,9 +1532,185 @@ CleanupByteCode(
     }
 
     TclHandleRelease(codePtr->interpHandle);
+#ifndef TCL_NO_SHARED_BYTECODE
+    if (codePtr->flags & TCL_BYTECODE_SHARED_CODE) {
+	ReleaseSharedCode(codePtr);
+    }
+#endif
     Tcl_Free(codePtr);
 }
 
+#ifndef TCL_NO_SHARED_BYTECODE
+/*
+ *----------------------------------------------------------------------
+ *
+ * HashSharedCode, CompareSharedCode --
+ *
+ *	Hash key procedures of sharedCodeTable, whose keys are SharedCode
+ *	blocks compared by their bytes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static size_t
+HashSharedCode(
+    TCL_UNUSED(Tcl_HashTable *),
+    void *keyPtr)
+{
+    SharedCode *sharedPtr = (SharedCode *)keyPtr;
+
+    return (size_t) TclHashBytes(sharedPtr->bytes, sharedPtr->numBytes,
+	    (uint64_t) PTR2UINT(&sharedCodeTable));
+}
+
+static int
+CompareSharedCode(
+    void *keyPtr,
+    Tcl_HashEntry *hPtr)
+{
+    SharedCode *sharedPtr = (SharedCode *)keyPtr;
+    SharedCode *otherPtr = (SharedCode *)hPtr->key.oneWordValue;
+
+    return sharedPtr->numBytes == otherPtr->numBytes
+	    && memcmp(sharedPtr->bytes, otherPtr->bytes,
+		    sharedPtr->numBytes) == 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ShareCode --
+ *
+ *	Called by TclInitByteCode once the code bytes and command location
+ *	map of a new ByteCode are in the block sharedPtr. If the process
+ *	already holds a block with the same bytes, the ByteCode is pointed
+ *	into that one and sharedPtr is freed; otherwise sharedPtr is entered
+ *	in sharedCodeTable.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets TCL_BYTECODE_SHARED_CODE in the flags of codePtr and may move
+ *	its codeStart and command location pointers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ShareCode(
+    ByteCode *codePtr,		/* ByteCode whose bytes are in sharedPtr. */
+    SharedCode *sharedPtr)	/* Newly filled block. */
+{
+    SharedCode *usedPtr;
+    Tcl_HashEntry *hPtr;
+    int isNew;
+
+    Tcl_MutexLock(&sharedCodeMutex);
+    if (!sharedCodeInitialized) {
+	Tcl_InitCustomHashTable(&sharedCodeTable, TCL_CUSTOM_PTR_KEYS,
+		&sharedCodeKeyType);
+	sharedCodeInitialized = 1;
+    }
+    hPtr = Tcl_CreateHashEntry(&sharedCodeTable, sharedPtr, &isNew);
+    if (isNew) {
+	sharedPtr->refCount = 1;
+	sharedPtr->hPtr = hPtr;
+	usedPtr = sharedPtr;
+    } else {
+	usedPtr = (SharedCode *)Tcl_GetHashKey(&sharedCodeTable, hPtr);
+	usedPtr->refCount++;
+    }
+    Tcl_MutexUnlock(&sharedCodeMutex);
+
+    if (usedPtr != sharedPtr) {
+	ptrdiff_t delta = usedPtr->bytes - sharedPtr->bytes;
+
+	codePtr->codeStart += delta;
+	codePtr->codeDeltaStart += delta;
+	codePtr->codeLengthStart += delta;
+	codePtr->srcDeltaStart += delta;
+	codePtr->srcLengthStart += delta;
+	Tcl_Free(sharedPtr);
+    }
+    codePtr->flags |= TCL_BYTECODE_SHARED_CODE;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseSharedCode --
+ *
+ *	Drops the reference of a ByteCode being freed to its shared code
+ *	block, freeing the block when this was the last one.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May free the block and remove it from sharedCodeTable.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ReleaseSharedCode(
+    ByteCode *codePtr)
+{
+    SharedCode *sharedPtr = (SharedCode *)
+	    (codePtr->codeStart - offsetof(SharedCode, bytes));
+
+    Tcl_MutexLock(&sharedCodeMutex);
+    if (sharedPtr->refCount-- > 1) {
+	sharedPtr = NULL;
+    } else if (sharedPtr->hPtr) {
+	Tcl_DeleteHashEntry(sharedPtr->hPtr);
+    }
+    Tcl_MutexUnlock(&sharedCodeMutex);
+
+    if (sharedPtr) {
+	Tcl_Free(sharedPtr);
+    }
+}
+#endif /* !TCL_NO_SHARED_BYTECODE */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFinalizeCompilation --
+ *
+ *	Deletes the table of shared code blocks when Tcl is finalized. Blocks
+ *	still used by ByteCodes that outlive finalization are left to them.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the table.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFinalizeCompilation(void)
+{
+#ifndef TCL_NO_SHARED_BYTECODE
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+
+    Tcl_MutexLock(&sharedCodeMutex);
+    if (sharedCodeInitialized) {
+	for (hPtr = Tcl_FirstHashEntry(&sharedCodeTable, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    ((SharedCode *)Tcl_GetHashKey(&sharedCodeTable, hPtr))->hPtr = NULL;
+	}
+	Tcl_DeleteHashTable(&sharedCodeTable);
+	sharedCodeInitialized = 0;
+    }
+    Tcl_MutexUnlock(&sharedCodeMutex);
+#endif
+}
+
 /*
  * ---------------------------------------------------------------------
  *
@@ -1929,6 +2168,7 @@ TclInitCompileEnv(
      */
 
     envPtr->clNext = NULL;
+    envPtr->cacheDepsPtr = NULL;
 
     envPtr->auxDataArrayPtr = envPtr->staticAuxDataArraySpace;
     envPtr->auxDataArrayNext = 0;
@@ -2012,6 +2252,9 @@ TclFreeCompileEnv(
 	ReleaseCmdWordData(envPtr->extCmdMapPtr);
 	envPtr->extCmdMapPtr = NULL;
     }
+    if (envPtr->cacheDepsPtr) {
+	TclCompCacheFreeDeps(envPtr);
+    }
 }
 
 /*
@@ -2416,6 +2659,9 @@ CompileCommandTokens(
 
     /* If cmdPtr != NULL, try to call cmdPtr->compileProc */
     if (cmdPtr) {
+	if (envPtr->cacheDepsPtr) {
+	    TclCompCacheNoteCommand(envPtr, cmdObj, cmdPtr);
+	}
 	code = CompileCmdCompileProc(interp, parsePtr, cmdPtr, envPtr);
     }
 
@@ -3157,6 +3403,9 @@ TclInitByteCode(
     Tcl_Size i, numLitObjects = envPtr->literalArrayNext;
     Namespace *namespacePtr;
     Interp *iPtr;
+#ifndef TCL_NO_SHARED_BYTECODE
+    SharedCode *sharedPtr = NULL;
+#endif
 
     if (envPtr->iPtr == NULL) {
 	Tcl_Panic("TclInitByteCodeObj() called on uninitialized CompileEnv");
@@ -3185,6 +3434,24 @@ TclInitByteCode(
     structureSize += auxDataArrayBytes;
     structureSize += cmdLocBytes;
 
+#ifndef TCL_NO_SHARED_BYTECODE
+    /*
+     * The code bytes and the command location map go to a separate block if
+     * it is large enough to be shared, see ShareCode().
+     */
+
+    if (TCL_ALIGN(codeBytes) + cmdLocBytes >= SHARED_CODE_MIN) {
+	size_t numBytes = TCL_ALIGN(codeBytes) + cmdLocBytes;
+
+	sharedPtr = (SharedCode *)Tcl_Alloc(
+		offsetof(SharedCode, bytes) + numBytes);
+	sharedPtr->numBytes = numBytes;
+	memset(sharedPtr->bytes + codeBytes, 0,
+		TCL_ALIGN(codeBytes) - codeBytes);
+	structureSize -= numBytes;
+    }
+#endif
+
     if (envPtr->iPtr->varFramePtr != NULL) {
 	namespacePtr = envPtr->iPtr->varFramePtr->nsPtr;
     } else {
@@ -3218,10 +3485,18 @@ TclInitByteCode(
     codePtr->maxStackDepth = envPtr->maxStackDepth;
 
     p += TCL_ALIGN(sizeof(ByteCode));	/* align code bytes */
-    codePtr->codeStart = p;
-    memcpy(p, envPtr->codeStart, codeBytes);
+#ifndef TCL_NO_SHARED_BYTECODE
+    if (sharedPtr) {
+	codePtr->codeStart = sharedPtr->bytes;
+	memcpy(sharedPtr->bytes, envPtr->codeStart, codeBytes);
+    } else
+#endif
+    {
+	codePtr->codeStart = p;
+	memcpy(p, envPtr->codeStart, codeBytes);
+	p += TCL_ALIGN(codeBytes);	/* align object array */
+    }
 
-    p += TCL_ALIGN(codeBytes);		/* align object array */
     codePtr->objArrayPtr = (Tcl_Obj **) p;
     for (i = 0;  i < numLitObjects;  i++) {
 	codePtr->objArrayPtr[i] = TclFetchLiteral(envPtr, i);
@@ -3244,6 +3519,11 @@ TclInitByteCode(
     }
 
     p += auxDataArrayBytes;
+#ifndef TCL_NO_SHARED_BYTECODE
+    if (sharedPtr) {
+	p = sharedPtr->bytes + TCL_ALIGN(codeBytes);
+    }
+#endif
 #ifndef TCL_COMPILE_DEBUG
     EncodeCmdLocMap(envPtr, codePtr, (unsigned char *) p);
 #else
@@ -3254,6 +3534,11 @@ TclInitByteCode(
 		(unsigned long)(nextPtr - p), (unsigned long)cmdLocBytes);
     }
 #endif
+#ifndef TCL_NO_SHARED_BYTECODE
+    if (sharedPtr) {
+	ShareCode(codePtr, sharedPtr);
+    }
+#endif
 
     /*
      * Record various compilation-related statistics about the new ByteCode
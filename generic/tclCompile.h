@@ -454,6 +454,11 @@ typedef struct CompileEnv {
     Tcl_Size *clNext;		/* If not NULL, it refers to the next slot in
 				 * clLoc to check for an invisible
 				 * continuation line. */
+    struct CompCacheDeps *cacheDepsPtr;
+				/* If not NULL, the script is recorded for
+				 * the bytecode cache, and this collects the
+				 * commands the compiler relies on. See
+				 * tclCompCache.c. */
 } CompileEnv;
 
 /*
@@ -481,7 +486,9 @@ typedef struct LineInformation {
  * Tcl script. Note that this structure is variable length: a single heap
  * object is allocated to hold the ByteCode structure immediately followed by
  * the code bytes, the literal object array, the ExceptionRange array, the
- * CmdLocation map, and the compilation AuxData array.
+ * CmdLocation map, and the compilation AuxData array. With the flag
+ * TCL_BYTECODE_SHARED_CODE, the code bytes and the CmdLocation map are
+ * instead in a read-only block shared with other ByteCodes.
  */
 
 enum ByteCodeFlags {
@@ -502,7 +509,14 @@ enum ByteCodeFlags {
      * The recompilation may generate the same bytecode sequence, but we can't
      * prove that without doing it.
      */
-    TCL_BYTECODE_RECOMPILE = 0x0004
+    TCL_BYTECODE_RECOMPILE = 0x0004,
+
+    /*
+     * The code bytes and command location map are not in the ByteCode's own
+     * heap object but in a block shared with other ByteCodes compiled to the
+     * same instructions, possibly in other interpreters and threads.
+     */
+    TCL_BYTECODE_SHARED_CODE = 0x0008
 };
 
 typedef struct ByteCode {
@@ -1299,6 +1313,16 @@ MODULE_SCOPE void	TclClearFailedCompile(CompileEnv *envPtr,
 MODULE_SCOPE void	TclCompileCmdWord(Tcl_Interp *interp,
 			    Tcl_Token *tokenPtr, Tcl_Size count,
 			    CompileEnv *envPtr);
+MODULE_SCOPE int	TclCompCacheFetch(Tcl_Interp *interp, Tcl_Obj *objPtr);
+MODULE_SCOPE void	TclCompCacheFreeDeps(CompileEnv *envPtr);
+MODULE_SCOPE void	TclCompCacheNoteCommand(CompileEnv *envPtr,
+			    Tcl_Obj *nameObj, Command *cmdPtr);
+MODULE_SCOPE void	TclCompCacheNoteEnsemble(CompileEnv *envPtr,
+			    Tcl_Command ensemble);
+MODULE_SCOPE void	TclCompCacheRecord(Tcl_Interp *interp,
+			    Tcl_Obj *objPtr, CompileEnv *envPtr);
+MODULE_SCOPE void	TclCompCacheWatch(Tcl_Interp *interp,
+			    Tcl_Obj *objPtr, CompileEnv *envPtr);
 MODULE_SCOPE void	TclCompileExpr(Tcl_Interp *interp, const char *script,
 			    Tcl_Size numBytes, CompileEnv *envPtr, bool optimize);
 MODULE_SCOPE void	TclCompileExprWords(Tcl_Interp *interp,
@@ -1327,6 +1351,7 @@ MODULE_SCOPE Tcl_Obj *	TclCreateLiteral(Interp *iPtr, const char *bytes,
 			    Namespace *nsPtr, int flags,
 			    LiteralEntry **globalPtrPtr);
 MODULE_SCOPE void	TclDeleteExecEnv(ExecEnv *eePtr);
+MODULE_SCOPE void	TclDeleteExecEnvPool(Interp *iPtr);
 MODULE_SCOPE void	TclDeleteLiteralTable(Tcl_Interp *interp,
 			    LiteralTable *tablePtr);
 MODULE_SCOPE void	TclEmitForwardJump(CompileEnv *envPtr,
@@ -1341,6 +1366,7 @@ MODULE_SCOPE Tcl_LVTIndex TclFindCompiledLocal(const char *name, Tcl_Size nameCh
 MODULE_SCOPE void	TclFixupForwardJump(CompileEnv *envPtr,
 			    JumpFixup *jumpFixupPtr, Tcl_Size jumpDist);
 MODULE_SCOPE void	TclFreeCompileEnv(CompileEnv *envPtr);
+MODULE_SCOPE void	TclFreeCoroutineExecEnv(ExecEnv *eePtr);
 MODULE_SCOPE void	TclFreeJumpFixupArray(JumpFixupArray *fixupArrayPtr);
 MODULE_SCOPE int	TclGetIndexFromToken(Tcl_Token *tokenPtr,
 			    size_t before, size_t after, int *indexPtr);
@@ -1392,6 +1418,8 @@ MODULE_SCOPE void	TclReleaseByteCode(ByteCode *codePtr);
 MODULE_SCOPE void	TclReleaseLiteral(Tcl_Interp *interp, Tcl_Obj *objPtr);
 MODULE_SCOPE void	TclInvalidateCmdLiteral(Tcl_Interp *interp,
 			    const char *name, Namespace *nsPtr);
+MODULE_SCOPE LiteralEntry *TclLookupLiteralEntry(Tcl_Interp *interp,
+			    Tcl_Obj *objPtr);
 MODULE_SCOPE Tcl_ObjCmdProc2	TclSingleOpCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2	TclSortingOpCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2	TclVariadicOpCmd;
@@ -1408,6 +1436,8 @@ MODULE_SCOPE void	TclLogCommandInfo(Tcl_Interp *interp,
 			    Tcl_Obj **tosPtr);
 MODULE_SCOPE Tcl_Obj *	TclGetInnerContext(Tcl_Interp *interp,
 			    const unsigned char *pc, Tcl_Obj **tosPtr);
+MODULE_SCOPE ExecEnv *	TclNewCoroutineExecEnv(Tcl_Interp *interp,
+			    size_t size);
 MODULE_SCOPE Tcl_Obj *	TclNewInstNameObj(unsigned char inst);
 MODULE_SCOPE int	TclPushProcCallFrame(void *clientData,
 			    Tcl_Interp *interp, Tcl_Size objc,
@@ -1947,6 +1947,17 @@ EXTERN int		Tcl_UnregisterPostInitProc(
 /* 701 */
 EXTERN int		Tcl_ClearPostInitProcs(void);
 /* 702 */
+EXTERN Tcl_TaskGroup	Tcl_CreateTaskGroup(void);
+/* 703 */
+EXTERN void		Tcl_DeleteTaskGroup(Tcl_TaskGroup group);
+/* 704 */
+EXTERN void		Tcl_TaskPoolSubmit(Tcl_TaskGroup group,
+				Tcl_TaskProc *proc, void *clientData);
+/* 705 */
+EXTERN void		Tcl_TaskGroupWait(Tcl_TaskGroup group);
+/* 706 */
+EXTERN int		Tcl_GetTaskPoolSize(void);
+/* 707 */
 EXTERN void		TclUnusedStubEntry(void);
 
 typedef struct {
@@ -2661,7 +2672,12 @@ typedef struct TclStubs {
     int (*tcl_RegisterPostInitProc) (Tcl_PostInitProc *postInitProc, void *clientData); /* 699 */
     int (*tcl_UnregisterPostInitProc) (Tcl_PostInitProc *postInitProc, void *clientData); /* 700 */
     int (*tcl_ClearPostInitProcs) (void); /* 701 */
-    void (*tclUnusedStubEntry) (void); /* 702 */
+    Tcl_TaskGroup (*tcl_CreateTaskGroup) (void); /* 702 */
+    void (*tcl_DeleteTaskGroup) (Tcl_TaskGroup group); /* 703 */
+    void (*tcl_TaskPoolSubmit) (Tcl_TaskGroup group, Tcl_TaskProc *proc, void *clientData); /* 704 */
+    void (*tcl_TaskGroupWait) (Tcl_TaskGroup group); /* 705 */
+    int (*tcl_GetTaskPoolSize) (void); /* 706 */
+    void (*tclUnusedStubEntry) (void); /* 707 */
 } TclStubs;
 
 extern const TclStubs *tclStubsPtr;
@@ -4025,8 +4041,18 @@ extern const TclStubs *tclStubsPtr;
 	(tclStubsPtr->tcl_UnregisterPostInitProc) /* 700 */
 #define Tcl_ClearPostInitProcs \
 	(tclStubsPtr->tcl_ClearPostInitProcs) /* 701 */
+#define Tcl_CreateTaskGroup \
+	(tclStubsPtr->tcl_CreateTaskGroup) /* 702 */
+#define Tcl_DeleteTaskGroup \
+	(tclStubsPtr->tcl_DeleteTaskGroup) /* 703 */
+#define Tcl_TaskPoolSubmit \
+	(tclStubsPtr->tcl_TaskPoolSubmit) /* 704 */
+#define Tcl_TaskGroupWait \
+	(tclStubsPtr->tcl_TaskGroupWait) /* 705 */
+#define Tcl_GetTaskPoolSize \
+	(tclStubsPtr->tcl_GetTaskPoolSize) /* 706 */
 #define TclUnusedStubEntry \
-	(tclStubsPtr->tclUnusedStubEntry) /* 702 */
+	(tclStubsPtr->tclUnusedStubEntry) /* 707 */
 
 #endif /* defined(USE_TCL_STUBS) */
 
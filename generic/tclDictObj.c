@@ -47,13 +47,6 @@ static Tcl_FreeInternalRepProc	FreeDictInternalRep;
 static void			InvalidateDictChain(Tcl_Obj *dictObj);
 static Tcl_SetFromAnyProc	SetDictFromAny;
 static Tcl_UpdateStringProc	UpdateStringOfDict;
-static Tcl_AllocHashEntryProc	AllocChainEntry;
-static inline void		InitChainTable(struct Dict *dict);
-static inline void		DeleteChainTable(struct Dict *dict);
-static inline Tcl_HashEntry *	CreateChainEntry(struct Dict *dict,
-					Tcl_Obj *keyPtr, int *newPtr);
-static inline int		DeleteChainEntry(struct Dict *dict,
-					Tcl_Obj *keyPtr);
 static Tcl_NRPostProc		FinalizeDictUpdate;
 static Tcl_NRPostProc		FinalizeDictWith;
 static Tcl_ObjCmdProc2		DictForNRCmd;
@@ -93,41 +86,112 @@ const EnsembleImplMap tclDictImplMap[] = {
 };
 
 /*
- * Internal representation of the entries in the hash table that backs a
+ * Internal representation of the entries of a dictionary. The key and value
+ * each hold a reference. An entry whose key is NULL has been removed from
+ * the dictionary but still occupies its place in the insertion order until
+ * the dictionary is compacted.
+ */
+
+typedef struct DictEntry {
+    Tcl_Obj *keyPtr;		/* Key of the entry, or NULL if removed. */
+    Tcl_Obj *valuePtr;		/* Value the key maps to. */
+    size_t hash;		/* Hash of the key, see DictHashKey. */
+} DictEntry;
+
+/*
+ * The entries are kept in insertion order in a "sequence": a trie with a
+ * fanout of DICT_FANOUT that is indexed by the position of the entry, with
+ * the entries themselves stored in the leaves. Positions are never reused,
+ * so an entry stays at the same position for as long as it is in the
  * dictionary.
+ *
+ * Lookup by key goes through a hash array mapped trie (HAMT) that maps the
+ * hash of each key to its position in the sequence. Each level of the trie
+ * consumes DICT_BITS bits of the hash; only the slots actually in use are
+ * allocated, with a bitmap saying which they are. Keys whose hashes are
+ * completely equal end up in a collision node at the bottom of the trie.
+ * Dictionaries with at most DICT_LINEAR_MAX positions in their sequence do
+ * without the HAMT and are searched by scanning the sequence.
+ *
+ * All nodes of both tries are reference counted. A node referenced once is
+ * private to one dictionary and may be updated in place; any other node is
+ * shared between dictionaries and is copied (along with the path from the
+ * root to it) before it is modified. Duplicating a dictionary therefore only
+ * needs to take a reference to the two roots, and modifying either copy
+ * afterwards costs O(log n) rather than O(n).
  */
 
-typedef struct ChainEntry {
-    Tcl_HashEntry entry;
-    struct ChainEntry *prevPtr;
-    struct ChainEntry *nextPtr;
-} ChainEntry;
+#define DICT_BITS	5
+#define DICT_FANOUT	(1 << DICT_BITS)
+#define DICT_MASK	(DICT_FANOUT - 1)
+#define DICT_HASH_BITS	(sizeof(size_t) * CHAR_BIT)
+#define DICT_LINEAR_MAX	8
+
+typedef struct SeqNode {
+    size_t refCount;		/* Number of references to this node. */
+    unsigned numUsed;		/* Number of children or entries in use. */
+    unsigned numAllocated;	/* Number of entries allocated (leaves). */
+} SeqNode;
+
+typedef struct SeqBranch {
+    SeqNode node;		/* Common header. */
+    SeqNode *children[DICT_FANOUT];
+				/* Subtries, in order. */
+} SeqBranch;
+
+typedef struct SeqLeaf {
+    SeqNode node;		/* Common header. */
+    DictEntry entries[TCLFLEXARRAY];
+				/* The entries, in insertion order. */
+} SeqLeaf;
+
+#define SEQ_LEAF_SIZE(numEntries) \
+    (offsetof(SeqLeaf, entries) + (numEntries) * sizeof(DictEntry))
+
+typedef union HamtSlot {
+    struct HamtNode *nodePtr;	/* Subtrie, if the slot's bit is set in the
+				 * subnodes map of the node. */
+    size_t index;		/* Otherwise, position of the entry in the
+				 * sequence. */
+} HamtSlot;
+
+typedef struct HamtNode {
+    size_t refCount;		/* Number of references to this node. */
+    unsigned bitmap;		/* Which of the DICT_FANOUT slots are present;
+				 * unused in collision nodes. */
+    unsigned subnodes;		/* Which of the present slots are subtries. */
+    unsigned numSlots;		/* Number of elements of slots[]. */
+    HamtSlot slots[TCLFLEXARRAY];
+				/* The present slots, in order of bit. */
+} HamtNode;
+
+#define HAMT_NODE_SIZE(numSlots) \
+    (offsetof(HamtNode, slots) + (numSlots) * sizeof(HamtSlot))
 
 /*
  * Internal representation of a dictionary.
  *
- * The internal representation of a dictionary object is a hash table (with
- * Tcl_Objs for both keys and values), a reference count and epoch number for
- * detecting concurrent modifications of the dictionary, and a pointer to the
- * parent object (used when invalidating string reps of pathed dictionary
- * trees) which is NULL in normal use. The fact that hash tables know (with
- * appropriate initialisation) already about objects makes key management /so/
- * much easier!
+ * The internal representation of a dictionary object is the sequence and
+ * HAMT described above (with Tcl_Objs for both keys and values), a reference
+ * count and epoch number for detecting concurrent modifications of the
+ * dictionary, and a pointer to the parent object (used when invalidating
+ * string reps of pathed dictionary trees) which is NULL in normal use.
  *
- * Reference counts are used to enable safe iteration across hashes while
- * allowing the type of the containing object to be modified.
+ * Reference counts are used to enable safe iteration across dictionaries
+ * while allowing the type of the containing object to be modified.
  */
 
 typedef struct Dict {
-    Tcl_HashTable table;	/* Object hash table to store mapping in. */
-    ChainEntry *entryChainHead;	/* Linked list of all entries in the
-				 * dictionary. Used for doing traversal of the
-				 * entries in the order that they are
-				 * created. */
-    ChainEntry *entryChainTail;	/* Other end of linked list of all entries in
-				 * the dictionary. Used for doing traversal of
-				 * the entries in the order that they are
-				 * created. */
+    SeqNode *seqRoot;		/* Root of the sequence of entries, or NULL
+				 * if there have never been any. */
+    unsigned seqShift;		/* Number of bits of a position that are
+				 * consumed above the leaves of the
+				 * sequence. */
+    Tcl_Size seqSize;		/* Number of positions used in the sequence,
+				 * including those of removed entries. */
+    Tcl_Size numEntries;	/* Number of entries in the dictionary. */
+    HamtNode *hamtRoot;		/* Root of the lookup trie, or NULL if the
+				 * sequence is scanned instead. */
     size_t epoch;		/* Epoch counter */
     size_t refCount;		/* Reference counter (see above) */
     Tcl_Obj *chain;		/* Linked list used for invalidating the
@@ -164,25 +228,6 @@ const Tcl_ObjType tclDictType = {
 	(dictRepPtr) = irPtr ? (Dict *)irPtr->twoPtrValue.ptr1 : NULL;	\
     } while (0)
 
-/*
- * The type of the specially adapted version of the Tcl_Obj *-containing hash
- * table defined in the tclObj.c code. This version differs in that it
- * allocates a bit more space in each hash entry in order to hold the pointers
- * used to keep the hash entries in a linked list.
- *
- * Note that this type of hash table is *only* suitable for direct use in
- * *this* file. Everything else should use the dict iterator API.
- */
-
-static const Tcl_HashKeyType chainHashType = {
-    TCL_HASH_KEY_TYPE_VERSION,
-    TCL_HASH_KEY_DIRECT_COMPARE,	/* allows compare keys by pointers */
-    TclHashObjKey,
-    TclCompareObjKeys,
-    AllocChainEntry,
-    TclFreeObjEntry
-};
-
 /*
  * Structure used in implementation of 'dict map' to hold the state that gets
  * passed between parts of the implementation.
@@ -203,135 +248,734 @@ typedef struct {
 /***** START OF FUNCTIONS IMPLEMENTING DICT CORE API *****/
 
 /*
- *----------------------------------------------------------------------
- *
- * AllocChainEntry --
- *
- *	Allocate space for a Tcl_HashEntry containing the Tcl_Obj * key, and
- *	which has a bit of extra space afterwards for storing pointers to the
- *	rest of the chain of entries (the extra pointers are left NULL).
- *
- * Results:
- *	The return value is a pointer to the created entry.
- *
- * Side effects:
- *	Increments the reference count on the object.
- *
- *----------------------------------------------------------------------
+ * Helper functions that disguise most of the details relating to how the
+ * entries of a dictionary are stored. In particular, these manage the
+ * sequence of entries and the lookup trie that indexes it, the sharing of
+ * their nodes between dictionaries, and the creation, lookup and removal of
+ * entries.
  */
 
-static Tcl_HashEntry *
-AllocChainEntry(
-    TCL_UNUSED(Tcl_HashTable *),
-    void *keyPtr)
+static inline unsigned
+BitCount(
+    unsigned bits)
 {
-    Tcl_Obj *objPtr = (Tcl_Obj *)keyPtr;
-    ChainEntry *cPtr;
+#if defined(__GNUC__)
+    return (unsigned) __builtin_popcount(bits);
+#else
+    unsigned count = 0;
 
-    cPtr = (ChainEntry *)Tcl_Alloc(sizeof(ChainEntry));
-    cPtr->entry.key.objPtr = objPtr;
-    Tcl_IncrRefCount(objPtr);
-    Tcl_SetHashValue(&cPtr->entry, NULL);
-    cPtr->prevPtr = cPtr->nextPtr = NULL;
+    while (bits) {
+	bits &= bits - 1;
+	count++;
+    }
+    return count;
+#endif
+}
+
+static inline size_t
+DictHashKey(
+    Tcl_Obj *keyPtr)
+{
+#ifdef TCL_HASH_SEED
+    /*
+     * The lookup trie consumes the hash a few bits at a time and only tells
+     * keys apart by comparing them once all of it is used up, so this wants
+     * a hash that spreads keys over all bits of the word. The seeded hash of
+     * Tcl_Obj hash table keys does, and keys cannot be chosen to collide in
+     * it either.
+     */
+
+    return TclHashObjKey(NULL, keyPtr);
+#else
+    Tcl_Size length;
+    const unsigned char *p = (const unsigned char *)
+	    TclGetStringFromObj(keyPtr, &length);
+    size_t hash = 0x811C9DC5U;
+
+    /*
+     * The lookup trie consumes the hash a few bits at a time and only tells
+     * keys apart by comparing them once all of it is used up, so this wants
+     * fewer collisions than the shift-and-add hash of the generic hash
+     * tables (which maps "k09" and "k10" together, for example). FNV-1a,
+     * followed by a mix to spread the result over all bits of the word.
+     */
 
-    return &cPtr->entry;
+    while (length-- > 0) {
+	hash = (hash ^ *p++) * 0x01000193U;
+    }
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6DU;
+    hash ^= hash >> 12;
+    hash *= 0x297A2D39U;
+    hash ^= hash >> 15;
+    return hash;
+#endif /* TCL_HASH_SEED */
 }
 
+static inline int
+SameKey(
+    Tcl_Obj *keyPtr,
+    Tcl_Obj *otherPtr)
+{
+    const char *p1, *p2;
+    Tcl_Size l1, l2;
+
+    if (keyPtr == otherPtr) {
+	return 1;
+    }
+    p1 = TclGetStringFromObj(keyPtr, &l1);
+    p2 = TclGetStringFromObj(otherPtr, &l2);
+    return (l1 == l2) && (memcmp(p1, p2, l1) == 0);
+}
+
 /*
- * Helper functions that disguise most of the details relating to how the
- * linked list of hash entries is managed. In particular, these manage the
- * creation of the table and initializing of the chain, the deletion of the
- * table and chain, the adding of an entry to the chain, and the removal of an
- * entry from the chain.
+ * Operations on the sequence of entries.
  */
 
-static inline void
-InitChainTable(
-    Dict *dict)
+static SeqNode *
+NewSeqNode(
+    unsigned shift,		/* 0 for a leaf, otherwise a branch. */
+    unsigned numAllocated)	/* Number of entries to allocate (leaves). */
 {
-    Tcl_InitCustomHashTable(&dict->table, TCL_CUSTOM_PTR_KEYS,
-	    &chainHashType);
-    dict->entryChainHead = dict->entryChainTail = NULL;
+    SeqNode *nodePtr;
+
+    if (shift == 0) {
+	nodePtr = (SeqNode *)Tcl_Alloc(SEQ_LEAF_SIZE(numAllocated));
+    } else {
+	nodePtr = (SeqNode *)Tcl_Alloc(sizeof(SeqBranch));
+	numAllocated = DICT_FANOUT;
+    }
+    nodePtr->refCount = 1;
+    nodePtr->numUsed = 0;
+    nodePtr->numAllocated = numAllocated;
+    return nodePtr;
 }
 
-static inline void
-DeleteChainTable(
-    Dict *dict)
+static void
+ReleaseSeqNode(
+    SeqNode *nodePtr,
+    unsigned shift)
 {
-    ChainEntry *cPtr;
+    unsigned i;
 
-    for (cPtr=dict->entryChainHead ; cPtr!=NULL ; cPtr=cPtr->nextPtr) {
-	Tcl_Obj *valuePtr = (Tcl_Obj *)Tcl_GetHashValue(&cPtr->entry);
+    if (nodePtr->refCount-- > 1) {
+	return;
+    }
+    if (shift == 0) {
+	DictEntry *entryPtr = ((SeqLeaf *) nodePtr)->entries;
 
-	TclDecrRefCount(valuePtr);
+	for (i = 0 ; i < nodePtr->numUsed ; i++, entryPtr++) {
+	    if (entryPtr->keyPtr != NULL) {
+		TclDecrRefCount(entryPtr->keyPtr);
+		TclDecrRefCount(entryPtr->valuePtr);
+	    }
+	}
+    } else {
+	SeqBranch *branchPtr = (SeqBranch *) nodePtr;
+
+	for (i = 0 ; i < nodePtr->numUsed ; i++) {
+	    ReleaseSeqNode(branchPtr->children[i], shift - DICT_BITS);
+	}
     }
-    Tcl_DeleteHashTable(&dict->table);
+    Tcl_Free(nodePtr);
 }
 
-static inline Tcl_HashEntry *
-CreateChainEntry(
+/*
+ * Make the node in *nodePtrPtr private to the dictionary that holds the
+ * reference, copying it if it is shared. Leaves are also grown to hold at
+ * least minAllocated entries.
+ */
+
+static SeqNode *
+UnshareSeqNode(
+    SeqNode **nodePtrPtr,
+    unsigned shift,
+    unsigned minAllocated)
+{
+    SeqNode *nodePtr = *nodePtrPtr, *copyPtr;
+    unsigned i, numAllocated = nodePtr->numAllocated;
+
+    while (numAllocated < minAllocated) {
+	numAllocated *= 2;
+    }
+    if (numAllocated > DICT_FANOUT) {
+	numAllocated = DICT_FANOUT;
+    }
+
+    if (nodePtr->refCount == 1) {
+	if (numAllocated != nodePtr->numAllocated) {
+	    nodePtr = (SeqNode *)Tcl_Realloc(nodePtr,
+		    SEQ_LEAF_SIZE(numAllocated));
+	    nodePtr->numAllocated = numAllocated;
+	    *nodePtrPtr = nodePtr;
+	}
+	return nodePtr;
+    }
+
+    copyPtr = NewSeqNode(shift, numAllocated);
+    copyPtr->numUsed = nodePtr->numUsed;
+    if (shift == 0) {
+	DictEntry *entryPtr = ((SeqLeaf *) copyPtr)->entries;
+
+	memcpy(entryPtr, ((SeqLeaf *) nodePtr)->entries,
+		nodePtr->numUsed * sizeof(DictEntry));
+	for (i = 0 ; i < nodePtr->numUsed ; i++, entryPtr++) {
+	    if (entryPtr->keyPtr != NULL) {
+		Tcl_IncrRefCount(entryPtr->keyPtr);
+		Tcl_IncrRefCount(entryPtr->valuePtr);
+	    }
+	}
+    } else {
+	SeqBranch *branchPtr = (SeqBranch *) copyPtr;
+
+	memcpy(branchPtr->children, ((SeqBranch *) nodePtr)->children,
+		nodePtr->numUsed * sizeof(SeqNode *));
+	for (i = 0 ; i < nodePtr->numUsed ; i++) {
+	    branchPtr->children[i]->refCount++;
+	}
+    }
+    nodePtr->refCount--;
+    *nodePtrPtr = copyPtr;
+    return copyPtr;
+}
+
+/*
+ * Read-only access to the entry at a position in the sequence.
+ */
+
+static inline DictEntry *
+SeqEntry(
+    const Dict *dict,
+    Tcl_Size index)
+{
+    SeqNode *nodePtr = dict->seqRoot;
+    unsigned shift;
+
+    for (shift = dict->seqShift ; shift > 0 ; shift -= DICT_BITS) {
+	nodePtr = ((SeqBranch *) nodePtr)->children[
+		(index >> shift) & DICT_MASK];
+    }
+    return &((SeqLeaf *) nodePtr)->entries[index & DICT_MASK];
+}
+
+/*
+ * Writable access to the entry at a position in the sequence. Shared nodes
+ * on the path to it are copied first, which also makes the references held
+ * by the entry count once for every dictionary that can reach it. Anything
+ * that hands a value out to code that might modify it in place when it is
+ * unshared must therefore use this rather than SeqEntry.
+ */
+
+static DictEntry *
+SeqEntryForUpdate(
+    Dict *dict,
+    Tcl_Size index)
+{
+    SeqNode **nodePtrPtr = &dict->seqRoot, *nodePtr;
+    unsigned shift;
+
+    for (shift = dict->seqShift ; shift > 0 ; shift -= DICT_BITS) {
+	nodePtr = UnshareSeqNode(nodePtrPtr, shift, 0);
+	nodePtrPtr = &((SeqBranch *) nodePtr)->children[
+		(index >> shift) & DICT_MASK];
+    }
+    nodePtr = UnshareSeqNode(nodePtrPtr, 0, 0);
+    return &((SeqLeaf *) nodePtr)->entries[index & DICT_MASK];
+}
+
+/*
+ * Add an entry for a key at the end of the sequence. The entry takes a
+ * reference to the key; its value is left for the caller to fill in.
+ */
+
+static DictEntry *
+SeqAppend(
     Dict *dict,
     Tcl_Obj *keyPtr,
-    int *newPtr)
+    size_t hash)
 {
-    ChainEntry *cPtr = (ChainEntry *)
-	    Tcl_CreateHashEntry(&dict->table, keyPtr, newPtr);
+    Tcl_Size index = dict->seqSize;
+    SeqNode **nodePtrPtr, *nodePtr;
+    DictEntry *entryPtr;
+    unsigned shift, slot;
+
+    if (dict->seqRoot == NULL) {
+	dict->seqRoot = NewSeqNode(0, DICT_LINEAR_MAX / 2);
+	dict->seqShift = 0;
+    } else if (index >> (dict->seqShift + DICT_BITS)) {
+	/*
+	 * The trie is full; add a level on top.
+	 */
 
-    /*
-     * If this is a new entry in the hash table, stitch it into the chain.
-     */
+	nodePtr = NewSeqNode(dict->seqShift + DICT_BITS, 0);
+	((SeqBranch *) nodePtr)->children[0] = dict->seqRoot;
+	nodePtr->numUsed = 1;
+	dict->seqRoot = nodePtr;
+	dict->seqShift += DICT_BITS;
+    }
+
+    nodePtrPtr = &dict->seqRoot;
+    for (shift = dict->seqShift ; shift > 0 ; shift -= DICT_BITS) {
+	nodePtr = UnshareSeqNode(nodePtrPtr, shift, 0);
+	slot = (index >> shift) & DICT_MASK;
+	if (slot == nodePtr->numUsed) {
+	    ((SeqBranch *) nodePtr)->children[slot] =
+		    NewSeqNode(shift - DICT_BITS, DICT_FANOUT);
+	    nodePtr->numUsed++;
+	}
+	nodePtrPtr = &((SeqBranch *) nodePtr)->children[slot];
+    }
 
-    if (*newPtr) {
-	cPtr->nextPtr = NULL;
-	if (dict->entryChainHead == NULL) {
-	    cPtr->prevPtr = NULL;
-	    dict->entryChainHead = cPtr;
-	    dict->entryChainTail = cPtr;
-	} else {
-	    cPtr->prevPtr = dict->entryChainTail;
-	    dict->entryChainTail->nextPtr = cPtr;
-	    dict->entryChainTail = cPtr;
+    slot = index & DICT_MASK;
+    nodePtr = UnshareSeqNode(nodePtrPtr, 0, slot + 1);
+    assert(nodePtr->numUsed == slot);
+    entryPtr = &((SeqLeaf *) nodePtr)->entries[slot];
+    entryPtr->keyPtr = keyPtr;
+    Tcl_IncrRefCount(keyPtr);
+    entryPtr->valuePtr = NULL;
+    entryPtr->hash = hash;
+    nodePtr->numUsed++;
+    dict->seqSize++;
+    return entryPtr;
+}
+
+/*
+ * Operations on the lookup trie.
+ */
+
+static void
+RetainHamtChildren(
+    HamtNode *nodePtr)
+{
+    unsigned bit, i;
+
+    if (nodePtr->subnodes == 0) {
+	return;
+    }
+    for (bit = 1, i = 0 ; bit != 0 ; bit <<= 1) {
+	if (nodePtr->bitmap & bit) {
+	    if (nodePtr->subnodes & bit) {
+		nodePtr->slots[i].nodePtr->refCount++;
+	    }
+	    i++;
 	}
     }
+}
 
-    return &cPtr->entry;
+static void
+ReleaseHamtNode(
+    HamtNode *nodePtr)
+{
+    unsigned bit, i;
+
+    if (nodePtr->refCount-- > 1) {
+	return;
+    }
+    if (nodePtr->subnodes != 0) {
+	for (bit = 1, i = 0 ; bit != 0 ; bit <<= 1) {
+	    if (nodePtr->bitmap & bit) {
+		if (nodePtr->subnodes & bit) {
+		    ReleaseHamtNode(nodePtr->slots[i].nodePtr);
+		}
+		i++;
+	    }
+	}
+    }
+    Tcl_Free(nodePtr);
 }
 
-static inline int
-DeleteChainEntry(
-    Dict *dict,
-    Tcl_Obj *keyPtr)
+static HamtNode *
+UnshareHamtNode(
+    HamtNode **nodePtrPtr)
 {
-    ChainEntry *cPtr = (ChainEntry *)
-	    Tcl_FindHashEntry(&dict->table, keyPtr);
+    HamtNode *nodePtr = *nodePtrPtr, *copyPtr;
+
+    if (nodePtr->refCount == 1) {
+	return nodePtr;
+    }
+    copyPtr = (HamtNode *)Tcl_Alloc(HAMT_NODE_SIZE(nodePtr->numSlots));
+    memcpy(copyPtr, nodePtr, HAMT_NODE_SIZE(nodePtr->numSlots));
+    copyPtr->refCount = 1;
+    RetainHamtChildren(copyPtr);
+    nodePtr->refCount--;
+    *nodePtrPtr = copyPtr;
+    return copyPtr;
+}
 
-    if (cPtr == NULL) {
-	return 0;
+/*
+ * Open up (if insert is true) or close up the slot at position pos of a
+ * private node. The caller updates the maps and fills in a new slot.
+ */
+
+static HamtNode *
+ResizeHamtNode(
+    HamtNode **nodePtrPtr,
+    unsigned pos,
+    int insert)
+{
+    HamtNode *nodePtr = *nodePtrPtr;
+    unsigned numSlots = nodePtr->numSlots;
+
+    assert(nodePtr->refCount == 1);
+    if (insert) {
+	nodePtr = (HamtNode *)Tcl_Realloc(nodePtr,
+		HAMT_NODE_SIZE(numSlots + 1));
+	memmove(nodePtr->slots + pos + 1, nodePtr->slots + pos,
+		(numSlots - pos) * sizeof(HamtSlot));
+	nodePtr->numSlots = numSlots + 1;
     } else {
-	Tcl_Obj *valuePtr = (Tcl_Obj *)Tcl_GetHashValue(&cPtr->entry);
+	memmove(nodePtr->slots + pos, nodePtr->slots + pos + 1,
+		(numSlots - pos - 1) * sizeof(HamtSlot));
+	nodePtr->numSlots = numSlots - 1;
+    }
+    *nodePtrPtr = nodePtr;
+    return nodePtr;
+}
+
+/*
+ * Record in the trie that the entry for a key with the given hash is at the
+ * given position of the sequence. The key must not be in the trie already.
+ */
 
-	TclDecrRefCount(valuePtr);
+static void
+HamtInsert(
+    const Dict *dict,
+    HamtNode **nodePtrPtr,
+    size_t hash,
+    size_t index,
+    unsigned shift)
+{
+    HamtNode *nodePtr = *nodePtrPtr, *subPtr;
+    unsigned bit, pos;
+    size_t otherIndex;
+
+    if (nodePtr == NULL) {
+	nodePtr = (HamtNode *)Tcl_Alloc(HAMT_NODE_SIZE(1));
+	nodePtr->refCount = 1;
+	nodePtr->bitmap = (shift < DICT_HASH_BITS)
+		? 1U << ((hash >> shift) & DICT_MASK) : 0;
+	nodePtr->subnodes = 0;
+	nodePtr->numSlots = 1;
+	nodePtr->slots[0].index = index;
+	*nodePtrPtr = nodePtr;
+	return;
     }
 
-    /*
-     * Unstitch from the chain.
-     */
+    nodePtr = UnshareHamtNode(nodePtrPtr);
+    if (shift >= DICT_HASH_BITS) {
+	/*
+	 * All bits of the hash are used up: collision node.
+	 */
+
+	nodePtr = ResizeHamtNode(nodePtrPtr, nodePtr->numSlots, 1);
+	nodePtr->slots[nodePtr->numSlots - 1].index = index;
+	return;
+    }
 
-    if (cPtr->nextPtr) {
-	cPtr->nextPtr->prevPtr = cPtr->prevPtr;
+    bit = 1U << ((hash >> shift) & DICT_MASK);
+    pos = BitCount(nodePtr->bitmap & (bit - 1));
+    if (!(nodePtr->bitmap & bit)) {
+	nodePtr = ResizeHamtNode(nodePtrPtr, pos, 1);
+	nodePtr->bitmap |= bit;
+	nodePtr->slots[pos].index = index;
+    } else if (nodePtr->subnodes & bit) {
+	HamtInsert(dict, &nodePtr->slots[pos].nodePtr, hash, index,
+		shift + DICT_BITS);
     } else {
-	dict->entryChainTail = cPtr->prevPtr;
+	/*
+	 * The slot is taken by another entry; push both down a level.
+	 */
+
+	otherIndex = nodePtr->slots[pos].index;
+	subPtr = NULL;
+	HamtInsert(dict, &subPtr, SeqEntry(dict, otherIndex)->hash,
+		otherIndex, shift + DICT_BITS);
+	HamtInsert(dict, &subPtr, hash, index, shift + DICT_BITS);
+	nodePtr->slots[pos].nodePtr = subPtr;
+	nodePtr->subnodes |= bit;
     }
-    if (cPtr->prevPtr) {
-	cPtr->prevPtr->nextPtr = cPtr->nextPtr;
+}
+
+/*
+ * Remove the record of the entry at the given position, which must be in
+ * the trie, for a key with the given hash.
+ */
+
+static void
+HamtRemove(
+    HamtNode **nodePtrPtr,
+    size_t hash,
+    size_t index,
+    unsigned shift)
+{
+    HamtNode *nodePtr = UnshareHamtNode(nodePtrPtr), *subPtr;
+    unsigned bit, pos;
+
+    if (shift >= DICT_HASH_BITS) {
+	for (pos = 0 ; nodePtr->slots[pos].index != index ; pos++) {
+	    assert(pos < nodePtr->numSlots);
+	}
+    } else {
+	bit = 1U << ((hash >> shift) & DICT_MASK);
+	pos = BitCount(nodePtr->bitmap & (bit - 1));
+	assert(nodePtr->bitmap & bit);
+	if (nodePtr->subnodes & bit) {
+	    HamtRemove(&nodePtr->slots[pos].nodePtr, hash, index,
+		    shift + DICT_BITS);
+	    subPtr = nodePtr->slots[pos].nodePtr;
+	    if (subPtr != NULL) {
+		if (subPtr->numSlots == 1 && subPtr->subnodes == 0) {
+		    /*
+		     * Pull a lone entry up so that lookups stay short.
+		     */
+
+		    nodePtr->slots[pos].index = subPtr->slots[0].index;
+		    nodePtr->subnodes &= ~bit;
+		    ReleaseHamtNode(subPtr);
+		}
+		return;
+	    }
+	    nodePtr->subnodes &= ~bit;
+	}
+	nodePtr->bitmap &= ~bit;
+    }
+
+    if (nodePtr->numSlots == 1) {
+	Tcl_Free(nodePtr);
+	*nodePtrPtr = NULL;
     } else {
-	dict->entryChainHead = cPtr->nextPtr;
+	ResizeHamtNode(nodePtrPtr, pos, 0);
     }
+}
+
+static void
+BuildHamt(
+    Dict *dict)
+{
+    Tcl_Size i;
+
+    for (i = 0 ; i < dict->seqSize ; i++) {
+	DictEntry *entryPtr = SeqEntry(dict, i);
+
+	if (entryPtr->keyPtr != NULL) {
+	    HamtInsert(dict, &dict->hamtRoot, entryPtr->hash, i, 0);
+	}
+    }
+}
+
+/*
+ * Find the position in the sequence of the entry for a key, or
+ * TCL_INDEX_NONE if the key is not in the dictionary.
+ */
+
+static Tcl_Size
+DictFind(
+    const Dict *dict,
+    Tcl_Obj *keyPtr,
+    size_t hash)
+{
+    const HamtNode *nodePtr = dict->hamtRoot;
+    const DictEntry *entryPtr;
+    unsigned shift, bit, pos;
+    Tcl_Size i;
 
-    Tcl_DeleteHashEntry(&cPtr->entry);
+    if (nodePtr == NULL) {
+	for (i = 0 ; i < dict->seqSize ; i++) {
+	    entryPtr = SeqEntry(dict, i);
+	    if (entryPtr->keyPtr != NULL && entryPtr->hash == hash
+		    && SameKey(keyPtr, entryPtr->keyPtr)) {
+		return i;
+	    }
+	}
+	return TCL_INDEX_NONE;
+    }
+
+    for (shift = 0 ; shift < DICT_HASH_BITS ; shift += DICT_BITS) {
+	bit = 1U << ((hash >> shift) & DICT_MASK);
+	if (!(nodePtr->bitmap & bit)) {
+	    return TCL_INDEX_NONE;
+	}
+	pos = BitCount(nodePtr->bitmap & (bit - 1));
+	if (!(nodePtr->subnodes & bit)) {
+	    i = (Tcl_Size) nodePtr->slots[pos].index;
+	    entryPtr = SeqEntry(dict, i);
+	    if (entryPtr->hash == hash && SameKey(keyPtr, entryPtr->keyPtr)) {
+		return i;
+	    }
+	    return TCL_INDEX_NONE;
+	}
+	nodePtr = nodePtr->slots[pos].nodePtr;
+    }
+
+    for (pos = 0 ; pos < nodePtr->numSlots ; pos++) {
+	i = (Tcl_Size) nodePtr->slots[pos].index;
+	if (SameKey(keyPtr, SeqEntry(dict, i)->keyPtr)) {
+	    return i;
+	}
+    }
+    return TCL_INDEX_NONE;
+}
+
+static inline void
+InitDictStorage(
+    Dict *dict)
+{
+    dict->seqRoot = NULL;
+    dict->seqShift = 0;
+    dict->seqSize = 0;
+    dict->numEntries = 0;
+    dict->hamtRoot = NULL;
+}
+
+static inline void
+DeleteDictStorage(
+    Dict *dict)
+{
+    if (dict->seqRoot != NULL) {
+	ReleaseSeqNode(dict->seqRoot, dict->seqShift);
+    }
+    if (dict->hamtRoot != NULL) {
+	ReleaseHamtNode(dict->hamtRoot);
+    }
+}
+
+/*
+ * Rebuild the storage of a dictionary without the holes left by removed
+ * entries. Done when they outnumber the entries, so the cost is amortized
+ * over the removals.
+ */
+
+static void
+CompactDict(
+    Dict *dict)
+{
+    Dict compacted;
+    Tcl_Size i;
+
+    InitDictStorage(&compacted);
+    for (i = 0 ; i < dict->seqSize ; i++) {
+	DictEntry *entryPtr = SeqEntry(dict, i);
+
+	if (entryPtr->keyPtr != NULL) {
+	    DictEntry *newEntryPtr = SeqAppend(&compacted, entryPtr->keyPtr,
+		    entryPtr->hash);
+
+	    newEntryPtr->valuePtr = entryPtr->valuePtr;
+	    Tcl_IncrRefCount(newEntryPtr->valuePtr);
+	}
+    }
+    if (compacted.seqSize > DICT_LINEAR_MAX) {
+	BuildHamt(&compacted);
+    }
+    DeleteDictStorage(dict);
+    dict->seqRoot = compacted.seqRoot;
+    dict->seqShift = compacted.seqShift;
+    dict->seqSize = compacted.seqSize;
+    dict->numEntries = compacted.seqSize;
+    dict->hamtRoot = compacted.hamtRoot;
+}
+
+/*
+ * Look up the entry for a key without taking a private copy of it. The
+ * value must not be modified even if it is unshared, as it may also be in
+ * other dictionaries.
+ */
+
+static inline DictEntry *
+FindDictEntry(
+    const Dict *dict,
+    Tcl_Obj *keyPtr)
+{
+    Tcl_Size index = DictFind(dict, keyPtr, DictHashKey(keyPtr));
+
+    return (index == TCL_INDEX_NONE) ? NULL : SeqEntry(dict, index);
+}
+
+/*
+ * Find the entry for a key, making it if it is not there (in which case its
+ * value is NULL and must be filled in by the caller). The entry returned is
+ * private to the dictionary and may be updated.
+ */
+
+static DictEntry *
+CreateDictEntry(
+    Dict *dict,
+    Tcl_Obj *keyPtr,
+    int *newPtr)
+{
+    size_t hash = DictHashKey(keyPtr);
+    Tcl_Size index = DictFind(dict, keyPtr, hash);
+    DictEntry *entryPtr;
+
+    if (index != TCL_INDEX_NONE) {
+	*newPtr = 0;
+	return SeqEntryForUpdate(dict, index);
+    }
+
+    *newPtr = 1;
+    entryPtr = SeqAppend(dict, keyPtr, hash);
+    dict->numEntries++;
+    if (dict->hamtRoot != NULL) {
+	HamtInsert(dict, &dict->hamtRoot, hash, dict->seqSize - 1, 0);
+    } else if (dict->seqSize > DICT_LINEAR_MAX) {
+	BuildHamt(dict);
+    }
+    return entryPtr;
+}
+
+static int
+DeleteDictEntry(
+    Dict *dict,
+    Tcl_Obj *keyPtr)
+{
+    size_t hash = DictHashKey(keyPtr);
+    Tcl_Size index = DictFind(dict, keyPtr, hash), numRemoved;
+    DictEntry *entryPtr;
+
+    if (index == TCL_INDEX_NONE) {
+	return 0;
+    }
+
+    if (dict->hamtRoot != NULL) {
+	HamtRemove(&dict->hamtRoot, hash, index, 0);
+    }
+    entryPtr = SeqEntryForUpdate(dict, index);
+    TclDecrRefCount(entryPtr->keyPtr);
+    TclDecrRefCount(entryPtr->valuePtr);
+    entryPtr->keyPtr = entryPtr->valuePtr = NULL;
+    dict->numEntries--;
+
+    numRemoved = dict->seqSize - dict->numEntries;
+    if (dict->numEntries == 0) {
+	DeleteDictStorage(dict);
+	InitDictStorage(dict);
+    } else if (numRemoved > dict->numEntries && numRemoved >= DICT_FANOUT) {
+	CompactDict(dict);
+    }
     return 1;
 }
 
+/*
+ * Step through the entries in insertion order. *indexPtr is the position to
+ * continue from, and is advanced past the entry returned. NULL is returned
+ * when there are no more entries.
+ */
+
+static inline DictEntry *
+NextDictEntry(
+    const Dict *dict,
+    Tcl_Size *indexPtr)
+{
+    while (*indexPtr < dict->seqSize) {
+	DictEntry *entryPtr = SeqEntry(dict, (*indexPtr)++);
+
+	if (entryPtr->keyPtr != NULL) {
+	    return entryPtr;
+	}
+    }
+    return NULL;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -346,10 +990,9 @@ DeleteChainEntry(
  * Side effects:
  *	"srcPtr"s dictionary internal rep pointer should not be NULL and we
  *	assume it is not NULL. We set "copyPtr"s internal rep to a pointer to
- *	a newly allocated dictionary rep that, in turn, points to "srcPtr"s
- *	key and value objects. Those objects are not actually copied but are
- *	shared between "srcPtr" and "copyPtr". The ref count of each key and
- *	value object is incremented.
+ *	a newly allocated dictionary rep that shares the storage of "srcPtr"s
+ *	dictionary; whichever of the two is modified later copies the parts
+ *	of it that it changes.
  *
  *----------------------------------------------------------------------
  */
@@ -360,27 +1003,23 @@ DupDictInternalRep(
     Tcl_Obj *copyPtr)
 {
     Dict *oldDict, *newDict = (Dict *)Tcl_Alloc(sizeof(Dict));
-    ChainEntry *cPtr;
 
     DictGetInternalRep(srcPtr, oldDict);
 
     /*
-     * Copy values across from the old hash table.
+     * Share the storage of the old dictionary.
      */
 
-    InitChainTable(newDict);
-    for (cPtr=oldDict->entryChainHead ; cPtr!=NULL ; cPtr=cPtr->nextPtr) {
-	Tcl_Obj *key = (Tcl_Obj *)Tcl_GetHashKey(&oldDict->table, &cPtr->entry);
-	Tcl_Obj *valuePtr = (Tcl_Obj *)Tcl_GetHashValue(&cPtr->entry);
-	int n;
-	Tcl_HashEntry *hPtr = CreateChainEntry(newDict, key, &n);
-
-	/*
-	 * Fill in the contents.
-	 */
-
-	Tcl_SetHashValue(hPtr, valuePtr);
-	Tcl_IncrRefCount(valuePtr);
+    newDict->seqRoot = oldDict->seqRoot;
+    newDict->seqShift = oldDict->seqShift;
+    newDict->seqSize = oldDict->seqSize;
+    newDict->numEntries = oldDict->numEntries;
+    newDict->hamtRoot = oldDict->hamtRoot;
+    if (newDict->seqRoot != NULL) {
+	newDict->seqRoot->refCount++;
+    }
+    if (newDict->hamtRoot != NULL) {
+	newDict->hamtRoot->refCount++;
     }
 
     /*
@@ -453,7 +1092,7 @@ static void
 DeleteDict(
     Dict *dict)
 {
-    DeleteChainTable(dict);
+    DeleteDictStorage(dict);
     Tcl_Free(dict);
 }
 
@@ -486,25 +1125,20 @@ UpdateStringOfDict(
 #define LOCAL_SIZE 64
     char localFlags[LOCAL_SIZE], *flagPtr = NULL;
     Dict *dict;
-    ChainEntry *cPtr;
+    DictEntry *entryPtr;
     Tcl_Obj *keyPtr, *valuePtr;
-    Tcl_Size i, length;
+    Tcl_Size i, index, length;
     size_t bytesNeeded = 0;
     const char *elem;
     char *dst;
 
-    /*
-     * This field is the most useful one in the whole hash structure, and it
-     * is not exposed by any API function...
-     */
-
     Tcl_Size numElems;
 
     DictGetInternalRep(dictPtr, dict);
 
     assert (dict != NULL);
 
-    numElems = dict->table.numEntries * 2;
+    numElems = dict->numEntries * 2;
 
     /* Handle empty list case first, simplifies what follows */
     if (numElems == 0) {
@@ -521,18 +1155,19 @@ UpdateStringOfDict(
     } else {
 	flagPtr = (char *)Tcl_Alloc(numElems);
     }
-    for (i=0,cPtr=dict->entryChainHead; i<numElems; i+=2,cPtr=cPtr->nextPtr) {
+    for (i=0,index=0; i<numElems; i+=2) {
 	/*
-	 * Assume that cPtr is never NULL since we know the number of array
+	 * Assume that entryPtr is never NULL since we know the number of array
 	 * elements already.
 	 */
 
+	entryPtr = NextDictEntry(dict, &index);
 	flagPtr[i] = ( i ? TCL_DONT_QUOTE_HASH : 0 );
-	keyPtr = (Tcl_Obj *)Tcl_GetHashKey(&dict->table, &cPtr->entry);
+	keyPtr = entryPtr->keyPtr;
 	elem = TclGetStringFromObj(keyPtr, &length);
 	bytesNeeded += TclScanElement(elem, length, flagPtr+i);
 	flagPtr[i+1] = TCL_DONT_QUOTE_HASH;
-	valuePtr = (Tcl_Obj *)Tcl_GetHashValue(&cPtr->entry);
+	valuePtr = entryPtr->valuePtr;
 	elem = TclGetStringFromObj(valuePtr, &length);
 	bytesNeeded += TclScanElement(elem, length, flagPtr+i+1);
     }
@@ -544,17 +1179,18 @@ UpdateStringOfDict(
 
     dst = Tcl_InitStringRep(dictPtr, NULL, bytesNeeded - 1);
     TclOOM(dst, bytesNeeded);
-    for (i=0,cPtr=dict->entryChainHead; i<numElems; i+=2,cPtr=cPtr->nextPtr) {
+    for (i=0,index=0; i<numElems; i+=2) {
+	entryPtr = NextDictEntry(dict, &index);
 	if (i) {
 	    flagPtr[i] |= TCL_DONT_QUOTE_HASH;
 	}
-	keyPtr = (Tcl_Obj *)Tcl_GetHashKey(&dict->table, &cPtr->entry);
+	keyPtr = entryPtr->keyPtr;
 	elem = TclGetStringFromObj(keyPtr, &length);
 	dst += TclConvertElement(elem, length, dst, flagPtr[i]);
 	*dst++ = ' ';
 
 	flagPtr[i+1] |= TCL_DONT_QUOTE_HASH;
-	valuePtr = (Tcl_Obj *)Tcl_GetHashValue(&cPtr->entry);
+	valuePtr = entryPtr->valuePtr;
 	elem = TclGetStringFromObj(valuePtr, &length);
 	dst += TclConvertElement(elem, length, dst, flagPtr[i+1]);
 	*dst++ = ' ';
@@ -592,11 +1228,11 @@ SetDictFromAny(
     Tcl_Interp *interp,
     Tcl_Obj *objPtr)
 {
-    Tcl_HashEntry *hPtr;
+    DictEntry *entryPtr;
     int isNew;
     Dict *dict = (Dict *)Tcl_Alloc(sizeof(Dict));
 
-    InitChainTable(dict);
+    InitDictStorage(dict);
 
     /*
      * Since lists and dictionaries have very closely-related string
@@ -616,9 +1252,9 @@ SetDictFromAny(
 
 	for (i=0 ; i<objc ; i+=2) {
 	    /* Store key and value in the hash table we're building. */
-	    hPtr = CreateChainEntry(dict, objv[i], &isNew);
+	    entryPtr = CreateDictEntry(dict, objv[i], &isNew);
 	    if (!isNew) {
-		Tcl_Obj *discardedValue = (Tcl_Obj *)Tcl_GetHashValue(hPtr);
+		Tcl_Obj *discardedValue = entryPtr->valuePtr;
 
 		/*
 		 * Not really a well-formed dictionary as there are duplicate
@@ -630,8 +1266,8 @@ SetDictFromAny(
 
 		TclDecrRefCount(discardedValue);
 	    }
-	    Tcl_SetHashValue(hPtr, objv[i+1]);
-	    Tcl_IncrRefCount(objv[i+1]); /* Since hash now holds ref to it */
+	    entryPtr->valuePtr = objv[i+1];
+	    Tcl_IncrRefCount(objv[i+1]); /* Since dict now holds ref to it */
 	}
     } else {
 	Tcl_Size length;
@@ -690,15 +1326,15 @@ SetDictFromAny(
 	    }
 
 	    /* Store key and value in the hash table we're building. */
-	    hPtr = CreateChainEntry(dict, keyPtr, &isNew);
+	    entryPtr = CreateDictEntry(dict, keyPtr, &isNew);
 	    if (!isNew) {
-		Tcl_Obj *discardedValue = (Tcl_Obj *)Tcl_GetHashValue(hPtr);
+		Tcl_Obj *discardedValue = entryPtr->valuePtr;
 
 		TclDecrRefCount(keyPtr);
 		TclDecrRefCount(discardedValue);
 	    }
-	    Tcl_SetHashValue(hPtr, valuePtr);
-	    Tcl_IncrRefCount(valuePtr); /* since hash now holds ref to it */
+	    entryPtr->valuePtr = valuePtr;
+	    Tcl_IncrRefCount(valuePtr); /* since dict now holds ref to it */
 	}
     }
 
@@ -721,7 +1357,7 @@ SetDictFromAny(
 	Tcl_SetErrorCode(interp, "TCL", "VALUE", "DICTIONARY", (char *)NULL);
     }
   errorInFindDictElement:
-    DeleteChainTable(dict);
+    DeleteDictStorage(dict);
     Tcl_Free(dict);
     return TCL_ERROR;
 }
@@ -798,10 +1434,11 @@ TclTraceDictPath(
     }
 
     for (i=0 ; i<keyc ; i++) {
-	Tcl_HashEntry *hPtr = Tcl_FindHashEntry(&dict->table, keyv[i]);
+	Tcl_Size index = DictFind(dict, keyv[i], DictHashKey(keyv[i]));
+	DictEntry *entryPtr;
 	Tcl_Obj *tmpObj;
 
-	if (hPtr == NULL) {
+	if (index == TCL_INDEX_NONE) {
 	    int isNew;			/* Dummy */
 
 	    if (flags & DICT_PATH_EXISTS) {
@@ -822,12 +1459,22 @@ TclTraceDictPath(
 	     * The next line should always set isNew to 1.
 	     */
 
-	    hPtr = CreateChainEntry(dict, keyv[i], &isNew);
+	    entryPtr = CreateDictEntry(dict, keyv[i], &isNew);
 	    tmpObj = Tcl_NewDictObj();
 	    Tcl_IncrRefCount(tmpObj);
-	    Tcl_SetHashValue(hPtr, tmpObj);
+	    entryPtr->valuePtr = tmpObj;
 	} else {
-	    tmpObj = (Tcl_Obj *)Tcl_GetHashValue(hPtr);
+	    /*
+	     * When updating, the entry must be private to this dictionary
+	     * before the value's reference count means anything.
+	     */
+
+	    if (flags & DICT_PATH_UPDATE) {
+		entryPtr = SeqEntryForUpdate(dict, index);
+	    } else {
+		entryPtr = SeqEntry(dict, index);
+	    }
+	    tmpObj = entryPtr->valuePtr;
 
 	    DictGetInternalRep(tmpObj, newDict);
 
@@ -844,7 +1491,7 @@ TclTraceDictPath(
 		TclDecrRefCount(tmpObj);
 		tmpObj = Tcl_DuplicateObj(tmpObj);
 		Tcl_IncrRefCount(tmpObj);
-		Tcl_SetHashValue(hPtr, tmpObj);
+		entryPtr->valuePtr = tmpObj;
 		dict->epoch++;
 		DictGetInternalRep(tmpObj, newDict);
 	    }
@@ -929,7 +1576,7 @@ Tcl_DictObjPut(
     Tcl_Obj *valuePtr)
 {
     Dict *dict;
-    Tcl_HashEntry *hPtr;
+    DictEntry *entryPtr;
     int isNew;
 
     if (Tcl_IsShared(dictPtr)) {
@@ -942,17 +1589,17 @@ Tcl_DictObjPut(
     }
 
     TclInvalidateStringRep(dictPtr);
-    hPtr = CreateChainEntry(dict, keyPtr, &isNew);
+    entryPtr = CreateDictEntry(dict, keyPtr, &isNew);
     dict->refCount++;
     TclFreeInternalRep(dictPtr)
     DictSetInternalRep(dictPtr, dict);
     Tcl_IncrRefCount(valuePtr);
     if (!isNew) {
-	Tcl_Obj *oldValuePtr = (Tcl_Obj *)Tcl_GetHashValue(hPtr);
+	Tcl_Obj *oldValuePtr = entryPtr->valuePtr;
 
 	TclDecrRefCount(oldValuePtr);
     }
-    Tcl_SetHashValue(hPtr, valuePtr);
+    entryPtr->valuePtr = valuePtr;
     dict->epoch++;
     return TCL_OK;
 }
@@ -972,7 +1619,7 @@ Tcl_DictObjPut(
  *
  * Side effects:
  *	The object pointed to by dictPtr is converted to a dictionary if it is
- *	not already one.
+ *	not already one. Storage shared with other dictionaries may be copied.
  *
  *----------------------------------------------------------------------
  */
@@ -985,7 +1632,7 @@ Tcl_DictObjGet(
     Tcl_Obj **valuePtrPtr)
 {
     Dict *dict;
-    Tcl_HashEntry *hPtr;
+    Tcl_Size index;
 
     dict = GetDictFromObj(interp, dictPtr);
     if (dict == NULL) {
@@ -993,11 +1640,107 @@ Tcl_DictObjGet(
 	return TCL_ERROR;
     }
 
-    hPtr = Tcl_FindHashEntry(&dict->table, keyPtr);
-    if (hPtr == NULL) {
+    /*
+     * Callers are allowed to modify the value in place if it is unshared, so
+     * the entry must not be one that other dictionaries can also see.
+     */
+
+    index = DictFind(dict, keyPtr, DictHashKey(keyPtr));
+    if (index == TCL_INDEX_NONE) {
 	*valuePtrPtr = NULL;
     } else {
-	*valuePtrPtr = (Tcl_Obj *)Tcl_GetHashValue(hPtr);
+	*valuePtrPtr = SeqEntryForUpdate(dict, index)->valuePtr;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDictObjLookup --
+ *
+ *	Given a key, get its value from the dictionary (or NULL if key is not
+ *	found in dictionary.) This is Tcl_DictObjGet for callers that only
+ *	read the value: it does not unshare the storage of the dictionary, so
+ *	the value must not be modified even if it is not shared.
+ *
+ * Results:
+ *	A standard Tcl result. The variable pointed to by valuePtrPtr is
+ *	updated with the value for the key.
+ *
+ * Side effects:
+ *	The object pointed to by dictPtr is converted to a dictionary if it is
+ *	not already one.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclDictObjLookup(
+    Tcl_Interp *interp,
+    Tcl_Obj *dictPtr,
+    Tcl_Obj *keyPtr,
+    Tcl_Obj **valuePtrPtr)
+{
+    Dict *dict;
+    DictEntry *entryPtr;
+
+    dict = GetDictFromObj(interp, dictPtr);
+    if (dict == NULL) {
+	*valuePtrPtr = NULL;
+	return TCL_ERROR;
+    }
+
+    entryPtr = FindDictEntry(dict, keyPtr);
+    *valuePtrPtr = (entryPtr == NULL) ? NULL : entryPtr->valuePtr;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDictObjGetForUpdate --
+ *
+ *	Given a key, get its value from the dictionary (or NULL if key is not
+ *	found in dictionary.) This is Tcl_DictObjGet for the commands that
+ *	modify the value in place when it is not shared, which must also make
+ *	sure that the dictionary itself is not shared.
+ *
+ * Results:
+ *	A standard Tcl result. The variable pointed to by valuePtrPtr is
+ *	updated with the value for the key.
+ *
+ * Side effects:
+ *	The object pointed to by dictPtr is converted to a dictionary if it is
+ *	not already one. Storage shared with other dictionaries may be copied.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclDictObjGetForUpdate(
+    Tcl_Interp *interp,
+    Tcl_Obj *dictPtr,
+    Tcl_Obj *keyPtr,
+    Tcl_Obj **valuePtrPtr)
+{
+    Dict *dict;
+    Tcl_Size index;
+
+    if (Tcl_IsShared(dictPtr)) {
+	Tcl_Panic("%s called with shared object", "TclDictObjGetForUpdate");
+    }
+    dict = GetDictFromObj(interp, dictPtr);
+    if (dict == NULL) {
+	*valuePtrPtr = NULL;
+	return TCL_ERROR;
+    }
+
+    index = DictFind(dict, keyPtr, DictHashKey(keyPtr));
+    if (index == TCL_INDEX_NONE) {
+	*valuePtrPtr = NULL;
+    } else {
+	*valuePtrPtr = SeqEntryForUpdate(dict, index)->valuePtr;
     }
     return TCL_OK;
 }
@@ -1038,7 +1781,7 @@ Tcl_DictObjRemove(
 	return TCL_ERROR;
     }
 
-    if (DeleteChainEntry(dict, keyPtr)) {
+    if (DeleteDictEntry(dict, keyPtr)) {
 	TclInvalidateStringRep(dictPtr);
 	dict->epoch++;
     }
@@ -1063,7 +1806,7 @@ TclDictGetSize(
 {
     Dict *dict;
     DictGetInternalRep(dictPtr, dict);
-    return dict->table.numEntries;
+    return dict->numEntries;
 }
 
 /*
@@ -1098,19 +1841,36 @@ Tcl_DictObjSize(
 	return TCL_ERROR;
     }
 
-    *sizePtr = dict->table.numEntries;
+    *sizePtr = dict->numEntries;
     return TCL_OK;
 }
 
+/*
+ * The position a search continues from is kept in its "next" field, shifted
+ * up to make room for a bit that says whether the search hands out values
+ * that their callers may modify, as those of Tcl_DictObjFirst do.
+ */
+
+#define DICT_SEARCH_UPDATE	1
+#define SearchNext(index, flags) \
+	INT2PTR(((index) << 1) | (flags))
+#define SearchIndex(searchPtr) \
+	(PTR2INT((searchPtr)->next) >> 1)
+#define SearchFlags(searchPtr) \
+	(PTR2INT((searchPtr)->next) & DICT_SEARCH_UPDATE)
+
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_DictObjFirst --
+ * Tcl_DictObjFirst, TclDictObjFirstLookup --
  *
  *	Start a traversal of the dictionary. Caller must supply the search
  *	context, pointers for returning key and value, and a pointer to allow
  *	indication of whether the dictionary has been traversed (i.e. the
  *	dictionary is empty). The order of traversal is undefined.
+ *	TclDictObjFirstLookup is for callers that only read the values: like
+ *	TclDictObjLookup, it does not unshare the storage of the dictionary,
+ *	so the values must not be modified even if they are not shared.
  *
  * Results:
  *	A standard Tcl result. Updates the variables pointed to by keyPtrPtr,
@@ -1126,48 +1886,80 @@ Tcl_DictObjSize(
  *----------------------------------------------------------------------
  */
 
-int
-Tcl_DictObjFirst(
-    Tcl_Interp *interp,		/* For error messages, or NULL if no error
-				 * messages desired. */
-    Tcl_Obj *dictPtr,		/* Dictionary to traverse. */
-    Tcl_DictSearch *searchPtr,	/* Pointer to a dict search context. */
-    Tcl_Obj **keyPtrPtr,	/* Pointer to a variable to have the first key
-				 * written into, or NULL. */
-    Tcl_Obj **valuePtrPtr,	/* Pointer to a variable to have the first
-				 * value written into, or NULL.*/
-    int *donePtr)		/* Pointer to a variable which will have a 1
-				 * written into when there are no further
-				 * values in the dictionary, or a 0
-				 * otherwise. */
+static int
+DictObjFirst(
+    Tcl_Interp *interp,
+    Tcl_Obj *dictPtr,
+    Tcl_DictSearch *searchPtr,
+    Tcl_Obj **keyPtrPtr,
+    Tcl_Obj **valuePtrPtr,
+    int *donePtr,
+    int flags)			/* DICT_SEARCH_UPDATE if the values may be
+				 * modified by the caller, 0 otherwise. */
 {
     Dict *dict;
-    ChainEntry *cPtr;
+    DictEntry *entryPtr;
+    Tcl_Size index = 0;
 
     dict = GetDictFromObj(interp, dictPtr);
     if (dict == NULL) {
 	return TCL_ERROR;
     }
 
-    cPtr = dict->entryChainHead;
-    if (cPtr == NULL) {
+    entryPtr = NextDictEntry(dict, &index);
+    if (entryPtr == NULL) {
 	searchPtr->epoch = 0;
 	*donePtr = 1;
     } else {
+	if (flags & DICT_SEARCH_UPDATE) {
+	    entryPtr = SeqEntryForUpdate(dict, index - 1);
+	}
 	*donePtr = 0;
 	searchPtr->dictionaryPtr = (Tcl_Dict) dict;
 	searchPtr->epoch = dict->epoch;
-	searchPtr->next = cPtr->nextPtr;
+	searchPtr->next = SearchNext(index, flags);
 	dict->refCount++;
 	if (keyPtrPtr != NULL) {
-	    *keyPtrPtr = (Tcl_Obj *)Tcl_GetHashKey(&dict->table, &cPtr->entry);
+	    *keyPtrPtr = entryPtr->keyPtr;
 	}
 	if (valuePtrPtr != NULL) {
-	    *valuePtrPtr = (Tcl_Obj *)Tcl_GetHashValue(&cPtr->entry);
+	    *valuePtrPtr = entryPtr->valuePtr;
 	}
     }
     return TCL_OK;
 }
+
+int
+Tcl_DictObjFirst(
+    Tcl_Interp *interp,		/* For error messages, or NULL if no error
+				 * messages desired. */
+    Tcl_Obj *dictPtr,		/* Dictionary to traverse. */
+    Tcl_DictSearch *searchPtr,	/* Pointer to a dict search context. */
+    Tcl_Obj **keyPtrPtr,	/* Pointer to a variable to have the first key
+				 * written into, or NULL. */
+    Tcl_Obj **valuePtrPtr,	/* Pointer to a variable to have the first
+				 * value written into, or NULL.*/
+    int *donePtr)		/* Pointer to a variable which will have a 1
+				 * written into when there are no further
+				 * values in the dictionary, or a 0
+				 * otherwise. */
+{
+    return DictObjFirst(interp, dictPtr, searchPtr, keyPtrPtr, valuePtrPtr,
+	    donePtr, DICT_SEARCH_UPDATE);
+}
+
+int
+TclDictObjFirstLookup(
+    Tcl_Interp *interp,
+    Tcl_Obj *dictPtr,
+    Tcl_DictSearch *searchPtr,
+    Tcl_Obj **keyPtrPtr,
+    Tcl_Obj **valuePtrPtr,
+    int *donePtr)
+{
+    return DictObjFirst(interp, dictPtr, searchPtr, keyPtrPtr, valuePtrPtr,
+	    donePtr, 0);
+}
 
 /*
  *----------------------------------------------------------------------
@@ -1175,12 +1967,12 @@ Tcl_DictObjFirst(
  * Tcl_DictObjNext --
  *
  *	Continue a traversal of a dictionary previously started with
- *	Tcl_DictObjFirst. This function is safe against concurrent
- *	modification of the underlying object (including type shimmering),
- *	treating such situations as if the search has terminated, though it is
- *	up to the caller to ensure that the object itself is not disposed
- *	until the search has finished. It is _not_ safe against modifications
- *	from other threads.
+ *	Tcl_DictObjFirst or TclDictObjFirstLookup. This function is safe
+ *	against concurrent modification of the underlying object (including
+ *	type shimmering), treating such situations as if the search has
+ *	terminated, though it is up to the caller to ensure that the object
+ *	itself is not disposed until the search has finished. It is _not_
+ *	safe against modifications from other threads.
  *
  * Results:
  *	Updates the variables pointed to by keyPtrPtr, valuePtrPtr and
@@ -1206,7 +1998,9 @@ Tcl_DictObjNext(
 				 * values in the dictionary, or a 0
 				 * otherwise. */
 {
-    ChainEntry *cPtr;
+    Dict *dict;
+    DictEntry *entryPtr;
+    Tcl_Size index;
 
     /*
      * If the search is done; we do no work.
@@ -1222,25 +2016,29 @@ Tcl_DictObjNext(
      * removed. This *shouldn't* happen, but...
      */
 
-    if (((Dict *)searchPtr->dictionaryPtr)->epoch != searchPtr->epoch) {
+    dict = (Dict *) searchPtr->dictionaryPtr;
+    if (dict->epoch != searchPtr->epoch) {
 	Tcl_Panic("concurrent dictionary modification and search");
     }
 
-    cPtr = (ChainEntry *)searchPtr->next;
-    if (cPtr == NULL) {
+    index = SearchIndex(searchPtr);
+    entryPtr = NextDictEntry(dict, &index);
+    if (entryPtr == NULL) {
 	Tcl_DictObjDone(searchPtr);
 	*donePtr = 1;
 	return;
     }
+    if (SearchFlags(searchPtr) & DICT_SEARCH_UPDATE) {
+	entryPtr = SeqEntryForUpdate(dict, index - 1);
+    }
 
-    searchPtr->next = cPtr->nextPtr;
+    searchPtr->next = SearchNext(index, SearchFlags(searchPtr));
     *donePtr = 0;
     if (keyPtrPtr != NULL) {
-	*keyPtrPtr = (Tcl_Obj *)Tcl_GetHashKey(
-		&((Dict *)searchPtr->dictionaryPtr)->table, &cPtr->entry);
+	*keyPtrPtr = entryPtr->keyPtr;
     }
     if (valuePtrPtr != NULL) {
-	*valuePtrPtr = (Tcl_Obj *)Tcl_GetHashValue(&cPtr->entry);
+	*valuePtrPtr = entryPtr->valuePtr;
     }
 }
 
@@ -1307,7 +2105,7 @@ Tcl_DictObjPutKeyList(
     Tcl_Obj *valuePtr)
 {
     Dict *dict;
-    Tcl_HashEntry *hPtr;
+    DictEntry *entryPtr;
     int isNew;
 
     if (Tcl_IsShared(dictPtr)) {
@@ -1324,14 +2122,14 @@ Tcl_DictObjPutKeyList(
 
     DictGetInternalRep(dictPtr, dict);
     assert(dict != NULL);
-    hPtr = CreateChainEntry(dict, keyv[keyc-1], &isNew);
+    entryPtr = CreateDictEntry(dict, keyv[keyc-1], &isNew);
     Tcl_IncrRefCount(valuePtr);
     if (!isNew) {
-	Tcl_Obj *oldValuePtr = (Tcl_Obj *)Tcl_GetHashValue(hPtr);
+	Tcl_Obj *oldValuePtr = entryPtr->valuePtr;
 
 	TclDecrRefCount(oldValuePtr);
     }
-    Tcl_SetHashValue(hPtr, valuePtr);
+    entryPtr->valuePtr = valuePtr;
     InvalidateDictChain(dictPtr);
 
     return TCL_OK;
@@ -1382,7 +2180,7 @@ Tcl_DictObjRemoveKeyList(
 
     DictGetInternalRep(dictPtr, dict);
     assert(dict != NULL);
-    DeleteChainEntry(dict, keyv[keyc-1]);
+    DeleteDictEntry(dict, keyv[keyc-1]);
     InvalidateDictChain(dictPtr);
     return TCL_OK;
 }
@@ -1423,7 +2221,7 @@ Tcl_NewDictObj(void)
     TclNewObj(dictPtr);
     TclInvalidateStringRep(dictPtr);
     dict = (Dict *)Tcl_Alloc(sizeof(Dict));
-    InitChainTable(dict);
+    InitDictStorage(dict);
     dict->epoch = 1;
     dict->chain = NULL;
     dict->refCount = 1;
@@ -1471,7 +2269,7 @@ Tcl_DbNewDictObj(
     TclDbNewObj(dictPtr, file, line);
     TclInvalidateStringRep(dictPtr);
     dict = (Dict *)Tcl_DbCkalloc(sizeof(Dict), file, line);
-    InitChainTable(dict);
+    InitDictStorage(dict);
     dict->epoch = 1;
     dict->chain = NULL;
     dict->refCount = 1;
@@ -1489,7 +2287,7 @@ Tcl_DbNewDictObj(
 #endif
 
 /***** START OF FUNCTIONS ACTING AS HELPERS *****/
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1520,7 +2318,7 @@ TclDictGet(
     int code;
 
     Tcl_IncrRefCount(keyPtr);
-    code = Tcl_DictObjGet(interp, dictPtr, keyPtr, valuePtrPtr);
+    code = TclDictObjLookup(interp, dictPtr, keyPtr, valuePtrPtr);
     Tcl_DecrRefCount(keyPtr);
     return code;
 }
@@ -1636,7 +2434,7 @@ TclDictRemove(
 }
 
 /***** START OF FUNCTIONS IMPLEMENTING TCL COMMANDS *****/
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1731,7 +2529,7 @@ DictGetCmd(
 	Tcl_DictSearch search;
 	int done;
 
-	result = Tcl_DictObjFirst(interp, objv[1], &search,
+	result = TclDictObjFirstLookup(interp, objv[1], &search,
 		&keyPtr, &valuePtr, &done);
 	if (result != TCL_OK) {
 	    return result;
@@ -1764,7 +2562,7 @@ DictGetCmd(
     if (dictPtr == NULL) {
 	return TCL_ERROR;
     }
-    result = Tcl_DictObjGet(interp, dictPtr, objv[objc-1], &valuePtr);
+    result = TclDictObjLookup(interp, dictPtr, objv[objc-1], &valuePtr);
     if (result != TCL_OK) {
 	return result;
     }
@@ -1835,7 +2633,7 @@ DictGetDefCmd(
 	return TCL_ERROR;
     } else if (dictPtr == DICT_PATH_NON_EXISTENT) {
 	Tcl_SetObjResult(interp, defaultPtr);
-    } else if (Tcl_DictObjGet(interp, dictPtr, keyPtr, &valuePtr) != TCL_OK) {
+    } else if (TclDictObjLookup(interp, dictPtr, keyPtr, &valuePtr) != TCL_OK) {
 	return TCL_ERROR;
     } else if (valuePtr == NULL) {
 	Tcl_SetObjResult(interp, defaultPtr);
@@ -2006,7 +2804,7 @@ DictMergeCmd(
 	allocatedDict = 1;
     }
     for (i=2 ; i<objc ; i++) {
-	if (Tcl_DictObjFirst(interp, objv[i], &search, &keyObj, &valueObj,
+	if (TclDictObjFirstLookup(interp, objv[i], &search, &keyObj, &valueObj,
 		&done) != TCL_OK) {
 	    if (allocatedDict) {
 		TclDecrRefCount(targetObj);
@@ -2078,7 +2876,7 @@ DictKeysCmd(
     if ((pattern != NULL) && TclMatchIsTrivial(pattern)) {
 	Tcl_Obj *valuePtr = NULL;
 
-	Tcl_DictObjGet(interp, objv[1], objv[2], &valuePtr);
+	TclDictObjLookup(interp, objv[1], objv[2], &valuePtr);
 	if (valuePtr != NULL) {
 	    Tcl_ListObjAppendElement(NULL, listPtr, objv[2]);
 	}
@@ -2094,7 +2892,7 @@ DictKeysCmd(
 	 * can start the iteration process without checking for failures.
 	 */
 
-	Tcl_DictObjFirst(NULL, objv[1], &search, &keyPtr, NULL, &done);
+	TclDictObjFirstLookup(NULL, objv[1], &search, &keyPtr, NULL, &done);
 	for (; !done ; Tcl_DictObjNext(&search, &keyPtr, NULL, &done)) {
 	    if (!pattern || Tcl_StringMatch(TclGetString(keyPtr), pattern)) {
 		Tcl_ListObjAppendElement(NULL, listPtr, keyPtr);
@@ -2142,7 +2940,7 @@ DictValuesCmd(
 	return TCL_ERROR;
     }
 
-    if (Tcl_DictObjFirst(interp, objv[1], &search, NULL, &valuePtr,
+    if (TclDictObjFirstLookup(interp, objv[1], &search, NULL, &valuePtr,
 	    &done) != TCL_OK) {
 	return TCL_ERROR;
     }
@@ -2294,7 +3092,8 @@ DictExistsCmd(
 
     dictPtr = TclTraceDictPath(NULL, objv[1], objc-3, objv+2,DICT_PATH_EXISTS);
     if (dictPtr == NULL || dictPtr == DICT_PATH_NON_EXISTENT ||
-	    Tcl_DictObjGet(NULL, dictPtr, objv[objc-1], &valuePtr) != TCL_OK) {
+	    TclDictObjLookup(NULL, dictPtr, objv[objc-1],
+		    &valuePtr) != TCL_OK) {
 	Tcl_SetObjResult(interp, Tcl_NewBooleanObj(0));
     } else {
 	Tcl_SetObjResult(interp, Tcl_NewBooleanObj(valuePtr != NULL));
@@ -2302,6 +3101,39 @@ DictExistsCmd(
     return TCL_OK;
 }
 
+/*
+ * Gather statistics about the lookup trie of a dictionary for "dict info".
+ */
+
+static void
+HamtStats(
+    const HamtNode *nodePtr,
+    unsigned depth,
+    Tcl_Size *numNodesPtr,
+    Tcl_Size *numCollisionsPtr,
+    unsigned *maxDepthPtr)
+{
+    unsigned bit, i;
+
+    (*numNodesPtr)++;
+    if (depth > *maxDepthPtr) {
+	*maxDepthPtr = depth;
+    }
+    if (nodePtr->bitmap == 0) {
+	(*numCollisionsPtr)++;
+	return;
+    }
+    for (bit = 1, i = 0 ; bit != 0 ; bit <<= 1) {
+	if (nodePtr->bitmap & bit) {
+	    if (nodePtr->subnodes & bit) {
+		HamtStats(nodePtr->slots[i].nodePtr, depth + 1, numNodesPtr,
+			numCollisionsPtr, maxDepthPtr);
+	    }
+	    i++;
+	}
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2328,7 +3160,9 @@ DictInfoCmd(
     Tcl_Obj *const *objv)
 {
     Dict *dict;
-    char *statsStr;
+    Tcl_Obj *resultObj;
+    Tcl_Size numNodes = 0, numCollisions = 0;
+    unsigned maxDepth = 0;
 
     if (objc != 2) {
 	Tcl_WrongNumArgs(interp, 1, objv, "dictionary");
@@ -2340,9 +3174,20 @@ DictInfoCmd(
 	return TCL_ERROR;
     }
 
-    statsStr = Tcl_HashStats(&dict->table);
-    Tcl_SetObjResult(interp, Tcl_NewStringObj(statsStr, -1));
-    Tcl_Free(statsStr);
+    resultObj = Tcl_ObjPrintf("%" TCL_SIZE_MODIFIER "d entries in "
+	    "%" TCL_SIZE_MODIFIER "d positions (sequence depth %u)\n",
+	    dict->numEntries, dict->seqSize,
+	    (dict->seqRoot == NULL) ? 0 : dict->seqShift / DICT_BITS + 1);
+    if (dict->hamtRoot == NULL) {
+	Tcl_AppendToObj(resultObj, "lookup by linear scan", -1);
+    } else {
+	HamtStats(dict->hamtRoot, 1, &numNodes, &numCollisions, &maxDepth);
+	Tcl_AppendPrintfToObj(resultObj, "lookup trie has "
+		"%" TCL_SIZE_MODIFIER "d nodes (%" TCL_SIZE_MODIFIER "d for "
+		"hash collisions), max depth %u",
+		numNodes, numCollisions, maxDepth);
+    }
+    Tcl_SetObjResult(interp, resultObj);
     return TCL_OK;
 }
 
@@ -2386,7 +3231,8 @@ DictIncrCmd(
 	 */
 
 	dictPtr = Tcl_NewDictObj();
-    } else if (Tcl_DictObjGet(interp, dictPtr, objv[2], &valuePtr) != TCL_OK) {
+    } else if (TclDictObjLookup(interp, dictPtr, objv[2],
+	    &valuePtr) != TCL_OK) {
 	/*
 	 * Variable contents are not a dict, report error.
 	 */
@@ -2405,6 +3251,14 @@ DictIncrCmd(
 	TclInvalidateStringRep(dictPtr);
 	DupDictInternalRep(oldPtr, dictPtr);
     }
+    if (valuePtr != NULL) {
+	/*
+	 * The value may be incremented in place below, so fetch it again from
+	 * storage that belongs to this dictionary alone.
+	 */
+
+	TclDictObjGetForUpdate(NULL, dictPtr, objv[2], &valuePtr);
+    }
     if (valuePtr == NULL) {
 	/*
 	 * Key not in dictionary. Create new key with increment as value.
@@ -2510,7 +3364,7 @@ DictLappendCmd(
 	dictPtr = Tcl_DuplicateObj(dictPtr);
     }
 
-    if (Tcl_DictObjGet(interp, dictPtr, objv[2], &valuePtr) != TCL_OK) {
+    if (TclDictObjGetForUpdate(interp, dictPtr, objv[2], &valuePtr) != TCL_OK) {
 	if (allocatedDict) {
 	    TclDecrRefCount(dictPtr);
 	}
@@ -2597,7 +3451,7 @@ DictAppendCmd(
 	dictPtr = Tcl_DuplicateObj(dictPtr);
     }
 
-    if (Tcl_DictObjGet(interp, dictPtr, objv[2], &valuePtr) != TCL_OK) {
+    if (TclDictObjGetForUpdate(interp, dictPtr, objv[2], &valuePtr) != TCL_OK) {
 	if (allocatedDict) {
 	    TclDecrRefCount(dictPtr);
 	}
@@ -2709,7 +3563,7 @@ DictForNRCmd(
 	return TCL_ERROR;
     }
     searchPtr = (Tcl_DictSearch *)TclStackAlloc(interp, sizeof(Tcl_DictSearch));
-    if (Tcl_DictObjFirst(interp, objv[2], searchPtr, &keyObj, &valueObj,
+    if (TclDictObjFirstLookup(interp, objv[2], searchPtr, &keyObj, &valueObj,
 	    &done) != TCL_OK) {
 	TclStackFree(interp, searchPtr);
 	return TCL_ERROR;
@@ -2904,7 +3758,7 @@ DictMapNRCmd(
 	return TCL_ERROR;
     }
     storagePtr = (DictMapStorage *)TclStackAlloc(interp, sizeof(DictMapStorage));
-    if (Tcl_DictObjFirst(interp, objv[2], &storagePtr->search, &keyObj,
+    if (TclDictObjFirstLookup(interp, objv[2], &storagePtr->search, &keyObj,
 	    &valueObj, &done) != TCL_OK) {
 	TclStackFree(interp, storagePtr);
 	return TCL_ERROR;
@@ -3241,7 +4095,7 @@ DictFilterCmd(
 	 * Create a dictionary whose keys all match a certain pattern.
 	 */
 
-	if (Tcl_DictObjFirst(interp, objv[1], &search,
+	if (TclDictObjFirstLookup(interp, objv[1], &search,
 		&keyObj, &valueObj, &done) != TCL_OK) {
 	    return TCL_ERROR;
 	}
@@ -3263,7 +4117,7 @@ DictFilterCmd(
 		 */
 
 		Tcl_DictObjDone(&search);
-		Tcl_DictObjGet(interp, objv[1], objv[3], &valueObj);
+		TclDictObjLookup(interp, objv[1], objv[3], &valueObj);
 		if (valueObj != NULL) {
 		    Tcl_DictObjPut(NULL, resultObj, objv[3], valueObj);
 		}
@@ -3303,7 +4157,7 @@ DictFilterCmd(
 	 * Create a dictionary whose values all match a certain pattern.
 	 */
 
-	if (Tcl_DictObjFirst(interp, objv[1], &search,
+	if (TclDictObjFirstLookup(interp, objv[1], &search,
 		&keyObj, &valueObj, &done) != TCL_OK) {
 	    return TCL_ERROR;
 	}
@@ -3360,7 +4214,7 @@ DictFilterCmd(
 	Tcl_IncrRefCount(valueVarObj);
 	Tcl_IncrRefCount(scriptObj);
 
-	result = Tcl_DictObjFirst(interp, objv[1],
+	result = TclDictObjFirstLookup(interp, objv[1],
 		&search, &keyObj, &valueObj, &done);
 	if (result != TCL_OK) {
 	    TclDecrRefCount(keyVarObj);
@@ -3516,7 +4370,7 @@ DictUpdateCmd(
     }
     Tcl_IncrRefCount(dictPtr);
     for (i=2 ; i+2<objc ; i+=2) {
-	if (Tcl_DictObjGet(interp, dictPtr, objv[i], &objPtr) != TCL_OK) {
+	if (TclDictObjLookup(interp, dictPtr, objv[i], &objPtr) != TCL_OK) {
 	    TclDecrRefCount(dictPtr);
 	    return TCL_ERROR;
 	}
@@ -3801,7 +4655,7 @@ TclDictWithInit(
      * has been structurally modified.
      */
 
-    if (Tcl_DictObjFirst(interp, dictPtr, &s, &keyPtr, &valPtr,
+    if (TclDictObjFirstLookup(interp, dictPtr, &s, &keyPtr, &valPtr,
 	    &done) != TCL_OK) {
 	return NULL;
     }
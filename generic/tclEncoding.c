@@ -11,6 +11,7 @@
 
 #include "tclInt.h"
 #include "../utf8proc/utf8proc.h" /* Relative path to ignore system include */
+#include "tclSimd.h"
 
 typedef size_t (LengthProc)(const char *src);
 
@@ -83,6 +84,10 @@ typedef struct {
 				 * is no corresponding character the encoding,
 				 * the value in the matrix is 0x0000.
 				 * malloc'd. */
+    int asciiIdentity;		/* Non-zero if the bytes 1 to 0x7F are the
+				 * ASCII characters and none of them is a
+				 * lead byte, so that TableToUtfProc may copy
+				 * runs of them. */
 } TableEncodingData;
 
 /*
@@ -225,6 +230,37 @@ static const struct TclEncodingProfiles {
 
 static unsigned short emptyPage[256];
 
+/*
+ * The kernels that copy runs of plain characters for the conversions, as
+ * chosen by InitEncodingKernels() for the processor. There is no kernel for
+ * UTF-8 without AVX2: the ASCII one copies what it can.
+ */
+
+typedef size_t (CopyAsciiProc)(char *dst, const char *src, size_t len);
+typedef size_t (CopyUtf8Proc)(char *dst, const char *src, size_t len,
+			    size_t *numCharsPtr);
+
+static CopyAsciiProc		CopyAsciiGeneric;
+#ifdef HAVE_SSE2_KERNELS
+static CopyAsciiProc		CopyAsciiSse2;
+static CopyAsciiProc *copyAsciiProc = CopyAsciiSse2;
+#else
+static CopyAsciiProc *copyAsciiProc = CopyAsciiGeneric;
+#endif
+#ifdef HAVE_AVX2_KERNELS
+static CopyAsciiProc		CopyAsciiAvx2;
+static CopyUtf8Proc		CopyUtf8Avx2;
+#endif
+static CopyUtf8Proc *copyUtf8Proc = NULL;
+
+/*
+ * Number of bytes of UTF-8 that copyUtf8Proc tests at once. After it fails
+ * on a block, UtfToUtfProc converts at least that many bytes by itself
+ * before trying again.
+ */
+
+#define UTF8_KERNEL_BLOCK 32
+
 /*
  * Functions used only in this module.
  */
@@ -245,11 +281,14 @@ static Tcl_Encoding		LoadTableEncoding(const char *name, int type,
 				    Tcl_Channel chan);
 static Tcl_Encoding		LoadEscapeEncoding(const char *name,
 				    Tcl_Channel chan);
+static void			InitEncodingKernels(void);
 static Tcl_Channel		OpenEncodingFileChannel(Tcl_Interp *interp,
 				    const char *name);
 static Tcl_EncodingFreeProc	TableFreeProc;
 static Tcl_EncodingConvertProc	TableFromUtfProc;
 static Tcl_EncodingConvertProc	TableToUtfProc;
+static size_t		CopyUtf16Ascii(char *dst, const char *src,
+				    size_t numUnits, int le);
 static size_t		unilen(const char *src);
 static size_t		unilen4(const char *src);
 static Tcl_EncodingConvertProc	Utf32ToUtfProc;
@@ -539,6 +578,7 @@ TclInitEncodingSubsystem(void)
     if (encodingsInitialized) {
 	return;
     }
+    InitEncodingKernels();
 
     /* Note: This DEPENDS on TCL_ENCODING_LE being defined in least sig byte */
     isLe.s = 1;
@@ -2650,6 +2690,13 @@ LoadTableEncoding(
 	    }
 	}
     }
+    dataPtr->asciiIdentity = 1;
+    for (lo = 1; lo < 0x80; lo++) {
+	if (dataPtr->prefixBytes[lo] || (dataPtr->toUnicode[0][lo] != lo)) {
+	    dataPtr->asciiIdentity = 0;
+	    break;
+	}
+    }
     if (type == ENCODING_MULTIBYTE) {
 	/*
 	 * If multibyte encodings don't have a backslash character, define
@@ -2901,6 +2948,379 @@ LoadEscapeEncoding(
     return Tcl_CreateEncoding(&type);
 }
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * CopyAsciiGeneric, CopyAsciiSse2, CopyAsciiAvx2 --
+ *
+ *	Copy the run of ASCII bytes other than NUL at the start of src, the
+ *	bytes that all the byte-oriented conversions below pass through
+ *	unchanged. The bytes are tested 8, 16 or 32 at a time. Whole blocks
+ *	are stored to dst as they are tested, so any of the len bytes of dst
+ *	may be written, not just the ones copied.
+ *
+ * Results:
+ *	The number of bytes copied, at most len.
+ *
+ * Side effects:
+ *	Writes to dst.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static size_t
+CopyAsciiGeneric(
+    char *dst,			/* Where to copy the bytes. */
+    const char *src,		/* Bytes to copy. */
+    size_t len)			/* Number of bytes to check. */
+{
+    size_t i = 0;
+    uint64_t word;
+
+    while (len - i >= 8) {
+	memcpy(&word, src + i, sizeof(word));
+
+	/*
+	 * A byte is NUL or has its high bit set if and only if subtracting 1
+	 * from it sets its high bit or it had it already.
+	 */
+
+	if ((word | (word - UINT64_C(0x0101010101010101)))
+		& UINT64_C(0x8080808080808080)) {
+	    break;
+	}
+	memcpy(dst + i, &word, sizeof(word));
+	i += 8;
+    }
+    while (i < len && (unsigned) UCHAR(src[i]) - 1 < 0x7F) {
+	dst[i] = src[i];
+	i++;
+    }
+    return i;
+}
+
+#ifdef HAVE_SSE2_KERNELS
+static size_t
+CopyAsciiSse2(
+    char *dst,			/* Where to copy the bytes. */
+    const char *src,		/* Bytes to copy. */
+    size_t len)			/* Number of bytes to check. */
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    while (len - i >= 16) {
+	__m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+	int mask = _mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero)));
+
+	_mm_storeu_si128((__m128i *) (dst + i), v);
+	if (mask) {
+	    return i + LowestSetBit(mask);
+	}
+	i += 16;
+    }
+    return i + CopyAsciiGeneric(dst + i, src + i, len - i);
+}
+#endif /* HAVE_SSE2_KERNELS */
+
+#ifdef HAVE_AVX2_KERNELS
+static TCL_AVX2 size_t
+CopyAsciiAvx2(
+    char *dst,			/* Where to copy the bytes. */
+    const char *src,		/* Bytes to copy. */
+    size_t len)			/* Number of bytes to check. */
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+
+    while (len - i >= 32) {
+	__m256i v = _mm256_loadu_si256((const __m256i *) (src + i));
+	unsigned mask = (unsigned) _mm256_movemask_epi8(
+		_mm256_or_si256(v, _mm256_cmpeq_epi8(v, zero)));
+
+	_mm256_storeu_si256((__m256i *) (dst + i), v);
+	if (mask) {
+	    return i + LowestSetBit(mask);
+	}
+	i += 32;
+    }
+    return i + CopyAsciiSse2(dst + i, src + i, len - i);
+}
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * CopyUtf8Avx2 --
+ *
+ *	Copy the run of well-formed UTF-8 at the start of src, validating it
+ *	32 bytes at a time with the table lookups of Keiser and Lemire,
+ *	"Validating UTF-8 In Less Than One Instruction Per Byte" (2021). The
+ *	run ends before NUL bytes, which UtfToUtfProc converts, and before
+ *	\xC0\x80, surrogates and all other malformed input, which the
+ *	encoding profile decides about. Such bytes come out of UtfToUtfProc
+ *	unchanged in either direction. Like the kernels above, any of the
+ *	len bytes of dst may be written.
+ *
+ * Results:
+ *	The number of bytes copied, always whole characters, and their number
+ *	of characters in *numCharsPtr. Input shorter than 32 bytes copies
+ *	nothing.
+ *
+ * Side effects:
+ *	Writes to dst.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+/*
+ * Error classes of pairs of bytes, from the high and low nibbles of the
+ * first byte and the high nibble of the second. A pair is malformed if
+ * all three lookups share a class.
+ */
+
+#define U8_TOO_SHORT	(1 << 0)	/* Lead or ASCII after a lead. */
+#define U8_TOO_LONG	(1 << 1)	/* Continuation after ASCII. */
+#define U8_OVERLONG_3	(1 << 2)	/* \xE0 then \x80-\x9F. */
+#define U8_TOO_LARGE	(1 << 3)	/* Beyond U+10FFFF. */
+#define U8_SURROGATE	(1 << 4)	/* \xED then \xA0-\xBF. */
+#define U8_OVERLONG_2	(1 << 5)	/* \xC0 or \xC1 then anything. */
+#define U8_TOO_LARGE_1000 (1 << 6)	/* \xF5-\xFF then \x80-\x8F. */
+#define U8_OVERLONG_4	(1 << 6)	/* \xF0 then \x80-\x8F. */
+#define U8_TWO_CONTS	(1 << 7)	/* Continuation after continuation. */
+#define U8_CARRY	(U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+#define U8_TABLE(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p) \
+    _mm256_setr_epi8((char)(a), (char)(b), (char)(c), (char)(d),	\
+	    (char)(e), (char)(f), (char)(g), (char)(h), (char)(i),	\
+	    (char)(j), (char)(k), (char)(l), (char)(m), (char)(n),	\
+	    (char)(o), (char)(p), (char)(a), (char)(b), (char)(c),	\
+	    (char)(d), (char)(e), (char)(f), (char)(g), (char)(h),	\
+	    (char)(i), (char)(j), (char)(k), (char)(l), (char)(m),	\
+	    (char)(n), (char)(o), (char)(p))
+
+static TCL_AVX2 size_t
+CopyUtf8Avx2(
+    char *dst,			/* Where to copy the bytes. */
+    const char *src,		/* Bytes to copy. */
+    size_t len,			/* Number of bytes to check. */
+    size_t *numCharsPtr)	/* Filled with the number of characters
+				 * copied. */
+{
+    const __m256i byte1High = U8_TABLE(
+	U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+	U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+	U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+	U8_TOO_SHORT | U8_OVERLONG_2,
+	U8_TOO_SHORT,
+	U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+	U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4);
+    const __m256i byte1Low = U8_TABLE(
+	U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,
+	U8_CARRY | U8_OVERLONG_2,
+	U8_CARRY,
+	U8_CARRY,
+	U8_CARRY | U8_TOO_LARGE,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000);
+    const __m256i byte2High = U8_TABLE(
+	U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+	U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+	U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3
+		| U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+	U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3
+		| U8_TOO_LARGE,
+	U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE
+		| U8_TOO_LARGE,
+	U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE
+		| U8_TOO_LARGE,
+	U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    /*
+     * A block ends inside a character when one of its last three bytes is
+     * a lead byte of a character longer than the rest of the block.
+     */
+
+    const __m256i lastLeads = _mm256_setr_epi8(
+	    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	    (char) (0xF0 - 1), (char) (0xE0 - 1), (char) (0xC0 - 1));
+    __m256i prevInput = zero, prevIncomplete = zero;
+    size_t i = 0, numChars = 0, k;
+
+    while (len - i >= 32) {
+	__m256i input = _mm256_loadu_si256((const __m256i *) (src + i));
+	__m256i error = _mm256_or_si256(_mm256_cmpeq_epi8(input, zero),
+		prevIncomplete);
+
+	if (_mm256_movemask_epi8(input)) {
+	    __m256i shifted = _mm256_permute2x128_si256(prevInput, input, 0x21);
+	    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+	    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+	    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+	    __m256i special = _mm256_and_si256(_mm256_and_si256(
+		    _mm256_shuffle_epi8(byte1High, _mm256_and_si256(
+			    _mm256_srli_epi16(prev1, 4), nibble)),
+		    _mm256_shuffle_epi8(byte1Low,
+			    _mm256_and_si256(prev1, nibble))),
+		    _mm256_shuffle_epi8(byte2High, _mm256_and_si256(
+			    _mm256_srli_epi16(input, 4), nibble)));
+
+	    /*
+	     * The third and fourth bytes of a character must be continuation
+	     * bytes, which the pair lookups above only see as two
+	     * continuations in a row.
+	     */
+
+	    __m256i must23 = _mm256_and_si256(_mm256_or_si256(
+		    _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)),
+		    _mm256_subs_epu8(prev3, _mm256_set1_epi8((char) (0xF0 - 0x80)))),
+		    _mm256_set1_epi8((char) 0x80));
+
+	    error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+	}
+	if (!_mm256_testz_si256(error, error)) {
+	    break;
+	}
+	_mm256_storeu_si256((__m256i *) (dst + i), input);
+
+	/*
+	 * Characters are counted by their bytes that are not continuation
+	 * bytes, \x80-\xBF, which are the signed bytes below -64.
+	 */
+
+	numChars += 32 - __builtin_popcount((unsigned) _mm256_movemask_epi8(
+		_mm256_cmpgt_epi8(_mm256_set1_epi8(-64), input)));
+	prevIncomplete = _mm256_subs_epu8(input, lastLeads);
+	prevInput = input;
+	i += 32;
+    }
+
+    /*
+     * Leave out a character the last block ends in.
+     */
+
+    for (k = 1; k <= 3 && k <= i; k++) {
+	unsigned char byte = UCHAR(src[i - k]);
+
+	if (byte >= 0xC0) {
+	    if ((byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2) > (int) k) {
+		i -= k;
+		numChars--;
+	    }
+	    break;
+	} else if (byte < 0x80) {
+	    break;
+	}
+    }
+    *numCharsPtr = numChars;
+    return i;
+}
+
+#undef U8_TABLE
+#endif /* HAVE_AVX2_KERNELS */
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * CopyUtf16Ascii --
+ *
+ *	Copy the run of UTF-16 code units from 1 to 0x7F at the start of src
+ *	as bytes, testing them 8 at a time where SSE2 is available. Any of
+ *	the numUnits bytes of dst may be written.
+ *
+ * Results:
+ *	The number of code units copied, at most numUnits.
+ *
+ * Side effects:
+ *	Writes to dst.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static size_t
+CopyUtf16Ascii(
+    char *dst,			/* Where to copy the characters. */
+    const char *src,		/* Code units to copy. */
+    size_t numUnits,		/* Number of code units to check. */
+    int le)			/* Non-zero for little-endian code units. */
+{
+    size_t i = 0;
+    unsigned ch;
+
+#ifdef HAVE_SSE2_KERNELS
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i notAscii = _mm_set1_epi16((short) 0xFF80);
+
+    while (numUnits - i >= 8) {
+	__m128i v = _mm_loadu_si128((const __m128i *) (src + 2 * i));
+	int mask;
+
+	if (!le) {
+	    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+	}
+	mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(v, zero),
+		_mm_xor_si128(_mm_cmpeq_epi16(_mm_and_si128(v, notAscii),
+			zero), _mm_cmpeq_epi16(zero, zero))));
+	_mm_storel_epi64((__m128i *) (dst + i), _mm_packus_epi16(v, v));
+	if (mask) {
+	    return i + LowestSetBit(mask) / 2;
+	}
+	i += 8;
+    }
+#endif /* HAVE_SSE2_KERNELS */
+    for (; i < numUnits; i++) {
+	if (le) {
+	    ch = UCHAR(src[2 * i]) | (UCHAR(src[2 * i + 1]) << 8);
+	} else {
+	    ch = (UCHAR(src[2 * i]) << 8) | UCHAR(src[2 * i + 1]);
+	}
+	if (ch - 1 >= 0x7F) {
+	    break;
+	}
+	dst[i] = (char) ch;
+    }
+    return i;
+}
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * InitEncodingKernels --
+ *
+ *	Chooses the widest kernels above that the processor runs.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets copyAsciiProc and copyUtf8Proc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static void
+InitEncodingKernels(void)
+{
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+	copyAsciiProc = CopyAsciiAvx2;
+	copyUtf8Proc = CopyUtf8Avx2;
+    }
+#endif
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -2974,7 +3394,7 @@ UtfToUtfProc(
     int *dstWrotePtr,
     int *dstCharsPtr)
 {
-    const char *srcStart, *srcEnd, *srcClose;
+    const char *srcStart, *srcEnd, *srcClose, *kernelFrom;
     const char *dstStart, *dstEnd;
     int result, numChars = 0, charLimit = INT_MAX;
     int ch;
@@ -2985,6 +3405,7 @@ UtfToUtfProc(
 
     srcStart = src;
     srcEnd = src + srcLen;
+    kernelFrom = src;
     srcClose = srcEnd;
     if ((flags & TCL_ENCODING_END) == 0) {
 	srcClose -= TCL_UTF_MAX;
@@ -3014,6 +3435,28 @@ UtfToUtfProc(
 	    break;
 	}
 
+	if (copyUtf8Proc && (charLimit == INT_MAX) && (src >= kernelFrom)) {
+	    /*
+	     * Well-formed UTF-8 comes out unchanged, whatever the profile and
+	     * direction, so copy as much of it as the kernel validates.
+	     */
+
+	    size_t copied, copiedChars;
+	    ptrdiff_t copyCount = srcEnd - src;
+
+	    if (copyCount > (dstEnd - dst + 1)) {
+		copyCount = dstEnd - dst + 1;
+	    }
+	    copied = copyUtf8Proc(dst, src, copyCount, &copiedChars);
+	    if (copied > 0) {
+		src += copied;
+		dst += copied;
+		numChars += (int) copiedChars - 1;
+		continue;
+	    }
+	    kernelFrom = src + UTF8_KERNEL_BLOCK;
+	}
+
 	if (BYTE_COPYABLE(*src)) {
 	    /*
 	     * Common case fast path for non-nul ASCII bytes.
@@ -3022,7 +3465,7 @@ UtfToUtfProc(
 	     * loop), *statePtr is guaranteed to be 0 here, so no
 	     * CHECK_ISOLATEDSURROGATE() call is needed.
 	     */
-	    const char *p = src;
+	    size_t copied;
 	    ptrdiff_t copyCount = srcEnd - src;
 	    if (charLimit != INT_MAX) {
 		if (copyCount > (charLimit - numChars)) {
@@ -3032,12 +3475,10 @@ UtfToUtfProc(
 	    if (copyCount > (dstEnd - dst + 1)) {
 		copyCount = dstEnd - dst + 1;
 	    }
-	    const char *srcStop = src + copyCount;
-	    while (p < srcStop && BYTE_COPYABLE(*p)) {
-		*dst++ = *p++;
-	    }
-	    numChars += (int)(p - src) - 1;
-	    src = p;
+	    copied = copyAsciiProc(dst, src, copyCount);
+	    dst += copied;
+	    numChars += (int) copied - 1;
+	    src += copied;
 	} else if ((UCHAR(*src) == 0xC0) && (src + 1 < srcEnd) &&
 		(UCHAR(src[1]) == 0x80) &&
 		(!(flags & ENCODING_INPUT) || !PROFILE_TCL8(profile))) {
@@ -3290,7 +3731,7 @@ UtfToCesu8Proc(
 	     *  - charLimit not reached
 	     *  - destination not full
 	     */
-	    const char *p = src;
+	    size_t copied;
 	    ptrdiff_t copyCount = srcEnd - src;
 	    /* Limit to caller-specified character count */
 	    if (charLimit != INT_MAX) {
@@ -3305,12 +3746,10 @@ UtfToCesu8Proc(
 	    if (copyCount > (dstEnd - dst + 1)) {
 		copyCount = dstEnd - dst + 1;
 	    }
-	    const char *srcStop = src + copyCount;
-	    while (p < srcStop && BYTE_COPYABLE(*p)) {
-		*dst++ = *p++;
-	    }
-	    numChars += (int)(p - src) - 1; /* -1 to adjust loop increment */
-	    src = p;
+	    copied = copyAsciiProc(dst, src, copyCount);
+	    dst += copied;
+	    numChars += (int) copied - 1; /* -1 to adjust loop increment */
+	    src += copied;
 	} else if ((UCHAR(*src) == 0xC0) && (src + 1 < srcEnd) &&
 		(UCHAR(src[1]) == 0x80) &&
 		(!(flags & ENCODING_INPUT) || !PROFILE_TCL8(profile))) {
@@ -3913,8 +4352,21 @@ Utf16ToUtfProc(
 	     * unsigned short-size data. Order checks based on expected frequency.
 	     */
 	    if ((unsigned)ch - 1 < 0x7F) {
-		/* ASCII except nul */
-		*dst++ = (ch & 0xFF);
+		/* ASCII except nul: copy the whole run of it */
+		size_t copied;
+		ptrdiff_t copyCount = (srcEnd - src) / 2;
+
+		if (copyCount > (charLimit - numChars)) {
+		    copyCount = charLimit - numChars;
+		}
+		if (copyCount > (dstEnd - dst + 1)) {
+		    copyCount = dstEnd - dst + 1;
+		}
+		copied = CopyUtf16Ascii(dst, src, copyCount,
+			flags & TCL_ENCODING_LE);
+		dst += copied;
+		src += 2 * (copied - 1);
+		numChars += (int) copied - 1;
 	    } else if (!SURROGATE(ch)) {
 		/* Not ASCII, not surrogate */
 		dst += Tcl_UniCharToUtf(ch, dst);
@@ -4300,6 +4752,22 @@ TableToUtfProc(
 	    break;
 	}
 	byte = *((unsigned char *) src);
+	if (dataPtr->asciiIdentity && ((unsigned)byte - 1 < 0x7F)) {
+	    size_t copied;
+	    ptrdiff_t copyCount = srcEnd - src;
+
+	    if (copyCount > (charLimit - numChars)) {
+		copyCount = charLimit - numChars;
+	    }
+	    if (copyCount > (dstEnd - dst + 1)) {
+		copyCount = dstEnd - dst + 1;
+	    }
+	    copied = copyAsciiProc(dst, src, copyCount);
+	    dst += copied;
+	    src += copied;
+	    numChars += (int) copied - 1;
+	    continue;
+	}
 	if (prefixBytes[byte]) {
 	    if (src >= srcEnd-1) {
 		/* Prefix byte but nothing after it */
@@ -4537,11 +5005,23 @@ Iso88591ToUtfProc(
 	ch = *((unsigned char *) src);
 
 	/*
-	 * Special case for 1-byte utf chars for speed.
+	 * Copy runs of ASCII, which is the same in both, at once.
 	 */
 
 	if ((unsigned)ch - 1 < 0x7F) {
-	    *dst++ = (char) ch;
+	    size_t copied;
+	    ptrdiff_t copyCount = srcEnd - src;
+
+	    if (copyCount > (charLimit - numChars)) {
+		copyCount = charLimit - numChars;
+	    }
+	    if (copyCount > (dstEnd - dst + 1)) {
+		copyCount = dstEnd - dst + 1;
+	    }
+	    copied = copyAsciiProc(dst, src, copyCount);
+	    dst += copied;
+	    src += copied - 1;
+	    numChars += (int) copied - 1;
 	} else {
 	    dst += Tcl_UniCharToUtf(ch, dst);
 	}
@@ -4620,6 +5100,19 @@ Iso88591FromUtfProc(
 	    result = TCL_CONVERT_MULTIBYTE;
 	    break;
 	}
+	if (((unsigned) UCHAR(*src) - 1 < 0x7F) && (dst <= dstEnd)) {
+	    size_t copied;
+	    ptrdiff_t copyCount = srcEnd - src;
+
+	    if (copyCount > (dstEnd - dst + 1)) {
+		copyCount = dstEnd - dst + 1;
+	    }
+	    copied = copyAsciiProc(dst, src, copyCount);
+	    dst += copied;
+	    src += copied;
+	    numChars += (int) copied - 1;
+	    continue;
+	}
 	len = TclUtfToUniChar(src, &ch);
 
 	/*
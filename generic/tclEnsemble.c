@@ -3036,6 +3036,9 @@ TclCompileEnsemble(
 
 	goto tryCompileToInv;
     }
+    if (envPtr->cacheDepsPtr) {
+	TclCompCacheNoteEnsemble(envPtr, ensemble);
+    }
 
     /*
      * Also refuse to compile anything that uses a formal parameter list for
@@ -3217,6 +3220,9 @@ TclCompileEnsemble(
 	 */
 	goto cleanup;
     }
+    if (envPtr->cacheDepsPtr) {
+	TclCompCacheNoteCommand(envPtr, targetCmdObj, newCmdPtr);
+    }
     cmdPtr = newCmdPtr;
     depth++;
 
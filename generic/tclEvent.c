@@ -1188,6 +1188,7 @@ Tcl_InitSubsystems(void)
 
 	    TclInitDoubleConversion();	/* Initializes constants for
 					 * converting to/from double. */
+	    TclInitUtfKernels();	/* Chooses the byte search kernels. */
 	    TclInitObjSubsystem();	/* Register obj types, create
 					 * mutexes. */
 	    TclInitIOSubsystem();	/* Inits a tsd key (noop). */
@@ -1302,6 +1303,7 @@ Tcl_Finalize(void)
      */
 
     TclFinalizeObjects();
+    TclFinalizeCompilation();
 
     /*
      * We must be sure the encoding finalization doesn't need to examine the
@@ -42,6 +42,24 @@
 #define IEEE_FLOATING_POINT
 #endif
 
+/*
+ * Threaded-code dispatch in TEBCresume. When building with a compiler that
+ * supports labels as values (gcc and clang), the most frequently executed
+ * instructions are reached through a table of label addresses and each
+ * instruction ending performs its own indirect jump to the next instruction,
+ * instead of all of them funnelling through the single indirect jump of the
+ * big switch. This gives the branch predictor one prediction site per
+ * instruction. The mode is disabled when debugging, statistics or DTrace
+ * probes need to see every instruction pass through the common path, and it
+ * may be disabled explicitly by defining TCL_NO_COMPUTED_GOTO.
+ */
+
+#if defined(__GNUC__) && !defined(TCL_NO_COMPUTED_GOTO) \
+	&& !defined(TCL_COMPILE_DEBUG) && !defined(TCL_COMPILE_STATS) \
+	&& !defined(USE_DTRACE)
+#define TCL_COMPUTED_GOTO 1
+#endif
+
 /*
  * A counter that is used to work out when the bytecode engine should call
  * Tcl_AsyncReady() to see whether there is a signal that needs handling, and
@@ -196,6 +214,31 @@ VarHashFindVar(
  * and within range.
  */
 
+/*
+ * Macros for threaded-code dispatch. TARGET() marks the start of the code
+ * for an instruction that has an entry in the dispatch table of TEBCresume,
+ * and NEXT_DISPATCH() continues with the instruction at pc, going through
+ * the common path at cleanup0 only when the async check is due.
+ */
+
+#ifdef TCL_COMPUTED_GOTO
+#define TARGET(opcode) \
+    target_##opcode:
+#define NEXT_DISPATCH() \
+    do {								\
+	if (interruptCounter > 1) {					\
+	    interruptCounter--;						\
+	    inst = *pc;							\
+	    goto *dispatchTable[inst];					\
+	}								\
+	goto cleanup0;							\
+    } while (0)
+#else
+#define TARGET(opcode)
+#define NEXT_DISPATCH() \
+    goto cleanup0
+#endif /* TCL_COMPUTED_GOTO */
+
 /* Verify the stack depth, only when no expansion is in progress */
 
 #ifdef TCL_COMPILE_DEBUG
@@ -222,7 +265,7 @@ VarHashFindVar(
 		}							\
 	    }								\
 	    pc += (pcAdjustment);					\
-	    goto cleanup0;						\
+	    NEXT_DISPATCH();						\
 	} else if (resultHandling != 0) {				\
 	    if ((resultHandling) > 0) {					\
 		Tcl_IncrRefCount(objResultPtr);				\
@@ -250,7 +293,7 @@ VarHashFindVar(
 	CHECK_STACK();							\
 	pc += (pcAdjustment);						\
 	switch (nCleanup) {						\
-	case 0: goto cleanup0;						\
+	case 0: NEXT_DISPATCH();					\
 	case 1: goto cleanup1;						\
 	case 2: goto cleanup2;						\
 	default: TCL_UNREACHABLE();					\
@@ -872,6 +915,7 @@ TclCreateExecEnv(
     eePtr->callbackPtr = NULL;
     eePtr->corPtr = NULL;
     eePtr->rewind = 0;
+    eePtr->nextPtr = NULL;
 
     esPtr->prevPtr = NULL;
     esPtr->nextPtr = NULL;
@@ -955,6 +999,113 @@ TclDeleteExecEnv(
     Tcl_Free(eePtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclNewCoroutineExecEnv, TclFreeCoroutineExecEnv --
+ *
+ *	Get and give back the execution environment of a coroutine. The
+ *	environments of ended coroutines are kept in a pool of the
+ *	interpreter, up to EXECENV_POOL_SIZE of them, with the last stack
+ *	they used if that holds no more than EXECENV_POOL_MAX_WORDS words.
+ *	A new coroutine thus usually gets an environment whose stack is
+ *	already large enough, without allocating anything.
+ *
+ * Results:
+ *	TclNewCoroutineExecEnv returns an ExecEnv with an empty evaluation
+ *	stack of at least size words, unless it comes from the pool.
+ *
+ * Side effects:
+ *	TclFreeCoroutineExecEnv frees the ExecEnv, or puts it in the pool.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define EXECENV_POOL_SIZE	32
+#define EXECENV_POOL_MAX_WORDS	1024
+
+ExecEnv *
+TclNewCoroutineExecEnv(
+    Tcl_Interp *interp,		/* Interpreter of the coroutine. */
+    size_t size)		/* The initial stack size, in number of words
+				 * [sizeof(Tcl_Obj *)] */
+{
+    Interp *iPtr = (Interp *) interp;
+    ExecEnv *eePtr = iPtr->execEnvPool;
+
+    if (eePtr == NULL) {
+	return TclCreateExecEnv(interp, size);
+    }
+    iPtr->execEnvPool = eePtr->nextPtr;
+    iPtr->numPooledExecEnvs--;
+    eePtr->nextPtr = NULL;
+    return eePtr;
+}
+
+void
+TclFreeCoroutineExecEnv(
+    ExecEnv *eePtr)		/* Execution environment of a coroutine that
+				 * ended. */
+{
+    Interp *iPtr = (Interp *) eePtr->interp;
+    ExecStack *esPtr = eePtr->execStackPtr;
+
+    if ((iPtr->flags & DELETED)
+	    || (iPtr->numPooledExecEnvs >= EXECENV_POOL_SIZE)
+	    || eePtr->callbackPtr || eePtr->corPtr || esPtr->markerPtr
+	    || (esPtr->endPtr - STACK_BASE(esPtr) > EXECENV_POOL_MAX_WORDS)) {
+	TclDeleteExecEnv(eePtr);
+	return;
+    }
+
+    /*
+     * Keep the current stack only; the others are empty.
+     */
+
+    while (esPtr->nextPtr) {
+	DeleteExecStack(esPtr->nextPtr);
+    }
+    while (esPtr->prevPtr) {
+	DeleteExecStack(esPtr->prevPtr);
+    }
+    esPtr->tosPtr = STACK_BASE(esPtr);
+    eePtr->rewind = 0;
+
+    eePtr->nextPtr = iPtr->execEnvPool;
+    iPtr->execEnvPool = eePtr;
+    iPtr->numPooledExecEnvs++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDeleteExecEnvPool --
+ *
+ *	Frees the pool of coroutine execution environments of an interpreter
+ *	that is being deleted.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Storage is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclDeleteExecEnvPool(
+    Interp *iPtr)
+{
+    while (iPtr->execEnvPool) {
+	ExecEnv *eePtr = iPtr->execEnvPool;
+
+	iPtr->execEnvPool = eePtr->nextPtr;
+	TclDeleteExecEnv(eePtr);
+    }
+    iPtr->numPooledExecEnvs = 0;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2148,6 +2299,70 @@ TEBCresume(
     const unsigned char *pc = (const unsigned char *)data[1];
 				/* The current program counter. */
     unsigned char inst;		/* The currently running instruction */
+#ifdef TCL_COMPUTED_GOTO
+    /*
+     * Where to go for each opcode; anything not listed here is dispatched by
+     * the switch. The instructions that are peepholed in front of the switch
+     * are entered through that code. The entries override a default range,
+     * which gcc warns about with -Woverride-init.
+     */
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverride-init"
+    static const void *const dispatchTable[256] = {
+	[0 ... 255] = &&dispatchSwitch,
+	[INST_LOAD_SCALAR] = &&instLoadScalar,
+	[INST_START_CMD] = &&peepholeStart,
+	[INST_NOP] = &&peepholeStart,
+	[INST_DONE] = &&target_INST_DONE,
+	[INST_PUSH] = &&target_INST_PUSH,
+	[INST_POP] = &&target_INST_POP,
+	[INST_DUP] = &&target_INST_DUP,
+	[INST_OVER] = &&target_INST_OVER,
+	[INST_STR_CONCAT1] = &&target_INST_STR_CONCAT1,
+	[INST_CONCAT_STK] = &&target_INST_CONCAT_STK,
+	[INST_INVOKE_STK] = &&target_INST_INVOKE_STK,
+	[INST_STORE_SCALAR] = &&target_INST_STORE_SCALAR,
+	[INST_LOAD_ARRAY] = &&target_INST_LOAD_ARRAY,
+	[INST_STORE_ARRAY] = &&target_INST_STORE_ARRAY,
+	[INST_LAPPEND_SCALAR] = &&target_INST_LAPPEND_SCALAR,
+	[INST_APPEND_SCALAR] = &&target_INST_APPEND_SCALAR,
+	[INST_INCR_SCALAR_IMM] = &&target_INST_INCR_SCALAR_IMM,
+	[INST_JUMP] = &&target_INST_JUMP,
+	[INST_JUMP_FALSE] = &&target_INST_JUMP_FALSE,
+	[INST_JUMP_TRUE] = &&target_INST_JUMP_TRUE,
+	[INST_LIST] = &&target_INST_LIST,
+	[INST_LIST_LENGTH] = &&target_INST_LIST_LENGTH,
+	[INST_LIST_INDEX] = &&target_INST_LIST_INDEX,
+	[INST_LIST_INDEX_IMM] = &&target_INST_LIST_INDEX_IMM,
+	[INST_STR_LEN] = &&target_INST_STR_LEN,
+	[INST_STR_INDEX] = &&target_INST_STR_INDEX,
+	[INST_FOREACH_STEP] = &&target_INST_FOREACH_STEP,
+	[INST_BEGIN_CATCH] = &&target_INST_BEGIN_CATCH,
+	[INST_END_CATCH] = &&target_INST_END_CATCH,
+	[INST_DICT_GET] = &&target_INST_DICT_GET,
+	[INST_LNOT] = &&target_INST_LNOT,
+	[INST_STR_EQ] = &&target_INST_STR_EQ,
+	[INST_STR_NEQ] = &&target_INST_STR_EQ,
+	[INST_STR_CMP] = &&target_INST_STR_EQ,
+	[INST_STR_LT] = &&target_INST_STR_EQ,
+	[INST_STR_GT] = &&target_INST_STR_EQ,
+	[INST_STR_LE] = &&target_INST_STR_EQ,
+	[INST_STR_GE] = &&target_INST_STR_EQ,
+	[INST_EQ] = &&target_INST_EQ,
+	[INST_NEQ] = &&target_INST_EQ,
+	[INST_LT] = &&target_INST_EQ,
+	[INST_GT] = &&target_INST_EQ,
+	[INST_LE] = &&target_INST_EQ,
+	[INST_GE] = &&target_INST_EQ,
+	[INST_EXPON] = &&target_INST_ADD,
+	[INST_ADD] = &&target_INST_ADD,
+	[INST_SUB] = &&target_INST_ADD,
+	[INST_DIV] = &&target_INST_ADD,
+	[INST_MULT] = &&target_INST_ADD,
+    };
+#pragma GCC diagnostic pop
+#endif /* TCL_COMPUTED_GOTO */
 
     /*
      * Transfer variables - needed only between opcodes, but not while
@@ -2355,7 +2570,7 @@ TEBCresume(
 	    }
 	}
 
-	if (TclLimitReady(iPtr->limit)) {
+	if (TclLimitReady(iPtr)) {
 	    if (Tcl_LimitCheck(interp) == TCL_ERROR) {
 		CACHE_STACK_INFO();
 		goto gotError;
@@ -2374,6 +2589,9 @@ TEBCresume(
      */
 
     inst = *pc;
+#ifdef TCL_COMPUTED_GOTO
+    goto *dispatchTable[inst];
+#endif
 
     peepholeStart:
 #ifdef TCL_COMPILE_STATS
@@ -2429,6 +2647,9 @@ TEBCresume(
 	goto peepholeStart;
     }
 
+#ifdef TCL_COMPUTED_GOTO
+  dispatchSwitch:
+#endif
     switch (inst) {
     case INST_SYNTAX:
     case INST_RETURN_IMM: {
@@ -2758,6 +2979,7 @@ TEBCresume(
 	return TclNREvalObjEx(interp, scriptObj, 0, invoker, word);
     }
 
+    TARGET(INST_DONE)
     case INST_DONE:
 	TRACE("=> ");
 	if (tosPtr > initTosPtr) {
@@ -2797,12 +3019,14 @@ TEBCresume(
 	NEXT_INST_F(2, 0, 1);
 #endif
 
+    TARGET(INST_PUSH)
     case INST_PUSH:
 	TRACE("%u => ", TclGetUInt4AtPtr(pc + 1));
 	objResultPtr = codePtr->objArrayPtr[TclGetUInt4AtPtr(pc + 1)];
 	TRACE_APPEND_OBJ(objResultPtr);
 	NEXT_INST_F(5, 0, 1);
 
+    TARGET(INST_POP)
     case INST_POP:
 	TRACE("=> discarding ");
 	objPtr = POP_OBJECT();
@@ -2810,12 +3034,14 @@ TEBCresume(
 	TclDecrRefCount(objPtr);
 	NEXT_INST_F0(1, 0);
 
+    TARGET(INST_DUP)
     case INST_DUP:
 	TRACE("=> ");
 	objResultPtr = OBJ_AT_TOS;
 	TRACE_APPEND_OBJ(objResultPtr);
 	NEXT_INST_F(1, 0, 1);
 
+    TARGET(INST_OVER)
     case INST_OVER:
 	numArgs = TclGetUInt4AtPtr(pc + 1);
 	TRACE("%u => ", (unsigned) numArgs);
@@ -2845,6 +3071,7 @@ TEBCresume(
 	TRACE("=> OK\n");
 	NEXT_INST_F0(1, 0);
 
+    TARGET(INST_STR_CONCAT1)
     case INST_STR_CONCAT1:
 	numArgs = TclGetUInt1AtPtr(pc + 1);
 	TRACE("%u => ", (unsigned)numArgs);
@@ -2860,6 +3087,7 @@ TEBCresume(
 	TRACE_APPEND_OBJ(objResultPtr);
 	NEXT_INST_V(2, numArgs, 1);
 
+    TARGET(INST_CONCAT_STK)
     case INST_CONCAT_STK:
 	/*
 	 * Pop the numArgs (objc) top stack elements, run through Tcl_ConcatObj,
@@ -3017,6 +3245,7 @@ TEBCresume(
 	TclNewObj(objResultPtr);
 	NEXT_INST_F(1, 0, 1);
 
+    TARGET(INST_INVOKE_STK)
     case INST_INVOKE_STK:
 	objc = TclGetUInt4AtPtr(pc + 1);
 	pcAdjustment = 5;
@@ -3181,6 +3410,7 @@ TEBCresume(
 	part1Ptr = part2Ptr = NULL;
 	goto doCallPtrGetVar;
 
+    TARGET(INST_LOAD_ARRAY)
     case INST_LOAD_ARRAY:
 	varIdx = TclGetUInt4AtPtr(pc + 1);
 	pcAdjustment = 5;
@@ -3297,6 +3527,7 @@ TEBCresume(
 	goto doStoreArrayDirect;
 #endif
 
+    TARGET(INST_STORE_ARRAY)
     case INST_STORE_ARRAY:
 	varIdx = TclGetUInt4AtPtr(pc + 1);
 	pcAdjustment = 5;
@@ -3331,6 +3562,7 @@ TEBCresume(
 	goto doStoreScalarDirect;
 #endif
 
+    TARGET(INST_STORE_SCALAR)
     case INST_STORE_SCALAR:
 	varIdx = TclGetUInt4AtPtr(pc + 1);
 	pcAdjustment = 5;
@@ -3484,6 +3716,7 @@ TEBCresume(
 	}
 	goto doCallPtrSetVar;
 
+    TARGET(INST_LAPPEND_SCALAR)
     case INST_LAPPEND_SCALAR:
 	varIdx = TclGetUInt4AtPtr(pc + 1);
 	pcAdjustment = 5;
@@ -3501,6 +3734,7 @@ TEBCresume(
 	goto doStoreScalar;
 #endif
 
+    TARGET(INST_APPEND_SCALAR)
     case INST_APPEND_SCALAR:
 	varIdx = TclGetUInt4AtPtr(pc + 1);
 	pcAdjustment = 5;
@@ -3845,6 +4079,7 @@ TEBCresume(
 	pcAdjustment = 3;
 	goto doIncrScalarImm;
 #endif
+    TARGET(INST_INCR_SCALAR_IMM)
     case INST_INCR_SCALAR_IMM:
 	varIdx = TclGetUInt4AtPtr(pc + 1);
 	increment = TclGetInt1AtPtr(pc + 5);
@@ -4492,6 +4727,7 @@ TEBCresume(
 	NEXT_INST_F0(pcAdjustment, 0);
 #endif
 
+    TARGET(INST_JUMP)
     case INST_JUMP:
 	pcAdjustment = TclGetInt4AtPtr(pc + 1);
 	TRACE("%d => new pc %" SIZEd "\n", pcAdjustment,
@@ -4519,12 +4755,14 @@ TEBCresume(
 	goto doCondJump;
 #endif
 
+    TARGET(INST_JUMP_FALSE)
     case INST_JUMP_FALSE:
 	jmpOffset[0] = TclGetInt4AtPtr(pc + 1);	/* FALSE offset */
 	jmpOffset[1] = 5;			/* TRUE offset */
 	TRACE("%d => ", jmpOffset[0]);
 	goto doCondJump;
 
+    TARGET(INST_JUMP_TRUE)
     case INST_JUMP_TRUE:
 	jmpOffset[0] = 5;
 	jmpOffset[1] = TclGetInt4AtPtr(pc + 1);
@@ -5003,6 +5241,7 @@ TEBCresume(
 	Tcl_Size slength, length2, fromIdx, toIdx, index, s1len, s2len, numIndices;
 	const char *s1, *s2;
 
+    TARGET(INST_LIST)
     case INST_LIST:
 	/*
 	 * Pop the numArgs (objc) top stack elements into a new list obj and then
@@ -5015,6 +5254,7 @@ TEBCresume(
 	TRACE_APPEND_OBJ(objResultPtr);
 	NEXT_INST_V(5, numArgs, 1);
 
+    TARGET(INST_LIST_LENGTH)
     case INST_LIST_LENGTH:
 	TRACE("\"%.30s\" => ", O2S(OBJ_AT_TOS));
 	if (TclListObjLength(interp, OBJ_AT_TOS, &length) != TCL_OK) {
@@ -5025,6 +5265,7 @@ TEBCresume(
 	TRACE_APPEND_NUM_OBJ(objResultPtr);
 	NEXT_INST_F(1, 1, 1);
 
+    TARGET(INST_LIST_INDEX)
     case INST_LIST_INDEX:	/* lindex with objc == 3 */
 	value2Ptr = OBJ_AT_TOS;
 	valuePtr = OBJ_UNDER_TOS;
@@ -5099,6 +5340,7 @@ TEBCresume(
 	TRACE_APPEND_OBJ(objResultPtr);
 	NEXT_INST_F(1, 2, -1);	/* Already has the correct refCount */
 
+    TARGET(INST_LIST_INDEX_IMM)
     case INST_LIST_INDEX_IMM: {	/* lindex with objc==3 and index in bytecode
 				 * stream */
 
@@ -5571,6 +5813,7 @@ TEBCresume(
 	 *	   Start of string-related instructions.
 	 */
 
+    TARGET(INST_STR_EQ)
     case INST_STR_EQ:
     case INST_STR_NEQ:		/* String (in)equality check */
     case INST_STR_CMP:		/* String compare. */
@@ -5630,6 +5873,7 @@ TEBCresume(
 	TRACE_APPEND("%d\n", (match < 0 ? -1 : match > 0 ? 1 : 0));
 	JUMP_PEEPHOLE_F(match, 1, 2);
 
+    TARGET(INST_STR_LEN)
     case INST_STR_LEN:
 	valuePtr = OBJ_AT_TOS;
 	TRACE("\"%.30s\" => ", O2S(valuePtr));
@@ -5669,6 +5913,7 @@ TEBCresume(
 	}
     }
 
+    TARGET(INST_STR_INDEX)
     case INST_STR_INDEX:
 	value2Ptr = OBJ_AT_TOS;
 	valuePtr = OBJ_UNDER_TOS;
@@ -5836,6 +6081,15 @@ TEBCresume(
 	} else if (valuePtr == value2Ptr) {
 	    objResultPtr = value3Ptr;
 	    goto doneStringMap;
+	} else {
+	    Tcl_Obj *mapPair[2];
+
+	    mapPair[0] = value2Ptr;
+	    mapPair[1] = value3Ptr;
+	    objResultPtr = TclStringMapAscii(valuePtr, 2, mapPair);
+	    if (objResultPtr != NULL) {
+		goto doneStringMap;
+	    }
 	}
 	ustring1 = Tcl_GetUnicodeFromObj(valuePtr, &slength);
 	if (slength == 0) {
@@ -6073,6 +6327,7 @@ TEBCresume(
 	TRACE_APPEND("%d\n", type1);
 	NEXT_INST_F(1, 1, 1);
 
+    TARGET(INST_EQ)
     case INST_EQ:
     case INST_NEQ:
     case INST_LT:
@@ -6368,6 +6623,7 @@ TEBCresume(
 	    NEXT_INST_F(1, 2, 1);
 	}
 
+    TARGET(INST_ADD)
     case INST_EXPON:
     case INST_ADD:
     case INST_SUB:
@@ -6529,6 +6785,7 @@ TEBCresume(
 	    NEXT_INST_F(1, 2, 1);
 	}
 
+    TARGET(INST_LNOT)
     case INST_LNOT: {
 	valuePtr = OBJ_AT_TOS;
 	TRACE("\"%.20s\" => ", O2S(valuePtr));
@@ -6829,6 +7086,7 @@ TEBCresume(
 	pc += 5 - infoPtr->loopCtTemp;
 	TCL_FALLTHROUGH();
 
+    TARGET(INST_FOREACH_STEP)
     case INST_FOREACH_STEP: /* TODO: address abstract list indexing here! */
 	/*
 	 * "Step" a foreach loop (i.e., begin its next iteration) by assigning
@@ -6991,6 +7249,7 @@ TEBCresume(
 	NEXT_INST_F0(1, 1);
     }
 
+    TARGET(INST_BEGIN_CATCH)
     case INST_BEGIN_CATCH:
 	/*
 	 * Record start of the catch command with exception range index equal
@@ -7004,6 +7263,7 @@ TEBCresume(
 		CURR_DEPTH);
 	NEXT_INST_F0(5, 0);
 
+    TARGET(INST_END_CATCH)
     case INST_END_CATCH:
 	catchTop--;
 	DECACHE_STACK_INFO();
@@ -7142,7 +7402,7 @@ TEBCresume(
 		goto afterDictExists;
 	    }
 	}
-	if (Tcl_DictObjGet(NULL, dictPtr, OBJ_AT_TOS,
+	if (TclDictObjLookup(NULL, dictPtr, OBJ_AT_TOS,
 		&objResultPtr) == TCL_OK) {
 	    found = (objResultPtr ? 1 : 0);
 	} else {
@@ -7199,6 +7459,7 @@ TEBCresume(
 	} else {
 	    NEXT_INST_F0(1, 1);
 	}
+    TARGET(INST_DICT_GET)
     case INST_DICT_GET:
 	numArgs = TclGetUInt4AtPtr(pc + 1);
 	TRACE("%u => ", (unsigned)numArgs);
@@ -7214,7 +7475,7 @@ TEBCresume(
 		goto gotError;
 	    }
 	}
-	if (Tcl_DictObjGet(interp, dictPtr, OBJ_AT_TOS,
+	if (TclDictObjLookup(interp, dictPtr, OBJ_AT_TOS,
 		&objResultPtr) != TCL_OK) {
 	    TRACE_APPEND("ERROR reading leaf dictionary key \"%.30s\": %s\n",
 		    O2S(OBJ_AT_TOS), O2S(Tcl_GetObjResult(interp)));
@@ -7251,7 +7512,7 @@ TEBCresume(
 		goto dictGetDefUseDefault;
 	    }
 	}
-	if (Tcl_DictObjGet(interp, dictPtr, OBJ_UNDER_TOS,
+	if (TclDictObjLookup(interp, dictPtr, OBJ_UNDER_TOS,
 		&objResultPtr) != TCL_OK) {
 	    TRACE_APPEND("ERROR reading leaf dictionary key \"%.30s\": %s\n",
 		    O2S(dictPtr), O2S(Tcl_GetObjResult(interp)));
@@ -7298,7 +7559,8 @@ TEBCresume(
 	case INST_DICT_INCR_IMM: {
 	    int increment = TclGetInt4AtPtr(pc + 1);
 	    cleanup = 1;
-	    result = Tcl_DictObjGet(interp, dictPtr, OBJ_AT_TOS, &valuePtr);
+	    result = TclDictObjGetForUpdate(interp, dictPtr, OBJ_AT_TOS,
+		    &valuePtr);
 	    if (result != TCL_OK) {
 		break;
 	    }
@@ -7389,7 +7651,7 @@ TEBCresume(
 	    }
 	}
 
-	if (Tcl_DictObjGet(interp, dictPtr, OBJ_UNDER_TOS,
+	if (TclDictObjGetForUpdate(interp, dictPtr, OBJ_UNDER_TOS,
 		&valuePtr) != TCL_OK) {
 	    Tcl_BounceRefCount(dictPtr);
 	    TRACE_ERROR(interp);
@@ -7500,7 +7762,7 @@ TEBCresume(
 	TRACE("%u => ", (unsigned) varIdx);
 	dictPtr = POP_OBJECT();
 	searchPtr = (Tcl_DictSearch *)Tcl_Alloc(sizeof(Tcl_DictSearch));
-	if (Tcl_DictObjFirst(interp, dictPtr, searchPtr, &keyPtr,
+	if (TclDictObjFirstLookup(interp, dictPtr, searchPtr, &keyPtr,
 		&valuePtr, &done) != TCL_OK) {
 	    /*
 	     * dictPtr is no longer on the stack, and we're not
@@ -7600,7 +7862,7 @@ TEBCresume(
 	    TCL_UNREACHABLE();
 	}
 	for (i=0 ; i<length ; i++) {
-	    if (Tcl_DictObjGet(interp, dictPtr, keyPtrPtr[i],
+	    if (TclDictObjLookup(interp, dictPtr, keyPtrPtr[i],
 		    &valuePtr) != TCL_OK) {
 		TRACE_ERROR(interp);
 		Tcl_DecrRefCount(dictPtr);
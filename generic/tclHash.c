@@ -36,6 +36,51 @@
 #define RANDOM_INDEX(tablePtr, i) \
     ((((i)*(size_t)1103515245) >> (tablePtr)->downShift) & (tablePtr)->mask)
 
+/*
+ * When a table grows, its entries are not all moved to the new bucket array
+ * at once: each key added or looked up afterwards moves MOVE_STEP buckets of
+ * the old array, so that no single insertion takes time proportional to the
+ * size of the table, and a table that stops growing still gets rid of its
+ * old array as it is used. The move is done long before the table next needs
+ * to grow. Until then, keys whose bucket in the old array has not been moved
+ * yet are looked up, added and deleted there. Tcl_FirstHashEntry finishes the
+ * move, so that lookups during a search cannot move entries behind it. The
+ * old array and the progress through it are kept in the staticBuckets array,
+ * which is not otherwise used once the table has outgrown it, and is cleared
+ * when the move is done.
+ */
+
+#define MOVE_STEP		8
+
+#define GROWING(tablePtr) \
+    (((tablePtr)->buckets != (tablePtr)->staticBuckets)			\
+	    && ((tablePtr)->staticBuckets[0] != NULL))
+
+#define OLD_BUCKETS(tablePtr) \
+    ((Tcl_HashEntry **) (void *) (tablePtr)->staticBuckets[0])
+#define NUM_OLD_BUCKETS(tablePtr) \
+    ((size_t) PTR2UINT((tablePtr)->staticBuckets[1]))
+#define NEXT_OLD_BUCKET(tablePtr) \
+    ((size_t) PTR2UINT((tablePtr)->staticBuckets[2]))
+#define OLD_DOWN_SHIFT(tablePtr) \
+    ((int) PTR2INT((tablePtr)->staticBuckets[3]))
+
+/*
+ * The index of the bucket for a hash value, in the current bucket array or
+ * in the old one of a table that is growing.
+ */
+
+#define BUCKET_INDEX(tablePtr, typePtr, hash) \
+    (((typePtr)->hashKeyProc == NULL					\
+	    || (typePtr)->flags & TCL_HASH_KEY_RANDOMIZE_HASH)		\
+	? RANDOM_INDEX(tablePtr, hash) : ((hash) & (tablePtr)->mask))
+#define OLD_BUCKET_INDEX(tablePtr, typePtr, hash) \
+    (((typePtr)->hashKeyProc == NULL					\
+	    || (typePtr)->flags & TCL_HASH_KEY_RANDOMIZE_HASH)		\
+	? ((((hash)*(size_t)1103515245) >> OLD_DOWN_SHIFT(tablePtr))	\
+		& (NUM_OLD_BUCKETS(tablePtr) - 1))			\
+	: ((hash) & (NUM_OLD_BUCKETS(tablePtr) - 1)))
+
 /*
  * Prototypes for the array hash key methods.
  */
@@ -62,7 +107,12 @@ static Tcl_HashEntry *	CreateHashEntry(Tcl_HashTable *tablePtr, const char *key,
 #ifndef TCL_NO_DEPRECATED
 static Tcl_HashEntry *	FindHashEntry(Tcl_HashTable *tablePtr, const char *key);
 #endif
+static void		MoveBuckets(Tcl_HashTable *tablePtr,
+			    const Tcl_HashKeyType *typePtr, size_t count);
 static void		RebuildTable(Tcl_HashTable *tablePtr);
+static inline Tcl_HashEntry *SearchBucket(Tcl_HashEntry *hPtr,
+			    const Tcl_HashKeyType *typePtr, const char *key,
+			    size_t hash);
 
 const Tcl_HashKeyType tclArrayHashKeyType = {
     TCL_HASH_KEY_TYPE_VERSION,		/* version */
@@ -283,7 +333,7 @@ CreateHashEntry(
     int *newPtr)		/* Store info here telling whether a new entry
 				 * was created. */
 {
-    Tcl_HashEntry *hPtr;
+    Tcl_HashEntry *hPtr, **bucketPtr;
     const Tcl_HashKeyType *typePtr;
     size_t hash, index;
 
@@ -311,60 +361,33 @@ CreateHashEntry(
     }
 
     /*
-     * Search all of the entries in the appropriate bucket.
+     * Search all of the entries in the appropriate bucket. That is in the
+     * old bucket array of a growing table if it has not been moved yet.
      */
 
-    if (typePtr->compareKeysProc) {
-	Tcl_CompareHashKeysProc *compareKeysProc = typePtr->compareKeysProc;
-	if (typePtr->flags & TCL_HASH_KEY_DIRECT_COMPARE) {
-	    for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
-		    hPtr = hPtr->nextPtr) {
-		if (hash != hPtr->hash) {
-		    continue;
-		}
-		/* if keys pointers or values are equal */
-		if ((key == hPtr->key.oneWordValue)
-			|| compareKeysProc((void *) key, hPtr)) {
-		    if (newPtr && (newPtr != TCL_HASH_FIND)) {
-			*newPtr = 0;
-		    }
-		    return hPtr;
-		}
-	    }
-	} else { /* no direct compare - compare key addresses only */
-	    for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
-		    hPtr = hPtr->nextPtr) {
-		if (hash != hPtr->hash) {
-		    continue;
-		}
-		/* if needle pointer equals content pointer or values equal */
-		if ((key == hPtr->key.string)
-			|| compareKeysProc((void *) key, hPtr)) {
-		    if (newPtr && (newPtr != TCL_HASH_FIND)) {
-			*newPtr = 0;
-		    }
-		    return hPtr;
-		}
-	    }
-	}
-    } else {
-	for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
-		hPtr = hPtr->nextPtr) {
-	    if (hash != hPtr->hash) {
-		continue;
-	    }
-	    if (key == hPtr->key.oneWordValue) {
-		if (newPtr && (newPtr != TCL_HASH_FIND)) {
-		    *newPtr = 0;
-		}
-		return hPtr;
-	    }
+    bucketPtr = &tablePtr->buckets[index];
+    if (GROWING(tablePtr)) {
+	size_t oldIndex = OLD_BUCKET_INDEX(tablePtr, typePtr, hash);
+
+	if (oldIndex >= NEXT_OLD_BUCKET(tablePtr)) {
+	    bucketPtr = &OLD_BUCKETS(tablePtr)[oldIndex];
 	}
     }
+    hPtr = SearchBucket(*bucketPtr, typePtr, key, hash);
+    if ((hPtr != NULL) || (newPtr == TCL_HASH_FIND)) {
+	if (hPtr && newPtr && (newPtr != TCL_HASH_FIND)) {
+	    *newPtr = 0;
+	}
 
-    if (newPtr == TCL_HASH_FIND) {
-	/* This is the findProc functionality, so we are done. */
-	return NULL;
+	/*
+	 * Lookups move old buckets too, as a table can stop growing long
+	 * before the insertions have moved all of them.
+	 */
+
+	if (GROWING(tablePtr)) {
+	    MoveBuckets(tablePtr, typePtr, MOVE_STEP);
+	}
+	return hPtr;
     }
 
     /*
@@ -387,21 +410,86 @@ CreateHashEntry(
 
     hPtr->tablePtr = tablePtr;
     hPtr->hash = hash;
-    hPtr->nextPtr = tablePtr->buckets[index];
-    tablePtr->buckets[index] = hPtr;
+    hPtr->nextPtr = *bucketPtr;
+    *bucketPtr = hPtr;
     tablePtr->numEntries++;
 
     /*
-     * If the table has exceeded a decent size, rebuild it with many more
-     * buckets.
+     * If the table is growing, move some more of its old buckets. If the
+     * table has exceeded a decent size, rebuild it with many more buckets.
      */
 
+    if (GROWING(tablePtr)) {
+	MoveBuckets(tablePtr, typePtr, MOVE_STEP);
+    }
     if (tablePtr->numEntries >= tablePtr->rebuildSize) {
 	RebuildTable(tablePtr);
     }
     return hPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * SearchBucket --
+ *
+ *	Search the chain of entries of a hash bucket for a key.
+ *
+ * Results:
+ *	The entry with a matching key, or NULL if there is none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline Tcl_HashEntry *
+SearchBucket(
+    Tcl_HashEntry *hPtr,	/* First entry in the bucket. */
+    const Tcl_HashKeyType *typePtr,
+				/* Type of the keys of the table. */
+    const char *key,		/* Key to search for. */
+    size_t hash)		/* Hash value of the key. */
+{
+    if (typePtr->compareKeysProc) {
+	Tcl_CompareHashKeysProc *compareKeysProc = typePtr->compareKeysProc;
+	if (typePtr->flags & TCL_HASH_KEY_DIRECT_COMPARE) {
+	    for (; hPtr != NULL; hPtr = hPtr->nextPtr) {
+		if (hash != hPtr->hash) {
+		    continue;
+		}
+		/* if keys pointers or values are equal */
+		if ((key == hPtr->key.oneWordValue)
+			|| compareKeysProc((void *) key, hPtr)) {
+		    return hPtr;
+		}
+	    }
+	} else { /* no direct compare - compare key addresses only */
+	    for (; hPtr != NULL; hPtr = hPtr->nextPtr) {
+		if (hash != hPtr->hash) {
+		    continue;
+		}
+		/* if needle pointer equals content pointer or values equal */
+		if ((key == hPtr->key.string)
+			|| compareKeysProc((void *) key, hPtr)) {
+		    return hPtr;
+		}
+	    }
+	}
+    } else {
+	for (; hPtr != NULL; hPtr = hPtr->nextPtr) {
+	    if (hash != hPtr->hash) {
+		continue;
+	    }
+	    if (key == hPtr->key.oneWordValue) {
+		return hPtr;
+	    }
+	}
+    }
+    return NULL;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -443,14 +531,17 @@ Tcl_DeleteHashEntry(
 	typePtr = &tclArrayHashKeyType;
     }
 
-    if (typePtr->hashKeyProc == NULL
-	    || typePtr->flags & TCL_HASH_KEY_RANDOMIZE_HASH) {
-	index = RANDOM_INDEX(tablePtr, entryPtr->hash);
-    } else {
-	index = entryPtr->hash & tablePtr->mask;
+    bucketPtr = NULL;
+    if (GROWING(tablePtr)) {
+	index = OLD_BUCKET_INDEX(tablePtr, typePtr, entryPtr->hash);
+	if (index >= NEXT_OLD_BUCKET(tablePtr)) {
+	    bucketPtr = &OLD_BUCKETS(tablePtr)[index];
+	}
+    }
+    if (bucketPtr == NULL) {
+	index = BUCKET_INDEX(tablePtr, typePtr, entryPtr->hash);
+	bucketPtr = &tablePtr->buckets[index];
     }
-
-    bucketPtr = &tablePtr->buckets[index];
 
     if (*bucketPtr == entryPtr) {
 	*bucketPtr = entryPtr->nextPtr;
@@ -511,9 +602,13 @@ Tcl_DeleteHashTable(
     }
 
     /*
-     * Free up all the entries in the table.
+     * Finish moving the entries of a growing table, then free up all the
+     * entries in the table.
      */
 
+    if (GROWING(tablePtr)) {
+	MoveBuckets(tablePtr, typePtr, NUM_OLD_BUCKETS(tablePtr));
+    }
     for (i = 0; i < tablePtr->numBuckets; i++) {
 	hPtr = tablePtr->buckets[i];
 	while (hPtr != NULL) {
@@ -565,7 +660,8 @@ Tcl_DeleteHashTable(
  *	all of the entries in the table, one at a time.
  *
  * Side effects:
- *	None.
+ *	The entries of a growing table are all moved to its current bucket
+ *	array.
  *
  *----------------------------------------------------------------------
  */
@@ -576,6 +672,27 @@ Tcl_FirstHashEntry(
     Tcl_HashSearch *searchPtr)	/* Place to store information about progress
 				 * through the table. */
 {
+    /*
+     * Finish moving the entries of a growing table, so that the search only
+     * has one bucket array to walk and lookups made during it move nothing.
+     */
+
+    if (GROWING(tablePtr)) {
+	const Tcl_HashKeyType *typePtr;
+
+	if (tablePtr->keyType == TCL_STRING_KEYS) {
+	    typePtr = &tclStringHashKeyType;
+	} else if (tablePtr->keyType == TCL_ONE_WORD_KEYS) {
+	    typePtr = &tclOneWordHashKeyType;
+	} else if (tablePtr->keyType == TCL_CUSTOM_TYPE_KEYS
+		|| tablePtr->keyType == TCL_CUSTOM_PTR_KEYS) {
+	    typePtr = tablePtr->typePtr;
+	} else {
+	    typePtr = &tclArrayHashKeyType;
+	}
+	MoveBuckets(tablePtr, typePtr, NUM_OLD_BUCKETS(tablePtr));
+    }
+
     searchPtr->tablePtr = tablePtr;
     searchPtr->nextIndex = 0;
     searchPtr->nextEntryPtr = NULL;
@@ -647,24 +764,32 @@ Tcl_HashStats(
     Tcl_HashTable *tablePtr)	/* Table for which to produce stats. */
 {
 #define NUM_COUNTERS 10
-    Tcl_Size i;
+    Tcl_Size i, numOld = 0;
     size_t count[NUM_COUNTERS], overflow, j;
     double average, tmp;
     Tcl_HashEntry *hPtr;
     char *result, *p;
 
     /*
-     * Compute a histogram of bucket usage.
+     * Compute a histogram of bucket usage. The old buckets of a growing
+     * table that have not been moved yet are counted as they are.
      */
 
+    if (GROWING(tablePtr)) {
+	numOld = NUM_OLD_BUCKETS(tablePtr) - NEXT_OLD_BUCKET(tablePtr);
+    }
+
     for (i = 0; i < NUM_COUNTERS; i++) {
 	count[i] = 0;
     }
     overflow = 0;
     average = 0.0;
-    for (i = 0; i < tablePtr->numBuckets; i++) {
+    for (i = 0; i < tablePtr->numBuckets + numOld; i++) {
 	j = 0;
-	for (hPtr = tablePtr->buckets[i]; hPtr != NULL; hPtr = hPtr->nextPtr) {
+	hPtr = (i < tablePtr->numBuckets) ? tablePtr->buckets[i]
+		: OLD_BUCKETS(tablePtr)[NEXT_OLD_BUCKET(tablePtr)
+			+ (i - tablePtr->numBuckets)];
+	for (; hPtr != NULL; hPtr = hPtr->nextPtr) {
 	    j++;
 	}
 	if (j < NUM_COUNTERS) {
@@ -961,7 +1086,9 @@ BogusCreate(
  *
  *	This function is invoked when the ratio of entries to hash buckets
  *	becomes too large. It creates a new table with a larger bucket array
- *	and moves all of the entries into the new table.
+ *	and starts moving the entries into the new table. The entries of a
+ *	small table are all moved at once; those of a larger one are left for
+ *	later lookups and insertions to move.
  *
  * Results:
  *	None.
@@ -976,10 +1103,9 @@ static void
 RebuildTable(
     Tcl_HashTable *tablePtr)	/* Table to enlarge. */
 {
-    size_t count, index, oldSize = tablePtr->numBuckets;
+    size_t oldSize = tablePtr->numBuckets;
     Tcl_HashEntry **oldBuckets = tablePtr->buckets;
-    Tcl_HashEntry **oldChainPtr, **newChainPtr;
-    Tcl_HashEntry *hPtr;
+    Tcl_HashEntry *smallBuckets[TCL_SMALL_HASH_TABLE];
     const Tcl_HashKeyType *typePtr;
 
     /* Avoid outgrowing capability of the memory allocators */
@@ -999,11 +1125,36 @@ RebuildTable(
 	typePtr = &tclArrayHashKeyType;
     }
 
+    /*
+     * Finish any previous growth first. That is not normally needed, as the
+     * table has to get four times fuller before it grows again.
+     */
+
+    if (GROWING(tablePtr)) {
+	MoveBuckets(tablePtr, typePtr, NUM_OLD_BUCKETS(tablePtr));
+    }
+
+    /*
+     * The static bucket array is about to hold the state of the move, so
+     * take its entries out of it, to be moved right away.
+     */
+
+    if (oldBuckets == tablePtr->staticBuckets) {
+	memcpy(smallBuckets, oldBuckets, sizeof(smallBuckets));
+	oldBuckets = smallBuckets;
+    }
+
     /*
      * Allocate and initialize the new bucket array, and set up hashing
-     * constants for new array size.
+     * constants for new array size. The old array becomes the one entries
+     * are moved from.
      */
 
+    tablePtr->staticBuckets[0] = (Tcl_HashEntry *) (void *) oldBuckets;
+    tablePtr->staticBuckets[1] = (Tcl_HashEntry *) UINT2PTR(oldSize);
+    tablePtr->staticBuckets[2] = NULL;
+    tablePtr->staticBuckets[3] = (Tcl_HashEntry *) INT2PTR(tablePtr->downShift);
+
     tablePtr->numBuckets *= 4;
     if (typePtr->flags & TCL_HASH_KEY_SYSTEM_HASH) {
 	tablePtr->buckets = (Tcl_HashEntry **)TclpSysAlloc(
@@ -1012,45 +1163,76 @@ RebuildTable(
 	tablePtr->buckets =
 		(Tcl_HashEntry **)Tcl_Alloc(tablePtr->numBuckets * sizeof(Tcl_HashEntry *));
     }
-    for (count = tablePtr->numBuckets, newChainPtr = tablePtr->buckets;
-	    count > 0; count--, newChainPtr++) {
-	*newChainPtr = NULL;
-    }
+    memset(tablePtr->buckets, 0, tablePtr->numBuckets * sizeof(Tcl_HashEntry *));
     tablePtr->rebuildSize *= 4;
     if (tablePtr->downShift > 1) {
 	tablePtr->downShift -= 2;
     }
     tablePtr->mask = (tablePtr->mask << 2) + 3;
+    if (oldBuckets == smallBuckets) {
+	MoveBuckets(tablePtr, typePtr, oldSize);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MoveBuckets --
+ *
+ *	Move the entries of some of the old buckets of a growing table to the
+ *	current bucket array.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The entries of up to count old buckets are re-hashed to new buckets.
+ *	Once all have been, the old bucket array is freed.
+ *
+ *----------------------------------------------------------------------
+ */
 
-    /*
-     * Rehash all of the existing entries into the new bucket array.
-     */
+static void
+MoveBuckets(
+    Tcl_HashTable *tablePtr,	/* Table that is growing. */
+    const Tcl_HashKeyType *typePtr,
+				/* Type of the keys of the table. */
+    size_t count)		/* Number of old buckets to move. */
+{
+    Tcl_HashEntry **oldBuckets = OLD_BUCKETS(tablePtr);
+    size_t index, next = NEXT_OLD_BUCKET(tablePtr);
+    size_t oldSize = NUM_OLD_BUCKETS(tablePtr);
+    Tcl_HashEntry *hPtr;
 
-    for (oldChainPtr = oldBuckets; oldSize > 0; oldSize--, oldChainPtr++) {
-	for (hPtr = *oldChainPtr; hPtr != NULL; hPtr = *oldChainPtr) {
-	    *oldChainPtr = hPtr->nextPtr;
-	    if (typePtr->hashKeyProc == NULL
-		    || typePtr->flags & TCL_HASH_KEY_RANDOMIZE_HASH) {
-		index = RANDOM_INDEX(tablePtr, hPtr->hash);
-	    } else {
-		index = hPtr->hash & tablePtr->mask;
-	    }
+    if (count > oldSize - next) {
+	count = oldSize - next;
+    }
+    for (; count > 0; count--, next++) {
+	for (hPtr = oldBuckets[next]; hPtr != NULL; hPtr = oldBuckets[next]) {
+	    oldBuckets[next] = hPtr->nextPtr;
+	    index = BUCKET_INDEX(tablePtr, typePtr, hPtr->hash);
 	    hPtr->nextPtr = tablePtr->buckets[index];
 	    tablePtr->buckets[index] = hPtr;
 	}
     }
+    if (next < oldSize) {
+	tablePtr->staticBuckets[2] = (Tcl_HashEntry *) UINT2PTR(next);
+	return;
+    }
 
     /*
-     * Free up the old bucket array, if it was dynamically allocated.
+     * All moved. Free up the old bucket array, if it was dynamically
+     * allocated.
      */
 
-    if (oldBuckets != tablePtr->staticBuckets) {
+    if (oldSize > TCL_SMALL_HASH_TABLE) {
 	if (typePtr->flags & TCL_HASH_KEY_SYSTEM_HASH) {
 	    TclpSysFree((char *) oldBuckets);
 	} else {
 	    Tcl_Free(oldBuckets);
 	}
     }
+    memset(tablePtr->staticBuckets, 0, sizeof(tablePtr->staticBuckets));
 }
 
 /*
@@ -103,6 +103,11 @@ typedef struct CopyState {
     Tcl_WideInt total;		/* Total bytes transferred (written). */
     Tcl_Interp *interp;		/* Interp that started the copy. */
     Tcl_Obj *cmdPtr;		/* Command to be invoked at completion. */
+    void *splicePtr;		/* Token from TclpSpliceOpen when the
+				 * platform can move the data without copying
+				 * it through user space, or NULL. */
+    int spliceMask;		/* Channel event SpliceEvent is currently
+				 * waiting for, or 0. */
     Tcl_Size bufSize;		/* Size of appended buffer. */
     char buffer[TCLFLEXARRAY];	/* Copy buffer, this must be the last
 				 * field. */
@@ -190,6 +195,8 @@ static void		MBError(CopyState *csPtr, int mask, int errorCode);
 static int		MBRead(CopyState *csPtr);
 static int		MBWrite(CopyState *csPtr);
 static void		MBEvent(void *clientData, int mask);
+static int		SpliceBytes(CopyState *csPtr, int *maskPtr);
+static void		SpliceEvent(void *clientData, int mask);
 
 static void		CopyEventProc(void *clientData, int mask);
 static void		CreateScriptRecord(Tcl_Interp *interp,
@@ -9454,6 +9461,19 @@ TclCopyChannel(
 	Tcl_IncrRefCount(cmdPtr);
     }
     csPtr->cmdPtr = cmdPtr;
+    csPtr->splicePtr = NULL;
+    csPtr->spliceMask = 0;
+
+    /*
+     * A lossless copy between two unstacked channels may be left to the
+     * kernel entirely when the platform supports it.
+     */
+
+    if (moveBytes && (inStatePtr != outStatePtr)
+	    && (inStatePtr->topChanPtr == inStatePtr->bottomChanPtr)
+	    && (outStatePtr->topChanPtr == outStatePtr->bottomChanPtr)) {
+	csPtr->splicePtr = TclpSpliceOpen(inChan, outChan);
+    }
 
     TclChannelPreserve(inChan);
     TclChannelPreserve(outChan);
@@ -9703,6 +9723,29 @@ MoveBytes(
 	}
     }
 
+    if (csPtr->splicePtr) {
+	int code, mask;
+
+	if (csPtr->cmdPtr) {
+	    Tcl_Channel inChan = (Tcl_Channel) csPtr->readPtr;
+	    csPtr->spliceMask = TCL_READABLE;
+	    Tcl_CreateChannelHandler(inChan, TCL_READABLE, SpliceEvent, csPtr);
+	    return TCL_OK;
+	}
+	do {
+	    code = SpliceBytes(csPtr, &mask);
+	} while (code == TCL_CONTINUE);
+	if (code == TCL_OK) {
+	    Tcl_SetObjResult(csPtr->interp, Tcl_NewWideIntObj(csPtr->total));
+	    StopCopy(csPtr);
+	    return TCL_OK;
+	}
+	if (code == TCL_ERROR) {
+	    return TCL_ERROR;
+	}
+	/* code == TCL_BREAK --> copy the ordinary way */
+    }
+
     if (csPtr->cmdPtr) {
 	Tcl_Channel inChan = (Tcl_Channel) csPtr->readPtr;
 	Tcl_CreateChannelHandler(inChan, TCL_READABLE, MBEvent, csPtr);
@@ -9728,6 +9771,138 @@ MoveBytes(
     }
     return TCL_OK;	/* Silence compiler warnings */
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SpliceBytes --
+ *
+ *	Moves the next chunk of a lossless copy whose channels the platform
+ *	can transfer between without user space, see TclpSpliceOpen. Data
+ *	already buffered by the input channel is passed on first, and output
+ *	still queued on the output channel is waited for.
+ *
+ * Results:
+ *	TCL_OK when the copy is complete, TCL_CONTINUE when there is more to
+ *	do, with the channel event to wait for before the next call in
+ *	*maskPtr, TCL_BREAK when the rest of the copy must be done the
+ *	ordinary way, or TCL_ERROR when the copy failed and has been stopped.
+ *
+ * Side effects:
+ *	Moves data between the channels.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SpliceBytes(
+    CopyState *csPtr,		/* State of copy operation. */
+    int *maskPtr)		/* Where to store the event to wait for. */
+{
+    ChannelState *inStatePtr = csPtr->readPtr->state;
+    ChannelState *outStatePtr = csPtr->writePtr->state;
+    long long moved;
+    int code, errorCode;
+
+    if (csPtr->toRead == 0) {
+	return TCL_OK;
+    }
+
+    *maskPtr = TCL_WRITABLE;
+    if (outStatePtr->outQueueHead != NULL) {
+	return TCL_CONTINUE;
+    }
+    if (inStatePtr->inQueueHead != NULL) {
+	code = MBWrite(csPtr);
+	if (code != TCL_CONTINUE || outStatePtr->outQueueHead != NULL) {
+	    return code;
+	}
+    }
+
+    ResetFlag(inStatePtr, CHANNEL_BLOCKED | CHANNEL_EOF);
+    moved = TclpSplice(csPtr->splicePtr, csPtr->toRead, maskPtr, &errorCode);
+    if (moved > 0) {
+	if (csPtr->toRead != -1) {
+	    csPtr->toRead -= moved;
+	}
+	csPtr->total += moved;
+	return (csPtr->toRead == 0) ? TCL_OK : TCL_CONTINUE;
+    } else if (moved == 0) {
+	SetFlag(inStatePtr, CHANNEL_EOF);
+	inStatePtr->inputEncodingFlags |= TCL_ENCODING_END;
+	return TCL_OK;
+    } else if (errorCode == EAGAIN) {
+	if (*maskPtr == TCL_READABLE) {
+	    SetFlag(inStatePtr, CHANNEL_BLOCKED);
+	}
+	return TCL_CONTINUE;
+    } else if (errorCode == EOPNOTSUPP) {
+	TclpSpliceClose(csPtr->splicePtr);
+	csPtr->splicePtr = NULL;
+	return TCL_BREAK;
+    }
+    MBError(csPtr, *maskPtr, errorCode);
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SpliceEvent --
+ *
+ *	Channel handler driving a background copy through SpliceBytes.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Moves data between the channels, and invokes the completion callback
+ *	when done.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SpliceEvent(
+    void *clientData,
+    TCL_UNUSED(int) /*mask*/)
+{
+    CopyState *csPtr = (CopyState *) clientData;
+    Tcl_Channel inChan = (Tcl_Channel) csPtr->readPtr;
+    Tcl_Channel outChan = (Tcl_Channel) csPtr->writePtr;
+    int code, mask;
+
+    code = SpliceBytes(csPtr, &mask);
+    if (code == TCL_ERROR) {
+	return;
+    }
+
+    /*
+     * Only touch the handlers when the event to wait for changes; most
+     * chunks of a big copy wait for the same one.
+     */
+
+    if (code != TCL_CONTINUE || mask != csPtr->spliceMask) {
+	Tcl_DeleteChannelHandler((csPtr->spliceMask == TCL_WRITABLE)
+		? outChan : inChan, SpliceEvent, csPtr);
+	csPtr->spliceMask = 0;
+    }
+    switch (code) {
+    case TCL_OK:
+	MBCallback(csPtr, NULL);
+	break;
+    case TCL_CONTINUE:
+	if (csPtr->spliceMask == 0) {
+	    csPtr->spliceMask = mask;
+	    Tcl_CreateChannelHandler((mask == TCL_WRITABLE) ? outChan : inChan,
+		    mask, SpliceEvent, csPtr);
+	}
+	break;
+    case TCL_BREAK:
+	Tcl_CreateChannelHandler(inChan, TCL_READABLE, MBEvent, csPtr);
+	break;
+    }
+}
 
 static int
 CopyData(
@@ -10427,6 +10602,8 @@ StopCopy(
 	}
 	Tcl_DeleteChannelHandler(inChan, MBEvent, csPtr);
 	Tcl_DeleteChannelHandler(outChan, MBEvent, csPtr);
+	Tcl_DeleteChannelHandler(inChan, SpliceEvent, csPtr);
+	Tcl_DeleteChannelHandler(outChan, SpliceEvent, csPtr);
 	TclDecrRefCount(csPtr->cmdPtr);
 	csPtr->cmdPtr = NULL;
     }
@@ -10451,6 +10628,9 @@ CopyDecrRefCount(
 	return;
     }
 
+    if (csPtr->splicePtr) {
+	TclpSpliceClose(csPtr->splicePtr);
+    }
     TclChannelRelease((Tcl_Channel)csPtr->readPtr);
     TclChannelRelease((Tcl_Channel)csPtr->writePtr);
 
@@ -1703,6 +1703,7 @@ Tcl_FSEvalFileEx(
     const char *string;
     Tcl_Channel chan;
     Tcl_Obj *objPtr;
+    void *token;
 
     if (Tcl_FSGetNormalizedPath(interp, pathPtr) == NULL) {
 	return result;
@@ -1788,6 +1789,7 @@ Tcl_FSEvalFileEx(
      * TIP #280:  Open a frame for the evaluated script.
      */
 
+    token = TclCompCacheBegin(interp, pathPtr, &statBuf, objPtr);
     iPtr->evalFlags |= TCL_EVAL_FILE;
     result = TclEvalEx(interp, string, length, 0, 1, NULL, string);
 
@@ -1818,6 +1820,9 @@ Tcl_FSEvalFileEx(
 		(overflow ? limit : (int)length), pathString,
 		(overflow ? "..." : ""), Tcl_GetErrorLine(interp)));
     }
+    if (token) {
+	TclCompCacheEnd(interp, token, result);
+    }
 
   end:
     Tcl_DecrRefCount(objPtr);
@@ -1928,7 +1933,7 @@ TclNREvalFile(
 
     iPtr->evalFlags |= TCL_EVAL_FILE;
     TclNRAddCallback(interp, EvalFileCallback, oldScriptFile, pathPtr, objPtr,
-	    NULL);
+	    TclCompCacheBegin(interp, pathPtr, &statBuf, objPtr));
     return TclNREvalObjEx(interp, objPtr, 0, NULL, INT_MIN);
 }
 
@@ -1972,6 +1977,9 @@ EvalFileCallback(
 		(overflow ? "..." : ""), Tcl_GetErrorLine(interp)));
     }
 
+    if (data[3]) {
+	TclCompCacheEnd(interp, data[3], result);
+    }
     Tcl_DecrRefCount(objPtr);
     return result;
 }
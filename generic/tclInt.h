@@ -1667,6 +1667,8 @@ typedef struct ExecEnv {
     int rewind;			/* Set when exception trapping is disabled
 				 * because a context is being deleted (e.g.,
 				 * the current coroutine has been deleted). */
+    struct ExecEnv *nextPtr;	/* Next in the pool of unused ExecEnvs of the
+				 * interpreter. */
 } ExecEnv;
 
 #define COR_IS_SUSPENDED(corPtr) \
@@ -2331,6 +2333,50 @@ typedef struct Interp {
     Tcl_Obj *innerContext;	/* cached list for fast reallocation */
     int resetErrorStack;	/* controls cleaning up of ::errorStack */
 
+    struct CompCache *compCachePtr;
+				/* The bytecode cache of the interpreter, or
+				 * NULL if no file has been sourced with it
+				 * enabled. See tclCompCache.c. */
+
+    /*
+     * Resource limiting framework support, continued: the memory limit and
+     * the sampler of the time limit. These are kept apart from the fields of
+     * 'limit' so that the layout of the fields after it does not change.
+     */
+
+    struct {
+	Tcl_WideInt memory;	/* Limit on the memory the interpreter may
+				 * allocate (net of what it frees), in bytes,
+				 * since the limit was set. */
+	Tcl_WideInt memoryUsed;	/* Memory charged to the interpreter since the
+				 * limit was set. Never negative, so that
+				 * freeing memory allocated before is no
+				 * credit. */
+	size_t memoryMark;	/* Bytes in use by the thread's allocator when
+				 * memory was last charged. */
+	Tcl_Size memoryDepth;	/* Number of evaluations being charged that
+				 * were started with no command running in
+				 * the interpreter. */
+	LimitHandler *memoryHandlers;
+				/* Handlers to execute when the limit is
+				 * reached. */
+	int memoryGranularity;	/* Mod factor used to determine how often to
+				 * evaluate the limit check. */
+	int timeDue;		/* Set by the sampler thread when the time
+				 * limit is due; the time limit is only
+				 * checked against the clock when set. Only
+				 * accessed through TclLimitTimeDue and
+				 * TclLimitSetTimeDue. */
+	struct LimitSample *timeSamplePtr;
+				/* Entry of the interpreter with the sampler
+				 * thread, or NULL if it has none. */
+    } limitEx;
+
+    ExecEnv *execEnvPool;	/* Execution environments of coroutines that
+				 * have ended, kept for new coroutines. See
+				 * TclNewCoroutineExecEnv. */
+    size_t numPooledExecEnvs;	/* Number of ExecEnvs in execEnvPool. */
+
 #ifdef TCL_COMPILE_STATS
     /*
      * Statistical information about the bytecode compiler and interpreter's
@@ -3217,6 +3263,26 @@ enum CheckEmptyStringResult {
     TCL_EMPTYSTRING_YES
 };
 
+/*
+ * A set of bytes for TclMemSearchSet, filled in by TclByteSetInit and
+ * TclByteSetAdd. Besides a flag per byte, it keeps what the vector kernels
+ * need: the first few bytes added, and for sets of ASCII bytes, a bit per
+ * high four bits for each value of the low four bits.
+ */
+
+#define TCL_BYTE_SET_LIST 4
+
+typedef struct {
+    char member[256];		/* Non-zero for the bytes in the set. */
+    int numMembers;		/* Number of bytes in the set. */
+    unsigned char members[TCL_BYTE_SET_LIST];
+				/* The first bytes added to the set. */
+    unsigned char nibbles[16];	/* Entry i has bit j set when the byte
+				 * (j << 4) | i is in the set, for j < 8. */
+    int allAscii;		/* Non-zero when all the bytes are less than
+				 * 0x80. */
+} TclByteSet;
+
 /*
  *----------------------------------------------------------------
  * Procedures shared among Tcl modules but not used by the outside world,
@@ -3373,6 +3439,12 @@ MODULE_SCOPE int	TclChanCaughtErrorBypass(Tcl_Interp *interp,
 MODULE_SCOPE Tcl_ObjCmdProc2 TclChannelNamesCmd;
 MODULE_SCOPE int	TclChanIsBinary(Tcl_Channel chan);
 MODULE_SCOPE Tcl_NRPostProc TclClearRootEnsemble;
+MODULE_SCOPE void *	TclCompCacheBegin(Tcl_Interp *interp, Tcl_Obj *pathPtr,
+			    const Tcl_StatBuf *statBufPtr, Tcl_Obj *scriptObj);
+MODULE_SCOPE void	TclCompCacheDelete(Interp *iPtr);
+MODULE_SCOPE void	TclCompCacheEnd(Tcl_Interp *interp, void *token,
+			    int result);
+MODULE_SCOPE void	TclCompCacheNoteProc(Tcl_Interp *interp, Proc *procPtr);
 MODULE_SCOPE int	TclCompareTwoNumbers(Tcl_Obj *valuePtr,
 			    Tcl_Obj *value2Ptr);
 MODULE_SCOPE ContLineLoc *TclContinuationsEnter(Tcl_Obj *objPtr, Tcl_Size num,
@@ -3406,6 +3478,16 @@ MODULE_SCOPE int	TclFindDictElement(Tcl_Interp *interp,
 			    const char **elementPtr, const char **nextPtr,
 			    Tcl_Size *sizePtr, int *literalPtr);
 MODULE_SCOPE Tcl_Obj *	TclDictObjSmartRef(Tcl_Interp *interp, Tcl_Obj *);
+MODULE_SCOPE int	TclDictObjFirstLookup(Tcl_Interp *interp,
+			    Tcl_Obj *dictPtr, Tcl_DictSearch *searchPtr,
+			    Tcl_Obj **keyPtrPtr, Tcl_Obj **valuePtrPtr,
+			    int *donePtr);
+MODULE_SCOPE int	TclDictObjGetForUpdate(Tcl_Interp *interp,
+			    Tcl_Obj *dictPtr, Tcl_Obj *keyPtr,
+			    Tcl_Obj **valuePtrPtr);
+MODULE_SCOPE int	TclDictObjLookup(Tcl_Interp *interp,
+			    Tcl_Obj *dictPtr, Tcl_Obj *keyPtr,
+			    Tcl_Obj **valuePtrPtr);
 MODULE_SCOPE int	TclDictGet(Tcl_Interp *interp, Tcl_Obj *dictPtr,
 			    const char *key, Tcl_Obj **valuePtrPtr);
 MODULE_SCOPE int	TclDictPut(Tcl_Interp *interp, Tcl_Obj *dictPtr,
@@ -3445,6 +3527,7 @@ MODULE_SCOPE Tcl_Namespace *TclEnsureNamespace(Tcl_Interp *interp,
 			    Tcl_Namespace *namespacePtr);
 MODULE_SCOPE void	TclFinalizeAllocSubsystem(void);
 MODULE_SCOPE void	TclFinalizeAsync(void);
+MODULE_SCOPE void	TclFinalizeCompilation(void);
 MODULE_SCOPE void	TclFinalizeDoubleConversion(void);
 MODULE_SCOPE void	TclFinalizeEncodingSubsystem(void);
 MODULE_SCOPE void	TclFinalizeEnvironment(void);
@@ -3528,6 +3611,7 @@ MODULE_SCOPE void	TclInitLimitSupport(Tcl_Interp *interp);
 MODULE_SCOPE void	TclInitNamespaceSubsystem(void);
 MODULE_SCOPE void	TclInitNotifier(void);
 MODULE_SCOPE void	TclInitObjSubsystem(void);
+MODULE_SCOPE void	TclInitUtfKernels(void);
 MODULE_SCOPE int	TclInitStaticPackages(Tcl_Interp *interp, void *);
 MODULE_SCOPE int	TclInterpReady(Tcl_Interp *interp);
 MODULE_SCOPE bool	TclIsBareword(int byte);
@@ -3537,7 +3621,11 @@ MODULE_SCOPE Tcl_Obj *	TclGetHomeDirObj(Tcl_Interp *interp, const char *user);
 MODULE_SCOPE Tcl_Obj *	TclResolveTildePath(Tcl_Interp *interp,
 			    Tcl_Obj *pathObj);
 MODULE_SCOPE Tcl_Obj *	TclResolveTildePathList(Tcl_Obj *pathsObj);
+MODULE_SCOPE Tcl_WideInt TclLimitGetMemory(Tcl_Interp *interp);
+MODULE_SCOPE int	TclLimitLeaveMemory(Tcl_Interp *interp, int result);
 MODULE_SCOPE void	TclLimitRemoveAllHandlers(Tcl_Interp *interp);
+MODULE_SCOPE void	TclLimitSetMemory(Tcl_Interp *interp,
+			    Tcl_WideInt memoryLimit);
 MODULE_SCOPE Tcl_Obj *	TclLindexList(Tcl_Interp *interp,
 			    Tcl_Obj *listPtr, Tcl_Obj *argPtr);
 MODULE_SCOPE Tcl_Obj *	TclLindexFlat(Tcl_Interp *interp, Tcl_Obj *listPtr,
@@ -3619,6 +3707,10 @@ MODULE_SCOPE void	TclpFinalizeMutex(Tcl_Mutex *mutexPtr);
 MODULE_SCOPE void	TclpFinalizeNotifier(void *clientData);
 MODULE_SCOPE void	TclpFinalizePipes(void);
 MODULE_SCOPE void	TclpFinalizeSockets(void);
+MODULE_SCOPE void *	TclpSpliceOpen(Tcl_Channel inChan, Tcl_Channel outChan);
+MODULE_SCOPE long long	TclpSplice(void *splicePtr, long long toCopy,
+			    int *maskPtr, int *errorCodePtr);
+MODULE_SCOPE void	TclpSpliceClose(void *splicePtr);
 #ifdef _WIN32
 MODULE_SCOPE void	TclInitSockets(void);
 #else
@@ -3633,6 +3725,7 @@ MODULE_SCOPE int	TclpThreadCreate(Tcl_ThreadId *idPtr,
 			    Tcl_ThreadCreateProc *proc, void *clientData,
 			    size_t stackSize, int flags);
 MODULE_SCOPE Tcl_Size	TclpFindVariable(const char *name, Tcl_Size *lengthPtr);
+MODULE_SCOPE int	TclpGetNumberOfCPUs(void);
 MODULE_SCOPE void	TclpInitLibraryPath(char **valuePtr,
 			    size_t *lengthPtr, Tcl_Encoding *encodingPtr);
 MODULE_SCOPE void	TclpInitLock(void);
@@ -3672,6 +3765,8 @@ MODULE_SCOPE void	TclpSetVariables(Tcl_Interp *interp);
 MODULE_SCOPE void *	TclThreadStorageKeyGet(Tcl_ThreadDataKey *keyPtr);
 MODULE_SCOPE void	TclThreadStorageKeySet(Tcl_ThreadDataKey *keyPtr,
 			    void *data);
+MODULE_SCOPE size_t	TclThreadAllocInUse(void);
+MODULE_SCOPE long long	TclThreadAllocIdle(void);
 MODULE_SCOPE TCL_NORETURN void TclpThreadExit(int status);
 MODULE_SCOPE void	TclRememberCondition(Tcl_Condition *mutex);
 MODULE_SCOPE void	TclRememberJoinableThread(Tcl_ThreadId id);
@@ -3728,6 +3823,17 @@ MODULE_SCOPE const char*TclGetCommandTypeName(Tcl_Command command);
 MODULE_SCOPE void	TclRegisterCommandTypeName(
 			    Tcl_ObjCmdProc2 *implementationProc,
 			    const char *nameStr);
+MODULE_SCOPE Tcl_Size	TclAsciiLength(const char *bytes, Tcl_Size numBytes);
+MODULE_SCOPE const char *TclMemSearch(const char *haystack,
+			    Tcl_Size numHaystack, const char *needle,
+			    Tcl_Size numNeedle);
+MODULE_SCOPE const char *TclMemSearchLast(const char *haystack,
+			    Tcl_Size numHaystack, const char *needle,
+			    Tcl_Size numNeedle);
+MODULE_SCOPE const char *TclMemSearchSet(const char *bytes,
+			    Tcl_Size numBytes, const TclByteSet *setPtr);
+MODULE_SCOPE void	TclByteSetInit(TclByteSet *setPtr);
+MODULE_SCOPE void	TclByteSetAdd(TclByteSet *setPtr, int byte);
 MODULE_SCOPE int	TclUtfCmp(const char *cs, const char *ct);
 MODULE_SCOPE int	TclUtfCasecmp(const char *cs, const char *ct);
 MODULE_SCOPE int	TclUtfCount(int ch);
@@ -3878,12 +3984,14 @@ MODULE_SCOPE Tcl_ObjCmdProc2 TclNamespaceEnsembleCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2 Tcl_OpenObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2 Tcl_PackageObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2 Tcl_PidObjCmd;
+MODULE_SCOPE Tcl_ObjCmdProc2 TclPMapObjCmd;
 MODULE_SCOPE int	TclSetUpPrefixCmd(Tcl_Interp *interp,
 				Tcl_Command prefixEnsemble);
 MODULE_SCOPE Tcl_ObjCmdProc2 Tcl_PutsObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2 Tcl_PwdObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2 Tcl_ReadObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2 Tcl_RegexpObjCmd;
+MODULE_SCOPE Tcl_ObjCmdProc2 TclRegexpCacheObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2 Tcl_RegsubObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2 Tcl_RenameObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc2 Tcl_RepresentationCmd;
@@ -4094,6 +4202,8 @@ MODULE_SCOPE Tcl_Obj *	TclStringFirst(Tcl_Obj *needle, Tcl_Obj *haystack,
 			    Tcl_Size start);
 MODULE_SCOPE Tcl_Obj *	TclStringLast(Tcl_Obj *needle, Tcl_Obj *haystack,
 			    Tcl_Size last);
+MODULE_SCOPE Tcl_Obj *	TclStringMapAscii(Tcl_Obj *objPtr, Tcl_Size mapElemc,
+			    Tcl_Obj *const *mapElemv);
 MODULE_SCOPE Tcl_Obj *	TclStringRepeat(Tcl_Interp *interp, Tcl_Obj *objPtr,
 			    Tcl_Size count, int flags);
 MODULE_SCOPE Tcl_Obj *	TclStringReplace(Tcl_Interp *interp, Tcl_Obj *objPtr,
@@ -4158,6 +4268,8 @@ MODULE_SCOPE int	TclObjCallVarTraces(Interp *iPtr, Var *arrayPtr,
 
 MODULE_SCOPE int	TclCompareObjKeys(void *keyPtr, Tcl_HashEntry *hPtr);
 MODULE_SCOPE void	TclFreeObjEntry(Tcl_HashEntry *hPtr);
+MODULE_SCOPE uint64_t	TclHashBytes(const void *bytes, size_t length,
+			    uint64_t seed);
 MODULE_SCOPE size_t TclHashObjKey(Tcl_HashTable *tablePtr, void *keyPtr);
 
 MODULE_SCOPE int	TclFullFinalizationRequested(void);
@@ -4360,6 +4472,7 @@ MODULE_SCOPE void	TclpSetAllocCache(void *);
 MODULE_SCOPE void	TclpFreeAllocMutex(Tcl_Mutex *mutex);
 MODULE_SCOPE void	TclpInitAllocCache(void);
 MODULE_SCOPE void	TclpFreeAllocCache(void *);
+MODULE_SCOPE void	TclpReleaseAllocPages(void *ptr, size_t size);
 
 /*
  * These macros need to be kept in sync with the code of TclThreadAllocObj()
@@ -5017,25 +5130,77 @@ MODULE_SCOPE Tcl_LibraryInitProc Tcl_ABSListTest_Init;
  * Inline versions of Tcl_LimitReady() and Tcl_LimitExceeded to limit number
  * of calls out of the critical path. Note that this code isn't particularly
  * readable; the non-inline version (in tclInterp.c) is much easier to
- * understand. Note also that these macros takes different args (iPtr->limit)
- * to the non-inline version.
+ * understand. Note also that these macros takes different args (iPtr->limit
+ * and iPtr) to the non-inline version.
  */
 
 #define TclLimitExceeded(limit) \
     ((limit).exceeded != 0)
 
-#define TclLimitReady(limit) \
-    (((limit).active == 0) ? 0 :					\
-    (++(limit).granularityTicker,					\
-    ((((limit).active & TCL_LIMIT_COMMANDS) &&				\
-	    (((limit).cmdGranularity == 1) ||				\
-	    ((limit).granularityTicker % (limit).cmdGranularity == 0)))	\
+/*
+ * Type of the memory limit, which is only set through [interp limit] and so
+ * is not part of the public limit types in tcl.h.
+ */
+
+#define TCL_LIMIT_MEMORY	0x04
+
+/*
+ * The timeDue flag of an interpreter is set by the sampler thread (see
+ * tclInterp.c) while the interpreter's thread reads it, so it is accessed
+ * atomically. Without GCC-style atomics there is no sampler thread and the
+ * flag is only touched by the interpreter's thread.
+ */
+
+#if TCL_THREADS && defined(__GNUC__) && defined(__ATOMIC_RELAXED)
+#   define TCL_LIMIT_SAMPLER 1
+#   define TclLimitTimeDue(iPtr) \
+	__atomic_load_n(&(iPtr)->limitEx.timeDue, __ATOMIC_RELAXED)
+#   define TclLimitSetTimeDue(iPtr, due) \
+	__atomic_store_n(&(iPtr)->limitEx.timeDue, (due), __ATOMIC_RELAXED)
+#else
+#   define TclLimitTimeDue(iPtr) \
+	((iPtr)->limitEx.timeDue)
+#   define TclLimitSetTimeDue(iPtr, due) \
+	((iPtr)->limitEx.timeDue = (due))
+#endif
+
+#define TclLimitReady(iPtr) \
+    (((iPtr)->limit.active == 0) ? 0 :					\
+    (++(iPtr)->limit.granularityTicker,					\
+    ((((iPtr)->limit.active & TCL_LIMIT_COMMANDS) &&			\
+	    (((iPtr)->limit.cmdGranularity == 1) ||			\
+	    ((iPtr)->limit.granularityTicker %				\
+		    (iPtr)->limit.cmdGranularity == 0)))		\
 	    ? 1 :							\
-    (((limit).active & TCL_LIMIT_TIME) &&				\
-	    (((limit).timeGranularity == 1) ||				\
-	    ((limit).granularityTicker % (limit).timeGranularity == 0)))\
+    (((iPtr)->limit.active & TCL_LIMIT_TIME) &&				\
+	    TclLimitTimeDue(iPtr) &&					\
+	    (((iPtr)->limit.timeGranularity == 1) ||			\
+	    ((iPtr)->limit.granularityTicker %				\
+		    (iPtr)->limit.timeGranularity == 0)))		\
+	    ? 1 :							\
+    (((iPtr)->limit.active & TCL_LIMIT_MEMORY) &&			\
+	    (((iPtr)->limitEx.memoryGranularity == 1) ||		\
+	    ((iPtr)->limit.granularityTicker %				\
+		    (iPtr)->limitEx.memoryGranularity == 0)))		\
 	    ? 1 : 0)))
 
+/*
+ * Memory is charged to the memory limit of an interpreter while it evaluates
+ * a script or command that was started with no command running in it.
+ * TclLimitEnterMemory marks the start of such an evaluation (it must be used
+ * before iPtr->numLevels is incremented) and TclLimitLeaveMemory() its end,
+ * once iPtr->numLevels is back to 0.
+ */
+
+#define TclLimitEnterMemory(iPtr) \
+    do {								\
+	if (((iPtr)->numLevels == 0) &&					\
+		((iPtr)->limit.active & TCL_LIMIT_MEMORY) &&		\
+		((iPtr)->limitEx.memoryDepth++ == 0)) {			\
+	    (iPtr)->limitEx.memoryMark = TclThreadAllocInUse();		\
+	}								\
+    } while (0)
+
 /*
  * Compile-time assertions: these produce a compile time error if the
  * expression is not known to be true at compile time. If the assertion is
@@ -253,6 +253,62 @@ enum LimitHandlerFlags {
 				 * careful.*/
 };
 
+/*
+ * Time limits are not checked by reading the clock while the limited
+ * interpreter runs. A sampler thread shared by the process sleeps until the
+ * earliest time limit comes, then sets the timeDue flag of the interpreters
+ * whose limits have come; only then does Tcl_LimitReady ask for the time
+ * limit to be checked. Each interpreter that has a time limit has a
+ * LimitSample, which is on the list of the sampler thread while armed.
+ */
+
+typedef struct LimitSample {
+    Interp *iPtr;		/* The interpreter whose time limit this is. */
+    long long time;		/* When the time limit comes. */
+    int armed;			/* Whether the sample is on the list of the
+				 * sampler thread. */
+    struct LimitSample *prevPtr;/* Previous armed sample. */
+    struct LimitSample *nextPtr;/* Next armed sample. */
+} LimitSample;
+
+/*
+ * States of the sampler thread.
+ */
+
+enum LimitSamplerStates {
+    SAMPLER_NONE,		/* Not started yet, or stopped. */
+    SAMPLER_RUNNING,		/* Running. */
+    SAMPLER_STOPPING,		/* Asked to stop. */
+    SAMPLER_FAILED		/* Could not be started; time limits are
+				 * checked against the clock every time their
+				 * granularity allows, as if always due. */
+};
+
+/*
+ * The longest the sampler thread sleeps at once, in microseconds, so that
+ * far-off limits do not overflow the timeout of the wait.
+ */
+
+#define SAMPLER_MAX_WAIT	3600000000LL
+
+static LimitSample *armedSamples = NULL;
+				/* Samples that the sampler thread waits
+				 * for. */
+static int samplerState = SAMPLER_NONE;
+				/* State of the sampler thread. */
+static Tcl_ThreadId samplerThread;
+				/* The sampler thread, while there is one. */
+static Tcl_Condition samplerCond = NULL;
+				/* Signalled when the sampler thread must look
+				 * at armedSamples again. */
+TCL_DECLARE_MUTEX(samplerMutex)	/* Guards all of the above and the samples,
+				 * and the writes of the timeDue flags. */
+#if defined(TCL_LIMIT_SAMPLER) && defined(HAVE_PTHREAD_ATFORK)
+static int samplerAtForkInit = 0;
+				/* Whether the fork handlers that reset the
+				 * sampler in the child are registered. */
+#endif
+
 /*
  * Macro to make looking up child and parent info more convenient.
  */
@@ -310,8 +366,24 @@ static int		ChildCommandLimitCmd(Tcl_Interp *interp,
 static int		ChildTimeLimitCmd(Tcl_Interp *interp,
 			    Tcl_Interp *childInterp, Tcl_Size consumedObjc,
 			    Tcl_Size objc, Tcl_Obj *const *objv);
+static int		ChildMemoryLimitCmd(Tcl_Interp *interp,
+			    Tcl_Interp *childInterp, Tcl_Size consumedObjc,
+			    Tcl_Size objc, Tcl_Obj *const *objv);
 static void		InheritLimitsFromParent(Tcl_Interp *childInterp,
 			    Tcl_Interp *parentInterp);
+static void		ArmTimeLimit(Interp *iPtr);
+static void		DisarmTimeLimit(Interp *iPtr);
+#ifdef TCL_LIMIT_SAMPLER
+static Tcl_ThreadCreateProc LimitSamplerThread;
+static void		StopLimitSampler(void *clientData);
+#if defined(HAVE_PTHREAD_ATFORK)
+static void		SamplerAtForkPrepare(void);
+static void		SamplerAtForkParent(void);
+static void		SamplerAtForkChild(void);
+#endif
+#endif /* TCL_LIMIT_SAMPLER */
+static void		ChargeMemoryLimit(Interp *iPtr);
+static void		DeleteLimitHandlers(LimitHandler *handlerPtr);
 static void		SetScriptLimitCallback(Tcl_Interp *interp, int type,
 			    Tcl_Interp *targetInterp, Tcl_Obj *scriptObj);
 static void		CallScriptLimitCallback(void *clientData,
@@ -1394,10 +1466,10 @@ NRInterpCmd(
     }
     case OPT_LIMIT: {
 	static const char *const limitTypes[] = {
-	    "commands", "time", NULL
+	    "commands", "memory", "time", NULL
 	};
 	enum LimitTypes {
-	    LIMIT_TYPE_COMMANDS, LIMIT_TYPE_TIME
+	    LIMIT_TYPE_COMMANDS, LIMIT_TYPE_MEMORY, LIMIT_TYPE_TIME
 	} limitType;
 
 	if (objc < 4) {
@@ -1416,6 +1488,8 @@ NRInterpCmd(
 	switch (limitType) {
 	case LIMIT_TYPE_COMMANDS:
 	    return ChildCommandLimitCmd(interp, childInterp, 4, objc,objv);
+	case LIMIT_TYPE_MEMORY:
+	    return ChildMemoryLimitCmd(interp, childInterp, 4, objc, objv);
 	case LIMIT_TYPE_TIME:
 	    return ChildTimeLimitCmd(interp, childInterp, 4, objc, objv);
 	default:
@@ -3053,10 +3127,10 @@ NRChildCmd(
     }
     case OPT_LIMIT: {
 	static const char *const limitTypes[] = {
-	    "commands", "time", NULL
+	    "commands", "memory", "time", NULL
 	};
 	enum LimitTypes {
-	    LIMIT_TYPE_COMMANDS, LIMIT_TYPE_TIME
+	    LIMIT_TYPE_COMMANDS, LIMIT_TYPE_MEMORY, LIMIT_TYPE_TIME
 	} limitType;
 
 	if (objc < 3) {
@@ -3070,6 +3144,8 @@ NRChildCmd(
 	switch (limitType) {
 	case LIMIT_TYPE_COMMANDS:
 	    return ChildCommandLimitCmd(interp, childInterp, 3, objc,objv);
+	case LIMIT_TYPE_MEMORY:
+	    return ChildMemoryLimitCmd(interp, childInterp, 3, objc, objv);
 	case LIMIT_TYPE_TIME:
 	    return ChildTimeLimitCmd(interp, childInterp, 3, objc, objv);
 	default:
@@ -3830,11 +3906,16 @@ Tcl_LimitReady(
 		    (ticker % iPtr->limit.cmdGranularity == 0))) {
 	    return 1;
 	}
-	if ((iPtr->limit.active & TCL_LIMIT_TIME) &&
+	if ((iPtr->limit.active & TCL_LIMIT_TIME) && TclLimitTimeDue(iPtr) &&
 		((iPtr->limit.timeGranularity == 1) ||
 		    (ticker % iPtr->limit.timeGranularity == 0))) {
 	    return 1;
 	}
+	if ((iPtr->limit.active & TCL_LIMIT_MEMORY) &&
+		((iPtr->limitEx.memoryGranularity == 1) ||
+		    (ticker % iPtr->limitEx.memoryGranularity == 0))) {
+	    return 1;
+	}
     }
     return 0;
 }
@@ -3892,13 +3973,24 @@ Tcl_LimitCheck(
 	Tcl_Release(interp);
     }
 
+    /*
+     * The clock is only read once the sampler thread has found the time
+     * limit due, or when the event loop forces a check by resetting the
+     * ticker (see TimeLimitCallback).
+     */
+
     if ((iPtr->limit.active & TCL_LIMIT_TIME) &&
+	    (TclLimitTimeDue(iPtr) || (ticker == 0)) &&
 	    ((iPtr->limit.timeGranularity == 1) ||
 		(ticker % iPtr->limit.timeGranularity == 0))) {
 	long long now;
 
 	now = Tcl_GetDayTime();
-	if (iPtr->limit.time <= now) {
+	if (iPtr->limit.time > now) {
+	    if (TclLimitTimeDue(iPtr)) {
+		ArmTimeLimit(iPtr);
+	    }
+	} else {
 	    iPtr->limit.exceeded |= TCL_LIMIT_TIME;
 	    Tcl_Preserve(interp);
 	    RunLimitHandlers(iPtr->limit.timeHandlers, interp);
@@ -3915,6 +4007,35 @@ Tcl_LimitCheck(
 	}
     }
 
+    if (iPtr->limit.active & TCL_LIMIT_MEMORY) {
+	if ((iPtr->limitEx.memoryGranularity == 1) ||
+		(ticker % iPtr->limitEx.memoryGranularity == 0)) {
+	    ChargeMemoryLimit(iPtr);
+	}
+	if (iPtr->limitEx.memoryUsed > iPtr->limitEx.memory) {
+	    iPtr->limit.exceeded |= TCL_LIMIT_MEMORY;
+	    Tcl_Preserve(interp);
+	    RunLimitHandlers(iPtr->limitEx.memoryHandlers, interp);
+
+	    /*
+	     * What the handlers allocated is not the interpreter's doing.
+	     */
+
+	    iPtr->limitEx.memoryMark = TclThreadAllocInUse();
+	    if (iPtr->limitEx.memoryUsed <= iPtr->limitEx.memory) {
+		iPtr->limit.exceeded &= ~TCL_LIMIT_MEMORY;
+	    } else if (iPtr->limit.exceeded & TCL_LIMIT_MEMORY) {
+		Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			"memory limit exceeded", -1));
+		Tcl_SetErrorCode(interp, "TCL", "LIMIT", "MEMORY",
+			(char *)NULL);
+		Tcl_Release(interp);
+		return TCL_ERROR;
+	    }
+	    Tcl_Release(interp);
+	}
+    }
+
     return TCL_OK;
 }
 
@@ -4054,6 +4175,14 @@ Tcl_LimitAddHandler(
 	}
 	iPtr->limit.timeHandlers = handlerPtr;
 	return;
+
+    case TCL_LIMIT_MEMORY:
+	handlerPtr->nextPtr = iPtr->limitEx.memoryHandlers;
+	if (handlerPtr->nextPtr != NULL) {
+	    handlerPtr->nextPtr->prevPtr = handlerPtr;
+	}
+	iPtr->limitEx.memoryHandlers = handlerPtr;
+	return;
     }
 
     Tcl_Panic("unknown type of resource limit");
@@ -4095,6 +4224,9 @@ Tcl_LimitRemoveHandler(
     case TCL_LIMIT_TIME:
 	handlerPtr = iPtr->limit.timeHandlers;
 	break;
+    case TCL_LIMIT_MEMORY:
+	handlerPtr = iPtr->limitEx.memoryHandlers;
+	break;
     default:
 	Tcl_Panic("unknown type of resource limit");
 	return;
@@ -4128,6 +4260,9 @@ Tcl_LimitRemoveHandler(
 	    case TCL_LIMIT_TIME:
 		iPtr->limit.timeHandlers = handlerPtr->nextPtr;
 		break;
+	    case TCL_LIMIT_MEMORY:
+		iPtr->limitEx.memoryHandlers = handlerPtr->nextPtr;
+		break;
 	    }
 	} else {
 	    handlerPtr->prevPtr->nextPtr = handlerPtr->nextPtr;
@@ -4175,47 +4310,54 @@ TclLimitRemoveAllHandlers(
     Tcl_Interp *interp)
 {
     Interp *iPtr = (Interp *) interp;
-    LimitHandler *handlerPtr, *nextHandlerPtr;
+
+    DeleteLimitHandlers(iPtr->limit.cmdHandlers);
+    iPtr->limit.cmdHandlers = NULL;
+    DeleteLimitHandlers(iPtr->limit.timeHandlers);
+    iPtr->limit.timeHandlers = NULL;
+    DeleteLimitHandlers(iPtr->limitEx.memoryHandlers);
+    iPtr->limitEx.memoryHandlers = NULL;
 
     /*
-     * Delete all command-limit handlers.
+     * Delete the timer callback that is used to trap limits that occur in
+     * [vwait]s, and take the time limit off the sampler thread.
      */
 
-    for (handlerPtr=iPtr->limit.cmdHandlers, iPtr->limit.cmdHandlers=NULL;
-	    handlerPtr!=NULL; handlerPtr=nextHandlerPtr) {
-	nextHandlerPtr = handlerPtr->nextPtr;
-
-	/*
-	 * Do not delete here if it has already been marked for deletion.
-	 */
-
-	if (handlerPtr->flags & LIMIT_HANDLER_DELETED) {
-	    continue;
-	}
-	handlerPtr->flags |= LIMIT_HANDLER_DELETED;
-	handlerPtr->prevPtr = NULL;
-	handlerPtr->nextPtr = NULL;
-
-	/*
-	 * If nothing is currently executing the handler, delete its client
-	 * data and the overall handler structure now. Otherwise it will all
-	 * go away when the handler returns.
-	 */
-
-	if (!(handlerPtr->flags & LIMIT_HANDLER_ACTIVE)) {
-	    if (handlerPtr->deleteProc != NULL) {
-		handlerPtr->deleteProc(handlerPtr->clientData);
-	    }
-	    Tcl_Free(handlerPtr);
-	}
+    if (iPtr->limit.timeEvent != NULL) {
+	Tcl_DeleteTimerHandler(iPtr->limit.timeEvent);
+	iPtr->limit.timeEvent = NULL;
     }
+    if (iPtr->limitEx.timeSamplePtr != NULL) {
+	DisarmTimeLimit(iPtr);
+	Tcl_Free(iPtr->limitEx.timeSamplePtr);
+	iPtr->limitEx.timeSamplePtr = NULL;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeleteLimitHandlers --
+ *
+ *	Delete a list of limit handlers, for TclLimitRemoveAllHandlers.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Limit handlers are deleted or marked for deletion (as with
+ *	Tcl_LimitRemoveHandler).
+ *
+ *----------------------------------------------------------------------
+ */
 
-    /*
-     * Delete all time-limit handlers.
-     */
+static void
+DeleteLimitHandlers(
+    LimitHandler *handlerPtr)
+{
+    LimitHandler *nextHandlerPtr;
 
-    for (handlerPtr=iPtr->limit.timeHandlers, iPtr->limit.timeHandlers=NULL;
-	    handlerPtr!=NULL; handlerPtr=nextHandlerPtr) {
+    for (; handlerPtr!=NULL; handlerPtr=nextHandlerPtr) {
 	nextHandlerPtr = handlerPtr->nextPtr;
 
 	/*
@@ -4242,16 +4384,6 @@ TclLimitRemoveAllHandlers(
 	    Tcl_Free(handlerPtr);
 	}
     }
-
-    /*
-     * Delete the timer callback that is used to trap limits that occur in
-     * [vwait]s...
-     */
-
-    if (iPtr->limit.timeEvent != NULL) {
-	Tcl_DeleteTimerHandler(iPtr->limit.timeEvent);
-	iPtr->limit.timeEvent = NULL;
-    }
 }
 
 /*
@@ -4320,7 +4452,8 @@ Tcl_LimitTypeExceeded(
  * Side effects:
  *	The limit is turned on and will be checked in future at an interval
  *	determined by the frequency of calling of Tcl_LimitReady and the
- *	granularity of the limit in question.
+ *	granularity of the limit in question. Turning on the memory limit
+ *	starts counting the memory allocated in the interpreter afresh.
  *
  *----------------------------------------------------------------------
  */
@@ -4332,6 +4465,15 @@ Tcl_LimitTypeSet(
 {
     Interp *iPtr = (Interp *) interp;
 
+    /*
+     * A memory limit counts what is allocated from when it is turned on.
+     */
+
+    if ((type & TCL_LIMIT_MEMORY) &&
+	    !(iPtr->limit.active & TCL_LIMIT_MEMORY)) {
+	iPtr->limitEx.memoryUsed = 0;
+	iPtr->limitEx.memoryDepth = 0;
+    }
     iPtr->limit.active |= type;
 }
 
@@ -4457,6 +4599,7 @@ Tcl_LimitSetTime2(
     iPtr->limit.timeEvent = TclCreateAbsoluteTimerHandler(nextMoment,
 	    TimeLimitCallback, interp);
     iPtr->limit.exceeded &= ~TCL_LIMIT_TIME;
+    ArmTimeLimit(iPtr);
 }
 
 void
@@ -4483,6 +4626,7 @@ Tcl_LimitSetTime(
     iPtr->limit.timeEvent = TclCreateAbsoluteTimerHandler(nextMoment,
 	    TimeLimitCallback, interp);
     iPtr->limit.exceeded &= ~TCL_LIMIT_TIME;
+    ArmTimeLimit(iPtr);
 }
 
 /*
@@ -4530,6 +4674,288 @@ TimeLimitCallback(
     Tcl_Release(interp);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ArmTimeLimit --
+ *
+ *	Have the sampler thread set the timeDue flag of an interpreter when
+ *	its time limit comes, starting the sampler thread if there is none
+ *	yet.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May start the sampler thread. If it cannot be started, the time limit
+ *	is always due, so it is checked against the clock as often as its
+ *	granularity allows.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ArmTimeLimit(
+    Interp *iPtr)
+{
+    LimitSample *samplePtr = iPtr->limitEx.timeSamplePtr;
+    int started = 0;
+
+    if (samplePtr == NULL) {
+	samplePtr = (LimitSample *) Tcl_Alloc(sizeof(LimitSample));
+	samplePtr->iPtr = iPtr;
+	samplePtr->armed = 0;
+	iPtr->limitEx.timeSamplePtr = samplePtr;
+    }
+
+    Tcl_MutexLock(&samplerMutex);
+    if ((samplerState == SAMPLER_NONE) && !TclInExit()) {
+#ifdef TCL_LIMIT_SAMPLER
+#if defined(HAVE_PTHREAD_ATFORK)
+	if (!samplerAtForkInit) {
+	    if (pthread_atfork(SamplerAtForkPrepare, SamplerAtForkParent,
+		    SamplerAtForkChild)) {
+		Tcl_Panic("ArmTimeLimit: pthread_atfork failed");
+	    }
+	    samplerAtForkInit = 1;
+	}
+#endif /* HAVE_PTHREAD_ATFORK */
+	started = (Tcl_CreateThread(&samplerThread, LimitSamplerThread, NULL,
+		TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) == TCL_OK);
+#endif /* TCL_LIMIT_SAMPLER */
+	samplerState = (started ? SAMPLER_RUNNING : SAMPLER_FAILED);
+    }
+    if (samplerState == SAMPLER_RUNNING) {
+	samplePtr->time = iPtr->limit.time;
+	TclLimitSetTimeDue(iPtr, 0);
+	if (!samplePtr->armed) {
+	    TclSpliceIn(samplePtr, armedSamples);
+	    samplePtr->armed = 1;
+	}
+	Tcl_ConditionNotify(&samplerCond);
+    } else {
+	TclLimitSetTimeDue(iPtr, 1);
+    }
+    Tcl_MutexUnlock(&samplerMutex);
+
+#ifdef TCL_LIMIT_SAMPLER
+    if (started) {
+	Tcl_CreateExitHandler(StopLimitSampler, NULL);
+    }
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DisarmTimeLimit --
+ *
+ *	Take the time limit of an interpreter off the list of the sampler
+ *	thread.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The sampler thread no longer touches the interpreter.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DisarmTimeLimit(
+    Interp *iPtr)
+{
+    LimitSample *samplePtr = iPtr->limitEx.timeSamplePtr;
+
+    Tcl_MutexLock(&samplerMutex);
+    if (samplePtr->armed) {
+	TclSpliceOut(samplePtr, armedSamples);
+	samplePtr->armed = 0;
+    }
+    Tcl_MutexUnlock(&samplerMutex);
+}
+
+#ifdef TCL_LIMIT_SAMPLER
+/*
+ *----------------------------------------------------------------------
+ *
+ * LimitSamplerThread --
+ *
+ *	The sampler thread. Sleeps until the earliest armed time limit comes,
+ *	then sets the timeDue flag of the interpreters whose limits have come
+ *	and disarms them.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets timeDue flags, which makes the interpreters check their time
+ *	limits.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+LimitSamplerThread(
+    TCL_UNUSED(void *))
+{
+    Tcl_MutexLock(&samplerMutex);
+    while (samplerState == SAMPLER_RUNNING) {
+	LimitSample *samplePtr, *nextPtr;
+	long long now = Tcl_GetDayTime();
+	long long wait = SAMPLER_MAX_WAIT;
+
+	for (samplePtr = armedSamples; samplePtr != NULL;
+		samplePtr = nextPtr) {
+	    nextPtr = samplePtr->nextPtr;
+	    if (samplePtr->time <= now) {
+		TclLimitSetTimeDue(samplePtr->iPtr, 1);
+		TclSpliceOut(samplePtr, armedSamples);
+		samplePtr->armed = 0;
+	    } else if (samplePtr->time - now < wait) {
+		wait = samplePtr->time - now;
+	    }
+	}
+	Tcl_ConditionWait2(&samplerCond, &samplerMutex, wait);
+    }
+    Tcl_MutexUnlock(&samplerMutex);
+    Tcl_ExitThread(0);
+
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StopLimitSampler --
+ *
+ *	Exit handler that stops the sampler thread.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Joins the sampler thread. Time limits set afterwards are checked
+ *	against the clock.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StopLimitSampler(
+    TCL_UNUSED(void *))
+{
+    int result;
+
+    Tcl_MutexLock(&samplerMutex);
+    if (samplerState != SAMPLER_RUNNING) {
+	/*
+	 * Stopped already, or this handler was inherited through fork() from
+	 * a parent whose sampler thread is not in this process.
+	 */
+
+	Tcl_MutexUnlock(&samplerMutex);
+	return;
+    }
+    samplerState = SAMPLER_STOPPING;
+    Tcl_ConditionNotify(&samplerCond);
+    Tcl_MutexUnlock(&samplerMutex);
+    Tcl_JoinThread(samplerThread, &result);
+
+    Tcl_MutexLock(&samplerMutex);
+    samplerState = SAMPLER_NONE;
+    Tcl_MutexUnlock(&samplerMutex);
+    Tcl_ConditionFinalize(&samplerCond);
+}
+
+#if defined(HAVE_PTHREAD_ATFORK)
+/*
+ *----------------------------------------------------------------------
+ *
+ * SamplerAtForkPrepare --
+ *
+ *	Lock the sampler mutex before a fork(), so that it is in a known state
+ *	in the child.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Locks samplerMutex.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SamplerAtForkPrepare(void)
+{
+    Tcl_MutexLock(&samplerMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SamplerAtForkParent --
+ *
+ *	Unlock the sampler mutex after a fork(), in the parent.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Unlocks samplerMutex.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SamplerAtForkParent(void)
+{
+    Tcl_MutexUnlock(&samplerMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SamplerAtForkChild --
+ *
+ *	Forget the sampler thread of the parent in the child of a fork(),
+ *	which only has the thread that forked. The armed time limits are made
+ *	due, so that they are checked against the clock and armed again with
+ *	a new sampler thread.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Empties the list of armed samples and resets samplerState. The
+ *	condition variable is leaked rather than finalized, since the sampler
+ *	thread of the parent may be counted as waiting on it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SamplerAtForkChild(void)
+{
+    LimitSample *samplePtr;
+
+    for (samplePtr = armedSamples; samplePtr != NULL;
+	    samplePtr = samplePtr->nextPtr) {
+	TclLimitSetTimeDue(samplePtr->iPtr, 1);
+	samplePtr->armed = 0;
+    }
+    armedSamples = NULL;
+    if (samplerState != SAMPLER_FAILED) {
+	samplerState = SAMPLER_NONE;
+    }
+    samplerCond = NULL;
+    Tcl_MutexUnlock(&samplerMutex);
+}
+#endif /* HAVE_PTHREAD_ATFORK */
+#endif /* TCL_LIMIT_SAMPLER */
+
 /*
  *----------------------------------------------------------------------
  *
@@ -4567,6 +4993,137 @@ Tcl_LimitGetTime(
     timeLimitPtr->usec = iPtr->limit.time % 1000000;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclLimitSetMemory --
+ *
+ *	Set the memory limit for an interpreter: the number of bytes it may
+ *	allocate, net of what it frees, from when the limit is turned on.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Also resets whether the memory limit was exceeded.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclLimitSetMemory(
+    Tcl_Interp *interp,
+    Tcl_WideInt memoryLimit)
+{
+    Interp *iPtr = (Interp *) interp;
+
+    iPtr->limitEx.memory = memoryLimit;
+    iPtr->limit.exceeded &= ~TCL_LIMIT_MEMORY;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclLimitGetMemory --
+ *
+ *	Get the memory limit for an interpreter.
+ *
+ * Results:
+ *	The limit, in bytes.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_WideInt
+TclLimitGetMemory(
+    Tcl_Interp *interp)
+{
+    Interp *iPtr = (Interp *) interp;
+
+    return iPtr->limitEx.memory;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChargeMemoryLimit --
+ *
+ *	Charge what the thread allocated since the last charge, less what it
+ *	freed, to the memory limit of an interpreter, if it is evaluating
+ *	something. The memory charged never drops below zero.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Updates the memory used by the interpreter.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ChargeMemoryLimit(
+    Interp *iPtr)
+{
+    if (iPtr->limitEx.memoryDepth > 0) {
+	size_t inUse = TclThreadAllocInUse();
+
+	iPtr->limitEx.memoryUsed +=
+		(Tcl_WideInt) (inUse - iPtr->limitEx.memoryMark);
+	iPtr->limitEx.memoryMark = inUse;
+
+	/*
+	 * Frees only make up for what was charged: memory allocated before
+	 * the limit was set, by the parent or by other threads is no credit.
+	 */
+
+	if (iPtr->limitEx.memoryUsed < 0) {
+	    iPtr->limitEx.memoryUsed = 0;
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclLimitLeaveMemory --
+ *
+ *	Called at the end of an evaluation started by TclLimitEnterMemory,
+ *	when the interpreter has a memory limit.
+ *
+ * Results:
+ *	The result of the evaluation, or TCL_ERROR if it was TCL_OK and the
+ *	memory limit is exceeded.
+ *
+ * Side effects:
+ *	Charges the memory allocated by the evaluation. May run the limit
+ *	handlers of the memory limit.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclLimitLeaveMemory(
+    Tcl_Interp *interp,
+    int result)
+{
+    Interp *iPtr = (Interp *) interp;
+
+    if (iPtr->limitEx.memoryDepth == 0) {
+	return result;
+    }
+    ChargeMemoryLimit(iPtr);
+    iPtr->limitEx.memoryDepth--;
+    if ((result == TCL_OK)
+	    && (iPtr->limitEx.memoryUsed > iPtr->limitEx.memory)) {
+	result = Tcl_LimitCheck(interp);
+    }
+    return result;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -4602,6 +5159,9 @@ Tcl_LimitSetGranularity(
     case TCL_LIMIT_TIME:
 	iPtr->limit.timeGranularity = granularity;
 	return;
+    case TCL_LIMIT_MEMORY:
+	iPtr->limitEx.memoryGranularity = granularity;
+	return;
     }
     Tcl_Panic("unknown type of resource limit");
 }
@@ -4634,6 +5194,8 @@ Tcl_LimitGetGranularity(
 	return iPtr->limit.cmdGranularity;
     case TCL_LIMIT_TIME:
 	return iPtr->limit.timeGranularity;
+    case TCL_LIMIT_MEMORY:
+	return iPtr->limitEx.memoryGranularity;
     }
     Tcl_Panic("unknown type of resource limit");
     return -1; /* NOT REACHED */
@@ -4852,6 +5414,14 @@ TclInitLimitSupport(
     iPtr->limit.timeHandlers = NULL;
     iPtr->limit.timeEvent = NULL;
     iPtr->limit.timeGranularity = 10;
+    iPtr->limitEx.memory = 0;
+    iPtr->limitEx.memoryUsed = 0;
+    iPtr->limitEx.memoryMark = 0;
+    iPtr->limitEx.memoryDepth = 0;
+    iPtr->limitEx.memoryHandlers = NULL;
+    iPtr->limitEx.memoryGranularity = 10;
+    TclLimitSetTimeDue(iPtr, 0);
+    iPtr->limitEx.timeSamplePtr = NULL;
     Tcl_InitHashTable(&iPtr->limit.callbacks,
 	    sizeof(ScriptLimitCallbackKey) / sizeof(int));
 }
@@ -4893,6 +5463,16 @@ InheritLimitsFromParent(
 	childPtr->limit.active |= TCL_LIMIT_TIME;
 	childPtr->limit.time = parentPtr->limit.time;
 	childPtr->limit.timeGranularity = parentPtr->limit.timeGranularity;
+	ArmTimeLimit(childPtr);
+    }
+    if (parentPtr->limit.active & TCL_LIMIT_MEMORY) {
+	Tcl_WideInt left = parentPtr->limitEx.memory
+		- parentPtr->limitEx.memoryUsed;
+
+	childPtr->limit.active |= TCL_LIMIT_MEMORY;
+	childPtr->limitEx.memory = (left > 0 ? left : 0);
+	childPtr->limitEx.memoryGranularity =
+		parentPtr->limitEx.memoryGranularity;
     }
 }
 
@@ -5337,6 +5917,198 @@ ChildTimeLimitCmd(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChildMemoryLimitCmd --
+ *
+ *	Implementation of the [interp limit $i memory] and [$i limit memory]
+ *	subcommands. See the interp manual page for a full description.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Depends on the arguments.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ChildMemoryLimitCmd(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Interp *childInterp,	/* Interpreter being adjusted. */
+    Tcl_Size consumedObjc,	/* Number of args already parsed. */
+    Tcl_Size objc,		/* Total number of arguments. */
+    Tcl_Obj *const *objv)	/* Argument objects. */
+{
+    static const char *const options[] = {
+	"-command", "-granularity", "-value", NULL
+    };
+    enum Options {
+	OPT_CMD, OPT_GRAN, OPT_VAL
+    } index;
+    Interp *iPtr = (Interp *) interp;
+    ScriptLimitCallbackKey key;
+    ScriptLimitCallback *limitCBPtr;
+    Tcl_HashEntry *hPtr;
+
+    /*
+     * As for the other limits, the calling interpreter may only manipulate
+     * the limits of its children.
+     */
+
+    if (interp == childInterp) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"limits on current interpreter inaccessible", -1));
+	Tcl_SetErrorCode(interp, "TCL", "OPERATION", "INTERP", "SELF",
+		(char *)NULL);
+	return TCL_ERROR;
+    }
+
+    if (objc == consumedObjc) {
+	Tcl_Obj *dictPtr, *empty;
+
+	TclNewObj(dictPtr);
+	key.interp = childInterp;
+	key.type = TCL_LIMIT_MEMORY;
+	hPtr = Tcl_FindHashEntry(&iPtr->limit.callbacks, &key);
+	limitCBPtr = (hPtr == NULL ? NULL :
+		(ScriptLimitCallback *) Tcl_GetHashValue(hPtr));
+	if (limitCBPtr != NULL && limitCBPtr->scriptObj != NULL) {
+	    TclDictPut(NULL, dictPtr, options[0], limitCBPtr->scriptObj);
+	} else {
+	    TclNewObj(empty);
+	    TclDictPut(NULL, dictPtr, options[0], empty);
+	}
+	TclDictPut(NULL, dictPtr, options[1], Tcl_NewWideIntObj(
+		Tcl_LimitGetGranularity(childInterp, TCL_LIMIT_MEMORY)));
+	if (Tcl_LimitTypeEnabled(childInterp, TCL_LIMIT_MEMORY)) {
+	    TclDictPut(NULL, dictPtr, options[2], Tcl_NewWideIntObj(
+		    TclLimitGetMemory(childInterp)));
+	} else {
+	    TclNewObj(empty);
+	    TclDictPut(NULL, dictPtr, options[2], empty);
+	}
+	Tcl_SetObjResult(interp, dictPtr);
+	return TCL_OK;
+    } else if (objc == consumedObjc+1) {
+	if (Tcl_GetIndexFromObj(interp, objv[consumedObjc], options, "option",
+		0, &index) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	switch (index) {
+	case OPT_CMD:
+	    key.interp = childInterp;
+	    key.type = TCL_LIMIT_MEMORY;
+	    hPtr = Tcl_FindHashEntry(&iPtr->limit.callbacks, &key);
+	    if (hPtr != NULL) {
+		limitCBPtr = (ScriptLimitCallback *) Tcl_GetHashValue(hPtr);
+		if (limitCBPtr != NULL && limitCBPtr->scriptObj != NULL) {
+		    Tcl_SetObjResult(interp, limitCBPtr->scriptObj);
+		}
+	    }
+	    break;
+	case OPT_GRAN:
+	    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(
+		    Tcl_LimitGetGranularity(childInterp, TCL_LIMIT_MEMORY)));
+	    break;
+	case OPT_VAL:
+	    if (Tcl_LimitTypeEnabled(childInterp, TCL_LIMIT_MEMORY)) {
+		Tcl_SetObjResult(interp,
+			Tcl_NewWideIntObj(TclLimitGetMemory(childInterp)));
+	    }
+	    break;
+	default:
+	    TCL_UNREACHABLE();
+	}
+	return TCL_OK;
+    } else if ((objc-consumedObjc) & 1 /* isOdd(objc-consumedObjc) */) {
+	Tcl_WrongNumArgs(interp, consumedObjc, objv, "?-option value ...?");
+	return TCL_ERROR;
+    } else {
+	Tcl_Size i, scriptLen = 0, limitLen = 0;
+	Tcl_Obj *scriptObj = NULL, *granObj = NULL, *limitObj = NULL;
+	int gran = 0;
+	Tcl_WideInt limit = 0;
+
+	for (i=consumedObjc ; i<objc ; i+=2) {
+	    if (Tcl_GetIndexFromObj(interp, objv[i], options, "option", 0,
+		    &index) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    switch (index) {
+	    case OPT_CMD:
+		scriptObj = objv[i+1];
+		(void) TclGetStringFromObj(scriptObj, &scriptLen);
+		break;
+	    case OPT_GRAN:
+		granObj = objv[i+1];
+		if (TclGetIntFromObj(interp, objv[i+1], &gran) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		if (gran < 1) {
+		    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			    "granularity must be at least 1", -1));
+		    Tcl_SetErrorCode(interp, "TCL", "OPERATION", "INTERP",
+			    "BADVALUE", (char *)NULL);
+		    return TCL_ERROR;
+		}
+		break;
+	    case OPT_VAL:
+		limitObj = objv[i+1];
+		(void) TclGetStringFromObj(objv[i+1], &limitLen);
+		if (limitLen == 0) {
+		    break;
+		}
+#if !TCL_THREADS || !defined(USE_THREAD_ALLOC)
+		/*
+		 * Memory is charged from the accounting of the threaded
+		 * allocator, so there is nothing to charge without it.
+		 */
+
+		Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			"memory limits need the threaded memory allocator",
+			-1));
+		Tcl_SetErrorCode(interp, "TCL", "OPERATION", "INTERP",
+			"UNSUPPORTED", (char *)NULL);
+		return TCL_ERROR;
+#else
+		if (TclGetWideIntFromObj(interp, objv[i+1], &limit) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		if (limit < 0) {
+		    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			    "memory limit value must be at least 0", -1));
+		    Tcl_SetErrorCode(interp, "TCL", "OPERATION", "INTERP",
+			    "BADVALUE", (char *)NULL);
+		    return TCL_ERROR;
+		}
+#endif
+		break;
+	    default:
+		TCL_UNREACHABLE();
+	    }
+	}
+	if (scriptObj != NULL) {
+	    SetScriptLimitCallback(interp, TCL_LIMIT_MEMORY, childInterp,
+		    (scriptLen > 0 ? scriptObj : NULL));
+	}
+	if (granObj != NULL) {
+	    Tcl_LimitSetGranularity(childInterp, TCL_LIMIT_MEMORY, gran);
+	}
+	if (limitObj != NULL) {
+	    if (limitLen > 0) {
+		TclLimitSetMemory(childInterp, limit);
+		Tcl_LimitTypeSet(childInterp, TCL_LIMIT_MEMORY);
+	    } else {
+		Tcl_LimitTypeReset(childInterp, TCL_LIMIT_MEMORY);
+	    }
+	}
+	return TCL_OK;
+    }
+}
+
 /*
  *---------------------------------------------------------------------------
  *
@@ -32,10 +32,6 @@ static size_t		AddLocalLiteralEntry(CompileEnv *envPtr,
 			    Tcl_Obj *objPtr, size_t localHash);
 static void		ExpandLocalLiteralArray(CompileEnv *envPtr);
 static size_t		HashString(const char *string, Tcl_Size length);
-#ifdef TCL_COMPILE_DEBUG
-static LiteralEntry *	LookupLiteralEntry(Tcl_Interp *interp,
-			    Tcl_Obj *objPtr);
-#endif
 static void		RebuildLiteralTable(LiteralTable *tablePtr);
 
 /*
@@ -272,7 +268,7 @@ TclCreateLiteral(
      * Yes, add it to the global literal table.
      */
 #ifdef TCL_COMPILE_DEBUG
-    if (LookupLiteralEntry((Tcl_Interp *) iPtr, objPtr) != NULL) {
+    if (TclLookupLiteralEntry((Tcl_Interp *) iPtr, objPtr) != NULL) {
 	Tcl_Panic("%s: literal \"%.*s\" found globally but shouldn't be",
 		"TclRegisterLiteral", (length>60? 60 : (int)length), bytes);
     }
@@ -485,14 +481,14 @@ TclRegisterLiteral(
     return (int)objIndex;
 }
 
-#ifdef TCL_COMPILE_DEBUG
 /*
  *----------------------------------------------------------------------
  *
- * LookupLiteralEntry --
+ * TclLookupLiteralEntry --
  *
  *	Finds the LiteralEntry that corresponds to a literal Tcl object
- *	holding a literal.
+ *	holding a literal. The bytecode cache uses it to tell how a literal
+ *	was registered.
  *
  * Results:
  *	Returns the matching LiteralEntry if found, otherwise NULL.
@@ -503,8 +499,8 @@ TclRegisterLiteral(
  *----------------------------------------------------------------------
  */
 
-static LiteralEntry *
-LookupLiteralEntry(
+LiteralEntry *
+TclLookupLiteralEntry(
     Tcl_Interp *interp,		/* Interpreter for which objPtr was created to
 				 * hold a literal. */
     Tcl_Obj *objPtr)		/* Points to a Tcl object holding a literal
@@ -528,7 +524,6 @@ LookupLiteralEntry(
     return NULL;
 }
 
-#endif
 /*
  *----------------------------------------------------------------------
  *
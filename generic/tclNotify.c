@@ -27,6 +27,30 @@ static Tcl_NotifierProcs tclNotifierHooks = {
     NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
 };
 
+/*
+ * Events that other threads append to a thread's queue are not linked in
+ * under the queue mutex but pushed on a lock-free stack, the inbox, which the
+ * owning thread moves to its queue whenever it looks at it. The number of
+ * queued events is maintained atomically, so that only the event that finds
+ * the queue idle alerts the notifier. This needs GCC-style atomics; define
+ * TCL_NO_NOTIFY_INBOX to always use the queue mutex.
+ */
+
+#if TCL_THREADS && !defined(TCL_NO_NOTIFY_INBOX) && defined(__GNUC__) \
+	&& defined(__ATOMIC_ACQUIRE)
+#   define TCL_NOTIFY_INBOX 1
+#endif
+
+/*
+ * The maximum number of times in a row that Tcl_DoOneEvent services events
+ * that a source has ready, such as due timers and idle handlers, without
+ * polling the system for I/O. See Tcl_DoOneEvent.
+ */
+
+#ifndef TCL_POLL_BATCH
+#   define TCL_POLL_BATCH 16
+#endif
+
 /*
  * For each event source (created with Tcl_CreateEventSource) there is a
  * structure of the following type:
@@ -48,8 +72,9 @@ typedef struct EventSource {
  * behind all other high-priority events already in the queue (this is used
  * for things like a sequence of Enter and Leave events generated during a
  * grab in Tk). These elements are protected by the queueMutex so that any
- * thread can queue an event on any notifier. Note that all of the values in
- * this structure will be initialized to 0.
+ * thread can queue an event on any notifier, except for the inbox and the
+ * event count when TCL_NOTIFY_INBOX is defined. Note that all of the values
+ * in this structure will be initialized to 0.
  */
 
 typedef struct ThreadSpecificData {
@@ -58,9 +83,15 @@ typedef struct ThreadSpecificData {
     Tcl_Event *markerEventPtr;	/* Last high-priority event in queue, or NULL
 				 * if none. */
     Tcl_Size eventCount;	/* Number of entries, but refer to comments in
-				 * Tcl_ServiceEvent(). */
+				 * Tcl_ServiceEvent(). Only accessed through
+				 * AddEventCount and TakeEventCount. */
+#ifdef TCL_NOTIFY_INBOX
+    Tcl_Event *inboxPtr;	/* Events appended by Tcl_ThreadQueueEvent
+				 * that are not in the queue yet, most recent
+				 * first. See DrainInbox(). */
+#endif /* TCL_NOTIFY_INBOX */
     Tcl_Mutex queueMutex;	/* Mutex to protect access to the previous
-				 * four fields. */
+				 * fields. */
     long long blockTime;		/* If blockTimeSet is true, gives the maximum
 				 * elapsed time for the next block. */
     int serviceMode;		/* One of TCL_SERVICE_NONE or
@@ -70,6 +101,9 @@ typedef struct ThreadSpecificData {
     bool inTraversal;		/* true if Tcl_SetMaxBlockTime is being called
 				 * during an event source traversal. */
     bool initialized;		/* true if notifier has been initialized. */
+    int pollsSkipped;		/* Number of times Tcl_DoOneEvent did not
+				 * wait for the system since it last did,
+				 * because a source had an event ready. */
     EventSource *firstEventSourcePtr;
 				/* Pointer to first event source in list of
 				 * event sources for this thread. */
@@ -99,6 +133,54 @@ TCL_DECLARE_MUTEX(listLock)
 
 static int		QueueEvent(ThreadSpecificData *tsdPtr,
 			    Tcl_Event *evPtr, int position);
+#ifdef TCL_NOTIFY_INBOX
+static void		DrainInbox(ThreadSpecificData *tsdPtr);
+static int		PushInbox(ThreadSpecificData *tsdPtr,
+			    Tcl_Event *evPtr, int position);
+#else
+#define DrainInbox(tsdPtr)	/* Nothing to do. */
+#endif /* TCL_NOTIFY_INBOX */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddEventCount, TakeEventCount --
+ *
+ *	Adjust the count of queued events of a thread, returning its old
+ *	value. TakeEventCount sets the count to zero. Unless TCL_NOTIFY_INBOX
+ *	is defined, these must be called with the queueMutex held.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline Tcl_Size
+AddEventCount(
+    ThreadSpecificData *tsdPtr,
+    Tcl_Size delta)
+{
+#ifdef TCL_NOTIFY_INBOX
+    return __atomic_fetch_add(&tsdPtr->eventCount, delta, __ATOMIC_SEQ_CST);
+#else
+    Tcl_Size count = tsdPtr->eventCount;
+
+    tsdPtr->eventCount += delta;
+    return count;
+#endif /* TCL_NOTIFY_INBOX */
+}
+
+static inline Tcl_Size
+TakeEventCount(
+    ThreadSpecificData *tsdPtr)
+{
+#ifdef TCL_NOTIFY_INBOX
+    return __atomic_exchange_n(&tsdPtr->eventCount, 0, __ATOMIC_SEQ_CST);
+#else
+    Tcl_Size count = tsdPtr->eventCount;
+
+    tsdPtr->eventCount = 0;
+    return count;
+#endif /* TCL_NOTIFY_INBOX */
+}
 
 /*
  *----------------------------------------------------------------------
@@ -188,7 +270,7 @@ TclFinalizeNotifier(void)
     }
     tsdPtr->firstEventPtr = NULL;
     tsdPtr->lastEventPtr = NULL;
-    tsdPtr->eventCount = 0;
+    (void) TakeEventCount(tsdPtr);
     Tcl_MutexUnlock(&(tsdPtr->queueMutex));
 
     Tcl_MutexLock(&listLock);
@@ -202,6 +284,20 @@ TclFinalizeNotifier(void)
 	    break;
 	}
     }
+
+#ifdef TCL_NOTIFY_INBOX
+    /*
+     * Other threads find the notifier through the list only, so nothing can
+     * arrive in the inbox any more.
+     */
+
+    for (evPtr = __atomic_exchange_n(&tsdPtr->inboxPtr, NULL,
+	    __ATOMIC_ACQUIRE); evPtr != NULL; ) {
+	hold = evPtr;
+	evPtr = evPtr->nextPtr;
+	Tcl_Free(hold);
+    }
+#endif /* TCL_NOTIFY_INBOX */
     tsdPtr->initialized = false;
 
     Tcl_MutexUnlock(&listLock);
@@ -443,10 +539,19 @@ Tcl_ThreadQueueEvent(
 
     /*
      * Queue the event if there was a notifier associated with the thread.
+     * The list lock keeps the notifier alive until we are done with it.
      */
 
     if (tsdPtr) {
-	if (QueueEvent(tsdPtr, evPtr, position)) {
+#ifdef TCL_NOTIFY_INBOX
+	int wasEmpty = ((position & 3) == TCL_QUEUE_TAIL)
+		? PushInbox(tsdPtr, evPtr, position)
+		: QueueEvent(tsdPtr, evPtr, position);
+#else
+	int wasEmpty = QueueEvent(tsdPtr, evPtr, position);
+#endif /* TCL_NOTIFY_INBOX */
+
+	if (wasEmpty) {
 	    Tcl_AlertNotifier(tsdPtr->clientData);
 	}
     } else {
@@ -492,6 +597,7 @@ QueueEvent(
     int wasEmpty = 0;
 
     Tcl_MutexLock(&(tsdPtr->queueMutex));
+    DrainInbox(tsdPtr);
     if ((position & 3) == TCL_QUEUE_TAIL) {
 	/*
 	 * Append the event on the end of the queue.
@@ -532,14 +638,108 @@ QueueEvent(
 	    tsdPtr->lastEventPtr = evPtr;
 	}
     }
-    if (position & TCL_QUEUE_ALERT_IF_EMPTY) {
-	wasEmpty = (tsdPtr->eventCount <= 0);
+    if (AddEventCount(tsdPtr, 1) <= 0) {
+	wasEmpty = (position & TCL_QUEUE_ALERT_IF_EMPTY) != 0;
     }
-    tsdPtr->eventCount++;
     Tcl_MutexUnlock(&(tsdPtr->queueMutex));
     return wasEmpty;
 }
 
+#ifdef TCL_NOTIFY_INBOX
+/*
+ *----------------------------------------------------------------------
+ *
+ * PushInbox --
+ *
+ *	Append an event to the tail of another thread's event queue without
+ *	taking its queue mutex: the event is pushed on the thread's inbox,
+ *	from where DrainInbox moves it to the queue.
+ *
+ * Results:
+ *	For TCL_QUEUE_ALERT_IF_EMPTY the empty state before the operation is
+ *	returned, as for QueueEvent. Only one of any number of events posted
+ *	while the owning thread is busy finds the queue empty.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+PushInbox(
+    ThreadSpecificData *tsdPtr,	/* Handle to thread local data that indicates
+				 * which event queue to use. */
+    Tcl_Event *evPtr,		/* Event to add to queue. */
+    int position)		/* TCL_QUEUE_TAIL, possibly combined with
+				 * TCL_QUEUE_ALERT_IF_EMPTY. */
+{
+    Tcl_Event *headPtr = __atomic_load_n(&tsdPtr->inboxPtr, __ATOMIC_RELAXED);
+
+    do {
+	evPtr->nextPtr = headPtr;
+    } while (!__atomic_compare_exchange_n(&tsdPtr->inboxPtr, &headPtr, evPtr,
+	    1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    /*
+     * The count must go up after the push: the owning thread drops it only
+     * after servicing an event and looks at the inbox again before it waits,
+     * so an event that does not find the count at zero is never stranded.
+     */
+
+    if (AddEventCount(tsdPtr, 1) <= 0) {
+	return (position & TCL_QUEUE_ALERT_IF_EMPTY) != 0;
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DrainInbox --
+ *
+ *	Move the events other threads have pushed on the inbox of the current
+ *	thread to the tail of its event queue, in the order they were pushed.
+ *	Must be called with the queueMutex held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DrainInbox(
+    ThreadSpecificData *tsdPtr)
+{
+    Tcl_Event *evPtr, *firstPtr = NULL, *lastPtr, *nextPtr;
+
+    if (__atomic_load_n(&tsdPtr->inboxPtr, __ATOMIC_RELAXED) == NULL) {
+	return;
+    }
+    evPtr = __atomic_exchange_n(&tsdPtr->inboxPtr, NULL, __ATOMIC_ACQUIRE);
+    lastPtr = evPtr;
+    while (evPtr != NULL) {
+	nextPtr = evPtr->nextPtr;
+	evPtr->nextPtr = firstPtr;
+	firstPtr = evPtr;
+	evPtr = nextPtr;
+    }
+    if (firstPtr == NULL) {
+	return;
+    }
+    if (tsdPtr->firstEventPtr == NULL) {
+	tsdPtr->firstEventPtr = firstPtr;
+    } else {
+	tsdPtr->lastEventPtr->nextPtr = firstPtr;
+    }
+    tsdPtr->lastEventPtr = lastPtr;
+}
+#endif /* TCL_NOTIFY_INBOX */
+
 /*
  *----------------------------------------------------------------------
  *
@@ -572,6 +772,7 @@ Tcl_DeleteEvents(
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
     Tcl_MutexLock(&(tsdPtr->queueMutex));
+    DrainInbox(tsdPtr);
 
     /*
      * Walk the queue of events for the thread, applying 'proc' to each to
@@ -610,7 +811,7 @@ Tcl_DeleteEvents(
 	    hold = evPtr;
 	    evPtr = evPtr->nextPtr;
 	    Tcl_Free(hold);
-	    tsdPtr->eventCount--;
+	    (void) AddEventCount(tsdPtr, -1);
 	} else {
 	    /*
 	     * Event is to be retained.
@@ -683,6 +884,7 @@ Tcl_ServiceEvent(
      */
 
     Tcl_MutexLock(&(tsdPtr->queueMutex));
+    DrainInbox(tsdPtr);
     for (evPtr = tsdPtr->firstEventPtr; evPtr != NULL;
 	    evPtr = evPtr->nextPtr) {
 	/*
@@ -719,12 +921,11 @@ Tcl_ServiceEvent(
 	 * On exit of the next level, the eventCount is readjusted.
 	 */
 
-	eventCount = tsdPtr->eventCount;
-	tsdPtr->eventCount = 0;
+	eventCount = TakeEventCount(tsdPtr);
 	Tcl_MutexUnlock(&(tsdPtr->queueMutex));
 	result = proc(evPtr, flags);
 	Tcl_MutexLock(&(tsdPtr->queueMutex));
-	tsdPtr->eventCount += eventCount;
+	(void) AddEventCount(tsdPtr, eventCount);
 
 	if (result) {
 	    /*
@@ -759,7 +960,7 @@ Tcl_ServiceEvent(
 	    }
 	    if (evPtr) {
 		Tcl_Free(evPtr);
-		tsdPtr->eventCount--;
+		(void) AddEventCount(tsdPtr, -1);
 	    }
 	    Tcl_MutexUnlock(&(tsdPtr->queueMutex));
 	    return 1;
@@ -947,6 +1148,7 @@ Tcl_DoOneEvent(
 				 * others defined by event sources. */
 {
     int result = 0, oldMode;
+    bool sourceReady;
     EventSource *sourcePtr;
     long long time;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
@@ -1003,23 +1205,19 @@ Tcl_DoOneEvent(
 	    break;
 	}
 
-	/*
-	 * If TCL_DONT_WAIT is set, be sure to poll rather than blocking,
-	 * otherwise reset the block time to infinity.
-	 */
-
-	if (flags & TCL_DONT_WAIT) {
-	    tsdPtr->blockTime = 0;
-	    tsdPtr->blockTimeSet = true;
-	} else {
-	    tsdPtr->blockTimeSet = false;
-	}
-
 	/*
 	 * Set up all the event sources for new events. This will cause the
-	 * block time to be updated if necessary.
+	 * block time to be updated if necessary. If TCL_DONT_WAIT is set, be
+	 * sure to poll rather than blocking, otherwise start from a block
+	 * time of infinity.
+	 *
+	 * Every source is set up and checked on each pass, even one with
+	 * nothing pending: Tcl_CreateEventSource promises that, and sources
+	 * rely on it to set their block time and to look at state that
+	 * other threads change without telling the notifier.
 	 */
 
+	tsdPtr->blockTimeSet = false;
 	tsdPtr->inTraversal = true;
 	for (sourcePtr = tsdPtr->firstEventSourcePtr; sourcePtr != NULL;
 		sourcePtr = sourcePtr->nextPtr) {
@@ -1029,21 +1227,50 @@ Tcl_DoOneEvent(
 	}
 	tsdPtr->inTraversal = false;
 
-	if ((flags & TCL_DONT_WAIT) || tsdPtr->blockTimeSet) {
+	sourceReady = tsdPtr->blockTimeSet && (tsdPtr->blockTime <= 0);
+	if (flags & TCL_DONT_WAIT) {
+	    time = 0;
+	} else if (tsdPtr->blockTimeSet) {
 	    time = tsdPtr->blockTime;
 	} else {
 	    time = -1;
 	}
 
+	/*
+	 * Before the thread blocks, the allocator may want to give memory
+	 * back to the system, and to be woken up later to do more of that.
+	 */
+
+	if (time != 0 && !sourceReady) {
+	    long long trimTime = TclThreadAllocIdle();
+
+	    if (trimTime >= 0 && (time < 0 || trimTime < time)) {
+		time = trimTime;
+	    }
+	}
+
 	/*
 	 * Wait for a new event or a timeout. If Tcl_WaitForEvent returns -1,
 	 * we should abort Tcl_DoOneEvent.
+	 *
+	 * When a source already has an event of this process ready, typically
+	 * a due timer or an idle handler, the wait would only poll the system
+	 * for I/O. Such events are serviced in batches of up to
+	 * TCL_POLL_BATCH between two polls, so that a busy loop of timers or
+	 * idle handlers does not make a system call per event, while I/O is
+	 * still looked at after every batch.
 	 */
 
-	result = Tcl_WaitForEvent2(time);
-	if (result < 0) {
+	if (sourceReady && (tsdPtr->pollsSkipped < TCL_POLL_BATCH)) {
+	    tsdPtr->pollsSkipped++;
 	    result = 0;
-	    break;
+	} else {
+	    tsdPtr->pollsSkipped = 0;
+	    result = Tcl_WaitForEvent2(time);
+	    if (result < 0) {
+		result = 0;
+		break;
+	    }
 	}
 
 	/*
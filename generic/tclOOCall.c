@@ -1074,6 +1074,91 @@ AddMethodToCallChain(
     callPtr->numChain++;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOBumpChainEpoch --
+ *
+ *	Invalidates the cached call chains of everything whose method
+ *	resolution goes through the given class: its instances, its
+ *	subclasses and the classes it is mixed into (and, recursively, their
+ *	instances and so on). Each of those classes has its chain epoch set to
+ *	the same fresh value, which doubles as the marker that a class has
+ *	already been visited. Call chains of unrelated classes and objects
+ *	are left alone.
+ *
+ *	Changes to the root classes affect practically everything, so those
+ *	just advance the global epoch instead of walking every class.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Call chains and property caches depending on the class will be
+ *	rebuilt the next time they are used.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+SetChainEpoch(
+    Class *clsPtr,
+    Tcl_Size chainEpoch)
+{
+    Class *subPtr;
+    Tcl_Size i;
+
+    if (clsPtr->chainEpoch == chainEpoch) {
+	return;
+    }
+    clsPtr->chainEpoch = chainEpoch;
+    FOREACH(subPtr, clsPtr->subclasses) {
+	SetChainEpoch(subPtr, chainEpoch);
+    }
+    FOREACH(subPtr, clsPtr->mixinSubs) {
+	SetChainEpoch(subPtr, chainEpoch);
+    }
+}
+
+void
+TclOOBumpChainEpoch(
+    Class *clsPtr)
+{
+    Foundation *fPtr = clsPtr->thisPtr->fPtr;
+
+    if (clsPtr == fPtr->objectCls || clsPtr == fPtr->classCls) {
+	fPtr->epoch++;
+	return;
+    }
+    SetChainEpoch(clsPtr, ++fPtr->chainEpochCounter);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOGetChainEpoch --
+ *
+ *	Computes a value that changes whenever TclOOBumpChainEpoch() is
+ *	applied to any class that the given object dispatches through, i.e.,
+ *	its class and its mixins (and what those inherit from). As the chain
+ *	epochs of classes only ever increase, their sum will do.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+Tcl_Size
+TclOOGetChainEpoch(
+    Object *oPtr)
+{
+    Tcl_Size i, chainEpoch = (oPtr->selfCls ? oPtr->selfCls->chainEpoch : 0);
+    Class *mixinPtr;
+
+    FOREACH(mixinPtr, oPtr->mixins) {
+	chainEpoch += mixinPtr->chainEpoch;
+    }
+    return chainEpoch;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -1099,6 +1184,7 @@ InitCallChain(
 
     callPtr->flags = flags &
 	    (PUBLIC_METHOD | PRIVATE_METHOD | SPECIAL | FILTER_HANDLING);
+    callPtr->chainEpoch = TclOOGetChainEpoch(oPtr);
     if (oPtr->flags & USE_CLASS_CACHE) {
 	oPtr = (oPtr->selfCls ? oPtr->selfCls->thisPtr : NULL);
 	callPtr->flags |= USE_CLASS_CACHE;
@@ -1126,7 +1212,8 @@ InitCallChain(
  *	method for the given object. The condition on a chain from a cached
  *	location being reusable is:
  *	- Refers to the same object (same creation epoch), and
- *	- Still across the same class structure (same global epoch), and
+ *	- Still across the same class structure (same global epoch and same
+ *	  chain epochs of the classes involved), and
  *	- Still across the same object structure (same local epoch), and
  *	- No public/private/filter magic leakage (same flags, modulo the fact
  *	  that a public chain will satisfy a non-public call).
@@ -1141,6 +1228,9 @@ IsStillValid(
     int flags,
     int mask)
 {
+    if (callPtr->chainEpoch != TclOOGetChainEpoch(oPtr)) {
+	return 0;
+    }
     if ((oPtr->flags & USE_CLASS_CACHE)) {
 	/*
 	 * If the object is in a weird state (due to stereotype tricks) then
@@ -1213,7 +1303,8 @@ TclOOGetCallContext(
 	    callPtr = oPtr->selfCls->constructorChainPtr;
 	    if ((callPtr != NULL)
 		    && (callPtr->objectEpoch == oPtr->selfCls->thisPtr->epoch)
-		    && (callPtr->epoch == oPtr->fPtr->epoch)) {
+		    && (callPtr->epoch == oPtr->fPtr->epoch)
+		    && (callPtr->chainEpoch == TclOOGetChainEpoch(oPtr))) {
 		callPtr->refCount++;
 		goto returnContext;
 	    }
@@ -1221,7 +1312,8 @@ TclOOGetCallContext(
 	    callPtr = oPtr->selfCls->destructorChainPtr;
 	    if ((oPtr->mixins.num == 0) && (callPtr != NULL)
 		    && (callPtr->objectEpoch == oPtr->selfCls->thisPtr->epoch)
-		    && (callPtr->epoch == oPtr->fPtr->epoch)) {
+		    && (callPtr->epoch == oPtr->fPtr->epoch)
+		    && (callPtr->chainEpoch == TclOOGetChainEpoch(oPtr))) {
 		callPtr->refCount++;
 		goto returnContext;
 	    }
@@ -1523,6 +1615,7 @@ TclOOGetStereotypeCallChain(
     callPtr->epoch = fPtr->epoch;
     callPtr->objectCreationEpoch = fPtr->tsdPtr->nsCount;
     callPtr->objectEpoch = clsPtr->thisPtr->epoch;
+    callPtr->chainEpoch = clsPtr->chainEpoch;
     callPtr->refCount = 1;
     callPtr->chain = callPtr->staticChain;
 
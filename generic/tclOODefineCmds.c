@@ -69,7 +69,7 @@ typedef struct DeclaredSlotMethod {
  * Forward declarations.
  */
 
-static inline void	BumpGlobalEpoch(Tcl_Interp *interp, Class *classPtr);
+static inline void	BumpClassEpoch(Tcl_Interp *interp, Class *classPtr);
 static inline void	BumpInstanceEpoch(Object *oPtr);
 static Tcl_Command	FindCommand(Tcl_Interp *interp, Tcl_Obj *stringObj,
 			    Tcl_Namespace *const namespacePtr);
@@ -188,59 +188,38 @@ IsPrivateDefine(
 /*
  * ----------------------------------------------------------------------
  *
- * BumpGlobalEpoch --
+ * BumpClassEpoch --
  *
  *	Utility that ensures that call chains that are invalid will get thrown
- *	away at an appropriate time. Note that exactly which epoch gets
- *	advanced will depend on exactly what the class is tangled up in; in
- *	the worst case, the simplest option is to advance the global epoch,
- *	causing *everything* to be thrown away on next usage.
+ *	away at an appropriate time. Only the call chains (and property
+ *	caches) of the objects and classes that actually depend on the class
+ *	are affected; see TclOOBumpChainEpoch(). In the worst case, when there
+ *	is no class (?!), the global epoch is advanced, causing *everything*
+ *	to be thrown away on next usage.
  *
  * ----------------------------------------------------------------------
  */
 
 static inline void
-BumpGlobalEpoch(
+BumpClassEpoch(
     Tcl_Interp *interp,
     Class *classPtr)
 {
-    if (classPtr != NULL
-	    && classPtr->subclasses.num == 0
-	    && classPtr->instances.num == 0
-	    && classPtr->mixinSubs.num == 0) {
-	/*
-	 * If a class has no subclasses or instances, and is not mixed into
-	 * anything, a change to its structure does not require us to
-	 * invalidate any call chains. Note that we still bump our object's
-	 * epoch if it has any mixins; the relation between a class and its
-	 * representative object is special. But it won't hurt.
-	 */
-
-	if (classPtr->thisPtr->mixins.num > 0) {
-	    classPtr->thisPtr->epoch++;
-
-	    /*
-	     * Invalidate the property caches directly.
-	     */
-
-	    if (classPtr->properties.allReadableCache) {
-		Tcl_DecrRefCount(classPtr->properties.allReadableCache);
-		classPtr->properties.allReadableCache = NULL;
-	    }
-	    if (classPtr->properties.allWritableCache) {
-		Tcl_DecrRefCount(classPtr->properties.allWritableCache);
-		classPtr->properties.allWritableCache = NULL;
-	    }
-	}
+    if (classPtr == NULL) {
+	TclOOGetFoundation(interp)->epoch++;
 	return;
     }
 
     /*
-     * Either there's no class (?!) or we're reconfiguring something that is
-     * in use. Force regeneration of call chains and properties.
+     * Note that we still bump our object's epoch if it has any mixins; the
+     * relation between a class and its representative object is special.
+     * But it won't hurt.
      */
 
-    TclOOGetFoundation(interp)->epoch++;
+    if (classPtr->thisPtr->mixins.num > 0) {
+	classPtr->thisPtr->epoch++;
+    }
+    TclOOBumpChainEpoch(classPtr);
 }
 
 /*
@@ -249,7 +228,7 @@ BumpGlobalEpoch(
  * BumpInstanceEpoch --
  *
  *	Advances the epoch and clears the property cache of an object. The
- *	equivalent for classes is BumpGlobalEpoch(), as classes have a more
+ *	equivalent for classes is BumpClassEpoch(), as classes have a more
  *	complex set of relationships to other entities.
  *
  * ----------------------------------------------------------------------
@@ -464,10 +443,10 @@ TclOOClassSetFilters(
     }
 
     /*
-     * There may be many objects affected, so bump the global epoch.
+     * There may be many objects affected, so bump the class's epoch.
      */
 
-    BumpGlobalEpoch(interp, classPtr);
+    BumpClassEpoch(interp, classPtr);
 }
 
 /*
@@ -585,7 +564,7 @@ TclOOClassSetMixins(
 	    AddRef(mixinPtr->thisPtr);
 	}
     }
-    BumpGlobalEpoch(interp, classPtr);
+    BumpClassEpoch(interp, classPtr);
 }
 
 /*
@@ -1792,10 +1771,9 @@ TclOODefineClassObjCmd(
 	}
 
 	if (oPtr->classPtr != NULL) {
-	    BumpGlobalEpoch(interp, oPtr->classPtr);
-	} else {
-	    BumpInstanceEpoch(oPtr);
+	    BumpClassEpoch(interp, oPtr->classPtr);
 	}
+	BumpInstanceEpoch(oPtr);
     }
     return TCL_OK;
 }
@@ -1984,7 +1962,7 @@ TclOODefineDeleteMethodObjCmd(
     if (isInstanceDeleteMethod) {
 	BumpInstanceEpoch(oPtr);
     } else {
-	BumpGlobalEpoch(interp, oPtr->classPtr);
+	BumpClassEpoch(interp, oPtr->classPtr);
     }
     return TCL_OK;
 }
@@ -2108,7 +2086,7 @@ TclOODefineExportObjCmd(
 	if (isInstanceExport) {
 	    BumpInstanceEpoch(oPtr);
 	} else {
-	    BumpGlobalEpoch(interp, clsPtr);
+	    BumpClassEpoch(interp, clsPtr);
 	}
     }
     return TCL_OK;
@@ -2431,7 +2409,7 @@ TclOODefineRenameMethodObjCmd(
     if (isInstanceRenameMethod) {
 	BumpInstanceEpoch(oPtr);
     } else {
-	BumpGlobalEpoch(interp, oPtr->classPtr);
+	BumpClassEpoch(interp, oPtr->classPtr);
     }
     return TCL_OK;
 }
@@ -2488,7 +2466,7 @@ TclOODefineUnexportObjCmd(
 	if (isInstanceUnexport) {
 	    BumpInstanceEpoch(oPtr);
 	} else {
-	    BumpGlobalEpoch(interp, clsPtr);
+	    BumpClassEpoch(interp, clsPtr);
 	}
     }
     return TCL_OK;
@@ -2526,7 +2504,7 @@ Tcl_ClassSetConstructor(
 	    TclOODeleteChain(clsPtr->constructorChainPtr);
 	    clsPtr->constructorChainPtr = NULL;
 	}
-	BumpGlobalEpoch(interp, clsPtr);
+	BumpClassEpoch(interp, clsPtr);
     }
 }
 
@@ -2545,7 +2523,7 @@ Tcl_ClassSetDestructor(
 	    TclOODeleteChain(clsPtr->destructorChainPtr);
 	    clsPtr->destructorChainPtr = NULL;
 	}
-	BumpGlobalEpoch(interp, clsPtr);
+	BumpClassEpoch(interp, clsPtr);
     }
 }
 
@@ -3481,7 +3459,7 @@ ClassSuper_Set(
      */
 
     TclOOSetSuperclasses(clsPtr, superc, superclasses);
-    BumpGlobalEpoch(interp, clsPtr);
+    BumpClassEpoch(interp, clsPtr);
 
     return TCL_OK;
 }
@@ -3947,7 +3925,7 @@ Configurable_ClassReadableProps_Set(
     }
 
     TclOOInstallReadableProperties(&clsPtr->properties, varc, varv);
-    BumpGlobalEpoch(interp, clsPtr);
+    BumpClassEpoch(interp, clsPtr);
     return TCL_OK;
 }
 
@@ -4063,7 +4041,7 @@ Configurable_ClassWritableProps_Set(
     }
 
     TclOOInstallWritableProperties(&clsPtr->properties, varc, varv);
-    BumpGlobalEpoch(interp, clsPtr);
+    BumpClassEpoch(interp, clsPtr);
     return TCL_OK;
 }
 
@@ -4228,7 +4206,7 @@ TclOORegisterProperty(
     }
     Tcl_BounceRefCount(listObj);
     if (changed) {
-	BumpGlobalEpoch(clsPtr->thisPtr->fPtr->interp, clsPtr);
+	BumpClassEpoch(clsPtr->thisPtr->fPtr->interp, clsPtr);
     }
 }
 
@@ -364,6 +364,10 @@ struct Class {
     PropertyStorage properties;	/* Information relating to the lists of
 				 * properties that this class *claims* to
 				 * support. */
+    Tcl_Size chainEpoch;	/* Advanced whenever a change to this class
+				 * or to a class it inherits from or has mixed
+				 * in may alter the call chains of its
+				 * instances. See TclOOBumpChainEpoch(). */
    Tcl_Obj *delegateNameObj;	/* The cache of the name of the class's
 				 * delegate. Class delegates are special
 				 * classes mixed into ordinary classes to
@@ -402,6 +406,8 @@ struct Foundation {
 				 * procedural method. */
     Tcl_Size epoch;		/* Used to invalidate method chains when the
 				 * class structure changes. */
+    Tcl_Size chainEpochCounter;	/* Source of new values for the chainEpoch
+				 * field of classes. */
     ThreadLocalData *tsdPtr;	/* Counter so we can allocate a unique
 				 * namespace to each object. */
     Tcl_Obj *unknownMethodNameObj;
@@ -450,6 +456,8 @@ struct CallChain {
 				 * snapshot. */
     Tcl_Size epoch;		/* Global (class structure) epoch counter
 				 * snapshot. */
+    Tcl_Size chainEpoch;	/* Snapshot of the chain epochs of the classes
+				 * the object was dispatching through. */
     int flags;			/* Assorted flags, see below. */
     Tcl_Size refCount;		/* Reference count. */
     Tcl_Size numChain;		/* Size of the call chain. */
@@ -569,6 +577,7 @@ MODULE_SCOPE void	TclOOAddToMixinSubs(Class *subPtr, Class *mixinPtr);
 MODULE_SCOPE void	TclOOAddToSubclasses(Class *subPtr, Class *superPtr);
 MODULE_SCOPE Class *	TclOOAllocClass(Tcl_Interp *interp,
 			    Object *useThisObj);
+MODULE_SCOPE void	TclOOBumpChainEpoch(Class *clsPtr);
 MODULE_SCOPE int	TclMethodIsType(Tcl_Method method,
 			    const Tcl_MethodType2 *typePtr,
 			    void **clientDataPtr);
@@ -604,6 +613,7 @@ MODULE_SCOPE CallContext *TclOOGetCallContext(Object *oPtr,
 			    Tcl_Obj *methodNameObj, int flags,
 			    Object *contextObjPtr, Class *contextClsPtr,
 			    Tcl_Obj *cacheInThisObj);
+MODULE_SCOPE Tcl_Size	TclOOGetChainEpoch(Object *oPtr);
 MODULE_SCOPE Class *	TclOOGetClassDefineCmdContext(Tcl_Interp *interp);
 MODULE_SCOPE Tcl_Obj *	TclOOGetClassDelegateName(Object *oPtr);
 MODULE_SCOPE Class *	TclOOGetClassFromObj(Tcl_Interp *interp,
@@ -298,7 +298,7 @@ TclNewMethod(
     }
 
   populate:
-    clsPtr->thisPtr->fPtr->epoch++;
+    TclOOBumpChainEpoch(clsPtr);
     mPtr->type2Ptr = typePtr;
     mPtr->clientData = clientData;
     mPtr->flags = 0;
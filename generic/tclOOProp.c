@@ -746,12 +746,13 @@ GetAllClassProperties(
     Tcl_HashTable hashTable;
     FOREACH_HASH_DECLS;
     Tcl_Obj *propName, *result;
+    Tcl_Size epoch = clsPtr->thisPtr->fPtr->epoch + clsPtr->chainEpoch;
 
     /*
      * Look in the cache.
      */
 
-    if (clsPtr->properties.epoch == clsPtr->thisPtr->fPtr->epoch) {
+    if (clsPtr->properties.epoch == epoch) {
 	if (writable) {
 	    if (clsPtr->properties.allWritableCache) {
 		*allocated = false;
@@ -782,7 +783,7 @@ GetAllClassProperties(
      * Cache the information. Also purges the cache.
      */
 
-    if (clsPtr->properties.epoch != clsPtr->thisPtr->fPtr->epoch) {
+    if (clsPtr->properties.epoch != epoch) {
 	if (clsPtr->properties.allWritableCache) {
 	    Tcl_DecrRefCount(clsPtr->properties.allWritableCache);
 	    clsPtr->properties.allWritableCache = NULL;
@@ -792,7 +793,7 @@ GetAllClassProperties(
 	    clsPtr->properties.allReadableCache = NULL;
 	}
     }
-    clsPtr->properties.epoch = clsPtr->thisPtr->fPtr->epoch;
+    clsPtr->properties.epoch = epoch;
     if (writable) {
 	clsPtr->properties.allWritableCache = result;
     } else {
@@ -861,12 +862,13 @@ GetAllObjectProperties(
     Tcl_HashTable hashTable;
     FOREACH_HASH_DECLS;
     Tcl_Obj *propName, *result;
+    Tcl_Size epoch = oPtr->fPtr->epoch + TclOOGetChainEpoch(oPtr);
 
     /*
      * Look in the cache.
      */
 
-    if (oPtr->properties.epoch == oPtr->fPtr->epoch) {
+    if (oPtr->properties.epoch == epoch) {
 	if (writable) {
 	    if (oPtr->properties.allWritableCache) {
 		return oPtr->properties.allWritableCache;
@@ -895,7 +897,7 @@ GetAllObjectProperties(
      * Cache the information.
      */
 
-    if (oPtr->properties.epoch != oPtr->fPtr->epoch) {
+    if (oPtr->properties.epoch != epoch) {
 	if (oPtr->properties.allWritableCache) {
 	    Tcl_DecrRefCount(oPtr->properties.allWritableCache);
 	    oPtr->properties.allWritableCache = NULL;
@@ -905,7 +907,7 @@ GetAllObjectProperties(
 	    oPtr->properties.allReadableCache = NULL;
 	}
     }
-    oPtr->properties.epoch = oPtr->fPtr->epoch;
+    oPtr->properties.epoch = epoch;
     if (writable) {
 	oPtr->properties.allWritableCache = result;
     } else {
@@ -50,6 +50,122 @@ Tcl_Mutex tclObjMutex;
 
 char tclEmptyString = '\0';
 
+#ifdef TCL_HASH_SEED
+/*
+ * Seed of the hash function of Tcl_Obj keys, chosen when Tcl starts, so that
+ * sets of keys that all land in the same bucket of a hash table cannot be
+ * worked out in advance. See TclHashObjKey.
+ */
+
+static uint64_t objHashSeed = 0;
+#endif
+
+#define HASH_SECRET0	UINT64_C(0xa0761d6478bd642f)
+#define HASH_SECRET1	UINT64_C(0xe7037ed1a0b428db)
+
+/*
+ * Multiply *aPtr by *bPtr, leaving the low 64 bits of the product in *aPtr and
+ * the high 64 bits in *bPtr.
+ */
+
+static inline void
+HashMultiply(
+    uint64_t *aPtr,
+    uint64_t *bPtr)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128) *aPtr * *bPtr;
+
+    *aPtr = (uint64_t) r;
+    *bPtr = (uint64_t) (r >> 64);
+#else
+    uint64_t ha = *aPtr >> 32, la = (uint32_t) *aPtr;
+    uint64_t hb = *bPtr >> 32, lb = (uint32_t) *bPtr;
+    uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+    uint64_t t = ll + (hl << 32), lo = t + (lh << 32);
+    uint64_t carry = (t < ll) + (lo < t);
+
+    *aPtr = lo;
+    *bPtr = hh + (hl >> 32) + (lh >> 32) + carry;
+#endif
+}
+
+static inline uint64_t
+HashMix(
+    uint64_t a,
+    uint64_t b)
+{
+    HashMultiply(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t
+HashRead8(
+    const unsigned char *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t
+HashRead4(
+    const unsigned char *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t
+HashBytes(
+    const void *bytes,		/* Bytes to hash. */
+    size_t length,		/* Number of bytes. */
+    uint64_t seed)		/* Seed of the hash function. */
+{
+    const unsigned char *p = (const unsigned char *) bytes;
+    uint64_t a, b;
+
+    /*
+     * This follows wyhash: the bytes are read eight at a time and mixed by
+     * full 64x64->128 bit multiplies with the seed. Given a secret seed, it
+     * stands up to keys chosen to collide.
+     */
+
+    if (length <= 16) {
+	if (length >= 4) {
+	    size_t step = (length >> 3) << 2;
+
+	    a = (HashRead4(p) << 32) | HashRead4(p + step);
+	    b = (HashRead4(p + length - 4) << 32)
+		    | HashRead4(p + length - 4 - step);
+	} else if (length > 0) {
+	    a = ((uint64_t) p[0] << 16) | ((uint64_t) p[length >> 1] << 8)
+		    | p[length - 1];
+	    b = 0;
+	} else {
+	    a = b = 0;
+	}
+    } else {
+	size_t i = length;
+
+	while (i > 16) {
+	    seed = HashMix(HashRead8(p) ^ HASH_SECRET1,
+		    HashRead8(p + 8) ^ seed);
+	    p += 16;
+	    i -= 16;
+	}
+	a = HashRead8(p + i - 16);
+	b = HashRead8(p + i - 8);
+    }
+    a ^= HASH_SECRET1;
+    b ^= seed;
+    HashMultiply(&a, &b);
+    return HashMix(a ^ HASH_SECRET0 ^ (uint64_t) length, b ^ HASH_SECRET1);
+}
+
 #if TCL_THREADS && defined(TCL_MEM_DEBUG)
 /*
  * Structure for tracking the source file and line number where a given
@@ -370,6 +486,23 @@ typedef struct ResolvedCmdName {
 void
 TclInitObjSubsystem(void)
 {
+#ifdef TCL_HASH_SEED
+    if (objHashSeed == 0) {
+	Tcl_Time now;
+
+	/*
+	 * The addresses add what address space layout randomisation the
+	 * system does. The seed must not change once set, as tables hashed
+	 * with it may outlive a finalization.
+	 */
+
+	Tcl_GetTime(&now);
+	objHashSeed = HashMix((uint64_t) now.sec * 1000000 + now.usec,
+		(uint64_t) TclpGetClicks() ^ ((uint64_t) PTR2UINT(&now) << 16)
+		^ (uint64_t) PTR2UINT(&objHashSeed)) | 1;
+    }
+#endif
+
     Tcl_MutexLock(&tableMutex);
     typeTableInitialized = 1;
     Tcl_InitHashTable(&typeTable, TCL_STRING_KEYS);
@@ -4168,6 +4301,34 @@ TclFreeObjEntry(
     Tcl_Free(hPtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclHashBytes --
+ *
+ *	Compute a 64-bit hash of a run of bytes under the given seed. With
+ *	the secret seed of this process it hashes the keys of Tcl_Obj tables;
+ *	with a fixed seed it gives a value that is the same in every process,
+ *	which the bytecode cache (tclCompCache.c) writes to disk.
+ *
+ * Results:
+ *	The hash value.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+uint64_t
+TclHashBytes(
+    const void *bytes,		/* Bytes to hash. */
+    size_t length,		/* Number of bytes. */
+    uint64_t seed)		/* Seed of the hash function. */
+{
+    return HashBytes(bytes, length, seed);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -4194,6 +4355,18 @@ TclHashObjKey(
     Tcl_Obj *objPtr = (Tcl_Obj *)keyPtr;
     Tcl_Size length;
     const char *string = Tcl_GetStringFromObj(objPtr, &length);
+#ifdef TCL_HASH_SEED
+
+    /*
+     * The keys of these tables are often under the control of whoever sends
+     * data to a program (the names of array elements, the keys of dicts).
+     * Built with TCL_HASH_SEED, they are hashed under a seed chosen at
+     * startup, so that keys cannot be chosen to collide; the order in which
+     * arrays are walked then differs between runs.
+     */
+
+    return (size_t) HashBytes(string, length, objHashSeed);
+#else
     size_t result = 0;
 
     /*
@@ -4237,6 +4410,7 @@ TclHashObjKey(
 	}
     }
     return result;
+#endif /* TCL_HASH_SEED */
 }
 
 /*
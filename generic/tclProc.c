@@ -315,6 +315,15 @@ Tcl_ProcObjCmd(
 	TclStackFree(interp, contextPtr);
     }
 
+    /*
+     * If a file is being sourced with the bytecode cache enabled, the body
+     * goes into its cache file.
+     */
+
+    if (iPtr->compCachePtr) {
+	TclCompCacheNoteProc(interp, procPtr);
+    }
+
     /*
      * Optimize for no-op procs: if the body is not precompiled (like a TclPro
      * procbody), and the argument list is just "args" and the body is empty,
@@ -60,30 +60,72 @@
 
 /*
  * Thread local storage used to maintain a per-thread cache of compiled
- * regular expressions.
+ * regular expressions. The cache is a hash table keyed on the pattern text
+ * and the compilation flags; its entries are also threaded on a list in
+ * least-recently-used order so that the oldest one can be discarded once the
+ * cache is full.
  */
 
-#define NUM_REGEXPS 30
+#define DEFAULT_NUM_REGEXPS 256
+
+typedef struct RegexpCacheEntry {
+    TclRegexp *regexpPtr;	/* Compiled form of the pattern. The cache
+				 * holds one reference to it. */
+    Tcl_HashEntry *hPtr;	/* Entry in the cache table that refers to
+				 * this record. */
+    struct RegexpCacheEntry *prevPtr;
+				/* Next more recently used entry, or NULL if
+				 * this is the most recently used one. */
+    struct RegexpCacheEntry *nextPtr;
+				/* Next less recently used entry, or NULL if
+				 * this is the least recently used one. */
+} RegexpCacheEntry;
 
 typedef struct {
     int initialized;		/* Set to 1 when the module is initialized. */
-    char *patterns[NUM_REGEXPS];/* Strings corresponding to compiled regular
-				 * expression patterns. NULL means that this
-				 * slot isn't used. Malloc-ed. */
-    size_t patLengths[NUM_REGEXPS];/* Number of non-null characters in
-				 * corresponding entry in patterns. -1 means
-				 * entry isn't used. */
-    TclRegexp *regexps[NUM_REGEXPS];
-				/* Compiled forms of above strings. Also
-				 * malloc-ed, or NULL if not in use yet. */
+    Tcl_HashTable cache;	/* Maps pattern/flags keys to cache entries.
+				 * See regexpKeyType. */
+    RegexpCacheEntry *firstPtr;	/* Most recently used entry. */
+    RegexpCacheEntry *lastPtr;	/* Least recently used entry, the first one
+				 * to go when the cache is full. */
+    Tcl_Size maxSize;		/* Maximum number of entries to keep; always
+				 * at least one, since Tcl_RegExpCompile
+				 * relies on the cache to own its result. */
+    Tcl_WideInt hits;		/* Number of lookups satisfied by the cache. */
+    Tcl_WideInt misses;		/* Number of lookups that had to compile. */
+    Tcl_WideInt evictions;	/* Number of entries discarded to make room
+				 * for newer ones. */
 } ThreadSpecificData;
 
+/*
+ * The key used to look up a pattern in the cache, and the form in which that
+ * key is stored in the hash entry itself.
+ */
+
+typedef struct {
+    const char *string;		/* Pattern text, not necessarily terminated. */
+    size_t length;		/* Number of bytes in the pattern. */
+    int flags;			/* Compilation flags. */
+} RegexpKey;
+
+typedef struct {
+    size_t length;		/* Number of bytes in the pattern. */
+    int flags;			/* Compilation flags. */
+    char string[TCLFLEXARRAY];	/* Pattern text, NUL-terminated. */
+} RegexpStoredKey;
+
 static Tcl_ThreadDataKey dataKey;
 
 /*
  * Declarations for functions used only in this file.
  */
 
+static Tcl_HashEntry *	AllocRegexpEntry(Tcl_HashTable *tablePtr,
+			    void *keyPtr);
+static void		CacheEvict(ThreadSpecificData *tsdPtr,
+			    RegexpCacheEntry *entryPtr);
+static void		CacheTrim(ThreadSpecificData *tsdPtr, Tcl_Size maxSize);
+static int		CompareRegexpKeys(void *keyPtr, Tcl_HashEntry *hPtr);
 static TclRegexp *	CompileRegexp(Tcl_Interp *interp, const char *pattern,
 			    size_t length, int flags);
 static void		DupRegexpInternalRep(Tcl_Obj *srcPtr,
@@ -91,11 +133,26 @@ static void		DupRegexpInternalRep(Tcl_Obj *srcPtr,
 static void		FinalizeRegexp(void *clientData);
 static void		FreeRegexp(TclRegexp *regexpPtr);
 static void		FreeRegexpInternalRep(Tcl_Obj *objPtr);
+static size_t		HashRegexpKey(Tcl_HashTable *tablePtr, void *keyPtr);
+static ThreadSpecificData *InitRegexpCache(void);
 static int		RegExpExecUniChar(Tcl_Interp *interp, Tcl_RegExp re,
 			    const Tcl_UniChar *uniString, size_t numChars,
 			    size_t nmatches, int flags);
 static int		SetRegexpFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr);
 
+/*
+ * The hash key type used for the per-thread cache of compiled patterns.
+ */
+
+static const Tcl_HashKeyType regexpKeyType = {
+    TCL_HASH_KEY_TYPE_VERSION,		/* version */
+    0,					/* flags */
+    HashRegexpKey,			/* hashKeyProc */
+    CompareRegexpKeys,			/* compareKeysProc */
+    AllocRegexpEntry,			/* allocEntryProc */
+    NULL				/* freeEntryProc */
+};
+
 /*
  * The regular expression Tcl object type. This serves as a cache of the
  * compiled form of the regular expression.
@@ -862,15 +919,13 @@ CompileRegexp(
 {
     TclRegexp *regexpPtr;
     const Tcl_UniChar *uniString;
-    int status, i, exact;
+    int status, exact, isNew;
     Tcl_Size numChars;
     Tcl_DString stringBuf;
-    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
-
-    if (!tsdPtr->initialized) {
-	tsdPtr->initialized = 1;
-	Tcl_CreateThreadExitHandler(FinalizeRegexp, NULL);
-    }
+    RegexpKey key;
+    RegexpCacheEntry *entryPtr;
+    Tcl_HashEntry *hPtr;
+    ThreadSpecificData *tsdPtr = InitRegexpCache();
 
     /*
      * This routine maintains a second-level regular expression cache in
@@ -884,33 +939,33 @@ CompileRegexp(
      * if it has the same pattern and the same flags.
      */
 
-    for (i = 0; (i < NUM_REGEXPS) && (tsdPtr->patterns[i] != NULL); i++) {
-	if ((length == tsdPtr->patLengths[i])
-		&& (tsdPtr->regexps[i]->flags == flags)
-		&& (strcmp(string, tsdPtr->patterns[i]) == 0)) {
-	    /*
-	     * Move the matched pattern to the first slot in the cache and
-	     * shift the other patterns down one position.
-	     */
-
-	    if (i != 0) {
-		int j;
-		char *cachedString;
-
-		cachedString = tsdPtr->patterns[i];
-		regexpPtr = tsdPtr->regexps[i];
-		for (j = i-1; j >= 0; j--) {
-		    tsdPtr->patterns[j+1] = tsdPtr->patterns[j];
-		    tsdPtr->patLengths[j+1] = tsdPtr->patLengths[j];
-		    tsdPtr->regexps[j+1] = tsdPtr->regexps[j];
-		}
-		tsdPtr->patterns[0] = cachedString;
-		tsdPtr->patLengths[0] = length;
-		tsdPtr->regexps[0] = regexpPtr;
+    key.string = string;
+    key.length = length;
+    key.flags = flags;
+    hPtr = Tcl_FindHashEntry(&tsdPtr->cache, &key);
+    if (hPtr != NULL) {
+	entryPtr = (RegexpCacheEntry *)Tcl_GetHashValue(hPtr);
+
+	/*
+	 * Move the matched pattern to the front of the LRU list.
+	 */
+
+	if (entryPtr->prevPtr != NULL) {
+	    entryPtr->prevPtr->nextPtr = entryPtr->nextPtr;
+	    if (entryPtr->nextPtr != NULL) {
+		entryPtr->nextPtr->prevPtr = entryPtr->prevPtr;
+	    } else {
+		tsdPtr->lastPtr = entryPtr->prevPtr;
 	    }
-	    return tsdPtr->regexps[0];
+	    entryPtr->prevPtr = NULL;
+	    entryPtr->nextPtr = tsdPtr->firstPtr;
+	    tsdPtr->firstPtr->prevPtr = entryPtr;
+	    tsdPtr->firstPtr = entryPtr;
 	}
+	tsdPtr->hits++;
+	return entryPtr->regexpPtr;
     }
+    tsdPtr->misses++;
 
     /*
      * This is a new expression, so compile it and add it to the cache.
@@ -980,27 +1035,23 @@ CompileRegexp(
     regexpPtr->refCount = 1;
 
     /*
-     * Free the last regexp, if necessary, and make room at the head of the
-     * list for the new regexp.
+     * Free the least recently used regexp, if necessary, and put the new
+     * regexp at the head of the list.
      */
 
-    if (tsdPtr->patterns[NUM_REGEXPS-1] != NULL) {
-	TclRegexp *oldRegexpPtr = tsdPtr->regexps[NUM_REGEXPS-1];
-
-	if (oldRegexpPtr->refCount-- <= 1) {
-	    FreeRegexp(oldRegexpPtr);
-	}
-	Tcl_Free(tsdPtr->patterns[NUM_REGEXPS-1]);
-    }
-    for (i = NUM_REGEXPS - 2; i >= 0; i--) {
-	tsdPtr->patterns[i+1] = tsdPtr->patterns[i];
-	tsdPtr->patLengths[i+1] = tsdPtr->patLengths[i];
-	tsdPtr->regexps[i+1] = tsdPtr->regexps[i];
+    CacheTrim(tsdPtr, tsdPtr->maxSize - 1);
+    entryPtr = (RegexpCacheEntry *)Tcl_Alloc(sizeof(RegexpCacheEntry));
+    entryPtr->regexpPtr = regexpPtr;
+    entryPtr->hPtr = Tcl_CreateHashEntry(&tsdPtr->cache, &key, &isNew);
+    Tcl_SetHashValue(entryPtr->hPtr, entryPtr);
+    entryPtr->prevPtr = NULL;
+    entryPtr->nextPtr = tsdPtr->firstPtr;
+    if (tsdPtr->firstPtr != NULL) {
+	tsdPtr->firstPtr->prevPtr = entryPtr;
+    } else {
+	tsdPtr->lastPtr = entryPtr;
     }
-    tsdPtr->patterns[0] = (char *)Tcl_Alloc(length + 1);
-    memcpy(tsdPtr->patterns[0], string, length + 1);
-    tsdPtr->patLengths[0] = length;
-    tsdPtr->regexps[0] = regexpPtr;
+    tsdPtr->firstPtr = entryPtr;
 
     return regexpPtr;
 }
@@ -1055,18 +1106,10 @@ static void
 FinalizeRegexp(
     TCL_UNUSED(void *))
 {
-    int i;
-    TclRegexp *regexpPtr;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
-    for (i = 0; (i < NUM_REGEXPS) && (tsdPtr->patterns[i] != NULL); i++) {
-	regexpPtr = tsdPtr->regexps[i];
-	if (regexpPtr->refCount-- <= 1) {
-	    FreeRegexp(regexpPtr);
-	}
-	Tcl_Free(tsdPtr->patterns[i]);
-	tsdPtr->patterns[i] = NULL;
-    }
+    CacheTrim(tsdPtr, 0);
+    Tcl_DeleteHashTable(&tsdPtr->cache);
 
     /*
      * We may find ourselves reinitialized if another finalization routine
@@ -1076,6 +1119,322 @@ FinalizeRegexp(
     tsdPtr->initialized = 0;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * InitRegexpCache --
+ *
+ *	Get the per-thread regexp cache, setting it up on first use.
+ *
+ * Results:
+ *	The thread-specific data of this module.
+ *
+ * Side effects:
+ *	May initialize the cache and register a thread exit handler.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ThreadSpecificData *
+InitRegexpCache(void)
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+    if (!tsdPtr->initialized) {
+	tsdPtr->initialized = 1;
+	Tcl_InitCustomHashTable(&tsdPtr->cache, TCL_CUSTOM_TYPE_KEYS,
+		&regexpKeyType);
+	tsdPtr->firstPtr = tsdPtr->lastPtr = NULL;
+	if (tsdPtr->maxSize <= 0) {
+	    tsdPtr->maxSize = DEFAULT_NUM_REGEXPS;
+	}
+	Tcl_CreateThreadExitHandler(FinalizeRegexp, NULL);
+    }
+    return tsdPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CacheEvict --
+ *
+ *	Remove an entry from the per-thread regexp cache, dropping the cache's
+ *	reference to its compiled regexp.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The regexp is freed if no Tcl_Obj refers to it any more.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CacheEvict(
+    ThreadSpecificData *tsdPtr,	/* Cache to remove the entry from. */
+    RegexpCacheEntry *entryPtr)	/* Entry to remove. */
+{
+    TclRegexp *regexpPtr = entryPtr->regexpPtr;
+
+    if (entryPtr->prevPtr != NULL) {
+	entryPtr->prevPtr->nextPtr = entryPtr->nextPtr;
+    } else {
+	tsdPtr->firstPtr = entryPtr->nextPtr;
+    }
+    if (entryPtr->nextPtr != NULL) {
+	entryPtr->nextPtr->prevPtr = entryPtr->prevPtr;
+    } else {
+	tsdPtr->lastPtr = entryPtr->prevPtr;
+    }
+    Tcl_DeleteHashEntry(entryPtr->hPtr);
+    Tcl_Free(entryPtr);
+
+    if (regexpPtr->refCount-- <= 1) {
+	FreeRegexp(regexpPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CacheTrim --
+ *
+ *	Discard least recently used entries from the per-thread regexp cache
+ *	until no more than maxSize remain.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Entries are evicted; see CacheEvict. Entries discarded while the cache
+ *	is live (as opposed to being finalized) are counted as evictions.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CacheTrim(
+    ThreadSpecificData *tsdPtr,	/* Cache to trim. */
+    Tcl_Size maxSize)		/* Number of entries that may remain. */
+{
+    while (tsdPtr->cache.numEntries > maxSize) {
+	CacheEvict(tsdPtr, tsdPtr->lastPtr);
+	if (maxSize > 0) {
+	    tsdPtr->evictions++;
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * HashRegexpKey --
+ *
+ *	Compute a hash value for a pattern/flags key of the regexp cache.
+ *
+ * Results:
+ *	The hash value.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static size_t
+HashRegexpKey(
+    TCL_UNUSED(Tcl_HashTable *),
+    void *keyPtr)		/* Key from which to compute hash value. */
+{
+    RegexpKey *key = (RegexpKey *)keyPtr;
+    const char *p = key->string;
+    const char *end = p + key->length;
+    size_t result = (size_t)key->flags;
+
+    /*
+     * Same scheme as for string keys (see TclHashStringKey), except that the
+     * length is known and the flags are mixed in up front.
+     */
+
+    while (p < end) {
+	result += (result << 3) + UCHAR(*p++);
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompareRegexpKeys --
+ *
+ *	Compare a pattern/flags key against the key stored in a regexp cache
+ *	entry.
+ *
+ * Results:
+ *	1 if the keys are equal, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CompareRegexpKeys(
+    void *keyPtr,		/* New key to compare. */
+    Tcl_HashEntry *hPtr)	/* Existing key to compare. */
+{
+    RegexpKey *key = (RegexpKey *)keyPtr;
+    RegexpStoredKey *storedPtr = (RegexpStoredKey *)hPtr->key.string;
+
+    return (key->length == storedPtr->length)
+	    && (key->flags == storedPtr->flags)
+	    && (memcmp(key->string, storedPtr->string, key->length) == 0);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AllocRegexpEntry --
+ *
+ *	Allocate space for a regexp cache hash entry, with a copy of the
+ *	pattern and flags stored inline as its key.
+ *
+ * Results:
+ *	The return value is a pointer to the created entry.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_HashEntry *
+AllocRegexpEntry(
+    TCL_UNUSED(Tcl_HashTable *),
+    void *keyPtr)		/* Key to store in the hash table entry. */
+{
+    RegexpKey *key = (RegexpKey *)keyPtr;
+    RegexpStoredKey *storedPtr;
+    Tcl_HashEntry *hPtr;
+
+    hPtr = (Tcl_HashEntry *)Tcl_Alloc(offsetof(Tcl_HashEntry, key)
+	    + offsetof(RegexpStoredKey, string) + key->length + 1);
+    storedPtr = (RegexpStoredKey *)hPtr->key.string;
+    storedPtr->length = key->length;
+    storedPtr->flags = key->flags;
+    memcpy(storedPtr->string, key->string, key->length);
+    storedPtr->string[key->length] = '\0';
+    Tcl_SetHashValue(hPtr, NULL);
+    return hPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRegexpCacheObjCmd --
+ *
+ *	This function is invoked to process the Tcl
+ *	"::tcl::unsupported::regexpcache" (internal, unsupported) command,
+ *	which inspects and tunes the per-thread cache of compiled regexps.
+ *
+ * Usage:
+ *	::tcl::unsupported::regexpcache ?-size ?count?? ?-clear?
+ *
+ *	With no options, returns a dictionary with the cache capacity and the
+ *	number of entries, hits, misses and evictions. -size queries or sets
+ *	the capacity; -clear empties the cache and resets the counters.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	May discard cached regexps.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclRegexpCacheObjCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Size objc,		/* Number of arguments. */
+    Tcl_Obj *const *objv)	/* Argument objects. */
+{
+    static const char *const options[] = {
+	"-clear", "-size", NULL
+    };
+    enum optionInd {
+	CACHE_CLEAR, CACHE_SIZE
+    };
+    ThreadSpecificData *tsdPtr = InitRegexpCache();
+    Tcl_Obj *resultObj;
+    Tcl_WideInt size;
+    Tcl_Size i;
+    int index;
+
+    if (objc == 1) {
+	TclNewObj(resultObj);
+	TclDictPut(NULL, resultObj, "size",
+		Tcl_NewWideIntObj(tsdPtr->maxSize));
+	TclDictPut(NULL, resultObj, "entries",
+		Tcl_NewWideIntObj(tsdPtr->cache.numEntries));
+	TclDictPut(NULL, resultObj, "hits", Tcl_NewWideIntObj(tsdPtr->hits));
+	TclDictPut(NULL, resultObj, "misses",
+		Tcl_NewWideIntObj(tsdPtr->misses));
+	TclDictPut(NULL, resultObj, "evictions",
+		Tcl_NewWideIntObj(tsdPtr->evictions));
+	Tcl_SetObjResult(interp, resultObj);
+	return TCL_OK;
+    }
+
+    for (i = 1; i < objc; i++) {
+	if (Tcl_GetIndexFromObj(interp, objv[i], options, "option", 0,
+		&index) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	switch ((enum optionInd) index) {
+	case CACHE_CLEAR:
+	    CacheTrim(tsdPtr, 0);
+	    tsdPtr->hits = tsdPtr->misses = tsdPtr->evictions = 0;
+	    Tcl_ResetResult(interp);
+	    break;
+	case CACHE_SIZE:
+	    if (++i < objc) {
+		/*
+		 * An option here means that the size was left out.
+		 */
+
+		if (Tcl_GetIndexFromObj(NULL, objv[i], options, "option", 0,
+			&index) == TCL_OK) {
+		    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			    "expected cache size but got option \"%s\"",
+			    TclGetString(objv[i])));
+		    Tcl_SetErrorCode(interp, "TCL", "VALUE", "REGEXPCACHE",
+			    (char *)NULL);
+		    return TCL_ERROR;
+		}
+		if (TclGetWideIntFromObj(interp, objv[i], &size) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		if (size < 1 || size > TCL_SIZE_MAX) {
+		    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			    "cache size must be a positive integer"));
+		    Tcl_SetErrorCode(interp, "TCL", "VALUE", "REGEXPCACHE",
+			    (char *)NULL);
+		    return TCL_ERROR;
+		}
+		tsdPtr->maxSize = (Tcl_Size)size;
+		CacheTrim(tsdPtr, tsdPtr->maxSize);
+	    }
+	    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(tsdPtr->maxSize));
+	    break;
+	}
+    }
+    return TCL_OK;
+}
+
 /*
  * Local Variables:
  * mode: c
@@ -0,0 +1,68 @@
+/*
+ * tclSimd.h --
+ *
+ *	This file says which vector instructions the kernels that scan
+ *	strings may use, for the encodings in tclEncoding.c and the byte
+ *	searches in tclUtf.c. It's only needed by Tcl's implementation; it
+ *	does not form a public or private API at all.
+ *
+ * See the file "license.terms" for information on usage and redistribution of
+ * this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#ifndef TCL_SIMD_H
+#define TCL_SIMD_H
+
+/*
+ * SSE2 kernels are used where the compiler targets it, and AVX2 kernels with
+ * gcc or clang where the processor has it, as found by
+ * __builtin_cpu_supports() when the kernels are chosen. Define TCL_NO_SIMD
+ * to use the plain C kernels instead.
+ */
+
+#if !defined(TCL_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#   define HAVE_SSE2_KERNELS 1
+#   include <emmintrin.h>
+#   if (defined(__GNUC__) || defined(__clang__)) \
+	    && (defined(__x86_64__) || defined(__i386__))
+#	define HAVE_AVX2_KERNELS 1
+#	define TCL_AVX2 __attribute__((target("avx2")))
+#	include <immintrin.h>
+#   endif
+#   if defined(__GNUC__) || defined(__clang__)
+#	define LowestSetBit(mask) __builtin_ctz(mask)
+#	define HighestSetBit(mask) (31 - __builtin_clz(mask))
+#   else
+#	include <intrin.h>
+static inline int
+LowestSetBit(
+    unsigned mask)
+{
+    unsigned long bit;
+
+    _BitScanForward(&bit, mask);
+    return (int) bit;
+}
+
+static inline int
+HighestSetBit(
+    unsigned mask)
+{
+    unsigned long bit;
+
+    _BitScanReverse(&bit, mask);
+    return (int) bit;
+}
+#   endif
+#endif
+
+#endif /* TCL_SIMD_H */
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 4
+ * fill-column: 78
+ * End:
+ */
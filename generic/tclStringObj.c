@@ -50,6 +50,7 @@ static void		AppendUtfToUnicodeRep(Tcl_Obj *objPtr,
 			    const char *bytes, Tcl_Size numBytes);
 static void		AppendUtfToUtfRep(Tcl_Obj *objPtr,
 			    const char *bytes, Tcl_Size numBytes);
+static void		DiscardCharIndex(String *stringPtr);
 static void		DupStringInternalRep(Tcl_Obj *objPtr,
 			    Tcl_Obj *copyPtr);
 static Tcl_Size		ExtendStringRepWithUnicode(Tcl_Obj *objPtr,
@@ -66,10 +67,34 @@ static void		SetUnicodeObj(Tcl_Obj *objPtr,
 			    const Tcl_UniChar *unicode, Tcl_Size numChars);
 static Tcl_Size		UnicodeLength(const Tcl_UniChar *unicode);
 static void		UpdateStringOfString(Tcl_Obj *objPtr);
+static const char *	UtfAtCharIndex(Tcl_Obj *objPtr, Tcl_Size index);
 
 #define ISCONTINUATION(bytes) (\
 	((bytes)[0] & 0xC0) == 0x80)
 
+/*
+ * Strings that are indexed by character but have no Tcl_UniChar rep are
+ * indexed in their UTF-8 form instead, which needs to know where characters
+ * start. The structure below records the byte offset of every
+ * CHAR_INDEX_STEP'th character, so that any character can be found by
+ * scanning at most CHAR_INDEX_STEP-1 characters from a recorded offset. The
+ * index is built as far as it is needed. Appending to the string leaves it
+ * valid; any other change to the string discards it.
+ */
+
+#define CHAR_INDEX_STEP 64
+
+typedef struct CharIndex {
+    Tcl_Size numOffsets;	/* Number of valid entries in offsets. */
+    Tcl_Size maxOffsets;	/* Number of entries allocated. */
+    Tcl_Size offsets[TCLFLEXARRAY];
+				/* offsets[i] is the byte offset of character
+				 * i*CHAR_INDEX_STEP. */
+} CharIndex;
+
+#define CHAR_INDEX_SIZE(n) \
+    (offsetof(CharIndex, offsets) + (n) * sizeof(Tcl_Size))
+
 /*
  * The structure below defines the string Tcl object type by means of
  * functions that can be invoked by generic object code.
@@ -580,8 +605,14 @@ Tcl_GetUniChar(
 	if (stringPtr->numChars == objPtr->length) {
 	    return (unsigned char) objPtr->bytes[index];
 	}
-	FillUnicodeRep(objPtr);
-	stringPtr = GET_STRING(objPtr);
+
+	/*
+	 * Find the character in the UTF-8 string rather than converting all
+	 * of it to Tcl_UniChars.
+	 */
+
+	TclUtfToUniChar(UtfAtCharIndex(objPtr, index), &ch);
+	return ch;
     }
 
     if (index >= stringPtr->numChars) {
@@ -791,8 +822,29 @@ Tcl_GetRange(
 	    stringPtr->numChars = newObjPtr->length;
 	    return newObjPtr;
 	}
-	FillUnicodeRep(objPtr);
-	stringPtr = GET_STRING(objPtr);
+	if (last < 0 || last >= stringPtr->numChars) {
+	    last = stringPtr->numChars - 1;
+	}
+	if (last < first) {
+	    TclNewObj(newObjPtr);
+	    return newObjPtr;
+	}
+
+	/*
+	 * Copy the range out of the UTF-8 string rather than converting all
+	 * of it to Tcl_UniChars.
+	 */
+
+	{
+	    const char *begin = UtfAtCharIndex(objPtr, first);
+	    const char *end = UtfAtCharIndex(objPtr, last + 1);
+
+	    newObjPtr = Tcl_NewStringObj(begin, end - begin);
+	}
+	SetStringFromAny(NULL, newObjPtr);
+	stringPtr = GET_STRING(newObjPtr);
+	stringPtr->numChars = last - first + 1;
+	return newObjPtr;
     }
     if (last < 0 || last >= stringPtr->numChars) {
 	last = stringPtr->numChars - 1;
@@ -974,6 +1026,7 @@ Tcl_SetObjLength(
 
 	stringPtr->numChars = TCL_INDEX_NONE;
 	stringPtr->hasUnicode = 0;
+	DiscardCharIndex(stringPtr);
     } else {
 	if (length > stringPtr->maxChars) {
 	    stringPtr = stringRealloc(stringPtr, length);
@@ -1076,6 +1129,7 @@ Tcl_AttemptSetObjLength(
 
 	stringPtr->numChars = TCL_INDEX_NONE;
 	stringPtr->hasUnicode = 0;
+	DiscardCharIndex(stringPtr);
     } else {
 	/*
 	 * Changing length of pure Unicode string.
@@ -1179,6 +1233,7 @@ SetUnicodeObj(
     stringPtr->unicode[numChars] = 0;
     stringPtr->numChars = numChars;
     stringPtr->hasUnicode = 1;
+    stringPtr->charIndex = NULL;
 
     TclInvalidateStringRep(objPtr);
     stringPtr->allocated = 0;
@@ -2975,7 +3030,12 @@ TclGetStringStorage(
 	return TclGetStringFromObj(objPtr, sizePtr);
     }
 
+    /*
+     * The caller may write anywhere in the buffer.
+     */
+
     stringPtr = GET_STRING(objPtr);
+    DiscardCharIndex(stringPtr);
     *sizePtr = stringPtr->allocated;
     return objPtr->bytes;
 }
@@ -3867,7 +3927,7 @@ TclStringFirst(
     }
 
     if (TclIsPureByteArray(needle) && TclIsPureByteArray(haystack)) {
-	unsigned char *end, *check, *bh;
+	unsigned char *check, *bh;
 	unsigned char *bn = Tcl_GetBytesFromObj(NULL, needle, &ln);
 
 	/* Find bytes in bytes */
@@ -3876,30 +3936,47 @@ TclStringFirst(
 	    /* Don't start the loop if there cannot be a valid answer */
 	    goto firstEnd;
 	}
-	end = bh + lh;
+	check = (unsigned char *)TclMemSearch((char *)bh + start, lh - start,
+		(char *)bn, ln);
+	if (check != NULL) {
+	    value = (check - bh);
+	}
+	goto firstEnd;
+    }
 
-	check = bh + start;
-	while (check + ln <= end) {
-	    /*
-	     * Look for the leading byte of the needle in the haystack
-	     * starting at check and stopping when there's not enough room
-	     * for the needle left.
-	     */
-	    check = (unsigned char *)memchr(check, bn[0], (end + 1 - ln) - check);
-	    if (check == NULL) {
-		/* Leading byte not found -> needle cannot be found. */
+    /*
+     * An ASCII needle can only match the bytes of ASCII characters, each of
+     * which is a character of its own, so search for it in the bytes of the
+     * haystack directly. When each character of the haystack is a single
+     * byte, the byte offset found is the index; otherwise the characters
+     * before it are counted.
+     */
+
+    lh = Tcl_GetCharLength(haystack);
+    if (haystack->bytes != NULL) {
+	Tcl_Size nb;
+	const char *check, *found, *bn = TclGetStringFromObj(needle, &nb);
+
+	if (TclAsciiLength(bn, nb) == nb) {
+	    if ((lh < nb) || (start > lh - nb)) {
 		goto firstEnd;
 	    }
-	    /* Leading byte found, check rest of needle. */
-	    if (0 == memcmp(check+1, bn+1, ln-1)) {
-		/* Checks! Return the successful index. */
-		value = (check - bh);
-		goto firstEnd;
+	    if (lh == haystack->length) {
+		check = haystack->bytes + start;
+	    } else if (TclHasInternalRep(haystack, &tclStringType)
+		    && !GET_STRING(haystack)->hasUnicode) {
+		check = UtfAtCharIndex(haystack, start);
+	    } else {
+		check = Tcl_UtfAtIndex(haystack->bytes, start);
+	    }
+	    found = TclMemSearch(check, haystack->bytes + haystack->length
+		    - check, bn, nb);
+	    if (found != NULL) {
+		value = start + ((lh == haystack->length) ? found - check
+			: Tcl_NumUtfChars(check, found - check));
 	    }
-	    /* Rest of needle match failed; Iterate to continue search. */
-	    check++;
+	    goto firstEnd;
 	}
-	goto firstEnd;
     }
 
     /*
@@ -3911,10 +3988,43 @@ TclStringFirst(
      * we explicitly decline to support.  Getting there will involve
      * locking down in practice more firmly just what encodings produce
      * what supported results for the objPtr->bytes values.  For now,
-     * do only the well-defined Tcl_UniChar array search.
+     * compare Tcl_UniChar values, but decode them from the haystack's
+     * UTF-8 string if it has no Tcl_UniChar array, so that searching a
+     * large string does not make a copy of it four times its size.
      */
 
     un = Tcl_GetUnicodeFromObj(needle, &ln);
+    if (TclHasInternalRep(haystack, &tclStringType)
+	    && !GET_STRING(haystack)->hasUnicode) {
+	const char *check;
+	Tcl_Size i;
+
+	if ((lh < ln) || (start > lh - ln)) {
+	    goto firstEnd;
+	}
+	check = UtfAtCharIndex(haystack, start);
+	for (i = start; i <= lh - ln; i++) {
+	    int ch;
+	    Tcl_Size j, len = TclUtfToUniChar(check, &ch);
+
+	    if ((Tcl_UniChar) ch == un[0]) {
+		const char *rest = check + len;
+
+		for (j = 1; j < ln; j++) {
+		    rest += TclUtfToUniChar(rest, &ch);
+		    if ((Tcl_UniChar) ch != un[j]) {
+			break;
+		    }
+		}
+		if (j == ln) {
+		    value = i;
+		    goto firstEnd;
+		}
+	    }
+	    check += len;
+	}
+	goto firstEnd;
+    }
     uh = Tcl_GetUnicodeFromObj(haystack, &lh);
     if ((lh < ln) || (start > lh - ln)) {
 	/* Don't start the loop if there cannot be a valid answer */
@@ -3984,17 +4094,37 @@ TclStringLast(
 	    /* Don't start the loop if there cannot be a valid answer */
 	    goto lastEnd;
 	}
-	check = bh + last + 1 - ln;
+	check = (unsigned char *)TclMemSearchLast((char *)bh, last + 1,
+		(char *)bn, ln);
+	if (check != NULL) {
+	    value = (check - bh);
+	}
+	goto lastEnd;
+    }
 
-	while (check >= bh) {
-	    if ((*check == bn[0])
-		    && (0 == memcmp(check+1, bn+1, ln-1))) {
-		value = (check - bh);
+    /*
+     * Search the bytes directly when they are the characters, as in
+     * TclStringFirst.
+     */
+
+    lh = Tcl_GetCharLength(haystack);
+    if ((haystack->bytes != NULL) && (lh == haystack->length)) {
+	Tcl_Size nb;
+	const char *check, *bn = TclGetStringFromObj(needle, &nb);
+
+	if (TclAsciiLength(bn, nb) == nb) {
+	    if (last >= lh) {
+		last = lh - 1;
+	    }
+	    if (last + 1 < nb) {
 		goto lastEnd;
 	    }
-	    check--;
+	    check = TclMemSearchLast(haystack->bytes, last + 1, bn, nb);
+	    if (check != NULL) {
+		value = (check - haystack->bytes);
+	    }
+	    goto lastEnd;
 	}
-	goto lastEnd;
     }
 
     uh = Tcl_GetUnicodeFromObj(haystack, &lh);
@@ -4021,6 +4151,107 @@ TclStringLast(
     return obj;
 }
 
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TclStringMapAscii --
+ *
+ *	Implements the case-sensitive [string map] operation for strings and
+ *	keys that are all ASCII, where the mapping can be done on the UTF-8
+ *	bytes, without making the Tcl_UniChar copy of the string that the
+ *	general case works on.
+ *
+ * Results:
+ *	NULL if the string or one of the keys is not all ASCII. Otherwise the
+ *	mapped string, which is objPtr itself if no key matched.
+ *
+ * Side effects:
+ *	May allocate a new Tcl_Obj.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclStringMapAscii(
+    Tcl_Obj *objPtr,		/* The string to map. */
+    Tcl_Size mapElemc,		/* Number of keys and values, even. */
+    Tcl_Obj *const *mapElemv)	/* The keys and the values to map them to,
+				 * alternating. */
+{
+    Tcl_Size length, keyLen, valueLen, index;
+    const char *bytes, *end, *p, *match, *key, *value;
+    Tcl_Obj *resultPtr = NULL;
+    TclByteSet keyStarts;
+
+    if (TclIsPureByteArray(objPtr)) {
+	return NULL;
+    }
+    bytes = TclGetStringFromObj(objPtr, &length);
+    if (TclAsciiLength(bytes, length) != length) {
+	return NULL;
+    }
+    TclByteSetInit(&keyStarts);
+    for (index = 0; index < mapElemc; index += 2) {
+	key = TclGetStringFromObj(mapElemv[index], &keyLen);
+	if (TclAsciiLength(key, keyLen) != keyLen) {
+	    return NULL;
+	}
+	if (keyLen > 0) {
+	    TclByteSetAdd(&keyStarts, *key);
+	}
+    }
+
+    end = bytes + length;
+    p = bytes;
+    if (mapElemc == 2) {
+	key = TclGetStringFromObj(mapElemv[0], &keyLen);
+	if (keyLen == 0) {
+	    return objPtr;
+	}
+	value = TclGetStringFromObj(mapElemv[1], &valueLen);
+	while ((match = TclMemSearch(p, end - p, key, keyLen)) != NULL) {
+	    if (resultPtr == NULL) {
+		TclNewObj(resultPtr);
+	    }
+	    Tcl_AppendToObj(resultPtr, p, match - p);
+	    Tcl_AppendToObj(resultPtr, value, valueLen);
+	    p = match + keyLen;
+	}
+    } else {
+	const char *check = p;
+
+	/*
+	 * At each byte that starts some key, try the keys in order, as the
+	 * general case does.
+	 */
+
+	while ((match = TclMemSearchSet(check, end - check,
+		&keyStarts)) != NULL) {
+	    check = match + 1;
+	    for (index = 0; index < mapElemc; index += 2) {
+		key = TclGetStringFromObj(mapElemv[index], &keyLen);
+		if ((keyLen > 0) && (keyLen <= end - match)
+			&& (memcmp(match, key, keyLen) == 0)) {
+		    if (resultPtr == NULL) {
+			TclNewObj(resultPtr);
+		    }
+		    value = TclGetStringFromObj(mapElemv[index + 1],
+			    &valueLen);
+		    Tcl_AppendToObj(resultPtr, p, match - p);
+		    Tcl_AppendToObj(resultPtr, value, valueLen);
+		    p = check = match + keyLen;
+		    break;
+		}
+	    }
+	}
+    }
+    if (resultPtr == NULL) {
+	return objPtr;
+    }
+    Tcl_AppendToObj(resultPtr, p, end - p);
+    return resultPtr;
+}
+
 /*
  *---------------------------------------------------------------------------
  *
@@ -4126,6 +4357,8 @@ TclStringReverse(
 	if (!inPlace || Tcl_IsShared(objPtr)) {
 	    TclNewObj(objPtr);
 	    Tcl_SetObjLength(objPtr, numBytes);
+	} else {
+	    DiscardCharIndex(stringPtr);
 	}
 	to = objPtr->bytes;
 
@@ -4286,11 +4519,37 @@ TclStringReplace(
     }
 
     /*
-     * TODO: Figure out how not to generate a Tcl_UniChar array rep
-     * when it can be determined objPtr->bytes points to a string of
-     * all single-byte characters so we can index it directly.
+     * A string without a Tcl_UniChar array rep is spliced in its UTF-8
+     * form, rather than converting all of it to Tcl_UniChars.
      */
 
+    {
+	Tcl_Size numChars = Tcl_GetCharLength(objPtr);
+
+	if (TclHasInternalRep(objPtr, &tclStringType)
+		&& !GET_STRING(objPtr)->hasUnicode) {
+	    const char *mid, *end;
+
+	    if (first > numChars) {
+		first = numChars;
+	    }
+	    if (count < 0) {
+		count = 0;
+	    }
+	    mid = UtfAtCharIndex(objPtr, first);
+	    result = Tcl_NewStringObj(objPtr->bytes, mid - objPtr->bytes);
+	    if (insertPtr) {
+		Tcl_AppendObjToObj(result, insertPtr);
+	    }
+	    if (count < numChars - first) {
+		end = UtfAtCharIndex(objPtr, first + count);
+		Tcl_AppendToObj(result, end,
+			objPtr->bytes + objPtr->length - end);
+	    }
+	    return result;
+	}
+    }
+
     /* The traditional implementation... */
     {
 	Tcl_Size numChars;
@@ -4335,6 +4594,12 @@ FillUnicodeRep(
 {
     String *stringPtr = GET_STRING(objPtr);
 
+    /*
+     * Once there are Tcl_UniChars, the index of the UTF-8 string is no
+     * longer used.
+     */
+
+    DiscardCharIndex(stringPtr);
     ExtendUnicodeRepWithString(objPtr, objPtr->bytes, objPtr->length,
 	    stringPtr->numChars);
 }
@@ -4484,6 +4749,7 @@ DupStringInternalRep(
     }
     copyStringPtr->hasUnicode = srcStringPtr->hasUnicode;
     copyStringPtr->numChars = srcStringPtr->numChars;
+    copyStringPtr->charIndex = NULL;
 
     /*
      * Tricky point: the string value was copied by generic object management
@@ -4538,6 +4804,7 @@ SetStringFromAny(
 	stringPtr->allocated = objPtr->length;
 	stringPtr->maxChars = 0;
 	stringPtr->hasUnicode = 0;
+	stringPtr->charIndex = NULL;
 	SET_STRING(objPtr, stringPtr);
 	objPtr->typePtr = &tclStringType;
     }
@@ -4577,6 +4844,7 @@ UpdateStringOfString(
      */
 
     stringPtr->allocated = 0;
+    DiscardCharIndex(stringPtr);
 
     if (stringPtr->numChars == 0) {
 	TclInitEmptyStringRep(objPtr);
@@ -4669,10 +4937,120 @@ static void
 FreeStringInternalRep(
     Tcl_Obj *objPtr)		/* Object with internal rep to free. */
 {
-    Tcl_Free(GET_STRING(objPtr));
+    String *stringPtr = GET_STRING(objPtr);
+
+    DiscardCharIndex(stringPtr);
+    Tcl_Free(stringPtr);
     objPtr->typePtr = NULL;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * UtfAtCharIndex --
+ *
+ *	Find a character in the UTF-8 string rep of a String object that has
+ *	no Tcl_UniChar rep, using (and extending as needed) the object's
+ *	sparse index of character positions. The number of characters in the
+ *	string must be known, and index must be between 0 and that number.
+ *
+ * Results:
+ *	Pointer to the first byte of character "index" in objPtr->bytes, or
+ *	to the terminating nul if index is the number of characters.
+ *
+ * Side effects:
+ *	May allocate or grow the index.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static const char *
+UtfAtCharIndex(
+    Tcl_Obj *objPtr,		/* String object to index. */
+    Tcl_Size index)		/* Index of the character to find. */
+{
+    String *stringPtr = GET_STRING(objPtr);
+    CharIndex *indexPtr = stringPtr->charIndex;
+    Tcl_Size slot = index / CHAR_INDEX_STEP;
+    const char *p;
+
+    if (stringPtr->numChars == objPtr->length) {
+	/*
+	 * All characters are single bytes.
+	 */
+
+	return objPtr->bytes + index;
+    }
+    if (slot == 0) {
+	/*
+	 * No index is needed near the start of the string.
+	 */
+
+	return Tcl_UtfAtIndex(objPtr->bytes, index);
+    }
+
+    if (indexPtr == NULL) {
+	Tcl_Size maxOffsets = stringPtr->numChars / CHAR_INDEX_STEP + 1;
+
+	indexPtr = (CharIndex *)Tcl_Alloc(CHAR_INDEX_SIZE(maxOffsets));
+	indexPtr->numOffsets = 1;
+	indexPtr->maxOffsets = maxOffsets;
+	indexPtr->offsets[0] = 0;
+	stringPtr->charIndex = indexPtr;
+    }
+
+    if (slot >= indexPtr->numOffsets) {
+	/*
+	 * Scan forward from the last recorded position, recording positions
+	 * on the way. The string may have grown since the index was made.
+	 */
+
+	if (slot >= indexPtr->maxOffsets) {
+	    Tcl_Size maxOffsets = stringPtr->numChars / CHAR_INDEX_STEP + 1;
+
+	    indexPtr = (CharIndex *)Tcl_Realloc(indexPtr,
+		    CHAR_INDEX_SIZE(maxOffsets));
+	    indexPtr->maxOffsets = maxOffsets;
+	    stringPtr->charIndex = indexPtr;
+	}
+	p = objPtr->bytes + indexPtr->offsets[indexPtr->numOffsets - 1];
+	while (indexPtr->numOffsets <= slot) {
+	    p = Tcl_UtfAtIndex(p, CHAR_INDEX_STEP);
+	    indexPtr->offsets[indexPtr->numOffsets++] = p - objPtr->bytes;
+	}
+    }
+
+    p = objPtr->bytes + indexPtr->offsets[slot];
+    return Tcl_UtfAtIndex(p, index - slot * CHAR_INDEX_STEP);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DiscardCharIndex --
+ *
+ *	Free the sparse character index of a String internal rep, if it has
+ *	one. Called whenever the UTF-8 string changes other than by appending.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DiscardCharIndex(
+    String *stringPtr)
+{
+    if (stringPtr->charIndex != NULL) {
+	Tcl_Free(stringPtr->charIndex);
+	stringPtr->charIndex = NULL;
+    }
+}
+
 /*
  * Local Variables:
  * mode: c
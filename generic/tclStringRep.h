@@ -41,6 +41,10 @@ typedef struct {
 				 * space allocated for the Unicode array. */
     int hasUnicode;		/* Boolean determining whether the string has
 				 * a Tcl_UniChar representation. */
+    struct CharIndex *charIndex;/* Sparse index of character positions in
+				 * the UTF-8 string, used to index strings
+				 * that have no Tcl_UniChar representation.
+				 * NULL if none has been built. */
     Tcl_UniChar unicode[TCLFLEXARRAY];	/* The array of Tcl_UniChar units.
 				 * The actual size of this field depends on
 				 * the maxChars field above. */
@@ -1513,7 +1513,12 @@ const TclStubs tclStubs = {
     Tcl_RegisterPostInitProc, /* 699 */
     Tcl_UnregisterPostInitProc, /* 700 */
     Tcl_ClearPostInitProcs, /* 701 */
-    TclUnusedStubEntry, /* 702 */
+    Tcl_CreateTaskGroup, /* 702 */
+    Tcl_DeleteTaskGroup, /* 703 */
+    Tcl_TaskPoolSubmit, /* 704 */
+    Tcl_TaskGroupWait, /* 705 */
+    Tcl_GetTaskPoolSize, /* 706 */
+    TclUnusedStubEntry, /* 707 */
 };
 
 /* !END!: Do not edit above this line. */
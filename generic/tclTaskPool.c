@@ -0,0 +1,1071 @@
+/*
+ * tclTaskPool.c --
+ *
+ *	This file implements the process-wide pool of worker threads behind
+ *	Tcl_TaskPoolSubmit and Tcl_TaskGroupWait, and the
+ *	::tcl::unsupported::pmap command built on them.
+ *
+ *	The pool has one worker thread per processor, started when the first
+ *	task is submitted. Each worker owns a deque of tasks: it pushes the
+ *	tasks it submits itself at the bottom and takes its next task from
+ *	there too, so that nested tasks run depth first while their data is
+ *	still in the cache. A worker whose deque is empty steals the oldest
+ *	task of another deque, starting from a random one. Tasks submitted by
+ *	threads outside the pool are dealt to the deques in turn. A thread
+ *	waiting for a task group runs queued tasks while it waits, so nested
+ *	waits cannot run out of threads, and tasks still run when the worker
+ *	threads cannot be started.
+ *
+ * See the file "license.terms" for information on usage and redistribution of
+ * this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#include "tclInt.h"
+
+/*
+ * A submitted task, and the group that waits for it.
+ */
+
+typedef struct TaskGroup TaskGroup;
+
+typedef struct {
+    Tcl_TaskProc *proc;		/* Function that runs the task. */
+    void *clientData;		/* Argument of proc. */
+    TaskGroup *groupPtr;	/* Group the task belongs to. */
+} Task;
+
+/*
+ * The deque of tasks of a worker. It is a ring buffer that doubles in size
+ * when full. Tasks are pushed and popped at the bottom, and stolen from the
+ * top. The indices are not wrapped; only their low bits select a slot.
+ */
+
+typedef struct {
+    Tcl_Mutex mutex;		/* Protects all the fields below. */
+    Task *tasks;		/* Ring buffer of (mask + 1) tasks. */
+    size_t mask;		/* Size of the ring buffer less 1. */
+    size_t top;			/* Index of the oldest task. */
+    size_t bottom;		/* Index after the newest task. */
+} TaskDeque;
+
+#define DEQUE_INITIAL_SIZE	64
+
+/*
+ * A group of tasks, as returned by Tcl_CreateTaskGroup.
+ */
+
+struct TaskGroup {
+    Tcl_Mutex mutex;		/* Protects pending and waiting. */
+    size_t pending;		/* Number of tasks submitted to the group that
+				 * have not finished. */
+    int waiting;		/* Set when a thread sleeps until the group is
+				 * done, so that the thread finishing the last
+				 * task wakes it up. */
+};
+
+/*
+ * State of the pool. All of this is protected by poolMutex. Lock order is
+ * poolMutex, then the mutex of a group, then the mutex of a deque. The deques
+ * array and numDeques are set before the first task is queued, and do not
+ * change while any task is queued or any worker runs.
+ */
+
+enum PoolState {
+    POOL_NONE,			/* No worker threads, none started yet. */
+    POOL_RUNNING,		/* Worker threads are running. */
+    POOL_STOPPING,		/* Worker threads are told to exit. */
+    POOL_FAILED			/* Worker threads could not be started. Tasks
+				 * are run by the threads that wait for them. */
+};
+
+TCL_DECLARE_MUTEX(poolMutex)
+static Tcl_Condition poolCond;	/* Wakes sleeping workers and waiters. */
+static enum PoolState poolState = POOL_NONE;
+static TaskDeque *deques = NULL;
+static int numDeques = 0;
+static int numWorkers = 0;
+static Tcl_ThreadId *workerThreads = NULL;
+static int numSleeping = 0;	/* Number of workers and waiters sleeping on
+				 * poolCond, or about to. */
+
+/*
+ * Workers push the tasks they submit on their own deque without taking
+ * poolMutex, and only take it to wake up sleeping threads when numSleeping
+ * says there are some. A thread counts itself in numSleeping before it looks
+ * at the deques for the last time, so either it finds the task or the worker
+ * finds it counted: the mutexes of the deques order the two. numSleeping is
+ * still only changed with poolMutex held. The lock-free read needs GCC-style
+ * atomics; without them, workers take poolMutex to submit like other
+ * threads.
+ */
+
+#if defined(__GNUC__) && defined(__ATOMIC_RELAXED)
+#   define TCL_TASK_POOL_LOCAL_PUSH 1
+#   define SleepingThreads() \
+	__atomic_load_n(&numSleeping, __ATOMIC_RELAXED)
+#   define AddSleepingThreads(n) \
+	__atomic_store_n(&numSleeping, numSleeping + (n), __ATOMIC_RELAXED)
+#else
+#   define SleepingThreads()	(numSleeping)
+#   define AddSleepingThreads(n)	(numSleeping += (n))
+#endif
+
+/*
+ * Per-thread data.
+ */
+
+typedef struct {
+    int workerIndex;		/* 1 + index of the deque of the worker that
+				 * runs in this thread, or 0 when the thread
+				 * is not a worker of the pool. */
+    unsigned int nextDeque;	/* Deque the next task submitted from outside
+				 * the pool goes to. */
+    unsigned int seed;		/* State of the generator choosing the first
+				 * deque to steal from. */
+} ThreadSpecificData;
+
+static Tcl_ThreadDataKey dataKey;
+
+/*
+ * A [pmap] job. Its tasks take chunks of consecutive items in turn until
+ * none is left. The strings of the lambda and of the items are taken in the
+ * calling thread before any task runs; the results are copied out of the
+ * task interpreters as strings allocated with Tcl_Alloc.
+ */
+
+typedef struct {
+    Tcl_Interp *interp;		/* Interpreter that called [pmap]. */
+    Tcl_ThreadId thread;	/* Thread of that interpreter. */
+    const char *lambda;		/* String of the lambda. */
+    Tcl_Size lambdaLength;
+    const char **items;		/* Strings of the items. */
+    Tcl_Size *itemLengths;
+    Tcl_Size numItems;		/* Number of items. */
+    Tcl_Size chunkSize;		/* Number of items a task takes at once. */
+    char **results;		/* Strings of the results, or NULL. */
+    Tcl_Size *resultLengths;
+    Tcl_Mutex mutex;		/* Protects the fields below. */
+    Tcl_Size nextItem;		/* First item that no task has taken. */
+    Tcl_Size errorIndex;	/* Lowest index of an item whose evaluation
+				 * failed, or the number of items. Items after
+				 * it are not evaluated. */
+    int canceled;		/* Set when the script of the calling
+				 * interpreter is canceled. No more items are
+				 * evaluated. */
+    char *errorMessage;		/* Result and return options of the failed */
+    char *errorOptions;		/* evaluation. */
+} MapJob;
+
+/*
+ * Number of chunks a [pmap] job is split into for each thread of the pool,
+ * to even out items that take different times.
+ */
+
+#define CHUNKS_PER_THREAD	4
+
+/*
+ * Static functions defined in this file.
+ */
+
+static int		FindTask(ThreadSpecificData *tsdPtr, Task *taskPtr);
+static void		InitTaskPool(void);
+static void		MapTask(void *clientData);
+static int		PopTask(TaskDeque *dequePtr, Task *taskPtr);
+static void		PushTask(TaskDeque *dequePtr, const Task *taskPtr);
+static void		RunTask(const Task *taskPtr);
+static int		StealTask(TaskDeque *dequePtr, Task *taskPtr);
+static void		StopTaskPool(void *clientData);
+static char *		TaskStringCopy(Tcl_Obj *objPtr, Tcl_Size *lengthPtr);
+static Tcl_ThreadCreateProc TaskPoolWorker;
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InitTaskPool --
+ *
+ *	Create the deques of the pool and start its worker threads, one for
+ *	each processor. Must be called with poolMutex held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Allocates the deques and starts threads. If no thread can be started,
+ *	or Tcl is exiting, the pool has a single deque and no workers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+InitTaskPool(void)
+{
+    int i, numCPUs = TclpGetNumberOfCPUs();
+
+    if (deques == NULL) {
+	numDeques = numCPUs;
+	deques = (TaskDeque *) Tcl_Alloc(numDeques * sizeof(TaskDeque));
+	for (i = 0; i < numDeques; i++) {
+	    deques[i].mutex = NULL;
+	    deques[i].tasks = (Task *)
+		    Tcl_Alloc(DEQUE_INITIAL_SIZE * sizeof(Task));
+	    deques[i].mask = DEQUE_INITIAL_SIZE - 1;
+	    deques[i].top = deques[i].bottom = 0;
+	}
+    }
+    if ((poolState != POOL_NONE) || TclInExit()) {
+	return;
+    }
+
+    workerThreads = (Tcl_ThreadId *)
+	    Tcl_Alloc(numDeques * sizeof(Tcl_ThreadId));
+    for (i = 0; i < numDeques; i++) {
+	if (Tcl_CreateThread(&workerThreads[i], TaskPoolWorker, INT2PTR(i),
+		TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+	    break;
+	}
+    }
+    numWorkers = i;
+    if (numWorkers == 0) {
+	Tcl_Free(workerThreads);
+	workerThreads = NULL;
+	poolState = POOL_FAILED;
+	return;
+    }
+    poolState = POOL_RUNNING;
+    Tcl_CreateExitHandler(StopTaskPool, NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StopTaskPool --
+ *
+ *	Exit handler that stops the worker threads of the pool.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Joins the worker threads. Tasks still queued, or submitted afterwards,
+ *	are run by the threads that wait for them.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StopTaskPool(
+    TCL_UNUSED(void *))
+{
+    int i, result;
+
+    Tcl_MutexLock(&poolMutex);
+    poolState = POOL_STOPPING;
+    Tcl_ConditionNotify(&poolCond);
+    Tcl_MutexUnlock(&poolMutex);
+    for (i = 0; i < numWorkers; i++) {
+	Tcl_JoinThread(workerThreads[i], &result);
+    }
+
+    Tcl_MutexLock(&poolMutex);
+    Tcl_Free(workerThreads);
+    workerThreads = NULL;
+    numWorkers = 0;
+    poolState = POOL_NONE;
+    for (i = 0; i < numDeques; i++) {
+	if (deques[i].top != deques[i].bottom) {
+	    break;
+	}
+    }
+    if (i == numDeques) {
+	for (i = 0; i < numDeques; i++) {
+	    Tcl_MutexFinalize(&deques[i].mutex);
+	    Tcl_Free(deques[i].tasks);
+	}
+	Tcl_Free(deques);
+	deques = NULL;
+	numDeques = 0;
+    }
+    Tcl_MutexUnlock(&poolMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TaskPoolWorker --
+ *
+ *	The worker threads of the pool. Each runs the tasks of its own deque
+ *	and steals those of the others until there are none, then sleeps
+ *	until a task is submitted.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Runs tasks.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+TaskPoolWorker(
+    void *clientData)		/* Index of the deque of the worker. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    Task task;
+
+    tsdPtr->workerIndex = PTR2INT(clientData) + 1;
+
+    /*
+     * The deques are searched once more with poolMutex held and the worker
+     * counted in numSleeping before going to sleep: a task pushed after that
+     * search finds the worker sleeping.
+     */
+
+    Tcl_MutexLock(&poolMutex);
+    while (poolState == POOL_RUNNING) {
+	AddSleepingThreads(1);
+	if (FindTask(tsdPtr, &task)) {
+	    AddSleepingThreads(-1);
+	    Tcl_MutexUnlock(&poolMutex);
+	    do {
+		RunTask(&task);
+	    } while (FindTask(tsdPtr, &task));
+	    Tcl_MutexLock(&poolMutex);
+	} else {
+	    Tcl_ConditionWait(&poolCond, &poolMutex, NULL);
+	    AddSleepingThreads(-1);
+	}
+    }
+    Tcl_MutexUnlock(&poolMutex);
+    Tcl_ExitThread(0);
+
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PushTask, PopTask, StealTask --
+ *
+ *	Add a task at the bottom of a deque, take the newest task from the
+ *	bottom, or take the oldest task from the top.
+ *
+ * Results:
+ *	PopTask and StealTask return 1 and store the task in *taskPtr, or
+ *	return 0 when the deque is empty.
+ *
+ * Side effects:
+ *	PushTask may grow the deque.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PushTask(
+    TaskDeque *dequePtr,
+    const Task *taskPtr)
+{
+    Tcl_MutexLock(&dequePtr->mutex);
+    if (dequePtr->bottom - dequePtr->top > dequePtr->mask) {
+	size_t i, newMask = 2 * dequePtr->mask + 1;
+	Task *newTasks = (Task *) Tcl_Alloc((newMask + 1) * sizeof(Task));
+
+	for (i = dequePtr->top; i != dequePtr->bottom; i++) {
+	    newTasks[i & newMask] = dequePtr->tasks[i & dequePtr->mask];
+	}
+	Tcl_Free(dequePtr->tasks);
+	dequePtr->tasks = newTasks;
+	dequePtr->mask = newMask;
+    }
+    dequePtr->tasks[dequePtr->bottom++ & dequePtr->mask] = *taskPtr;
+    Tcl_MutexUnlock(&dequePtr->mutex);
+}
+
+static int
+PopTask(
+    TaskDeque *dequePtr,
+    Task *taskPtr)
+{
+    int found = 0;
+
+    Tcl_MutexLock(&dequePtr->mutex);
+    if (dequePtr->bottom != dequePtr->top) {
+	*taskPtr = dequePtr->tasks[--dequePtr->bottom & dequePtr->mask];
+	found = 1;
+    }
+    Tcl_MutexUnlock(&dequePtr->mutex);
+    return found;
+}
+
+static int
+StealTask(
+    TaskDeque *dequePtr,
+    Task *taskPtr)
+{
+    int found = 0;
+
+    Tcl_MutexLock(&dequePtr->mutex);
+    if (dequePtr->bottom != dequePtr->top) {
+	*taskPtr = dequePtr->tasks[dequePtr->top++ & dequePtr->mask];
+	found = 1;
+    }
+    Tcl_MutexUnlock(&dequePtr->mutex);
+    return found;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindTask --
+ *
+ *	Take the next task for the current thread: the newest task of its own
+ *	deque when it is a worker, else the oldest task of the first deque
+ *	that has one, starting from a random deque.
+ *
+ * Results:
+ *	1 with the task stored in *taskPtr, or 0 when all deques are empty.
+ *
+ * Side effects:
+ *	Removes the task from its deque.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+FindTask(
+    ThreadSpecificData *tsdPtr,
+    Task *taskPtr)
+{
+    int i, start;
+
+    if (numDeques == 0) {
+	return 0;
+    }
+    if (tsdPtr->workerIndex
+	    && PopTask(&deques[tsdPtr->workerIndex - 1], taskPtr)) {
+	return 1;
+    }
+
+    /*
+     * Xorshift generator, seeded with the address of the thread's data.
+     */
+
+    if (tsdPtr->seed == 0) {
+	tsdPtr->seed = (unsigned int) PTR2UINT(tsdPtr) | 1;
+    }
+    tsdPtr->seed ^= tsdPtr->seed << 13;
+    tsdPtr->seed ^= tsdPtr->seed >> 17;
+    tsdPtr->seed ^= tsdPtr->seed << 5;
+    start = (int) (tsdPtr->seed % (unsigned int) numDeques);
+
+    for (i = 0; i < numDeques; i++) {
+	if (StealTask(&deques[(start + i) % numDeques], taskPtr)) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RunTask --
+ *
+ *	Run a task and count it as done in its group.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Whatever the task does. Wakes up the threads that wait for the group
+ *	when this was its last pending task.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RunTask(
+    const Task *taskPtr)
+{
+    TaskGroup *groupPtr = taskPtr->groupPtr;
+    int wake;
+
+    taskPtr->proc(taskPtr->clientData);
+
+    /*
+     * The group may be deleted as soon as its mutex is released with no
+     * pending task, so it must not be touched after that.
+     */
+
+    Tcl_MutexLock(&groupPtr->mutex);
+    wake = (--groupPtr->pending == 0) && groupPtr->waiting;
+    if (wake) {
+	groupPtr->waiting = 0;
+    }
+    Tcl_MutexUnlock(&groupPtr->mutex);
+
+    if (wake) {
+	Tcl_MutexLock(&poolMutex);
+	Tcl_ConditionNotify(&poolCond);
+	Tcl_MutexUnlock(&poolMutex);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_CreateTaskGroup --
+ *
+ *	Create a group to submit tasks to and wait for.
+ *
+ * Results:
+ *	The new task group.
+ *
+ * Side effects:
+ *	Allocates memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_TaskGroup
+Tcl_CreateTaskGroup(void)
+{
+    TaskGroup *groupPtr = (TaskGroup *) Tcl_Alloc(sizeof(TaskGroup));
+
+    groupPtr->mutex = NULL;
+    groupPtr->pending = 0;
+    groupPtr->waiting = 0;
+    return (Tcl_TaskGroup) groupPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_DeleteTaskGroup --
+ *
+ *	Wait for the tasks of a group, then delete it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	See Tcl_TaskGroupWait. Frees the group.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Tcl_DeleteTaskGroup(
+    Tcl_TaskGroup group)
+{
+    TaskGroup *groupPtr = (TaskGroup *) group;
+
+    Tcl_TaskGroupWait(group);
+    Tcl_MutexFinalize(&groupPtr->mutex);
+    Tcl_Free(groupPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_TaskPoolSubmit --
+ *
+ *	Queue a task, to be run by the task pool as proc(clientData). The task
+ *	is counted in the given group until it has run. Tasks may submit
+ *	further tasks, to their own group or to others.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Starts the worker threads of the pool on first use. Wakes up a
+ *	sleeping worker. Tasks submitted by a worker go to its own deque.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Tcl_TaskPoolSubmit(
+    Tcl_TaskGroup group,	/* Group to count the task in. */
+    Tcl_TaskProc *proc,		/* Function that runs the task. */
+    void *clientData)		/* Argument of proc. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    TaskGroup *groupPtr = (TaskGroup *) group;
+    Task task;
+    int index;
+
+    task.proc = proc;
+    task.clientData = clientData;
+    task.groupPtr = groupPtr;
+
+#ifdef TCL_TASK_POOL_LOCAL_PUSH
+    if (tsdPtr->workerIndex) {
+	/*
+	 * The pool is running, since this thread is one of its workers, and
+	 * its deques stay until the worker has exited.
+	 */
+
+	Tcl_MutexLock(&groupPtr->mutex);
+	groupPtr->pending++;
+	Tcl_MutexUnlock(&groupPtr->mutex);
+	PushTask(&deques[tsdPtr->workerIndex - 1], &task);
+	if (SleepingThreads()) {
+	    Tcl_MutexLock(&poolMutex);
+	    Tcl_ConditionNotify(&poolCond);
+	    Tcl_MutexUnlock(&poolMutex);
+	}
+	return;
+    }
+#endif /* TCL_TASK_POOL_LOCAL_PUSH */
+
+    Tcl_MutexLock(&poolMutex);
+    if ((deques == NULL) || (poolState == POOL_NONE)) {
+	InitTaskPool();
+    }
+    Tcl_MutexLock(&groupPtr->mutex);
+    groupPtr->pending++;
+    Tcl_MutexUnlock(&groupPtr->mutex);
+
+    if (tsdPtr->workerIndex) {
+	index = tsdPtr->workerIndex - 1;
+    } else {
+	index = (int) (tsdPtr->nextDeque++ % (unsigned int) numDeques);
+    }
+    PushTask(&deques[index], &task);
+    if (SleepingThreads()) {
+	Tcl_ConditionNotify(&poolCond);
+    }
+    Tcl_MutexUnlock(&poolMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_TaskGroupWait --
+ *
+ *	Wait until all tasks submitted to a group have run. The calling thread
+ *	runs queued tasks, of any group, while it waits.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Runs tasks.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Tcl_TaskGroupWait(
+    Tcl_TaskGroup group)
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    TaskGroup *groupPtr = (TaskGroup *) group;
+    size_t pending;
+    Task task;
+
+    while (1) {
+	Tcl_MutexLock(&groupPtr->mutex);
+	pending = groupPtr->pending;
+	Tcl_MutexUnlock(&groupPtr->mutex);
+	if (pending == 0) {
+	    return;
+	}
+	if (FindTask(tsdPtr, &task)) {
+	    RunTask(&task);
+	    continue;
+	}
+
+	/*
+	 * Nothing to run: the remaining tasks of the group are running in
+	 * other threads. Sleep until the last of them is done or a task is
+	 * submitted, checking both again with poolMutex held so that neither
+	 * wakeup can be missed.
+	 */
+
+	Tcl_MutexLock(&poolMutex);
+	Tcl_MutexLock(&groupPtr->mutex);
+	pending = groupPtr->pending;
+	if (pending) {
+	    groupPtr->waiting = 1;
+	}
+	Tcl_MutexUnlock(&groupPtr->mutex);
+	if (pending == 0) {
+	    Tcl_MutexUnlock(&poolMutex);
+	    return;
+	}
+	AddSleepingThreads(1);
+	if (FindTask(tsdPtr, &task)) {
+	    AddSleepingThreads(-1);
+	    Tcl_MutexUnlock(&poolMutex);
+	    RunTask(&task);
+	    continue;
+	}
+	Tcl_ConditionWait(&poolCond, &poolMutex, NULL);
+	AddSleepingThreads(-1);
+	Tcl_MutexUnlock(&poolMutex);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_GetTaskPoolSize --
+ *
+ *	Tell how many tasks the pool runs at the same time, so that callers
+ *	can split their work in about as many tasks, or a few times more.
+ *
+ * Results:
+ *	The number of worker threads of the pool, or of processors when the
+ *	pool is not started yet. 1 when the pool could not start any thread.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+Tcl_GetTaskPoolSize(void)
+{
+    int size;
+
+    Tcl_MutexLock(&poolMutex);
+    switch (poolState) {
+    case POOL_RUNNING:
+	size = numWorkers;
+	break;
+    case POOL_FAILED:
+	size = 1;
+	break;
+    default:
+	size = TclpGetNumberOfCPUs();
+	break;
+    }
+    Tcl_MutexUnlock(&poolMutex);
+    return size;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TaskStringCopy --
+ *
+ *	Copy the string of a value into memory allocated with Tcl_Alloc, to
+ *	hand it to another thread.
+ *
+ * Results:
+ *	The copy, with its length stored in *lengthPtr.
+ *
+ * Side effects:
+ *	Allocates memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static char *
+TaskStringCopy(
+    Tcl_Obj *objPtr,
+    Tcl_Size *lengthPtr)
+{
+    Tcl_Size length;
+    const char *bytes = Tcl_GetStringFromObj(objPtr, &length);
+    char *copy = (char *) Tcl_Alloc(length + 1);
+
+    memcpy(copy, bytes, length + 1);
+    *lengthPtr = length;
+    return copy;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MapTask --
+ *
+ *	Task that evaluates [apply $lambda $item] for the items of a [pmap]
+ *	job, taking chunks of them until none is left, in an interpreter
+ *	created for the task. The interpreter has the built-in commands only:
+ *	Tcl_Init is not called on it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Stores the results in the job. On error, records the error unless an
+ *	earlier item failed already; items after the failed one are not
+ *	evaluated. When run in the thread of the calling interpreter and that
+ *	interpreter has been canceled, stops the job.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+MapTask(
+    void *clientData)		/* The MapJob. */
+{
+    MapJob *jobPtr = (MapJob *) clientData;
+    int inCaller = (Tcl_GetCurrentThread() == jobPtr->thread);
+    Tcl_Interp *interp = NULL;
+    Tcl_Obj *objv[3];
+    Tcl_Size i, first, last, length;
+    int code, stop;
+
+    while (1) {
+	/*
+	 * The cancellation of the calling interpreter is delivered to its
+	 * thread, which sees it while it evaluates items as well.
+	 */
+
+	Tcl_MutexLock(&jobPtr->mutex);
+	if (inCaller && TclCanceled((Interp *) jobPtr->interp)) {
+	    jobPtr->canceled = 1;
+	}
+	first = jobPtr->nextItem;
+	last = first + jobPtr->chunkSize;
+	if (last > jobPtr->numItems) {
+	    last = jobPtr->numItems;
+	}
+	stop = jobPtr->canceled || (first >= last)
+		|| (first > jobPtr->errorIndex);
+	if (!stop) {
+	    jobPtr->nextItem = last;
+	}
+	Tcl_MutexUnlock(&jobPtr->mutex);
+	if (stop) {
+	    break;
+	}
+
+	if (interp == NULL) {
+	    interp = Tcl_CreateInterp();
+	    TclNewLiteralStringObj(objv[0], "::apply");
+	    objv[1] = Tcl_NewStringObj(jobPtr->lambda, jobPtr->lambdaLength);
+	    Tcl_IncrRefCount(objv[0]);
+	    Tcl_IncrRefCount(objv[1]);
+	}
+
+	for (i = first; i < last; i++) {
+	    Tcl_MutexLock(&jobPtr->mutex);
+	    if (inCaller && TclCanceled((Interp *) jobPtr->interp)) {
+		jobPtr->canceled = 1;
+	    }
+	    stop = jobPtr->canceled || (i > jobPtr->errorIndex);
+	    Tcl_MutexUnlock(&jobPtr->mutex);
+	    if (stop) {
+		break;
+	    }
+
+	    objv[2] = Tcl_NewStringObj(jobPtr->items[i],
+		    jobPtr->itemLengths[i]);
+	    Tcl_IncrRefCount(objv[2]);
+	    code = Tcl_EvalObjv(interp, 3, objv, TCL_EVAL_GLOBAL);
+	    Tcl_DecrRefCount(objv[2]);
+
+	    if (code == TCL_OK) {
+		jobPtr->results[i] = TaskStringCopy(Tcl_GetObjResult(interp),
+			&jobPtr->resultLengths[i]);
+		continue;
+	    }
+
+	    Tcl_MutexLock(&jobPtr->mutex);
+	    if (i < jobPtr->errorIndex) {
+		Tcl_Obj *optionsObj = Tcl_GetReturnOptions(interp, code);
+
+		if (jobPtr->errorMessage != NULL) {
+		    Tcl_Free(jobPtr->errorMessage);
+		    Tcl_Free(jobPtr->errorOptions);
+		}
+		jobPtr->errorIndex = i;
+		jobPtr->errorMessage = TaskStringCopy(
+			Tcl_GetObjResult(interp), &length);
+		jobPtr->errorOptions = TaskStringCopy(optionsObj, &length);
+		Tcl_DecrRefCount(optionsObj);
+	    }
+	    Tcl_MutexUnlock(&jobPtr->mutex);
+	    break;
+	}
+    }
+
+    if (interp != NULL) {
+	Tcl_DecrRefCount(objv[0]);
+	Tcl_DecrRefCount(objv[1]);
+	Tcl_DeleteInterp(interp);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclPMapObjCmd --
+ *
+ *	This function is invoked to process the Tcl "::tcl::unsupported::pmap"
+ *	(internal, unsupported) command, which maps a list through a lambda
+ *	like [lmap], with the items evaluated in parallel by the task pool.
+ *
+ * Usage:
+ *	::tcl::unsupported::pmap lambda list
+ *
+ *	Returns the list of the results of [apply $lambda $item] for each item
+ *	of the list, in order. The lambda runs in interpreters created for the
+ *	call, which have only the built-in commands; an interpreter may
+ *	evaluate several items in turn, so the lambda should only compute its
+ *	result from its argument. If it fails for any item, the error of the
+ *	first such item is returned.
+ *
+ *	The interpreters of the lambda are neither safe nor limited, so
+ *	[pmap] is refused in safe interpreters and in interpreters that have
+ *	a limit set.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Runs tasks in the task pool.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclPMapObjCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Size objc,		/* Number of arguments. */
+    Tcl_Obj *const *objv)	/* Argument objects. */
+{
+    MapJob job;
+    Tcl_TaskGroup group;
+    Tcl_Obj **itemObjs, **resultObjs;
+    Tcl_Size i, numItems, numChunks, numTasks;
+    int code = TCL_OK;
+
+    if (objc != 3) {
+	Tcl_WrongNumArgs(interp, 1, objv, "lambda list");
+	return TCL_ERROR;
+    }
+    if (Tcl_IsSafe(interp)) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"pmap cannot be used in a safe interpreter", -1));
+	Tcl_SetErrorCode(interp, "TCL", "OPERATION", "PMAP", "SAFE",
+		(char *)NULL);
+	return TCL_ERROR;
+    }
+    if (((Interp *) interp)->limit.active) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"pmap cannot be used in a limited interpreter", -1));
+	Tcl_SetErrorCode(interp, "TCL", "OPERATION", "PMAP", "LIMITED",
+		(char *)NULL);
+	return TCL_ERROR;
+    }
+    if (TclListObjGetElements(interp, objv[2], &numItems,
+	    &itemObjs) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (numItems == 0) {
+	return TCL_OK;
+    }
+
+    /*
+     * Take all the strings the tasks read in this thread, before any of them
+     * runs. The list is not shared with the tasks, so it cannot be changed
+     * under them.
+     */
+
+    Tcl_IncrRefCount(objv[2]);
+    job.interp = interp;
+    job.thread = Tcl_GetCurrentThread();
+    job.lambda = Tcl_GetStringFromObj(objv[1], &job.lambdaLength);
+    job.items = (const char **) Tcl_Alloc(numItems * sizeof(const char *));
+    job.itemLengths = (Tcl_Size *) Tcl_Alloc(numItems * sizeof(Tcl_Size));
+    job.results = (char **) Tcl_Alloc(numItems * sizeof(char *));
+    job.resultLengths = (Tcl_Size *) Tcl_Alloc(numItems * sizeof(Tcl_Size));
+    for (i = 0; i < numItems; i++) {
+	job.items[i] = Tcl_GetStringFromObj(itemObjs[i], &job.itemLengths[i]);
+	job.results[i] = NULL;
+    }
+    job.numItems = numItems;
+    job.mutex = NULL;
+    job.nextItem = 0;
+    job.errorIndex = numItems;
+    job.canceled = 0;
+    job.errorMessage = NULL;
+    job.errorOptions = NULL;
+
+    /*
+     * One task per thread of the pool, each with an interpreter of its own,
+     * taking the items in chunks.
+     */
+
+    numTasks = (Tcl_Size) Tcl_GetTaskPoolSize();
+    numChunks = numTasks * CHUNKS_PER_THREAD;
+    if (numChunks > numItems) {
+	numChunks = numItems;
+    }
+    if (numTasks > numChunks) {
+	numTasks = numChunks;
+    }
+    job.chunkSize = (numItems + numChunks - 1) / numChunks;
+    group = Tcl_CreateTaskGroup();
+    for (i = 0; i < numTasks; i++) {
+	Tcl_TaskPoolSubmit(group, MapTask, &job);
+    }
+    Tcl_DeleteTaskGroup(group);
+
+    if (job.canceled) {
+	if (job.errorMessage != NULL) {
+	    Tcl_Free(job.errorMessage);
+	    Tcl_Free(job.errorOptions);
+	    job.errorMessage = NULL;
+	}
+	Tcl_Canceled(interp, TCL_LEAVE_ERR_MSG);
+	code = TCL_ERROR;
+    } else if (job.errorMessage != NULL) {
+	Tcl_Obj *optionsObj = Tcl_NewStringObj(job.errorOptions, -1);
+
+	Tcl_IncrRefCount(optionsObj);
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(job.errorMessage, -1));
+	code = Tcl_SetReturnOptions(interp, optionsObj);
+	Tcl_DecrRefCount(optionsObj);
+	Tcl_AppendObjToErrorInfo(interp, Tcl_ObjPrintf(
+		"\n    (\"pmap\" item %" TCL_SIZE_MODIFIER "d)", job.errorIndex));
+	Tcl_Free(job.errorMessage);
+	Tcl_Free(job.errorOptions);
+    }
+
+    /*
+     * The copies of the results become the string representations of the
+     * elements of the result, without another copy.
+     */
+
+    if (code == TCL_OK) {
+	resultObjs = (Tcl_Obj **) Tcl_Alloc(numItems * sizeof(Tcl_Obj *));
+	for (i = 0; i < numItems; i++) {
+	    TclNewObj(resultObjs[i]);
+	    resultObjs[i]->bytes = job.results[i];
+	    resultObjs[i]->length = job.resultLengths[i];
+	}
+	Tcl_SetObjResult(interp, Tcl_NewListObj(numItems, resultObjs));
+	Tcl_Free(resultObjs);
+    } else {
+	for (i = 0; i < numItems; i++) {
+	    if (job.results[i] != NULL) {
+		Tcl_Free(job.results[i]);
+	    }
+	}
+    }
+
+    Tcl_MutexFinalize(&job.mutex);
+    Tcl_Free(job.items);
+    Tcl_Free((void *) job.itemLengths);
+    Tcl_Free(job.results);
+    Tcl_Free((void *) job.resultLengths);
+    Tcl_DecrRefCount(objv[2]);
+    return code;
+}
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 4
+ * fill-column: 78
+ * End:
+ */
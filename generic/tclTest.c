@@ -23,6 +23,7 @@
 #endif
 #define TCLBOOLWARNING(boolPtr) /* needed here because we compile with -Wc++-compat */
 #include "tclInt.h"
+#include "tclCompile.h"
 #include "tclOO.h"
 #include <math.h>
 #include <assert.h>
@@ -337,6 +338,7 @@ static Tcl_ObjCmdProc2	TestGetUniCharCmd;
 static Tcl_ObjCmdProc2	TestFindFirstCmd;
 static Tcl_ObjCmdProc2	TestFindLastCmd;
 static Tcl_ObjCmdProc2	TestHashSystemHashCmd;
+static Tcl_ObjCmdProc2	TestHashSearchCmd;
 static Tcl_ObjCmdProc2	TestGetIntForIndexCmd;
 static Tcl_ObjCmdProc2	TestLutilCmd;
 static Tcl_NRPostProc	NREUnwind_callback;
@@ -347,6 +349,9 @@ static Tcl_ObjCmdProc2	TestInterpResolverCmd;
 static Tcl_ObjCmdProc2	TestcpuidCmd;
 #endif
 static Tcl_ObjCmdProc2	TestApplyLambdaCmd;
+static Tcl_ObjCmdProc2	TestSharedCodeCmd;
+static Tcl_ObjCmdProc2	TestTaskPoolCmd;
+static Tcl_TaskProc	TestTaskProc;
 #ifdef _WIN32
 static Tcl_ObjCmdProc2	TestHandleCountCmd;
 static Tcl_ObjCmdProc2	TestAppVerifierPresentCmd;
@@ -642,6 +647,8 @@ Tcltest_Init(
 	    NULL, NULL);
     Tcl_CreateObjCommand2(interp, "testhashsystemhash",
 	    TestHashSystemHashCmd, NULL, NULL);
+    Tcl_CreateObjCommand2(interp, "testhashsearch",
+	    TestHashSearchCmd, NULL, NULL);
     Tcl_CreateObjCommand2(interp, "testgetassocdata", TestgetassocdataCmd,
 	    NULL, NULL);
     Tcl_CreateObjCommand2(interp, "testgetint", TestgetintCmd,
@@ -738,6 +745,10 @@ Tcltest_Init(
 	    NULL, NULL);
     Tcl_CreateObjCommand2(interp, "testapplylambda", TestApplyLambdaCmd,
 	    NULL, NULL);
+    Tcl_CreateObjCommand2(interp, "testsharedcode", TestSharedCodeCmd,
+	    NULL, NULL);
+    Tcl_CreateObjCommand2(interp, "testtaskpool", TestTaskPoolCmd,
+	    NULL, NULL);
     Tcl_CreateObjCommand2(interp, "testlutil", TestLutilCmd,
 	    NULL, NULL);
     Tcl_CreateObjCommand2(interp, "testutftonormalized",
@@ -8343,6 +8354,71 @@ TestHashSystemHashCmd(
     return TCL_OK;
 }
 
+/*
+ * Used to check that a search of a table with string keys returns each entry
+ * once, even when keys are looked up in the second half of it.
+ */
+
+static int
+TestHashSearchCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,
+    Tcl_Size objc,
+    Tcl_Obj *const *objv)
+{
+    Tcl_HashTable hash;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    char key[TCL_INTEGER_SPACE];
+    int i, isNew, limit, count = 0;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "numEntries");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIntFromObj(interp, objv[1], &limit) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    Tcl_InitHashTable(&hash, TCL_STRING_KEYS);
+    for (i=0 ; i<limit ; i++) {
+	snprintf(key, sizeof(key), "%d", i);
+	hPtr = Tcl_CreateHashEntry(&hash, key, &isNew);
+	Tcl_SetHashValue(hPtr, INT2PTR(1));
+    }
+
+    for (hPtr = Tcl_FirstHashEntry(&hash, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	if (Tcl_GetHashValue(hPtr) == NULL) {
+	    Tcl_AppendResult(interp, "entry \"", (char *)Tcl_GetHashKey(&hash,
+		    hPtr), "\" returned twice", (char *)NULL);
+	    Tcl_DeleteHashTable(&hash);
+	    return TCL_ERROR;
+	}
+	Tcl_SetHashValue(hPtr, NULL);
+	count++;
+
+	for (i=0 ; i<4 && count>limit/2 ; i++) {
+	    snprintf(key, sizeof(key), "%d", (count * 4 + i) % limit);
+	    if (Tcl_FindHashEntry(&hash, key) == NULL) {
+		Tcl_AppendResult(interp, "lookup of \"", key, "\" failed",
+			(char *)NULL);
+		Tcl_DeleteHashTable(&hash);
+		return TCL_ERROR;
+	    }
+	}
+    }
+
+    Tcl_DeleteHashTable(&hash);
+    if (count != limit) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"search returned %d of %d entries", count, limit));
+	return TCL_ERROR;
+    }
+    Tcl_AppendResult(interp, "OK", (char *)NULL);
+    return TCL_OK;
+}
+
 /*
  * Used for testing Tcl_GetInt which is no longer used directly by the
  * core very much.
@@ -9168,6 +9244,199 @@ TestApplyLambdaCmd(
     return result;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestSharedCodeCmd --
+ *
+ *	Implements the Tcl command "testsharedcode procName". Returns the
+ *	address of the code bytes of the compiled body of the procedure when
+ *	they are in a block shared between ByteCodes, and an empty result
+ *	when they are not or the body is not compiled yet.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestSharedCodeCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Size objc,		/* Number of arguments. */
+    Tcl_Obj *const *objv)	/* Arguments. */
+{
+    Proc *procPtr;
+    const Tcl_ObjInternalRep *irPtr;
+    ByteCode *codePtr;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "procName");
+	return TCL_ERROR;
+    }
+    procPtr = TclFindProc((Interp *) interp, Tcl_GetString(objv[1]));
+    if (procPtr == NULL) {
+	Tcl_AppendResult(interp, "\"", Tcl_GetString(objv[1]),
+		"\" isn't a procedure", (char *)NULL);
+	return TCL_ERROR;
+    }
+    irPtr = Tcl_FetchInternalRep(procPtr->bodyPtr,
+	    Tcl_GetObjType("bytecode"));
+    if (irPtr) {
+	codePtr = (ByteCode *) irPtr->twoPtrValue.ptr1;
+	if (codePtr->flags & TCL_BYTECODE_SHARED_CODE) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf("%p",
+		    (void *) codePtr->codeStart));
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestTaskPoolCmd --
+ *
+ *	This procedure implements the "testtaskpool" command, which tests the
+ *	C API of the task pool.
+ *
+ *	testtaskpool size
+ *		Returns the result of Tcl_GetTaskPoolSize.
+ *	testtaskpool run numTasks depth nested
+ *		Submits numTasks tasks to a group and waits for it. Each task
+ *		submits two subtasks, down to depth levels: to the same group,
+ *		or when nested is true to a group of its own that it waits
+ *		for. Returns the number of tasks that ran.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Runs tasks in the task pool.
+ *
+ *----------------------------------------------------------------------
+ */
+
+typedef struct {
+    Tcl_Mutex mutex;		/* Protects count. */
+    Tcl_Size count;		/* Number of tasks that ran. */
+    Tcl_TaskGroup group;	/* Group the tasks are submitted to. */
+} TestTaskData;
+
+typedef struct {
+    TestTaskData *dataPtr;	/* Where the task is counted. */
+    int depth;			/* Levels of subtasks left to submit. */
+    int nested;			/* Whether subtasks go to a group of their
+				 * own. */
+} TestTask;
+
+static void
+TestTaskProc(
+    void *clientData)		/* The TestTask, freed here. */
+{
+    TestTask *taskPtr = (TestTask *) clientData;
+    TestTaskData *dataPtr = taskPtr->dataPtr;
+    TestTaskData subData, *subDataPtr = dataPtr;
+    int i;
+
+    Tcl_MutexLock(&dataPtr->mutex);
+    dataPtr->count++;
+    Tcl_MutexUnlock(&dataPtr->mutex);
+
+    if (taskPtr->depth > 0) {
+	if (taskPtr->nested) {
+	    subData.mutex = NULL;
+	    subData.count = 0;
+	    subData.group = Tcl_CreateTaskGroup();
+	    subDataPtr = &subData;
+	}
+	for (i = 0; i < 2; i++) {
+	    TestTask *subPtr = (TestTask *) Tcl_Alloc(sizeof(TestTask));
+
+	    subPtr->dataPtr = subDataPtr;
+	    subPtr->depth = taskPtr->depth - 1;
+	    subPtr->nested = taskPtr->nested;
+	    Tcl_TaskPoolSubmit(subDataPtr->group, TestTaskProc, subPtr);
+	}
+	if (taskPtr->nested) {
+	    Tcl_TaskGroupWait(subData.group);
+	    Tcl_DeleteTaskGroup(subData.group);
+	    Tcl_MutexFinalize(&subData.mutex);
+	    Tcl_MutexLock(&dataPtr->mutex);
+	    dataPtr->count += subData.count;
+	    Tcl_MutexUnlock(&dataPtr->mutex);
+	}
+    }
+    Tcl_Free(taskPtr);
+}
+
+static int
+TestTaskPoolCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Size objc,		/* Number of arguments. */
+    Tcl_Obj *const *objv)	/* Arguments. */
+{
+    static const char *const subcmds[] = {
+	"run", "size", NULL
+    };
+    enum options {
+	TASKPOOL_RUN, TASKPOOL_SIZE
+    } idx;
+    TestTaskData data;
+    int i, numTasks, depth, nested;
+
+    if (objc < 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "option ?arg ...?");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], subcmds, "option", 0,
+	    &idx) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    switch (idx) {
+    case TASKPOOL_SIZE:
+	if (objc != 2) {
+	    Tcl_WrongNumArgs(interp, 2, objv, NULL);
+	    return TCL_ERROR;
+	}
+	Tcl_SetObjResult(interp, Tcl_NewWideIntObj(Tcl_GetTaskPoolSize()));
+	break;
+    case TASKPOOL_RUN:
+	if (objc != 5) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "numTasks depth nested");
+	    return TCL_ERROR;
+	}
+	if ((Tcl_GetIntFromObj(interp, objv[2], &numTasks) != TCL_OK)
+		|| (Tcl_GetIntFromObj(interp, objv[3], &depth) != TCL_OK)
+		|| (Tcl_GetBooleanFromObj(interp, objv[4], &nested) != TCL_OK)) {
+	    return TCL_ERROR;
+	}
+	data.mutex = NULL;
+	data.count = 0;
+	data.group = Tcl_CreateTaskGroup();
+	for (i = 0; i < numTasks; i++) {
+	    TestTask *taskPtr = (TestTask *) Tcl_Alloc(sizeof(TestTask));
+
+	    taskPtr->dataPtr = &data;
+	    taskPtr->depth = depth;
+	    taskPtr->nested = nested;
+	    Tcl_TaskPoolSubmit(data.group, TestTaskProc, taskPtr);
+	}
+	Tcl_TaskGroupWait(data.group);
+	Tcl_DeleteTaskGroup(data.group);
+	Tcl_MutexFinalize(&data.mutex);
+	Tcl_SetObjResult(interp, Tcl_NewWideIntObj(data.count));
+	break;
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
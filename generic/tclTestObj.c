@@ -39,6 +39,7 @@ static void		SetVarToObj(Tcl_Obj **varPtr, Tcl_Size varIndex,
 			    Tcl_Obj *objPtr);
 static Tcl_ObjCmdProc2	TestbignumobjCmd;
 static Tcl_ObjCmdProc2	TestbooleanobjCmd;
+static Tcl_ObjCmdProc2	TestdictobjCmd;
 static Tcl_ObjCmdProc2	TestdoubleobjCmd;
 static Tcl_ObjCmdProc2	TestindexobjCmd;
 static Tcl_ObjCmdProc2	TestintobjCmd;
@@ -123,6 +124,8 @@ TclObjTest_Init(
 	    NULL, NULL);
     Tcl_CreateObjCommand2(interp, "testbooleanobj", TestbooleanobjCmd,
 	    NULL, NULL);
+    Tcl_CreateObjCommand2(interp, "testdictobj", TestdictobjCmd,
+	    NULL, NULL);
     Tcl_CreateObjCommand2(interp, "testdoubleobj", TestdoubleobjCmd,
 	    NULL, NULL);
     Tcl_CreateObjCommand2(interp, "testintobj", TestintobjCmd,
@@ -441,6 +444,103 @@ TestbooleanobjCmd(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestdictobjCmd --
+ *
+ *	This function implements the "testdictobj" command. It is used to
+ *	test that the values handed out by Tcl_DictObjGet, Tcl_DictObjFirst
+ *	and Tcl_DictObjNext may be modified in place when they are not shared,
+ *	as extensions do.
+ *
+ *	testdictobj append dict key string
+ *	testdictobj appendall dict string
+ *
+ * Results:
+ *	A standard Tcl result; the modified copy of the dictionary.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestdictobjCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Size objc,		/* Number of arguments. */
+    Tcl_Obj *const *objv)	/* Argument objects. */
+{
+    static const char *const subcommands[] = {
+	"append", "appendall", NULL
+    };
+    enum options {
+	DICTOBJ_APPEND, DICTOBJ_APPENDALL
+    } cmdIndex;
+    Tcl_Obj *dictPtr, *keyPtr, *valuePtr, *stringPtr;
+    Tcl_DictSearch search;
+    int done;
+
+    if (objc < 3) {
+	Tcl_WrongNumArgs(interp, 1, objv, "option dict ?arg ...?");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], subcommands, "option", 0,
+	    &cmdIndex) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    dictPtr = Tcl_DuplicateObj(objv[2]);
+    Tcl_IncrRefCount(dictPtr);
+    switch (cmdIndex) {
+    case DICTOBJ_APPEND:
+	if (objc != 5) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "dict key string");
+	    goto error;
+	}
+	if (Tcl_DictObjGet(interp, dictPtr, objv[3], &valuePtr) != TCL_OK) {
+	    goto error;
+	}
+	if (valuePtr == NULL) {
+	    Tcl_DictObjPut(NULL, dictPtr, objv[3], objv[4]);
+	} else if (Tcl_IsShared(valuePtr)) {
+	    valuePtr = Tcl_DuplicateObj(valuePtr);
+	    Tcl_AppendObjToObj(valuePtr, objv[4]);
+	    Tcl_DictObjPut(NULL, dictPtr, objv[3], valuePtr);
+	} else {
+	    Tcl_AppendObjToObj(valuePtr, objv[4]);
+	    Tcl_InvalidateStringRep(dictPtr);
+	}
+	break;
+    case DICTOBJ_APPENDALL:
+	if (objc != 4) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "dict string");
+	    goto error;
+	}
+	stringPtr = objv[3];
+	if (Tcl_DictObjFirst(interp, dictPtr, &search, &keyPtr, &valuePtr,
+		&done) != TCL_OK) {
+	    goto error;
+	}
+	for (; !done ; Tcl_DictObjNext(&search, &keyPtr, &valuePtr, &done)) {
+	    if (!Tcl_IsShared(valuePtr)) {
+		Tcl_AppendObjToObj(valuePtr, stringPtr);
+	    }
+	}
+	Tcl_InvalidateStringRep(dictPtr);
+	break;
+    }
+    Tcl_SetObjResult(interp, dictPtr);
+    Tcl_DecrRefCount(dictPtr);
+    return TCL_OK;
+
+  error:
+    Tcl_DecrRefCount(dictPtr);
+    return TCL_ERROR;
+}
+
 /*
  *----------------------------------------------------------------------
  *
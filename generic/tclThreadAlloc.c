@@ -28,6 +28,56 @@
 #endif
 #endif
 
+/*
+ * In the sharded mode, blocks and Tcl_Obj's that a thread cache has too many
+ * of are not handed to the shared cache under a lock but pushed in batches on
+ * lock-free stacks, spread over NSHARDS shards to keep threads from
+ * contending for the same stack. Define TCL_NO_SHARDED_ALLOC to use the
+ * shared cache instead.
+ */
+
+#if !defined(TCL_NO_SHARDED_ALLOC) && defined(__GNUC__) \
+	&& defined(__ATOMIC_ACQUIRE) \
+	&& defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)
+#   define TCL_SHARDED_ALLOC 1
+#endif
+
+#ifdef TCL_SHARDED_ALLOC
+#   if !defined(_WIN32) && defined(HAVE_UNISTD_H)
+#	include <unistd.h>
+#	ifdef _POSIX_PRIORITY_SCHEDULING
+#	    include <sched.h>
+#	endif
+#   endif
+
+/*
+ * A thread waiting for another to finish popping a batch spins up to
+ * POP_SPINS times, telling the processor it is spinning, then gives up its
+ * time slice on each further try, in case the other thread was preempted.
+ */
+
+#   define POP_SPINS	100
+#   if defined(__i386__) || defined(__x86_64__)
+#	define CpuRelax()	__builtin_ia32_pause()
+#   elif defined(__aarch64__) || (defined(__arm__) && __ARM_ARCH >= 7)
+#	define CpuRelax()	__asm__ __volatile__("yield" ::: "memory")
+#   else
+#	define CpuRelax()	__asm__ __volatile__("" ::: "memory")
+#   endif
+
+static inline void
+YieldToOtherThreads(void)
+{
+#   if defined(_WIN32)
+    Sleep(0);
+#   elif defined(_POSIX_PRIORITY_SCHEDULING)
+    (void) sched_yield();
+#   else
+    Tcl_Sleep(1);
+#   endif
+}
+#endif /* TCL_SHARDED_ALLOC */
+
 /*
  * The following define the number of Tcl_Obj's to allocate/move at a time and
  * the high water mark to prune a per-thread cache. On a 32 bit system,
@@ -110,6 +160,11 @@ typedef struct Cache {
     Tcl_Obj *lastPtr;		/* Last object in this cache */
     size_t totalAssigned;	/* Total space assigned to thread */
     Bucket buckets[NBUCKETS];	/* The buckets for this thread */
+    unsigned shard;		/* Shard this thread puts its spare blocks
+				 * and objs in (sharded mode only). */
+    size_t objsHeld;		/* Number of objects, free or in use, that
+				 * the thread took from the shared list or
+				 * the system, less those it gave back. */
 } Cache;
 
 /*
@@ -124,18 +179,111 @@ static struct {
     Tcl_Mutex *lockPtr;		/* Share bucket lock. */
 } bucketInfo[NBUCKETS];
 
+#ifdef TCL_SHARDED_ALLOC
+/*
+ * A stack of batches of free blocks or Tcl_Obj's. The items of a batch are
+ * linked through their usual free list pointer; the first item of each batch
+ * also records the next batch down the stack, the last item of the batch and
+ * the number of items in it. Batches are pushed without a lock, but only one
+ * thread at a time may pop, which keeps a batch from being popped and pushed
+ * again under a popping thread (the ABA problem) without having to tag the
+ * head. The statistics are used to notice when nothing is being taken from
+ * the stack.
+ */
+
+typedef union BatchStack {
+    struct {
+	void *head;		/* Top batch. */
+	unsigned char popLock;	/* Set while a thread is popping. */
+	size_t numFree;		/* Number of items in all batches. */
+	size_t numUntrimmed;	/* Number of items pushed since the stack
+				 * was last trimmed. */
+	size_t numPops;		/* Number of batches taken by caches. */
+	size_t numPopsChecked;	/* Value of numPops when the stack was last
+				 * found to be holding too much. */
+	long long idleSince;	/* Time (in seconds) since when numPops has
+				 * been seen to stay the same, or since the
+				 * stack was last trimmed. */
+    } s;
+    unsigned char padding[64];	/* Keep each stack on its own cache line. */
+} BatchStack;
+
+/*
+ * There is a stack for each bucket and one (at index OBJSTACK) for Tcl_Obj's
+ * in each shard. Each thread cache puts its spare items in its own shard,
+ * and takes from there first.
+ */
+
+#define NSHARDS		16
+#define OBJSTACK	NBUCKETS
+
+typedef struct {
+    BatchStack stacks[NBUCKETS + 1];
+} Shard;
+
+static Shard shards[NSHARDS] __attribute__((aligned(64)));
+static unsigned nextShard = 0;
+
+/*
+ * The batch information kept in the first block of a batch, just after the
+ * Block header. The number of blocks in the batch is in its blockReqSize.
+ */
+
+typedef struct {
+    Block *nextBatch;		/* Next batch down the stack. */
+    Block *lastPtr;		/* Last block in this batch. */
+} BlockBatch;
+
+#define BLOCK_BATCH(blockPtr)	((BlockBatch *) ((blockPtr) + 1))
+#define BLOCK_NEXT_BATCH \
+    (sizeof(Block) + offsetof(BlockBatch, nextBatch))
+
+/*
+ * The first Tcl_Obj of a batch keeps the next batch in ptr2, the last object
+ * of the batch in bytes and the number of objects in length.
+ */
+
+#define OBJ_NEXT_BATCH \
+    offsetof(Tcl_Obj, internalRep.twoPtrValue.ptr2)
+
+/*
+ * Blocks at least this big have whole pages in them that can be given back
+ * to the system when they have been sitting unused in a shard for a while:
+ * when a stack holds at least TRIM_MINFREE of them and none have been taken
+ * from it for TRIM_IDLE_SECS. This is checked when more are put on the stack
+ * and when a thread of the shard waits for events.
+ */
+
+#define TRIM_MINSIZE	8192
+#define TRIM_MINFREE	16
+#define TRIM_IDLE_SECS	1
+#endif /* TCL_SHARDED_ALLOC */
+
 /*
  * Static functions defined in this file.
  */
 
 static Cache *	GetCache(void);
+#ifdef TCL_SHARDED_ALLOC
+static void	PushBatch(BatchStack *stackPtr, void *batchPtr,
+		    size_t numItems, size_t nextOffset);
+static void *	PopBatch(BatchStack *stackPtr, size_t nextOffset);
+static void *	TakeBatch(Cache *cachePtr, int stack, size_t nextOffset,
+		    BatchStack **stackPtrPtr);
+static void	TrimBlocks(BatchStack *stackPtr, int bucket);
+static int	CheckTrim(BatchStack *stackPtr, int bucket,
+		    long long now);
+#else
 static void	LockBucket(Cache *cachePtr, int bucket);
 static void	UnlockBucket(Cache *cachePtr, int bucket);
+#endif
 static void	PutBlocks(Cache *cachePtr, int bucket, size_t numMove);
 static int	GetBlocks(Cache *cachePtr, int bucket);
 static Block *	Ptr2Block(void *ptr);
 static void *	Block2Ptr(Block *blockPtr, int bucket, size_t reqSize);
+#ifndef TCL_SHARDED_ALLOC
 static void	MoveObjs(Cache *fromPtr, Cache *toPtr, size_t numMove);
+#endif
 static void	PutObjs(Cache *fromPtr, size_t numMove);
 
 /*
@@ -218,6 +366,9 @@ GetCache(void)
 	Tcl_MutexLock(listLockPtr);
 	cachePtr->nextPtr = firstCachePtr;
 	firstCachePtr = cachePtr;
+#ifdef TCL_SHARDED_ALLOC
+	cachePtr->shard = nextShard++ % NSHARDS;
+#endif
 	Tcl_MutexUnlock(listLockPtr);
 	cachePtr->owner = Tcl_GetCurrentThread();
 	TclpSetAllocCache(cachePtr);
@@ -522,7 +673,21 @@ TclThreadAllocObj(void)
 
     if (cachePtr->numObjects == 0) {
 	size_t numMove;
-
+#ifdef TCL_SHARDED_ALLOC
+	BatchStack *stackPtr;
+
+	objPtr = (Tcl_Obj *)TakeBatch(cachePtr, OBJSTACK, OBJ_NEXT_BATCH,
+		&stackPtr);
+	if (objPtr != NULL) {
+	    numMove = (size_t) objPtr->length;
+	    __atomic_fetch_sub(&stackPtr->s.numFree, numMove,
+		    __ATOMIC_RELAXED);
+	    cachePtr->firstObjPtr = objPtr;
+	    cachePtr->lastPtr = (Tcl_Obj *)(void *)objPtr->bytes;
+	    cachePtr->numObjects = numMove;
+	    cachePtr->objsHeld += numMove;
+	}
+#else
 	Tcl_MutexLock(objLockPtr);
 	numMove = sharedPtr->numObjects;
 	if (numMove > 0) {
@@ -532,10 +697,12 @@ TclThreadAllocObj(void)
 	    MoveObjs(sharedPtr, cachePtr, numMove);
 	}
 	Tcl_MutexUnlock(objLockPtr);
+#endif
 	if (cachePtr->numObjects == 0) {
 	    Tcl_Obj *newObjsPtr;
 
 	    cachePtr->numObjects = numMove = NOBJALLOC;
+	    cachePtr->objsHeld += numMove;
 	    newObjsPtr = (Tcl_Obj *)TclpSysAlloc(sizeof(Tcl_Obj) * numMove);
 	    if (newObjsPtr == NULL) {
 		Tcl_Panic("alloc: could not allocate %" TCL_Z_MODIFIER "u new objects", numMove);
@@ -609,6 +776,86 @@ TclThreadFreeObj(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclThreadAllocInUse --
+ *
+ *	Return the number of bytes the current thread has allocated and not
+ *	freed, counting blocks and objects. Memory allocated by one thread and
+ *	freed by another is counted against the thread that frees it, so the
+ *	result may wrap around; only the difference between two results in
+ *	the same thread is meaningful. Used to charge the memory limit of
+ *	interpreters (see tclInterp.c).
+ *
+ * Results:
+ *	Byte count.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+size_t
+TclThreadAllocInUse(void)
+{
+    Cache *cachePtr;
+    size_t inUse;
+    unsigned int n;
+
+    GETCACHE(cachePtr);
+    inUse = cachePtr->totalAssigned
+	    + (cachePtr->objsHeld - cachePtr->numObjects) * sizeof(Tcl_Obj);
+    for (n = 0; n < NBUCKETS; ++n) {
+	inUse += cachePtr->buckets[n].totalAssigned;
+    }
+    return inUse;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclThreadAllocIdle --
+ *
+ *	Called by the notifier when the current thread is about to wait for
+ *	events. Big blocks that have been left unused in the thread's shard
+ *	are only given back to the system once they have sat there for a
+ *	while, which is checked when more are put in; a thread that goes idle
+ *	puts no more in, so it checks here instead, and asks to be woken up
+ *	to check again if it has to wait longer for that.
+ *
+ * Results:
+ *	The number of microseconds after which to call this again, or -1 if
+ *	there is no need.
+ *
+ * Side effects:
+ *	May give pages back to the system.
+ *
+ *----------------------------------------------------------------------
+ */
+
+long long
+TclThreadAllocIdle(void)
+{
+#ifdef TCL_SHARDED_ALLOC
+    Cache *cachePtr;
+    Tcl_Time now;
+    unsigned int bucket;
+    int pending = 0;
+
+    GETCACHE(cachePtr);
+    Tcl_GetTime(&now);
+    for (bucket = 0; bucket < NBUCKETS; ++bucket) {
+	pending |= CheckTrim(&shards[cachePtr->shard].stacks[bucket],
+		bucket, now.sec);
+    }
+    return pending ? TRIM_IDLE_SECS * 1000000LL : -1;
+#else
+    return -1;
+#endif
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -644,10 +891,22 @@ Tcl_GetMemoryInfo(
 	    Tcl_DStringAppendElement(dsPtr, buf);
 	}
 	for (n = 0; n < NBUCKETS; ++n) {
+	    size_t numFree = cachePtr->buckets[n].numFree;
+
+#ifdef TCL_SHARDED_ALLOC
+	    if (cachePtr == sharedPtr) {
+		unsigned i;
+
+		for (i = 0; i < NSHARDS; i++) {
+		    numFree += __atomic_load_n(
+			    &shards[i].stacks[n].s.numFree, __ATOMIC_RELAXED);
+		}
+	    }
+#endif
 	    snprintf(buf, sizeof(buf), "%" TCL_Z_MODIFIER "u %" TCL_Z_MODIFIER "u %" TCL_Z_MODIFIER "u %"
 		    TCL_Z_MODIFIER "u %" TCL_Z_MODIFIER "u %" TCL_Z_MODIFIER "u",
 		    bucketInfo[n].blockSize,
-		    cachePtr->buckets[n].numFree,
+		    numFree,
 		    cachePtr->buckets[n].numRemoves,
 		    cachePtr->buckets[n].numInserts,
 		    cachePtr->buckets[n].totalAssigned,
@@ -660,6 +919,7 @@ Tcl_GetMemoryInfo(
     Tcl_MutexUnlock(listLockPtr);
 }
 
+#ifndef TCL_SHARDED_ALLOC
 /*
  *----------------------------------------------------------------------
  *
@@ -686,7 +946,9 @@ MoveObjs(
     Tcl_Obj *fromFirstObjPtr = objPtr;
 
     toPtr->numObjects += numMove;
+    toPtr->objsHeld += numMove;
     fromPtr->numObjects -= numMove;
+    fromPtr->objsHeld -= numMove;
 
     /*
      * Find the last object to be moved; set the next one (the first one not
@@ -707,6 +969,7 @@ MoveObjs(
     objPtr->internalRep.twoPtrValue.ptr1 = toPtr->firstObjPtr; /* NULL */
     toPtr->firstObjPtr = fromFirstObjPtr;
 }
+#endif /* !TCL_SHARDED_ALLOC */
 
 /*
  *----------------------------------------------------------------------
@@ -733,6 +996,7 @@ PutObjs(
     Tcl_Obj *firstPtr, *lastPtr = NULL;
 
     fromPtr->numObjects = keep;
+    fromPtr->objsHeld -= numMove;
     firstPtr = fromPtr->firstObjPtr;
     if (keep == 0) {
 	fromPtr->firstObjPtr = NULL;
@@ -744,6 +1008,16 @@ PutObjs(
 	lastPtr->internalRep.twoPtrValue.ptr1 = NULL;
     }
 
+#ifdef TCL_SHARDED_ALLOC
+    /*
+     * Push all objects as a batch on the stack of this thread's shard.
+     */
+
+    firstPtr->bytes = (char *) fromPtr->lastPtr;
+    firstPtr->length = (Tcl_Size) numMove;
+    PushBatch(&shards[fromPtr->shard].stacks[OBJSTACK], firstPtr, numMove,
+	    OBJ_NEXT_BATCH);
+#else
     /*
      * Move all objects as a block - they are already linked to each other, we
      * just have to update the first and last.
@@ -757,6 +1031,7 @@ PutObjs(
     }
     sharedPtr->numObjects += numMove;
     Tcl_MutexUnlock(objLockPtr);
+#endif
 
     fromPtr->lastPtr = lastPtr;
 }
@@ -816,6 +1091,245 @@ Ptr2Block(
     return blockPtr;
 }
 
+#ifdef TCL_SHARDED_ALLOC
+/*
+ *----------------------------------------------------------------------
+ *
+ * PushBatch, PopBatch --
+ *
+ *	Push a batch of blocks or Tcl_Obj's on a stack, or pop one off. The
+ *	location of the link to the next batch in the first item of a batch is
+ *	given by nextOffset. PushBatch updates the count of items on the
+ *	stack, but the caller of PopBatch has to do that (as only it knows
+ *	where to find the size of the batch).
+ *
+ * Results:
+ *	PopBatch returns the first item of the batch, or NULL if the stack is
+ *	empty.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PushBatch(
+    BatchStack *stackPtr,
+    void *batchPtr,
+    size_t numItems,
+    size_t nextOffset)
+{
+    void **nextPtrPtr = (void **) ((char *) batchPtr + nextOffset);
+    void *oldHead;
+
+    oldHead = __atomic_load_n(&stackPtr->s.head, __ATOMIC_RELAXED);
+    do {
+	__atomic_store_n(nextPtrPtr, oldHead, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&stackPtr->s.head, &oldHead,
+	    batchPtr, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_fetch_add(&stackPtr->s.numFree, numItems, __ATOMIC_RELAXED);
+}
+
+static void *
+PopBatch(
+    BatchStack *stackPtr,
+    size_t nextOffset)
+{
+    void *batchPtr, *nextPtr;
+    int numSpins = 0;
+
+    if (__atomic_load_n(&stackPtr->s.head, __ATOMIC_RELAXED) == NULL) {
+	return NULL;
+    }
+    while (__atomic_test_and_set(&stackPtr->s.popLock, __ATOMIC_ACQUIRE)) {
+	while (__atomic_load_n(&stackPtr->s.popLock, __ATOMIC_RELAXED)) {
+	    /*
+	     * Another thread is popping; it only takes a few instructions
+	     * unless it has lost the processor.
+	     */
+
+	    if (numSpins < POP_SPINS) {
+		numSpins++;
+		CpuRelax();
+	    } else {
+		YieldToOtherThreads();
+	    }
+	}
+    }
+
+    /*
+     * With pops excluded, the top batch stays on the stack until the head is
+     * updated here, so its link can be read safely. The update only fails
+     * when another batch has been pushed meanwhile.
+     */
+
+    batchPtr = __atomic_load_n(&stackPtr->s.head, __ATOMIC_ACQUIRE);
+    while (batchPtr != NULL) {
+	nextPtr = __atomic_load_n((void **) ((char *) batchPtr + nextOffset),
+		__ATOMIC_RELAXED);
+	if (__atomic_compare_exchange_n(&stackPtr->s.head, &batchPtr,
+		nextPtr, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+	    break;
+	}
+    }
+    __atomic_clear(&stackPtr->s.popLock, __ATOMIC_RELEASE);
+    return batchPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TakeBatch --
+ *
+ *	Get a batch of blocks (for the bucket given by stack) or Tcl_Obj's
+ *	(when stack is OBJSTACK) for a cache, trying the cache's own shard
+ *	first and then the others.
+ *
+ * Results:
+ *	The first item of the batch, or NULL if all shards are out of them.
+ *	The stack the batch came from is stored in *stackPtrPtr, for the
+ *	caller to update the count of items on it.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void *
+TakeBatch(
+    Cache *cachePtr,
+    int stack,
+    size_t nextOffset,
+    BatchStack **stackPtrPtr)
+{
+    unsigned i;
+
+    for (i = 0; i < NSHARDS; i++) {
+	BatchStack *stackPtr =
+		&shards[(cachePtr->shard + i) % NSHARDS].stacks[stack];
+	void *batchPtr = PopBatch(stackPtr, nextOffset);
+
+	if (batchPtr != NULL) {
+	    __atomic_fetch_add(&stackPtr->s.numPops, 1, __ATOMIC_RELAXED);
+	    *stackPtrPtr = stackPtr;
+	    return batchPtr;
+	}
+    }
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TrimBlocks --
+ *
+ *	Give the pages inside the free blocks on a stack back to the system.
+ *	The blocks stay on the stack; their pages are supplied afresh when
+ *	they are next used.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The contents of the blocks after their batch information are lost.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TrimBlocks(
+    BatchStack *stackPtr,
+    int bucket)
+{
+    Block *batchPtr, *blockPtr, *trimmedPtr = NULL;
+    size_t numItems, numTrimmed = 0;
+    size_t limit = __atomic_load_n(&stackPtr->s.numFree, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&stackPtr->s.numUntrimmed, 0, __ATOMIC_RELAXED);
+
+    /*
+     * Take the batches off the stack while working on them, so that no other
+     * thread can be using them. Stop after the number that were there at the
+     * start, in case others keep pushing more.
+     */
+
+    while (numTrimmed < limit
+	    && (batchPtr = (Block *)PopBatch(stackPtr, BLOCK_NEXT_BATCH))) {
+	numItems = batchPtr->blockReqSize;
+	__atomic_fetch_sub(&stackPtr->s.numFree, numItems, __ATOMIC_RELAXED);
+	for (blockPtr = batchPtr; blockPtr != NULL;
+		blockPtr = blockPtr->nextBlock) {
+	    TclpReleaseAllocPages(BLOCK_BATCH(blockPtr) + 1,
+		    bucketInfo[bucket].blockSize - sizeof(Block)
+		    - sizeof(BlockBatch));
+	}
+	BLOCK_BATCH(batchPtr)->nextBatch = trimmedPtr;
+	trimmedPtr = batchPtr;
+	numTrimmed += numItems;
+    }
+
+    while (trimmedPtr != NULL) {
+	batchPtr = trimmedPtr;
+	trimmedPtr = BLOCK_BATCH(batchPtr)->nextBatch;
+	PushBatch(stackPtr, batchPtr, batchPtr->blockReqSize,
+		BLOCK_NEXT_BATCH);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CheckTrim --
+ *
+ *	Trim a stack of big blocks if it holds enough of them that have not
+ *	been trimmed yet, and nothing has been taken from it since it was
+ *	first seen that way at least TRIM_IDLE_SECS ago. The time now is given
+ *	in seconds.
+ *
+ * Results:
+ *	1 if the stack holds blocks that are waiting to be trimmed when it has
+ *	been idle long enough, 0 otherwise.
+ *
+ * Side effects:
+ *	May give pages back to the system.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CheckTrim(
+    BatchStack *stackPtr,
+    int bucket,
+    long long now)
+{
+    size_t numPops;
+    long long idleSince;
+
+    if (bucketInfo[bucket].blockSize < TRIM_MINSIZE
+	    || __atomic_load_n(&stackPtr->s.numFree, __ATOMIC_RELAXED)
+		    < TRIM_MINFREE
+	    || __atomic_load_n(&stackPtr->s.numUntrimmed, __ATOMIC_RELAXED)
+		    == 0) {
+	return 0;
+    }
+
+    numPops = __atomic_load_n(&stackPtr->s.numPops, __ATOMIC_RELAXED);
+    idleSince = __atomic_load_n(&stackPtr->s.idleSince, __ATOMIC_RELAXED);
+    if (__atomic_exchange_n(&stackPtr->s.numPopsChecked, numPops,
+	    __ATOMIC_RELAXED) != numPops || idleSince == 0) {
+	__atomic_store_n(&stackPtr->s.idleSince, now, __ATOMIC_RELAXED);
+    } else if (now - idleSince >= TRIM_IDLE_SECS
+	    && __atomic_compare_exchange_n(&stackPtr->s.idleSince,
+	    &idleSince, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	TrimBlocks(stackPtr, bucket);
+	return 0;
+    }
+    return 1;
+}
+
+#else /* !TCL_SHARDED_ALLOC */
 /*
  *----------------------------------------------------------------------
  *
@@ -850,6 +1364,7 @@ UnlockBucket(
 {
     Tcl_MutexUnlock(bucketInfo[bucket].lockPtr);
 }
+#endif /* TCL_SHARDED_ALLOC */
 
 /*
  *----------------------------------------------------------------------
@@ -893,6 +1408,30 @@ PutBlocks(
 	lastPtr->nextBlock = NULL;
     }
 
+#ifdef TCL_SHARDED_ALLOC
+    /*
+     * Push the list of blocks as a batch on this thread's shard, and check
+     * whether the shard has been holding on to more of them than it needs.
+     */
+
+    {
+	BatchStack *stackPtr = &shards[cachePtr->shard].stacks[bucket];
+
+	BLOCK_BATCH(firstPtr)->lastPtr = cachePtr->buckets[bucket].lastPtr;
+	firstPtr->blockReqSize = numMove;
+	PushBatch(stackPtr, firstPtr, numMove, BLOCK_NEXT_BATCH);
+	cachePtr->buckets[bucket].numLocks++;
+
+	if (bucketInfo[bucket].blockSize >= TRIM_MINSIZE) {
+	    Tcl_Time now;
+
+	    __atomic_fetch_add(&stackPtr->s.numUntrimmed, numMove,
+		    __ATOMIC_RELAXED);
+	    Tcl_GetTime(&now);
+	    CheckTrim(stackPtr, bucket, now.sec);
+	}
+    }
+#else
     /*
      * Aquire the lock and place the list of blocks at the front of the shared
      * cache bucket.
@@ -908,6 +1447,7 @@ PutBlocks(
     }
     sharedPtr->buckets[bucket].numFree += numMove;
     UnlockBucket(cachePtr, bucket);
+#endif
 
     cachePtr->buckets[bucket].lastPtr = lastPtr;
 }
@@ -936,6 +1476,26 @@ GetBlocks(
     Block *blockPtr;
     size_t n;
 
+#ifdef TCL_SHARDED_ALLOC
+    /*
+     * First, attempt to take a batch of blocks from the shards.
+     */
+
+    if (cachePtr != sharedPtr) {
+	BatchStack *stackPtr;
+
+	blockPtr = (Block *)TakeBatch(cachePtr, bucket, BLOCK_NEXT_BATCH,
+		&stackPtr);
+	if (blockPtr != NULL) {
+	    n = blockPtr->blockReqSize;
+	    __atomic_fetch_sub(&stackPtr->s.numFree, n, __ATOMIC_RELAXED);
+	    cachePtr->buckets[bucket].firstPtr = blockPtr;
+	    cachePtr->buckets[bucket].lastPtr = BLOCK_BATCH(blockPtr)->lastPtr;
+	    cachePtr->buckets[bucket].numFree = n;
+	    cachePtr->buckets[bucket].numLocks++;
+	}
+    }
+#else
     /*
      * First, attempt to move blocks from the shared cache. Note the
      * potentially dirty read of numFree before acquiring the lock which is a
@@ -976,6 +1536,7 @@ GetBlocks(
 	}
 	UnlockBucket(cachePtr, bucket);
     }
+#endif
 
     if (cachePtr->buckets[bucket].numFree == 0) {
 	size_t size;
@@ -1149,6 +1710,52 @@ Tcl_GetMemoryInfo(
     Tcl_Panic("Tcl_GetMemoryInfo called when threaded memory allocator not in use");
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclThreadAllocInUse --
+ *
+ *	Return the number of bytes the current thread has allocated and not
+ *	freed. Without the threaded allocator this is not counted.
+ *
+ * Results:
+ *	Always 0.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+size_t
+TclThreadAllocInUse(void)
+{
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclThreadAllocIdle --
+ *
+ *	Called by the notifier when the current thread is about to wait for
+ *	events. Without the threaded allocator there is nothing to do.
+ *
+ * Results:
+ *	Always -1.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+long long
+TclThreadAllocIdle(void)
+{
+    return -1;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -14,8 +14,9 @@
 
 /*
  * For each timer callback that's pending there is one record of the following
- * type. The normal handlers (created by Tcl_CreateTimerHandler) are chained
- * together in a list sorted by time (earliest event first).
+ * type. The normal handlers (created by Tcl_CreateTimerHandler) are kept in a
+ * binary heap per queue, ordered by time (earliest event first) and, for equal
+ * times, by creation.
  */
 
 typedef struct TimerHandler {
@@ -24,8 +25,9 @@ typedef struct TimerHandler {
     void *clientData;		/* Argument to pass to proc. */
     Tcl_TimerToken token;	/* Identifies handler so it can be deleted.
 				 * NULL for [after/timer idle]. */
-    struct TimerHandler *nextPtr;
-				/* Next event in queue, or NULL for end of
+    int queue;			/* Queue of the handler, a timeHandlerType
+				 * value. */
+    Tcl_Size heapIndex;		/* Position of the handler in the heap of its
 				 * queue. */
 } TimerHandler;
 
@@ -48,6 +50,8 @@ typedef struct AfterInfo {
 				 * handler rather than as a timer handler. */
     struct AfterInfo *nextPtr;	/* Next in list of all "after" commands for
 				 * this interpreter. */
+    struct AfterInfo *prevPtr;	/* Previous in list of all "after" commands
+				 * for this interpreter. */
 } AfterInfo;
 
 /*
@@ -63,6 +67,8 @@ typedef struct AfterAssocData {
 				 * or "idle"
 				 * commands still pending for this interpreter, or
 				 * NULL if none. */
+    Tcl_HashTable idTable;	/* Maps the ids of the pending commands to
+				 * their AfterInfo. */
 } AfterAssocData;
 
 /* Associated data key used to look up the AfterAssocData for an interp. */
@@ -106,9 +112,14 @@ enum timeHandlerType {
  */
 
 typedef struct {
-    TimerHandler *firstTimerHandlerPtr[2];
-				/* [0] First event in monotonic queue. */
-				/* [1]: First event in wallclock queue. */
+    TimerHandler **timerHeap[2];/* [0]: Monotonic queue. */
+				/* [1]: Wallclock queue. */
+				/* Each queue is a binary min-heap of
+				 * handlers; element 0 fires first. */
+    Tcl_Size numTimers[2];	/* Number of handlers in each queue. */
+    Tcl_Size timerHeapSize[2];	/* Allocated size of each heap. */
+    Tcl_HashTable timerTokens;	/* Maps the tokens of all pending handlers
+				 * to their TimerHandler. */
     int lastTimerId;		/* Timer identifier of most recently created
 				 * timer. */
     int lastTimerIdQueue[2];	/* Last timer ID for each queue. This is
@@ -177,13 +188,20 @@ enum unitEnum {
  * Prototypes for functions referenced only in this file:
  */
 
+static void		AddAfterPtr(AfterAssocData *assocPtr,
+			    AfterInfo *afterPtr);
 static void		AfterCleanupProc(void *clientData,
 			    Tcl_Interp *interp);
 static void		AfterProc(void *clientData);
 static void		FreeAfterPtr(AfterInfo *afterPtr);
+static void		UnlinkAfterPtr(AfterInfo *afterPtr);
 static AfterInfo *	GetAfterEvent(AfterAssocData *assocPtr,
 			    Tcl_Obj *commandPtr);
 static ThreadSpecificData *InitTimer(void);
+static void		InsertTimerHandler(ThreadSpecificData *tsdPtr,
+			    TimerHandler *timerHandlerPtr);
+static void		RemoveTimerHandler(ThreadSpecificData *tsdPtr,
+			    TimerHandler *timerHandlerPtr);
 static void		TimerExitProc(void *clientData);
 static int		TimerHandlerEventProc(Tcl_Event *evPtr, int flags);
 static void		TimerCheckProc(void *clientData, int flags);
@@ -254,6 +272,7 @@ InitTimer(void)
 
     if (tsdPtr == NULL) {
 	tsdPtr = TCL_TSD_INIT(&dataKey);
+	Tcl_InitHashTable(&tsdPtr->timerTokens, TCL_ONE_WORD_KEYS);
 	Tcl_CreateEventSource(TimerSetupProc, TimerCheckProc, NULL);
 	Tcl_CreateThreadExitHandler(TimerExitProc, NULL);
     }
@@ -291,14 +310,224 @@ TimerExitProc(
 
 	for (int timerHandlerIndex = timerHandlerMonotonic;
 		timerHandlerIndex <=timerHandlerWallclock; timerHandlerIndex++) {
-	    TimerHandler *timerHandlerPtr =
-		    tsdPtr->firstTimerHandlerPtr[timerHandlerIndex];
-	    while (timerHandlerPtr != NULL) {
-		tsdPtr->firstTimerHandlerPtr[timerHandlerIndex] = timerHandlerPtr->nextPtr;
-		Tcl_Free(timerHandlerPtr);
-		timerHandlerPtr = tsdPtr->firstTimerHandlerPtr[timerHandlerIndex];
+	    for (Tcl_Size i = 0; i < tsdPtr->numTimers[timerHandlerIndex];
+		    i++) {
+		Tcl_Free(tsdPtr->timerHeap[timerHandlerIndex][i]);
 	    }
+	    if (tsdPtr->timerHeap[timerHandlerIndex] != NULL) {
+		Tcl_Free(tsdPtr->timerHeap[timerHandlerIndex]);
+		tsdPtr->timerHeap[timerHandlerIndex] = NULL;
+	    }
+	    tsdPtr->numTimers[timerHandlerIndex] = 0;
+	    tsdPtr->timerHeapSize[timerHandlerIndex] = 0;
+	}
+
+	/*
+	 * Leave an empty (rather than a deleted) table behind, in case some
+	 * other exit handler still creates or deletes a timer.
+	 */
+
+	Tcl_DeleteHashTable(&tsdPtr->timerTokens);
+	Tcl_InitHashTable(&tsdPtr->timerTokens, TCL_ONE_WORD_KEYS);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TimerBefore, FirstTimerHandler --
+ *
+ *	Helpers for the heaps of timer handlers. TimerBefore tells whether
+ *	one handler is to fire before another: the earlier time goes first
+ *	and, for equal times, the handler created first. FirstTimerHandler
+ *	returns the handler that fires first in a queue, or NULL if the queue
+ *	is empty.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline bool
+TimerBefore(
+    const TimerHandler *aPtr,
+    const TimerHandler *bPtr)
+{
+    if (aPtr->time != bPtr->time) {
+	return aPtr->time < bPtr->time;
+    }
+
+    /*
+     * Timer ids can wrap around, so compare their distance.
+     */
+
+    return (int) ((unsigned) PTR2INT(aPtr->token)
+	    - (unsigned) PTR2INT(bPtr->token)) < 0;
+}
+
+static inline TimerHandler *
+FirstTimerHandler(
+    ThreadSpecificData *tsdPtr,
+    int timerHandlerIndex)
+{
+    if (tsdPtr->numTimers[timerHandlerIndex] == 0) {
+	return NULL;
+    }
+    return tsdPtr->timerHeap[timerHandlerIndex][0];
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SiftUp, SiftDown --
+ *
+ *	Restore the heap order after the handler at the given position got an
+ *	earlier (SiftUp) or later (SiftDown) place in the order than its
+ *	neighbours.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Moves handlers in the heap and updates their heapIndex fields.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SiftUp(
+    TimerHandler **heap,
+    Tcl_Size i)
+{
+    TimerHandler *timerHandlerPtr = heap[i];
+
+    while (i > 0) {
+	Tcl_Size parent = (i - 1) / 2;
+
+	if (!TimerBefore(timerHandlerPtr, heap[parent])) {
+	    break;
+	}
+	heap[i] = heap[parent];
+	heap[i]->heapIndex = i;
+	i = parent;
+    }
+    heap[i] = timerHandlerPtr;
+    timerHandlerPtr->heapIndex = i;
+}
+
+static void
+SiftDown(
+    TimerHandler **heap,
+    Tcl_Size numTimers,
+    Tcl_Size i)
+{
+    TimerHandler *timerHandlerPtr = heap[i];
+
+    while (1) {
+	Tcl_Size child = 2 * i + 1;
+
+	if (child >= numTimers) {
+	    break;
+	}
+	if (child + 1 < numTimers && TimerBefore(heap[child + 1], heap[child])) {
+	    child++;
+	}
+	if (!TimerBefore(heap[child], timerHandlerPtr)) {
+	    break;
 	}
+	heap[i] = heap[child];
+	heap[i]->heapIndex = i;
+	i = child;
+    }
+    heap[i] = timerHandlerPtr;
+    timerHandlerPtr->heapIndex = i;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InsertTimerHandler --
+ *
+ *	Adds a handler to the heap of its queue and to the token table.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May grow the heap.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+InsertTimerHandler(
+    ThreadSpecificData *tsdPtr,
+    TimerHandler *timerHandlerPtr)
+{
+    int timerHandlerIndex = timerHandlerPtr->queue;
+    Tcl_Size numTimers = tsdPtr->numTimers[timerHandlerIndex];
+    Tcl_HashEntry *hPtr;
+    int isNew;
+
+    if (numTimers >= tsdPtr->timerHeapSize[timerHandlerIndex]) {
+	Tcl_Size newSize = (numTimers ? 2 * numTimers : 16);
+
+	tsdPtr->timerHeap[timerHandlerIndex] = (TimerHandler **) Tcl_Realloc(
+		tsdPtr->timerHeap[timerHandlerIndex],
+		newSize * sizeof(TimerHandler *));
+	tsdPtr->timerHeapSize[timerHandlerIndex] = newSize;
+    }
+    tsdPtr->timerHeap[timerHandlerIndex][numTimers] = timerHandlerPtr;
+    tsdPtr->numTimers[timerHandlerIndex] = numTimers + 1;
+    SiftUp(tsdPtr->timerHeap[timerHandlerIndex], numTimers);
+
+    hPtr = Tcl_CreateHashEntry(&tsdPtr->timerTokens, timerHandlerPtr->token,
+	    &isNew);
+    Tcl_SetHashValue(hPtr, timerHandlerPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoveTimerHandler --
+ *
+ *	Removes a handler from the heap of its queue and from the token
+ *	table. Does not free the handler.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RemoveTimerHandler(
+    ThreadSpecificData *tsdPtr,
+    TimerHandler *timerHandlerPtr)
+{
+    int timerHandlerIndex = timerHandlerPtr->queue;
+    TimerHandler **heap = tsdPtr->timerHeap[timerHandlerIndex];
+    Tcl_Size numTimers = --tsdPtr->numTimers[timerHandlerIndex];
+    Tcl_Size i = timerHandlerPtr->heapIndex;
+    Tcl_HashEntry *hPtr;
+
+    if (i < numTimers) {
+	/*
+	 * Fill the hole with the last handler and move that into place.
+	 */
+
+	heap[i] = heap[numTimers];
+	if (i > 0 && TimerBefore(heap[i], heap[(i - 1) / 2])) {
+	    SiftUp(heap, i);
+	} else {
+	    SiftDown(heap, numTimers, i);
+	}
+    }
+
+    hPtr = Tcl_FindHashEntry(&tsdPtr->timerTokens, timerHandlerPtr->token);
+    if (hPtr != NULL && Tcl_GetHashValue(hPtr) == timerHandlerPtr) {
+	Tcl_DeleteHashEntry(hPtr);
     }
 }
 
@@ -479,7 +708,7 @@ CreateTimerHandler(
     void *clientData,
     bool monotonic)
 {
-    TimerHandler *timerHandlerPtr, *tPtr2, *prevPtr;
+    TimerHandler *timerHandlerPtr;
     ThreadSpecificData *tsdPtr = InitTimer();
     enum timeHandlerType timerHandlerIndex = (monotonic ? timerHandlerMonotonic
 	    : timerHandlerWallclock);
@@ -495,25 +724,14 @@ CreateTimerHandler(
     tsdPtr->lastTimerId++;
     tsdPtr->lastTimerIdQueue[timerHandlerIndex] = tsdPtr->lastTimerId;
     timerHandlerPtr->token = (Tcl_TimerToken) INT2PTR(tsdPtr->lastTimerId);
+    timerHandlerPtr->queue = timerHandlerIndex;
 
     /*
-     * Add the event to the corresponding queue in the correct position
-     * (ordered by event firing time).
+     * Add the event to the corresponding queue (ordered by event firing
+     * time).
      */
 
-    tPtr2 = tsdPtr->firstTimerHandlerPtr[timerHandlerIndex];
-    for (prevPtr = NULL; tPtr2 != NULL;
-	    prevPtr = tPtr2, tPtr2 = tPtr2->nextPtr) {
-	if (timerHandlerPtr->time < tPtr2->time) {
-	    break;
-	}
-    }
-    timerHandlerPtr->nextPtr = tPtr2;
-    if (prevPtr == NULL) {
-	tsdPtr->firstTimerHandlerPtr[timerHandlerIndex] = timerHandlerPtr;
-    } else {
-	prevPtr->nextPtr = timerHandlerPtr;
-    }
+    InsertTimerHandler(tsdPtr, timerHandlerPtr);
 
     TimerSetupProc(NULL, TCL_ALL_EVENTS);
 
@@ -543,30 +761,21 @@ Tcl_DeleteTimerHandler(
     Tcl_TimerToken token)	/* Result previously returned by
 				 * Tcl_DeleteTimerHandler. */
 {
-    TimerHandler *timerHandlerPtr, *prevPtr;
+    TimerHandler *timerHandlerPtr;
+    Tcl_HashEntry *hPtr;
     ThreadSpecificData *tsdPtr = InitTimer();
 
     if (token == NULL) {
 	return;
     }
 
-    for (int timerHandlerIndex = timerHandlerMonotonic;
-	    timerHandlerIndex <= timerHandlerWallclock; timerHandlerIndex++) {
-	for (timerHandlerPtr = tsdPtr->firstTimerHandlerPtr[timerHandlerIndex], prevPtr = NULL;
-		timerHandlerPtr != NULL; prevPtr = timerHandlerPtr,
-		timerHandlerPtr = timerHandlerPtr->nextPtr) {
-	    if (timerHandlerPtr->token != token) {
-		continue;
-	    }
-	    if (prevPtr == NULL) {
-		tsdPtr->firstTimerHandlerPtr[timerHandlerIndex] = timerHandlerPtr->nextPtr;
-	    } else {
-		prevPtr->nextPtr = timerHandlerPtr->nextPtr;
-	    }
-	    Tcl_Free(timerHandlerPtr);
-	    return;
-	}
+    hPtr = Tcl_FindHashEntry(&tsdPtr->timerTokens, token);
+    if (hPtr == NULL) {
+	return;
     }
+    timerHandlerPtr = (TimerHandler *) Tcl_GetHashValue(hPtr);
+    RemoveTimerHandler(tsdPtr, timerHandlerPtr);
+    Tcl_Free(timerHandlerPtr);
 }
 
 /*
@@ -605,8 +814,8 @@ TimerSetupProc(
 
 	blockTime = 0;
     } else if ((flags & TCL_TIMER_EVENTS) &&
-	    (tsdPtr->firstTimerHandlerPtr[timerHandlerMonotonic]
-	    || tsdPtr->firstTimerHandlerPtr[timerHandlerWallclock])) {
+	    (tsdPtr->numTimers[timerHandlerMonotonic]
+	    || tsdPtr->numTimers[timerHandlerWallclock])) {
 	long long myBlockTimeUS;
 	long long blockTimeUS = LLONG_MAX;
 	bool blockTimePresent = false;
@@ -619,7 +828,7 @@ TimerSetupProc(
 		timerHandlerIndex <= timerHandlerWallclock; timerHandlerIndex++) {
 	    long long myTimeUS;
 	    TimerHandler *firstTimerHandlerPtrCur =
-		    tsdPtr->firstTimerHandlerPtr[timerHandlerIndex];
+		    FirstTimerHandler(tsdPtr, timerHandlerIndex);
 	    if (firstTimerHandlerPtrCur == NULL) {
 		continue;
 	    }
@@ -676,8 +885,8 @@ TimerCheckProc(
     ThreadSpecificData *tsdPtr = InitTimer();
 
     if ((flags & TCL_TIMER_EVENTS) &&
-	    (tsdPtr->firstTimerHandlerPtr[timerHandlerMonotonic]
-	    || tsdPtr->firstTimerHandlerPtr[timerHandlerWallclock])) {
+	    (tsdPtr->numTimers[timerHandlerMonotonic]
+	    || tsdPtr->numTimers[timerHandlerWallclock])) {
 	bool queueEvent = false;
 	/*
 	 * Compute the timeout for the next timer on one of the lists.
@@ -687,7 +896,7 @@ TimerCheckProc(
 	for (int timerHandlerIndex = timerHandlerMonotonic;
 		timerHandlerIndex <= timerHandlerWallclock; timerHandlerIndex++ ) {
 	    TimerHandler *firstTimerHandlerPtrCur =
-		    tsdPtr->firstTimerHandlerPtr[timerHandlerIndex];
+		    FirstTimerHandler(tsdPtr, timerHandlerIndex);
 	    if (firstTimerHandlerPtrCur == NULL) {
 		continue;
 	    }
@@ -777,16 +986,16 @@ TimerHandlerEventProc(
      *	  only way a new timer will even be considered runnable is if its
      *	  expiration time is within the same millisecond as the current time.
      *	  This is fairly likely on Windows, since it has a course granularity
-     *	  clock. Since timers are placed on the queue in time order with the
-     *	  most recently created handler appearing after earlier ones with the
-     *	  same expiration time, we don't have to worry about newer generation
-     *	  timers appearing before later ones.
+     *	  clock. Since timers are ordered on the queue by time and then by
+     *	  creation, the most recently created handler comes after earlier
+     *	  ones with the same expiration time, so we don't have to worry about
+     *	  newer generation timers appearing before later ones.
      */
 
     for (int timerHandlerIndex = timerHandlerMonotonic;
 	    timerHandlerIndex <= timerHandlerWallclock; timerHandlerIndex++) {
 	long long timeUS;
-	TimerHandler *timerHandlerPtr, **nextPtrPtr;
+	TimerHandler *timerHandlerPtr;
 	int currentTimerId;
 
 	if (!tsdPtr->timerPendingQueue[timerHandlerIndex]) {
@@ -808,8 +1017,7 @@ TimerHandlerEventProc(
 	    timeUS = Tcl_GetDayTime();
 	}
 	while (1) {
-	    nextPtrPtr = &tsdPtr->firstTimerHandlerPtr[timerHandlerIndex];
-	    timerHandlerPtr = tsdPtr->firstTimerHandlerPtr[timerHandlerIndex];
+	    timerHandlerPtr = FirstTimerHandler(tsdPtr, timerHandlerIndex);
 	    if (timerHandlerPtr == NULL) {
 		break;
 	    }
@@ -831,7 +1039,7 @@ TimerHandlerEventProc(
 	     * potential reentrancy problems.
 	     */
 
-	    *nextPtrPtr = timerHandlerPtr->nextPtr;
+	    RemoveTimerHandler(tsdPtr, timerHandlerPtr);
 	    timerHandlerPtr->proc(timerHandlerPtr->clientData);
 	    Tcl_Free(timerHandlerPtr);
 	}
@@ -1122,8 +1330,7 @@ Tcl_AfterObjCmd(
 	tsdPtr->afterId += 1;
 	afterPtr->token = CreateTimerHandler(wakeupUS,
 		AfterProc, afterPtr, true);
-	afterPtr->nextPtr = assocPtr->firstAfterPtr;
-	assocPtr->firstAfterPtr = afterPtr;
+	AddAfterPtr(assocPtr, afterPtr);
 	Tcl_SetObjResult(interp, Tcl_ObjPrintf("after#%d", afterPtr->id));
 	return TCL_OK;
     }
@@ -1488,7 +1695,7 @@ GetAfterEvent(
 {
     const char *cmdString;	/* Textual identifier for after event, such as
 				 * "after#6". */
-    AfterInfo *afterPtr;
+    Tcl_HashEntry *hPtr;
     int id;
     char *end;
 
@@ -1501,13 +1708,11 @@ GetAfterEvent(
     if ((end == cmdString) || (*end != 0)) {
 	return NULL;
     }
-    for (afterPtr = assocPtr->firstAfterPtr; afterPtr != NULL;
-	    afterPtr = afterPtr->nextPtr) {
-	if (afterPtr->id == id) {
-	    return afterPtr;
-	}
+    hPtr = Tcl_FindHashEntry(&assocPtr->idTable, INT2PTR(id));
+    if (hPtr == NULL) {
+	return NULL;
     }
-    return NULL;
+    return (AfterInfo *) Tcl_GetHashValue(hPtr);
 }
 
 /*
@@ -1535,7 +1740,6 @@ AfterProc(
 {
     AfterInfo *afterPtr = (AfterInfo *)clientData;
     AfterAssocData *assocPtr = afterPtr->assocPtr;
-    AfterInfo *prevPtr;
     int result;
     Tcl_Interp *interp;
 
@@ -1545,15 +1749,7 @@ AfterProc(
      * a core dump.
      */
 
-    if (assocPtr->firstAfterPtr == afterPtr) {
-	assocPtr->firstAfterPtr = afterPtr->nextPtr;
-    } else {
-	for (prevPtr = assocPtr->firstAfterPtr; prevPtr->nextPtr != afterPtr;
-		prevPtr = prevPtr->nextPtr) {
-	    /* Empty loop body. */
-	}
-	prevPtr->nextPtr = afterPtr->nextPtr;
-    }
+    UnlinkAfterPtr(afterPtr);
 
     /*
      * Execute the callback.
@@ -1597,21 +1793,73 @@ AfterProc(
 static void
 FreeAfterPtr(
     AfterInfo *afterPtr)	/* Command to be deleted. */
+{
+    UnlinkAfterPtr(afterPtr);
+    Tcl_DecrRefCount(afterPtr->commandPtr);
+    Tcl_Free(afterPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddAfterPtr, UnlinkAfterPtr --
+ *
+ *	These functions add an "after" command to, and remove one from, the
+ *	list of those that are pending and the table that maps their ids.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AddAfterPtr(
+    AfterAssocData *assocPtr,	/* The interpreter's "after" data. */
+    AfterInfo *afterPtr)	/* Command to be added. */
+{
+    Tcl_HashEntry *hPtr;
+    int isNew;
+
+    afterPtr->prevPtr = NULL;
+    afterPtr->nextPtr = assocPtr->firstAfterPtr;
+    if (assocPtr->firstAfterPtr != NULL) {
+	assocPtr->firstAfterPtr->prevPtr = afterPtr;
+    }
+    assocPtr->firstAfterPtr = afterPtr;
+    hPtr = Tcl_CreateHashEntry(&assocPtr->idTable, INT2PTR(afterPtr->id),
+	    &isNew);
+    Tcl_SetHashValue(hPtr, afterPtr);
+}
+
+static void
+UnlinkAfterPtr(
+    AfterInfo *afterPtr)	/* Command to be removed. */
 {
     AfterAssocData *assocPtr = afterPtr->assocPtr;
+    Tcl_HashEntry *hPtr;
 
-    if (assocPtr->firstAfterPtr == afterPtr) {
+    if (afterPtr->prevPtr == NULL) {
 	assocPtr->firstAfterPtr = afterPtr->nextPtr;
     } else {
-	AfterInfo *prevPtr;
-	for (prevPtr = assocPtr->firstAfterPtr; prevPtr->nextPtr != afterPtr;
-		prevPtr = prevPtr->nextPtr) {
-	    /* Empty loop body. */
-	}
-	prevPtr->nextPtr = afterPtr->nextPtr;
+	afterPtr->prevPtr->nextPtr = afterPtr->nextPtr;
+    }
+    if (afterPtr->nextPtr != NULL) {
+	afterPtr->nextPtr->prevPtr = afterPtr->prevPtr;
+    }
+
+    /*
+     * After a wrap-around of the ids, the entry may belong to a newer
+     * command with the same id.
+     */
+
+    hPtr = Tcl_FindHashEntry(&assocPtr->idTable, INT2PTR(afterPtr->id));
+    if (hPtr != NULL && Tcl_GetHashValue(hPtr) == afterPtr) {
+	Tcl_DeleteHashEntry(hPtr);
     }
-    Tcl_DecrRefCount(afterPtr->commandPtr);
-    Tcl_Free(afterPtr);
 }
 
 /*
@@ -1650,6 +1898,7 @@ AfterCleanupProc(
 	Tcl_DecrRefCount(afterPtr->commandPtr);
 	Tcl_Free(afterPtr);
     }
+    Tcl_DeleteHashTable(&assocPtr->idTable);
     Tcl_Free(assocPtr);
 }
 
@@ -1790,8 +2039,7 @@ TimerAtCmd(
     tsdPtr->afterId += 1;
     afterPtr->token = CreateTimerHandler(timeArgUS,
 	    AfterProc, afterPtr, false);
-    afterPtr->nextPtr = assocPtr->firstAfterPtr;
-    assocPtr->firstAfterPtr = afterPtr;
+    AddAfterPtr(assocPtr, afterPtr);
     Tcl_SetObjResult(interp, Tcl_ObjPrintf("after#%d", afterPtr->id));
     return TCL_OK;
 }
@@ -1900,8 +2148,7 @@ TimerInCmd(
     tsdPtr->afterId += 1;
     afterPtr->token = CreateTimerHandler(wakeupUS,
 	    AfterProc, afterPtr, true);
-    afterPtr->nextPtr = assocPtr->firstAfterPtr;
-    assocPtr->firstAfterPtr = afterPtr;
+    AddAfterPtr(assocPtr, afterPtr);
     Tcl_SetObjResult(interp, Tcl_ObjPrintf("after#%d", afterPtr->id));
     return TCL_OK;
 }
@@ -2055,6 +2302,7 @@ TimerAssocDataGet(
 	assocPtr = (AfterAssocData *)Tcl_Alloc(sizeof(AfterAssocData));
 	assocPtr->interp = interp;
 	assocPtr->firstAfterPtr = NULL;
+	Tcl_InitHashTable(&assocPtr->idTable, TCL_ONE_WORD_KEYS);
 	Tcl_SetAssocData(interp, ASSOC_KEY, AfterCleanupProc, assocPtr);
     }
     return assocPtr;
@@ -2121,11 +2369,17 @@ TimerCancelDo(
     AfterAssocData *assocPtr = TimerAssocDataGet(interp);
     Tcl_Size length;
 
+    /*
+     * Search for the after Id first, as that is a cheap lookup.
+     */
+
+    afterPtr = GetAfterEvent(assocPtr, objArg);
+
     /*
      * "after cancel" also searches for the command name
      */
 
-    if (!isTimerCancel) {
+    if (afterPtr == NULL && !isTimerCancel) {
 	command = TclGetStringFromObj(objArg, &length);
 	for (afterPtr = assocPtr->firstAfterPtr;  afterPtr != NULL;
 		afterPtr = afterPtr->nextPtr) {
@@ -2138,14 +2392,6 @@ TimerCancelDo(
 	}
     }
 
-    /*
-     * Search for the after Id
-     */
-
-    if (afterPtr == NULL) {
-	afterPtr = GetAfterEvent(assocPtr, objArg);
-    }
-
     /*
      * Delete the after event if found
      */
@@ -2225,8 +2471,7 @@ TimerIdleDo(
     afterPtr->id = tsdPtr->afterId;
     tsdPtr->afterId += 1;
     afterPtr->token = NULL;
-    afterPtr->nextPtr = assocPtr->firstAfterPtr;
-    assocPtr->firstAfterPtr = afterPtr;
+    AddAfterPtr(assocPtr, afterPtr);
     Tcl_DoWhenIdle(AfterProc, afterPtr);
     Tcl_SetObjResult(interp, Tcl_ObjPrintf("after#%d", afterPtr->id));
     return TCL_OK;
@@ -2348,41 +2593,30 @@ TimerInfoDo(
 	    Tcl_ListObjAppendElement(interp, resultListPtr,
 		    Tcl_NewStringObj("timer", -1));
 	} else {
-	    bool found = false;
 	    TimerHandler *timerHandlerPtr;
+	    Tcl_HashEntry *hPtr;
 	    ThreadSpecificData *tsdPtr = InitTimer();
 
 	    /*
-	     * Walk through the queues to find this token
+	     * Look up the handler of this token
 	     */
 
-	    for (int timerHandlerIndex = timerHandlerMonotonic;
-		    timerHandlerIndex <=timerHandlerWallclock && ! found;
-		    timerHandlerIndex++) {
-		timerHandlerPtr = tsdPtr->firstTimerHandlerPtr[timerHandlerIndex];
-		while (timerHandlerPtr != NULL) {
-		    if (timerHandlerPtr->token == afterPtr->token) {
-			Tcl_ListObjAppendElement(interp, resultListPtr,
-				Tcl_NewStringObj(
-				    (timerHandlerIndex == timerHandlerMonotonic ?
-				    "monotonic" : "wallclock"),
-				    TCL_AUTO_LENGTH));
-
-			Tcl_ListObjAppendElement(interp, resultListPtr,
-				Tcl_NewWideIntObj(timerHandlerPtr->time));
-			found = true;
-			break;
-		    }
-		}
-	    }
-
-	    if (!found) {
+	    hPtr = Tcl_FindHashEntry(&tsdPtr->timerTokens, afterPtr->token);
+	    if (hPtr == NULL) {
 		/*
 		 * Token not found -> this should not happen
 		 */
 
-		Tcl_Panic("Timer token not fount!");
+		Tcl_Panic("Timer token not found!");
 	    }
+	    timerHandlerPtr = (TimerHandler *) Tcl_GetHashValue(hPtr);
+	    Tcl_ListObjAppendElement(interp, resultListPtr,
+		    Tcl_NewStringObj(
+			(timerHandlerPtr->queue == timerHandlerMonotonic ?
+			"monotonic" : "wallclock"),
+			TCL_AUTO_LENGTH));
+	    Tcl_ListObjAppendElement(interp, resultListPtr,
+		    Tcl_NewWideIntObj(timerHandlerPtr->time));
 	}
     }
     Tcl_SetObjResult(interp, resultListPtr);
@@ -11,6 +11,7 @@
 
 #include "tclInt.h"
 #include "../utf8proc/utf8proc.h"
+#include "tclSimd.h"
 
 /*
  * Include the static character classification tables and macros.
@@ -993,6 +994,558 @@ Tcl_UtfFindLast(
     return last;
 }
 
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TclAsciiLength --
+ *
+ *	Counts the bytes at the start of a string that are ASCII characters,
+ *	testing eight bytes at a time. In a UTF-8 string each such byte is a
+ *	character of its own, and no other byte can encode an ASCII
+ *	character other than NUL.
+ *
+ * Results:
+ *	The number of leading bytes less than 0x80; numBytes if all are.
+ *
+ * Side effects:
+ *	None.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+Tcl_Size
+TclAsciiLength(
+    const char *bytes,		/* The bytes to check. */
+    Tcl_Size numBytes)		/* Number of bytes to check. */
+{
+    const char *p = bytes, *end = bytes + numBytes;
+    uint64_t word;
+
+    while (end - p >= 8) {
+	memcpy(&word, p, sizeof(word));
+	if (word & UINT64_C(0x8080808080808080)) {
+	    break;
+	}
+	p += 8;
+    }
+    while (p < end && UCHAR(*p) < 0x80) {
+	p++;
+    }
+    return p - bytes;
+}
+
+/*
+ * The kernels that search for needles shorter than HORSPOOL_MIN_NEEDLE and
+ * for sets of bytes, as chosen by TclInitUtfKernels() for the processor.
+ * The vector kernels for short needles compare the first and the last byte
+ * of the needle at 16 or 32 positions at once, and only compare the rest
+ * where both match.
+ */
+
+#define HORSPOOL_MIN_NEEDLE 16
+
+typedef const char *(MemSearchProc)(const char *haystack,
+			    Tcl_Size numHaystack, const char *needle,
+			    Tcl_Size numNeedle);
+typedef const char *(MemSearchSetProc)(const char *bytes,
+			    Tcl_Size numBytes, const TclByteSet *setPtr);
+
+static MemSearchProc		MemSearchGeneric;
+static MemSearchProc		MemSearchLastGeneric;
+static MemSearchSetProc		MemSearchSetGeneric;
+#ifdef HAVE_SSE2_KERNELS
+static MemSearchProc		MemSearchSse2;
+static MemSearchProc		MemSearchLastSse2;
+static MemSearchSetProc		MemSearchSetSse2;
+static MemSearchProc *memSearchProc = MemSearchSse2;
+static MemSearchProc *memSearchLastProc = MemSearchLastSse2;
+static MemSearchSetProc *memSearchSetProc = MemSearchSetSse2;
+#else
+static MemSearchProc *memSearchProc = MemSearchGeneric;
+static MemSearchProc *memSearchLastProc = MemSearchLastGeneric;
+static MemSearchSetProc *memSearchSetProc = MemSearchSetGeneric;
+#endif
+#ifdef HAVE_AVX2_KERNELS
+static MemSearchProc		MemSearchAvx2;
+static MemSearchSetProc		MemSearchSetAvx2;
+#endif
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TclMemSearch, TclMemSearchLast --
+ *
+ *	Find the first or the last occurrence of a sequence of bytes in
+ *	another. These are the search kernels of [string first], [string
+ *	last] and [string map]. Single bytes are searched for with memchr().
+ *	Short needles are searched for by the vector kernels where the
+ *	processor has them, or else with memchr() on their first byte. Long
+ *	needles are searched for with the Boyer-Moore-Horspool algorithm,
+ *	which skips ahead by up to the length of the needle after each
+ *	mismatch.
+ *
+ * Results:
+ *	Pointer to the start of the match in haystack, or NULL if there is
+ *	none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+const char *
+TclMemSearch(
+    const char *haystack,	/* The bytes to search. */
+    Tcl_Size numHaystack,	/* Number of bytes in haystack. */
+    const char *needle,		/* The bytes to search for. */
+    Tcl_Size numNeedle)		/* Number of bytes in needle, > 0. */
+{
+    const char *p, *last;
+    Tcl_Size skip[256], i;
+    unsigned char c, lastByte;
+
+    if (numNeedle > numHaystack) {
+	return NULL;
+    }
+    if (numNeedle == 1) {
+	return (const char *)memchr(haystack, needle[0], numHaystack);
+    }
+    if (numNeedle < HORSPOOL_MIN_NEEDLE) {
+	return memSearchProc(haystack, numHaystack, needle, numNeedle);
+    }
+
+    last = haystack + numHaystack - numNeedle;
+    lastByte = UCHAR(needle[numNeedle - 1]);
+    for (i = 0; i < 256; i++) {
+	skip[i] = numNeedle;
+    }
+    for (i = 0; i < numNeedle - 1; i++) {
+	skip[UCHAR(needle[i])] = numNeedle - 1 - i;
+    }
+    for (p = haystack; p <= last; p += skip[c]) {
+	c = UCHAR(p[numNeedle - 1]);
+	if (c == lastByte && memcmp(p, needle, numNeedle - 1) == 0) {
+	    return p;
+	}
+    }
+    return NULL;
+}
+
+const char *
+TclMemSearchLast(
+    const char *haystack,	/* The bytes to search. */
+    Tcl_Size numHaystack,	/* Number of bytes in haystack. */
+    const char *needle,		/* The bytes to search for. */
+    Tcl_Size numNeedle)		/* Number of bytes in needle, > 0. */
+{
+    const char *p;
+    Tcl_Size skip[256], i;
+    unsigned char c, firstByte;
+
+    if (numNeedle > numHaystack) {
+	return NULL;
+    }
+    if (numNeedle < HORSPOOL_MIN_NEEDLE) {
+	return memSearchLastProc(haystack, numHaystack, needle, numNeedle);
+    }
+
+    /*
+     * Horspool run backwards: align on the first byte of the needle and
+     * skip by the distance to the nearest earlier occurrence of the
+     * haystack byte there.
+     */
+
+    firstByte = UCHAR(needle[0]);
+    for (i = 0; i < 256; i++) {
+	skip[i] = numNeedle;
+    }
+    for (i = numNeedle - 1; i > 0; i--) {
+	skip[UCHAR(needle[i])] = i;
+    }
+    p = haystack + numHaystack - numNeedle;
+    while (1) {
+	c = UCHAR(*p);
+	if (c == firstByte && memcmp(p + 1, needle + 1, numNeedle - 1) == 0) {
+	    return p;
+	}
+	if (p - haystack < skip[c]) {
+	    break;
+	}
+	p -= skip[c];
+    }
+    return NULL;
+}
+
+/*
+ * The kernels for short needles. The haystack is at least as long as the
+ * needle.
+ */
+
+static const char *
+MemSearchGeneric(
+    const char *haystack,	/* The bytes to search. */
+    Tcl_Size numHaystack,	/* Number of bytes in haystack. */
+    const char *needle,		/* The bytes to search for. */
+    Tcl_Size numNeedle)		/* Number of bytes in needle, > 0. */
+{
+    const char *p, *last = haystack + numHaystack - numNeedle;
+
+    for (p = haystack; p <= last; p++) {
+	p = (const char *)memchr(p, needle[0], last - p + 1);
+	if (p == NULL) {
+	    return NULL;
+	}
+	if (memcmp(p + 1, needle + 1, numNeedle - 1) == 0) {
+	    return p;
+	}
+    }
+    return NULL;
+}
+
+static const char *
+MemSearchLastGeneric(
+    const char *haystack,	/* The bytes to search. */
+    Tcl_Size numHaystack,	/* Number of bytes in haystack. */
+    const char *needle,		/* The bytes to search for. */
+    Tcl_Size numNeedle)		/* Number of bytes in needle, > 0. */
+{
+    const char *p;
+
+    for (p = haystack + numHaystack - numNeedle; p >= haystack; p--) {
+	if (*p == needle[0]
+		&& memcmp(p + 1, needle + 1, numNeedle - 1) == 0) {
+	    return p;
+	}
+    }
+    return NULL;
+}
+
+#ifdef HAVE_SSE2_KERNELS
+static const char *
+MemSearchSse2(
+    const char *haystack,	/* The bytes to search. */
+    Tcl_Size numHaystack,	/* Number of bytes in haystack. */
+    const char *needle,		/* The bytes to search for. */
+    Tcl_Size numNeedle)		/* Number of bytes in needle, > 1. */
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i lastByte = _mm_set1_epi8(needle[numNeedle - 1]);
+    const char *p = haystack, *last = haystack + numHaystack - numNeedle;
+
+    while (last - p >= 15) {
+	unsigned mask = (unsigned) _mm_movemask_epi8(_mm_and_si128(
+		_mm_cmpeq_epi8(first,
+			_mm_loadu_si128((const __m128i *) p)),
+		_mm_cmpeq_epi8(lastByte,
+			_mm_loadu_si128((const __m128i *) (p + numNeedle - 1)))));
+
+	while (mask) {
+	    const char *match = p + LowestSetBit(mask);
+
+	    if (memcmp(match + 1, needle + 1, numNeedle - 2) == 0) {
+		return match;
+	    }
+	    mask &= mask - 1;
+	}
+	p += 16;
+    }
+    return MemSearchGeneric(p, last - p + numNeedle, needle, numNeedle);
+}
+
+static const char *
+MemSearchLastSse2(
+    const char *haystack,	/* The bytes to search. */
+    Tcl_Size numHaystack,	/* Number of bytes in haystack. */
+    const char *needle,		/* The bytes to search for. */
+    Tcl_Size numNeedle)		/* Number of bytes in needle, > 0. */
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i lastByte = _mm_set1_epi8(needle[numNeedle - 1]);
+    Tcl_Size i = numHaystack - numNeedle - 15;
+
+    /*
+     * i is the first of the 16 positions tested at once, from the end.
+     */
+
+    for (; i >= 0; i -= 16) {
+	const char *p = haystack + i;
+	unsigned mask = (unsigned) _mm_movemask_epi8(_mm_and_si128(
+		_mm_cmpeq_epi8(first,
+			_mm_loadu_si128((const __m128i *) p)),
+		_mm_cmpeq_epi8(lastByte,
+			_mm_loadu_si128((const __m128i *) (p + numNeedle - 1)))));
+
+	while (mask) {
+	    int bit = HighestSetBit(mask);
+
+	    if (memcmp(p + bit + 1, needle + 1, numNeedle - 1) == 0) {
+		return p + bit;
+	    }
+	    mask &= ~(1U << bit);
+	}
+    }
+    if (i + 15 < 0) {
+	return NULL;
+    }
+    return MemSearchLastGeneric(haystack, i + 15 + numNeedle, needle,
+	    numNeedle);
+}
+#endif /* HAVE_SSE2_KERNELS */
+
+#ifdef HAVE_AVX2_KERNELS
+static TCL_AVX2 const char *
+MemSearchAvx2(
+    const char *haystack,	/* The bytes to search. */
+    Tcl_Size numHaystack,	/* Number of bytes in haystack. */
+    const char *needle,		/* The bytes to search for. */
+    Tcl_Size numNeedle)		/* Number of bytes in needle, > 1. */
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i lastByte = _mm256_set1_epi8(needle[numNeedle - 1]);
+    const char *p = haystack, *last = haystack + numHaystack - numNeedle;
+
+    while (last - p >= 31) {
+	unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_and_si256(
+		_mm256_cmpeq_epi8(first,
+			_mm256_loadu_si256((const __m256i *) p)),
+		_mm256_cmpeq_epi8(lastByte, _mm256_loadu_si256(
+			(const __m256i *) (p + numNeedle - 1)))));
+
+	while (mask) {
+	    const char *match = p + LowestSetBit(mask);
+
+	    if (memcmp(match + 1, needle + 1, numNeedle - 2) == 0) {
+		return match;
+	    }
+	    mask &= mask - 1;
+	}
+	p += 32;
+    }
+    return MemSearchSse2(p, last - p + numNeedle, needle, numNeedle);
+}
+#endif /* HAVE_AVX2_KERNELS */
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TclByteSetInit, TclByteSetAdd --
+ *
+ *	Empty a set of bytes for TclMemSearchSet, and add a byte to it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Fills in *setPtr.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+void
+TclByteSetInit(
+    TclByteSet *setPtr)		/* The set to empty. */
+{
+    memset(setPtr, 0, sizeof(TclByteSet));
+    setPtr->allAscii = 1;
+}
+
+void
+TclByteSetAdd(
+    TclByteSet *setPtr,		/* The set to add to. */
+    int byte)			/* The byte to add. */
+{
+    unsigned char c = UCHAR(byte);
+
+    if (setPtr->member[c]) {
+	return;
+    }
+    setPtr->member[c] = 1;
+    if (setPtr->numMembers < TCL_BYTE_SET_LIST) {
+	setPtr->members[setPtr->numMembers] = c;
+    }
+    setPtr->numMembers++;
+    if (c < 0x80) {
+	setPtr->nibbles[c & 0xF] |= (unsigned char) (1 << (c >> 4));
+    } else {
+	setPtr->allAscii = 0;
+    }
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TclMemSearchSet --
+ *
+ *	Find the first byte in a sequence of bytes that belongs to a set of
+ *	bytes. [split] uses this for sets of ASCII characters, and [string
+ *	map] to find where keys may start. The SSE2 kernel compares with each
+ *	byte of sets of up to TCL_BYTE_SET_LIST bytes, 16 bytes at a time. The
+ *	AVX2 kernel looks 32 bytes at a time up in the set of ASCII bytes,
+ *	split by their low and high four bits.
+ *
+ * Results:
+ *	Pointer to the byte found, or NULL if there is none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+const char *
+TclMemSearchSet(
+    const char *bytes,		/* The bytes to search. */
+    Tcl_Size numBytes,		/* Number of bytes to search. */
+    const TclByteSet *setPtr)	/* The bytes to search for. */
+{
+    return memSearchSetProc(bytes, numBytes, setPtr);
+}
+
+static const char *
+MemSearchSetGeneric(
+    const char *bytes,		/* The bytes to search. */
+    Tcl_Size numBytes,		/* Number of bytes to search. */
+    const TclByteSet *setPtr)	/* The bytes to search for. */
+{
+    const unsigned char *p = (const unsigned char *) bytes;
+    const unsigned char *end = p + numBytes;
+    const char *set = setPtr->member;
+
+    /*
+     * Unrolled, as the loop overhead is most of the work.
+     */
+
+    while (end - p >= 4) {
+	if (set[p[0]]) {
+	    return (const char *) p;
+	}
+	if (set[p[1]]) {
+	    return (const char *) p + 1;
+	}
+	if (set[p[2]]) {
+	    return (const char *) p + 2;
+	}
+	if (set[p[3]]) {
+	    return (const char *) p + 3;
+	}
+	p += 4;
+    }
+    for (; p < end; p++) {
+	if (set[*p]) {
+	    return (const char *) p;
+	}
+    }
+    return NULL;
+}
+
+#ifdef HAVE_SSE2_KERNELS
+static const char *
+MemSearchSetSse2(
+    const char *bytes,		/* The bytes to search. */
+    Tcl_Size numBytes,		/* Number of bytes to search. */
+    const TclByteSet *setPtr)	/* The bytes to search for. */
+{
+    __m128i members[TCL_BYTE_SET_LIST];
+    const char *p = bytes, *end = bytes + numBytes;
+    int i, numMembers = setPtr->numMembers;
+
+    if (numMembers > TCL_BYTE_SET_LIST) {
+	return MemSearchSetGeneric(bytes, numBytes, setPtr);
+    }
+    for (i = 0; i < numMembers; i++) {
+	members[i] = _mm_set1_epi8((char) setPtr->members[i]);
+    }
+    while (end - p >= 16) {
+	__m128i v = _mm_loadu_si128((const __m128i *) p);
+	__m128i found = _mm_setzero_si128();
+	int mask;
+
+	for (i = 0; i < numMembers; i++) {
+	    found = _mm_or_si128(found, _mm_cmpeq_epi8(v, members[i]));
+	}
+	mask = _mm_movemask_epi8(found);
+	if (mask) {
+	    return p + LowestSetBit(mask);
+	}
+	p += 16;
+    }
+    return MemSearchSetGeneric(p, end - p, setPtr);
+}
+#endif /* HAVE_SSE2_KERNELS */
+
+#ifdef HAVE_AVX2_KERNELS
+static TCL_AVX2 const char *
+MemSearchSetAvx2(
+    const char *bytes,		/* The bytes to search. */
+    Tcl_Size numBytes,		/* Number of bytes to search. */
+    const TclByteSet *setPtr)	/* The bytes to search for. */
+{
+    const __m256i nibbles = _mm256_broadcastsi128_si256(
+	    _mm_loadu_si128((const __m128i *) setPtr->nibbles));
+    const __m256i bits = _mm256_setr_epi8(
+	    1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+	    1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i lowBits = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+    const char *p = bytes, *end = bytes + numBytes;
+
+    if (!setPtr->allAscii) {
+	return MemSearchSetSse2(bytes, numBytes, setPtr);
+    }
+
+    /*
+     * The entry of nibbles for the low four bits of a byte has the bit for
+     * its high four bits set if the byte is in the set. Bytes from 0x80 up
+     * have no bit.
+     */
+
+    while (end - p >= 32) {
+	__m256i v = _mm256_loadu_si256((const __m256i *) p);
+	__m256i row = _mm256_shuffle_epi8(nibbles,
+		_mm256_and_si256(v, lowBits));
+	__m256i bit = _mm256_shuffle_epi8(bits,
+		_mm256_and_si256(_mm256_srli_epi16(v, 4), lowBits));
+	unsigned mask = ~(unsigned) _mm256_movemask_epi8(
+		_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), zero));
+
+	if (mask) {
+	    return p + LowestSetBit(mask);
+	}
+	p += 32;
+    }
+    return MemSearchSetGeneric(p, end - p, setPtr);
+}
+#endif /* HAVE_AVX2_KERNELS */
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TclInitUtfKernels --
+ *
+ *	Chooses the widest byte search kernels above that the processor runs.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets memSearchProc and memSearchSetProc.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+void
+TclInitUtfKernels(void)
+{
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+	memSearchProc = MemSearchAvx2;
+	memSearchSetProc = MemSearchSetAvx2;
+    }
+#endif
+}
+
 /*
  *---------------------------------------------------------------------------
  *
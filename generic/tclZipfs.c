@@ -247,6 +247,16 @@ enum ZipCompressionMethods {
 #define ZIP_MAX_FILE_SIZE		INT_MAX
 #define DEFAULT_WRITE_MAX_SIZE		ZIP_MAX_FILE_SIZE
 
+/*
+ * Deflated files larger than this are decompressed on demand by read-only
+ * channels, through a window of this size, instead of all at once when the
+ * channel is opened. Compressed (and possibly encrypted) data is fed to the
+ * decompressor in pieces of ZIP_INFLATE_INPUT bytes.
+ */
+
+#define ZIP_INFLATE_WINDOW		65536
+#define ZIP_INFLATE_INPUT		16384
+
 /*
  * Mutex to protect localtime(3) when no reentrant version available.
  */
@@ -327,6 +337,11 @@ enum ZipEntryFlags {
  * method), ubuf points directly to the mapped zip file data in memory. No
  * additional storage is allocated and so ubufToFree is NULL.
  *
+ * For READ-ONLY files that are compressed and larger than ZIP_INFLATE_WINDOW,
+ * stream is not NULL and ubuf/ubufToFree is a window of ZIP_INFLATE_WINDOW
+ * bytes holding the uncompressed data from windowStart on. The window is
+ * refilled by ZipChannelInflate() as reading proceeds.
+ *
  * In all other combinations of compression and encryption or if channel is
  * writable, storage is allocated for the decrypted and/or uncompressed data
  * and a pointer to it is stored in ubufToFree and ubuf. When channel is
@@ -350,6 +365,27 @@ typedef struct ZipChannel {
     int isEncrypted;		/* True if data is encrypted */
     int mode;			/* O_WRITE, O_APPEND, O_TRUNC etc.*/
     unsigned long keys[3];	/* Key for decryption */
+    z_stream *stream;		/* Decompressor state when decompressing on
+				 * demand, else NULL. Fields below are only
+				 * used in that case. */
+    Tcl_Size windowStart;	/* Offset in the uncompressed data of the
+				 * first byte in the window (ubuf). */
+    Tcl_Size windowLen;		/* Number of valid bytes in the window. */
+    const unsigned char *zbuf;	/* The compressed data (after any decryption
+				 * header) in the mapped ZIP file. */
+    Tcl_Size zbufSize;		/* Size of the compressed data. */
+    Tcl_Size zbufUsed;		/* Amount of compressed data passed to the
+				 * decompressor since the last restart. */
+    unsigned char *cbuf;	/* Buffer of ZIP_INFLATE_INPUT bytes for
+				 * decrypted input, or NULL if the data is not
+				 * encrypted. */
+    unsigned long initKeys[3];	/* Decryption key just after the decryption
+				 * header, for restarting decompression. */
+    int checkCrc;		/* True if the CRC of the data has still to be
+				 * compared when the end is reached. */
+    unsigned long crc;		/* CRC of the data decompressed so far. */
+    int streamError;		/* Error code to report from any further
+				 * reads, or 0. */
 } ZipChannel;
 
 static inline int
@@ -411,6 +447,8 @@ static int		DescribeMounted(Tcl_Interp *interp,
 			    const char *mountPoint);
 static int		InitReadableChannel(Tcl_Interp *interp,
 			    ZipChannel *info, ZipEntry *z);
+static int		InitStreamingChannel(Tcl_Interp *interp,
+			    ZipChannel *info, ZipEntry *z);
 static int		InitWritableChannel(Tcl_Interp *interp,
 			    ZipChannel *info, ZipEntry *z, int trunc);
 static int		ListMountPoints(Tcl_Interp *interp);
@@ -468,6 +506,7 @@ static int		ZipChannelClose(void *instanceData,
 static Tcl_DriverGetHandleProc	ZipChannelGetFile;
 static int		ZipChannelRead(void *instanceData, char *buf,
 			    int toRead, int *errloc);
+static int		ZipChannelInflate(ZipChannel *info, int *errloc);
 static long long	ZipChannelWideSeek(void *instanceData,
 			    long long offset, int mode, int *errloc);
 static void		ZipChannelWatchChannel(void *instanceData,
@@ -4647,6 +4686,16 @@ ZipChannelClose(
     }
     info->zipFilePtr->numOpen--;
     Unlock();
+    if (info->stream) {
+	inflateEnd(info->stream);
+	Tcl_Free(info->stream);
+	info->stream = NULL;
+	if (info->cbuf) {
+	    memset(info->initKeys, 0, sizeof(info->initKeys));
+	    Tcl_Free(info->cbuf);
+	    info->cbuf = NULL;
+	}
+    }
     if (info->ubufToFree) {
 	assert(info->ubuf);
 	Tcl_Free(info->ubufToFree);
@@ -4715,6 +4764,33 @@ ZipChannelRead(
     if (toRead == 0) {
 	return 0;
     }
+    if (info->stream) {
+	char *p = buf;
+	Tcl_Size n;
+
+	/*
+	 * Decompress on demand; the window may have to be refilled several
+	 * times for a large read.
+	 */
+
+	while (info->cursor < nextpos) {
+	    if (info->cursor < info->windowStart
+		    || info->cursor >= info->windowStart + info->windowLen) {
+		if (ZipChannelInflate(info, errloc) != TCL_OK) {
+		    return -1;
+		}
+	    }
+	    n = info->windowStart + info->windowLen - info->cursor;
+	    if (n > nextpos - info->cursor) {
+		n = nextpos - info->cursor;
+	    }
+	    memcpy(p, info->ubuf + (info->cursor - info->windowStart), n);
+	    p += n;
+	    info->cursor += n;
+	}
+	*errloc = 0;
+	return toRead;
+    }
     if (info->isEncrypted) {
 	int i;
 	/*
@@ -4735,6 +4811,136 @@ ZipChannelRead(
     return toRead;
 }
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * ZipChannelInflate --
+ *
+ *	Refills the window of a channel that decompresses on demand so that
+ *	it contains the byte at the channel's cursor. Decompression proceeds
+ *	forward from the end of the current window, discarding whole windows
+ *	if needed; for positions before the window, it restarts from the
+ *	beginning of the compressed data. When the end of the data is reached
+ *	for the first time, its CRC is checked.
+ *
+ * Results:
+ *	Tcl result code; on error, *errloc is set to EIO (corrupt data or CRC
+ *	mismatch) or ENOMEM.
+ *
+ * Side effects:
+ *	Decompresses (and decrypts) data. May update the CRC flags of the
+ *	ZipEntry.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static int
+ZipChannelInflate(
+    ZipChannel *info,
+    int *errloc)
+{
+    z_stream *stream = info->stream;
+    Tcl_Size want, j;
+    int err;
+
+    if (info->streamError) {
+	*errloc = info->streamError;
+	return TCL_ERROR;
+    }
+    if (info->cursor < info->windowStart) {
+	/*
+	 * Going backwards; start decompressing all over again.
+	 */
+
+	if (inflateReset(stream) != Z_OK) {
+	    goto corrupt;
+	}
+	stream->next_in = NULL;
+	stream->avail_in = 0;
+	info->zbufUsed = 0;
+	info->windowStart = 0;
+	info->windowLen = 0;
+	info->crc = crc32(0, NULL, 0);
+	if (info->cbuf) {
+	    memcpy(info->keys, info->initKeys, sizeof(info->keys));
+	}
+    }
+
+    while (info->cursor >= info->windowStart + info->windowLen) {
+	info->windowStart += info->windowLen;
+	info->windowLen = 0;
+	want = info->numBytes - info->windowStart;
+	if (want > ZIP_INFLATE_WINDOW) {
+	    want = ZIP_INFLATE_WINDOW;
+	}
+	stream->next_out = info->ubuf;
+	stream->avail_out = (uInt) want;
+	while (stream->avail_out > 0) {
+	    if (stream->avail_in == 0) {
+		Tcl_Size n = info->zbufSize - info->zbufUsed;
+
+		if (n > ZIP_INFLATE_INPUT) {
+		    n = ZIP_INFLATE_INPUT;
+		}
+		if (info->cbuf) {
+		    for (j = 0; j < n; j++) {
+			int ch = info->zbuf[info->zbufUsed + j];
+
+			info->cbuf[j] = zdecode(info->keys, crc32tab, ch);
+		    }
+		    stream->next_in = info->cbuf;
+		} else {
+		    stream->next_in = (Bytef *) info->zbuf + info->zbufUsed;
+		}
+		stream->avail_in = (uInt) n;
+		info->zbufUsed += n;
+	    }
+	    err = inflate(stream, Z_SYNC_FLUSH);
+	    if (err == Z_STREAM_END) {
+		break;
+	    } else if (err != Z_OK) {
+		/*
+		 * Includes Z_BUF_ERROR, i.e. the compressed data ran out too
+		 * early.
+		 */
+
+		goto corrupt;
+	    }
+	}
+	info->windowLen = want - stream->avail_out;
+	if (info->windowLen != want) {
+	    /* Less data than announced in the directory. */
+	    goto corrupt;
+	}
+	if (info->checkCrc) {
+	    info->crc = crc32(info->crc, info->ubuf, (uInt) info->windowLen);
+	    if (info->windowStart + info->windowLen == info->numBytes) {
+		ZipEntry *z = info->zipEntryPtr;
+		int correct = (info->crc == (unsigned long) (unsigned) z->crc32);
+
+		info->checkCrc = 0;
+		WriteLock();
+		if (z->data == NULL) {
+		    z->flags |= ZE_F_CRC_COMPARED;
+		    if (correct) {
+			z->flags |= ZE_F_CRC_CORRECT;
+		    }
+		}
+		Unlock();
+		if (!correct) {
+		    goto corrupt;
+		}
+	    }
+	}
+    }
+    return TCL_OK;
+
+  corrupt:
+    info->streamError = EIO;
+    *errloc = EIO;
+    return TCL_ERROR;
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -4951,7 +5157,8 @@ ZipChannelGetFile(
  *	Tcl_Channel on success, or NULL on error.
  *
  * Side effects:
- *	Memory is allocated, the file from the ZIP archive is uncompressed.
+ *	Memory is allocated, the file from the ZIP archive is uncompressed
+ *	(large compressed files only as they are read).
  *
  *-------------------------------------------------------------------------
  */
@@ -5095,7 +5302,14 @@ ZipChannelOpen(
     }
 
     if (z->crc32) {
-	if (!(z->flags & ZE_F_CRC_COMPARED)) {
+	if (info->stream) {
+	    /*
+	     * Checked by ZipChannelInflate() once the end is reached.
+	     */
+
+	    info->checkCrc = !(z->flags & ZE_F_CRC_COMPARED);
+	    info->crc = crc32(0, NULL, 0);
+	} else if (!(z->flags & ZE_F_CRC_COMPARED)) {
 	    int crc = crc32(0, NULL, info->numBytes);
 	    crc = crc32(crc, info->ubuf, info->numBytes);
 	    z->flags |= ZE_F_CRC_COMPARED;
@@ -5103,9 +5317,19 @@ ZipChannelOpen(
 		z->flags |= ZE_F_CRC_CORRECT;
 	    }
 	}
-	if (!(z->flags & ZE_F_CRC_CORRECT)) {
+	if ((z->flags & ZE_F_CRC_COMPARED)
+		&& !(z->flags & ZE_F_CRC_CORRECT)) {
 	    ZIPFS_ERROR(interp, "invalid CRC");
 	    ZIPFS_ERROR_CODE(interp, "CRC_FAILED");
+	    if (info->stream) {
+		inflateEnd(info->stream);
+		Tcl_Free(info->stream);
+		if (info->cbuf) {
+		    memset(info->initKeys, 0, sizeof(info->initKeys));
+		    memset(info->keys, 0, sizeof(info->keys));
+		    Tcl_Free(info->cbuf);
+		}
+	    }
 	    if (info->ubufToFree) {
 		Tcl_Free(info->ubufToFree);
 		info->ubufSize = 0;
@@ -5357,7 +5581,9 @@ InitReadableChannel(
 	info->ubuf += ZIP_CRYPT_HDR_LEN;
     }
 
-    if (info->iscompr) {
+    if (info->iscompr && info->numBytes > ZIP_INFLATE_WINDOW) {
+	return InitStreamingChannel(interp, info, z);
+    } else if (info->iscompr) {
 	z_stream stream;
 	int err;
 	unsigned int j;
@@ -5474,6 +5700,97 @@ InitReadableChannel(
     return TCL_ERROR;
 }
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * InitStreamingChannel --
+ *
+ *	Assistant for InitReadableChannel() that sets up a readable channel
+ *	on a large compressed file so that it is decompressed on demand by
+ *	ZipChannelInflate(), rather than all at once. The decryption key (if
+ *	any) has already been set up by the caller.
+ *
+ * Returns:
+ *	Tcl result code.
+ *
+ * Side effects:
+ *	Allocates memory for the window and the decompressor state. Writes to
+ *	the interpreter's result on error.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static int
+InitStreamingChannel(
+    Tcl_Interp *interp,		/* Current interpreter, or NULL (when errors
+				 * will be silent). */
+    ZipChannel *info,		/* The channel to set up. */
+    ZipEntry *z)		/* The zipped file that the channel will read
+				 * from. */
+{
+    info->zbuf = info->ubuf;
+    info->zbufSize = z->numCompressedBytes;
+    if (info->isEncrypted) {
+	info->zbufSize -= ZIP_CRYPT_HDR_LEN;
+	memcpy(info->initKeys, info->keys, sizeof(info->keys));
+	info->cbuf = (unsigned char *) Tcl_AttemptAlloc(ZIP_INFLATE_INPUT);
+	if (!info->cbuf) {
+	    goto memoryError;
+	}
+    }
+    info->ubufSize = ZIP_INFLATE_WINDOW;
+    info->ubufToFree = (unsigned char *) Tcl_AttemptAlloc(info->ubufSize);
+    info->ubuf = info->ubufToFree;
+    if (!info->ubuf) {
+	goto memoryError;
+    }
+    info->stream = (z_stream *) Tcl_AttemptAlloc(sizeof(z_stream));
+    if (!info->stream) {
+	goto memoryError;
+    }
+    memset(info->stream, 0, sizeof(z_stream));
+    info->stream->zalloc = Z_NULL;
+    info->stream->zfree = Z_NULL;
+    info->stream->opaque = Z_NULL;
+    if (inflateInit2(info->stream, -15) != Z_OK) {
+	Tcl_Free(info->stream);
+	info->stream = NULL;
+	ZIPFS_ERROR(interp, "decompression error");
+	ZIPFS_ERROR_CODE(interp, "CORRUPT");
+	goto error_cleanup;
+    }
+
+    /*
+     * Nothing is decompressed yet: the (empty) window is at the start.
+     */
+
+    info->windowStart = 0;
+    info->windowLen = 0;
+    return TCL_OK;
+
+  memoryError:
+    ZIPFS_MEM_ERROR(interp);
+
+  error_cleanup:
+    if (info->stream) {
+	Tcl_Free(info->stream);
+	info->stream = NULL;
+    }
+    if (info->cbuf) {
+	memset(info->initKeys, 0, sizeof(info->initKeys));
+	memset(info->keys, 0, sizeof(info->keys));
+	Tcl_Free(info->cbuf);
+	info->cbuf = NULL;
+    }
+    if (info->ubufToFree) {
+	Tcl_Free(info->ubufToFree);
+	info->ubufToFree = NULL;
+	info->ubuf = NULL;
+	info->ubufSize = 0;
+    }
+    return TCL_ERROR;
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -83,6 +83,10 @@ typedef struct {
     int flags;			/* Miscellaneous flag bits. */
     GzipHeader *gzHeaderPtr;	/* If we've allocated a gzip header
 				 * structure. */
+    int threads;		/* Number of blocks compressed at once, or 1
+				 * to compress with the stream itself. */
+    struct ParallelDeflate *parallelPtr;
+				/* Compressor in blocks, if threads > 1. */
 } ZlibStreamHandle;
 
 enum ZlibStreamHandleFlags {
@@ -132,6 +136,10 @@ typedef struct {
     Tcl_Obj *compDictObj;	/* Byte-array object containing compression
 				 * dictionary (not dictObj!) to use if
 				 * necessary. */
+    struct ParallelDeflate *parallelPtr;
+				/* Compressor in blocks used instead of
+				 * outStream, when compressing with several
+				 * threads or with a block index. */
 } ZlibChannelData;
 
 /*
@@ -159,6 +167,72 @@ enum ZlibChannelDataFlags {
 #define MIN_NONSTREAM_BUFFER_SIZE 16
 #define MAX_BUFFER_SIZE		65536
 
+/*
+ * Structures used for compressing with several threads (the -threads
+ * option). The data is cut into blocks that are deflated by tasks of the
+ * task pool, each with its own raw deflate stream primed with the 32 KiB of
+ * data before the block as dictionary. Each block ends with a sync flush
+ * (the last one with the end of the stream) so that the compressed blocks,
+ * written in order between the header and trailer of the format, make a
+ * single ordinary stream. The checksums of the blocks are combined as they
+ * are written.
+ */
+
+#define PARALLEL_BLOCK_SIZE	(128 * 1024)
+#define DEFLATE_WINDOW_SIZE	(1 << MAX_WBITS)
+#define MAX_DEFLATE_THREADS	256
+
+typedef struct {
+    unsigned char *buffer;	/* DEFLATE_WINDOW_SIZE bytes of room for the
+				 * dictionary, followed by the data. */
+    size_t dictLen;		/* Bytes of dictionary just before the data;
+				 * 0 if the block does not depend on the data
+				 * before it. */
+    size_t dataLen;		/* Bytes of data to compress. */
+    unsigned char *out;		/* Compressed block. */
+    size_t outLen, outAllocated;
+    uLong check;		/* Checksum of the data of the block. */
+    int format;			/* Flags from the TCL_ZLIB_FORMAT_* set. */
+    int level;			/* Compression level. */
+    int flush;			/* Z_SYNC_FLUSH, or Z_FINISH for the last
+				 * block. */
+    int error;			/* zlib result of compressing the block. */
+    Tcl_TaskGroup group;	/* Counts the task compressing the block,
+				 * while the block is in flight. */
+} DeflateBlock;
+
+typedef int (ParallelDeflateOutputProc)(void *clientData,
+	const unsigned char *bytes, size_t length);
+
+typedef struct ParallelDeflate {
+    int format;			/* Flags from the TCL_ZLIB_FORMAT_* set. */
+    int level;			/* Compression level. */
+    gz_header *headerPtr;	/* Gzip header to write, or NULL for the
+				 * default one. Owned by the caller. */
+    Tcl_Obj *compDictObj;	/* Dictionary for the next block that does
+				 * not follow other data, or NULL. */
+    DeflateBlock *blocks;	/* Ring of blocks: the ones in flight, oldest
+				 * first, then the one being filled. */
+    int numBlocks;		/* Size of the ring. */
+    int first;			/* Index of the oldest block in flight. */
+    int numBusy;		/* Number of blocks in flight. */
+    DeflateBlock *prevPtr;	/* Last block handed to the pool, whose data
+				 * is the dictionary of the next one, or NULL
+				 * if the next one starts afresh. */
+    int independent;		/* Whether blocks never depend on the data
+				 * before them. */
+    int started;		/* Whether the header was written. */
+    int finished;		/* Whether the trailer was written. */
+    int error;			/* Sticky zlib error, or Z_OK. */
+    uLong check;		/* Checksum of the data written so far. */
+    Tcl_WideUInt totalIn;	/* Bytes of data written so far. */
+    Tcl_WideUInt totalOut;	/* Bytes written so far, header included. */
+    Tcl_Obj *indexObj;		/* List of uncompressed and compressed offsets
+				 * of the independent blocks, or NULL. */
+    ParallelDeflateOutputProc *outputProc;
+    void *clientData;		/* Where the compressed bytes go. */
+} ParallelDeflate;
+
 /*
  * Prototypes for private procedures defined later in this file:
  */
@@ -193,20 +267,48 @@ static void		ConvertError(Tcl_Interp *interp, int code,
 static Tcl_Obj *	ConvertErrorToList(int code, uLong adler);
 static inline int	Deflate(z_streamp strm, void *bufferPtr,
 			    size_t bufferSize, int flush, size_t *writtenPtr);
+static Tcl_TaskProc	DeflateBlockTask;
 static void		ExtractHeader(gz_header *headerPtr, Tcl_Obj *dictObj);
 static int		GenerateHeader(Tcl_Interp *interp, Tcl_Obj *dictObj,
 			    GzipHeader *headerPtr, int *extraSizePtr);
+static int		GetThreadsFromObj(Tcl_Interp *interp,
+			    Tcl_Obj *threadsObj, int *threadsPtr);
+static ParallelDeflate *ParallelDeflateCreate(int format, int level,
+			    int threads, gz_header *headerPtr, int withIndex,
+			    ParallelDeflateOutputProc *outputProc,
+			    void *clientData);
+static void		ParallelDeflateDelete(ParallelDeflate *pdPtr);
+static int		ParallelDeflateEmit(ParallelDeflate *pdPtr);
+static int		ParallelDeflatePut(ParallelDeflate *pdPtr,
+			    const unsigned char *bytes, size_t length,
+			    int flush);
+static int		ParallelDeflateSetDictionary(ParallelDeflate *pdPtr,
+			    Tcl_Obj *compDictObj);
+static int		ParallelDeflateSubmit(ParallelDeflate *pdPtr,
+			    int flush);
+static int		ParallelDeflateWrite(ParallelDeflate *pdPtr,
+			    const unsigned char *bytes, size_t length);
+static int		ParallelDeflateWriteHeader(ParallelDeflate *pdPtr);
 static int		ResultDecompress(ZlibChannelData *chanDataPtr,
 			    char *buf, int toRead, int flush,
 			    int *errorCodePtr);
+static int		ZlibDeflateWithOptions(Tcl_Interp *interp,
+			    int format, Tcl_Size objc, Tcl_Obj *const *objv);
+static int		ZlibParallelDeflate(Tcl_Interp *interp, int format,
+			    Tcl_Obj *data, int level,
+			    Tcl_Obj *gzipHeaderDictObj, int threads,
+			    Tcl_Obj *indexVarObj);
 static Tcl_Channel	ZlibStackChannelTransform(Tcl_Interp *interp,
 			    int mode, int format, int level, int limit,
 			    Tcl_Channel channel, Tcl_Obj *gzipHeaderDictPtr,
-			    Tcl_Obj *compDictObj);
+			    Tcl_Obj *compDictObj, int threads, int withIndex);
 static void		ZlibStreamCleanup(ZlibStreamHandle *zshPtr);
+static void		ZlibStreamStartThreads(ZlibStreamHandle *zshPtr,
+			    int threads);
 static inline void	ZlibTransformEventTimerKill(
 			    ZlibChannelData *chanDataPtr);
 static void		ZlibTransformTimerRun(void *clientData);
+static ParallelDeflateOutputProc WriteToParent;
 
 /*
  * Type of zlib-based compressing and decompressing channels.
@@ -685,6 +787,593 @@ AppendByteArray(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateCreate, ParallelDeflateDelete --
+ *
+ *	Create and delete a compressor that deflates blocks of its data in the
+ *	task pool. The compressed stream is handed to outputProc in order, by
+ *	the thread that puts the data in. Deleting the compressor waits for
+ *	the blocks still in flight and drops their output.
+ *
+ * Results:
+ *	The compressor (ParallelDeflateCreate).
+ *
+ * Side effects:
+ *	Allocates or frees memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define FillingBlock(pdPtr) \
+    (&(pdPtr)->blocks[((pdPtr)->first + (pdPtr)->numBusy) % (pdPtr)->numBlocks])
+
+static ParallelDeflate *
+ParallelDeflateCreate(
+    int format,			/* Flags from the TCL_ZLIB_FORMAT_* set. */
+    int level,			/* 0-9 or Z_DEFAULT_COMPRESSION. */
+    int threads,		/* Number of blocks to compress at once. */
+    gz_header *headerPtr,	/* Gzip header to write, or NULL for the
+				 * default one. */
+    int withIndex,		/* Whether to make all blocks independent and
+				 * list where they start. */
+    ParallelDeflateOutputProc *outputProc,
+				/* Where the compressed bytes go. */
+    void *clientData)		/* Argument of outputProc. */
+{
+    ParallelDeflate *pdPtr = (ParallelDeflate *)
+	    Tcl_Alloc(sizeof(ParallelDeflate));
+
+    memset(pdPtr, 0, sizeof(ParallelDeflate));
+    pdPtr->format = format;
+    pdPtr->level = level;
+    pdPtr->headerPtr = headerPtr;
+
+    /*
+     * Keep up to twice as many blocks in flight as are compressed at once,
+     * so that the pool still has work while the oldest block is written
+     * out, and one more for the block being filled.
+     */
+
+    pdPtr->numBlocks = 2 * threads + 1;
+    pdPtr->blocks = (DeflateBlock *)
+	    Tcl_Alloc(pdPtr->numBlocks * sizeof(DeflateBlock));
+    memset(pdPtr->blocks, 0, pdPtr->numBlocks * sizeof(DeflateBlock));
+    pdPtr->independent = withIndex;
+    pdPtr->error = Z_OK;
+    if (format == TCL_ZLIB_FORMAT_GZIP) {
+	pdPtr->check = crc32(0, NULL, 0);
+    } else {
+	pdPtr->check = adler32(0, NULL, 0);
+    }
+    if (withIndex) {
+	TclNewObj(pdPtr->indexObj);
+	Tcl_IncrRefCount(pdPtr->indexObj);
+    }
+    pdPtr->outputProc = outputProc;
+    pdPtr->clientData = clientData;
+    return pdPtr;
+}
+
+static void
+ParallelDeflateDelete(
+    ParallelDeflate *pdPtr)
+{
+    int i;
+
+    for (i = 0; i < pdPtr->numBlocks; i++) {
+	DeflateBlock *blockPtr = &pdPtr->blocks[i];
+
+	if (blockPtr->group) {
+	    Tcl_DeleteTaskGroup(blockPtr->group);
+	}
+	if (blockPtr->buffer) {
+	    Tcl_Free(blockPtr->buffer);
+	}
+	if (blockPtr->out) {
+	    Tcl_Free(blockPtr->out);
+	}
+    }
+    Tcl_Free(pdPtr->blocks);
+    if (pdPtr->compDictObj) {
+	Tcl_DecrRefCount(pdPtr->compDictObj);
+    }
+    if (pdPtr->indexObj) {
+	Tcl_DecrRefCount(pdPtr->indexObj);
+    }
+    Tcl_Free(pdPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateSetDictionary --
+ *
+ *	Set the dictionary that primes the compression of the data put next.
+ *	As with deflateSetDictionary(), only raw streams may have one set
+ *	after the start of the data.
+ *
+ * Results:
+ *	A zlib result code.
+ *
+ * Side effects:
+ *	May hand the data put so far to the pool.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelDeflateSetDictionary(
+    ParallelDeflate *pdPtr,
+    Tcl_Obj *compDictObj)	/* Byte-array object containing compression
+				 * dictionary (not dictObj!). */
+{
+    int e;
+
+    if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	return Z_STREAM_ERROR;
+    }
+    if (pdPtr->started || FillingBlock(pdPtr)->dataLen > 0) {
+	if (pdPtr->format != TCL_ZLIB_FORMAT_RAW || pdPtr->finished) {
+	    return Z_STREAM_ERROR;
+	}
+	if (FillingBlock(pdPtr)->dataLen > 0) {
+	    e = ParallelDeflateSubmit(pdPtr, Z_SYNC_FLUSH);
+	    if (e != Z_OK) {
+		return e;
+	    }
+	}
+    }
+    if (compDictObj != NULL) {
+	Tcl_IncrRefCount(compDictObj);
+    }
+    if (pdPtr->compDictObj != NULL) {
+	Tcl_DecrRefCount(pdPtr->compDictObj);
+    }
+    pdPtr->compDictObj = compDictObj;
+    pdPtr->prevPtr = NULL;
+    return Z_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflatePut --
+ *
+ *	Add data to a compressor that deflates in blocks, and flush it or end
+ *	the stream. Full blocks are handed to the pool; the compressed blocks
+ *	are written out in order as the ring of blocks in flight fills up, and
+ *	all of them on a flush.
+ *
+ * Results:
+ *	A zlib result code, Z_ERRNO if writing out failed.
+ *
+ * Side effects:
+ *	Calls the output procedure of the compressor.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelDeflatePut(
+    ParallelDeflate *pdPtr,
+    const unsigned char *bytes,	/* Data to compress. */
+    size_t length,		/* Number of bytes of data. */
+    int flush)			/* Z_NO_FLUSH, Z_SYNC_FLUSH, Z_FULL_FLUSH or
+				 * Z_FINISH. */
+{
+    DeflateBlock *blockPtr;
+    unsigned char trailer[8];
+    size_t count;
+    int e = Z_OK;
+
+    if (pdPtr->error != Z_OK) {
+	return pdPtr->error;
+    }
+    if (pdPtr->finished) {
+	return Z_STREAM_ERROR;
+    }
+
+    while (length > 0) {
+	blockPtr = FillingBlock(pdPtr);
+	if (blockPtr->dataLen == PARALLEL_BLOCK_SIZE) {
+	    e = ParallelDeflateSubmit(pdPtr, Z_SYNC_FLUSH);
+	    if (e != Z_OK) {
+		return e;
+	    }
+	    continue;
+	}
+	if (blockPtr->buffer == NULL) {
+	    blockPtr->buffer = (unsigned char *)
+		    Tcl_Alloc(DEFLATE_WINDOW_SIZE + PARALLEL_BLOCK_SIZE);
+	}
+	count = PARALLEL_BLOCK_SIZE - blockPtr->dataLen;
+	if (count > length) {
+	    count = length;
+	}
+	memcpy(blockPtr->buffer + DEFLATE_WINDOW_SIZE + blockPtr->dataLen,
+		bytes, count);
+	blockPtr->dataLen += count;
+	bytes += count;
+	length -= count;
+    }
+
+    switch (flush) {
+    case Z_NO_FLUSH:
+	return Z_OK;
+    case Z_FINISH:
+	e = ParallelDeflateSubmit(pdPtr, Z_FINISH);
+	while (e == Z_OK && pdPtr->numBusy > 0) {
+	    e = ParallelDeflateEmit(pdPtr);
+	}
+	if (e != Z_OK) {
+	    return e;
+	}
+	pdPtr->finished = 1;
+	if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	    trailer[0] = (unsigned char) pdPtr->check;
+	    trailer[1] = (unsigned char) (pdPtr->check >> 8);
+	    trailer[2] = (unsigned char) (pdPtr->check >> 16);
+	    trailer[3] = (unsigned char) (pdPtr->check >> 24);
+	    trailer[4] = (unsigned char) pdPtr->totalIn;
+	    trailer[5] = (unsigned char) (pdPtr->totalIn >> 8);
+	    trailer[6] = (unsigned char) (pdPtr->totalIn >> 16);
+	    trailer[7] = (unsigned char) (pdPtr->totalIn >> 24);
+	    return ParallelDeflateWrite(pdPtr, trailer, 8);
+	} else if (pdPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+	    trailer[0] = (unsigned char) (pdPtr->check >> 24);
+	    trailer[1] = (unsigned char) (pdPtr->check >> 16);
+	    trailer[2] = (unsigned char) (pdPtr->check >> 8);
+	    trailer[3] = (unsigned char) pdPtr->check;
+	    return ParallelDeflateWrite(pdPtr, trailer, 4);
+	}
+	return Z_OK;
+    default:
+	/*
+	 * The blocks already end on a byte boundary, so a flush only has to
+	 * write out everything put so far. After a full flush, the next block
+	 * starts afresh.
+	 */
+
+	if (FillingBlock(pdPtr)->dataLen > 0) {
+	    e = ParallelDeflateSubmit(pdPtr, Z_SYNC_FLUSH);
+	} else if (!pdPtr->started) {
+	    e = ParallelDeflateWriteHeader(pdPtr);
+	}
+	while (e == Z_OK && pdPtr->numBusy > 0) {
+	    e = ParallelDeflateEmit(pdPtr);
+	}
+	if (flush == Z_FULL_FLUSH) {
+	    pdPtr->prevPtr = NULL;
+	}
+	return e;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateSubmit --
+ *
+ *	Hand the block being filled to the task pool, primed with the end of
+ *	the data before it, and start filling the next block of the ring,
+ *	writing out the oldest block first if the ring is full.
+ *
+ * Results:
+ *	A zlib result code.
+ *
+ * Side effects:
+ *	Writes the header of the stream before the first block.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelDeflateSubmit(
+    ParallelDeflate *pdPtr,
+    int flush)			/* Z_SYNC_FLUSH, or Z_FINISH for the last
+				 * block. */
+{
+    DeflateBlock *blockPtr = FillingBlock(pdPtr);
+    unsigned char *dataPtr;
+    int e;
+
+    if (!pdPtr->started) {
+	e = ParallelDeflateWriteHeader(pdPtr);
+	if (e != Z_OK) {
+	    return e;
+	}
+    }
+    if (blockPtr->buffer == NULL) {
+	blockPtr->buffer = (unsigned char *)
+		Tcl_Alloc(DEFLATE_WINDOW_SIZE + PARALLEL_BLOCK_SIZE);
+    }
+    dataPtr = blockPtr->buffer + DEFLATE_WINDOW_SIZE;
+
+    /*
+     * The dictionary is the end of the previous block and of its own
+     * dictionary, still in its buffer as its slot is not reused before this
+     * block is written out, or else the dictionary that was set.
+     */
+
+    blockPtr->dictLen = 0;
+    if (pdPtr->prevPtr != NULL) {
+	DeflateBlock *prevPtr = pdPtr->prevPtr;
+	size_t length = prevPtr->dictLen + prevPtr->dataLen;
+
+	if (length > DEFLATE_WINDOW_SIZE) {
+	    length = DEFLATE_WINDOW_SIZE;
+	}
+	memcpy(dataPtr - length, prevPtr->buffer + DEFLATE_WINDOW_SIZE
+		+ prevPtr->dataLen - length, length);
+	blockPtr->dictLen = length;
+    } else if (pdPtr->compDictObj != NULL) {
+	Tcl_Size length = 0;
+	const unsigned char *bytes = Tcl_GetBytesFromObj(NULL,
+		pdPtr->compDictObj, &length);
+
+	if (bytes != NULL) {
+	    if (length > DEFLATE_WINDOW_SIZE) {
+		bytes += length - DEFLATE_WINDOW_SIZE;
+		length = DEFLATE_WINDOW_SIZE;
+	    }
+	    memcpy(dataPtr - length, bytes, length);
+	    blockPtr->dictLen = length;
+	}
+	Tcl_DecrRefCount(pdPtr->compDictObj);
+	pdPtr->compDictObj = NULL;
+    }
+
+    blockPtr->format = pdPtr->format;
+    blockPtr->level = pdPtr->level;
+    blockPtr->flush = flush;
+    blockPtr->error = Z_OK;
+    blockPtr->group = Tcl_CreateTaskGroup();
+    Tcl_TaskPoolSubmit(blockPtr->group, DeflateBlockTask, blockPtr);
+    pdPtr->numBusy++;
+    pdPtr->prevPtr = pdPtr->independent ? NULL : blockPtr;
+
+    if (pdPtr->numBusy == pdPtr->numBlocks) {
+	e = ParallelDeflateEmit(pdPtr);
+	if (e != Z_OK) {
+	    return e;
+	}
+    }
+    FillingBlock(pdPtr)->dataLen = 0;
+    return Z_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeflateBlockTask --
+ *
+ *	Task that compresses one block with a raw deflate stream of its own,
+ *	and computes the checksum of its data.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Fills in the output, checksum and result of the block.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DeflateBlockTask(
+    void *clientData)		/* The DeflateBlock. */
+{
+    DeflateBlock *blockPtr = (DeflateBlock *) clientData;
+    const unsigned char *dataPtr = blockPtr->buffer + DEFLATE_WINDOW_SIZE;
+    z_stream stream;
+    size_t needed, used;
+    int e;
+
+    memset(&stream, 0, sizeof(z_stream));
+    e = deflateInit2(&stream, blockPtr->level, Z_DEFLATED, WBITS_RAW,
+	    MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    if (e != Z_OK) {
+	blockPtr->error = e;
+	return;
+    }
+    if (blockPtr->dictLen > 0) {
+	e = deflateSetDictionary(&stream, dataPtr - blockPtr->dictLen,
+		blockPtr->dictLen);
+    }
+
+    /*
+     * deflateBound() leaves out the empty block of a sync flush; add room
+     * for it. The buffer still grows if that was not enough.
+     */
+
+    needed = deflateBound(&stream, blockPtr->dataLen) + 16;
+    if (blockPtr->outAllocated < needed) {
+	if (blockPtr->out) {
+	    Tcl_Free(blockPtr->out);
+	}
+	blockPtr->out = (unsigned char *) Tcl_Alloc(needed);
+	blockPtr->outAllocated = needed;
+    }
+    stream.next_in = (Bytef *) dataPtr;
+    stream.avail_in = blockPtr->dataLen;
+    stream.next_out = blockPtr->out;
+    stream.avail_out = blockPtr->outAllocated;
+    while (e == Z_OK) {
+	e = deflate(&stream, blockPtr->flush);
+	if (e == Z_STREAM_END || (e == Z_OK && stream.avail_out > 0)) {
+	    e = Z_OK;
+	    break;
+	}
+	if (e != Z_OK && e != Z_BUF_ERROR) {
+	    break;
+	}
+	used = stream.next_out - blockPtr->out;
+	blockPtr->outAllocated *= 2;
+	blockPtr->out = (unsigned char *)
+		Tcl_Realloc(blockPtr->out, blockPtr->outAllocated);
+	stream.next_out = blockPtr->out + used;
+	stream.avail_out = blockPtr->outAllocated - used;
+	e = Z_OK;
+    }
+    blockPtr->outLen = stream.next_out - blockPtr->out;
+    deflateEnd(&stream);
+
+    if (blockPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	blockPtr->check = crc32(crc32(0, NULL, 0), dataPtr,
+		blockPtr->dataLen);
+    } else if (blockPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+	blockPtr->check = adler32(adler32(0, NULL, 0), dataPtr,
+		blockPtr->dataLen);
+    }
+    blockPtr->error = e;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateEmit --
+ *
+ *	Wait for the oldest block in flight and write it out.
+ *
+ * Results:
+ *	A zlib result code: that of compressing the block, or Z_ERRNO if
+ *	writing out failed.
+ *
+ * Side effects:
+ *	Calls the output procedure of the compressor; adds the block to the
+ *	index and its data to the checksum.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelDeflateEmit(
+    ParallelDeflate *pdPtr)
+{
+    DeflateBlock *blockPtr = &pdPtr->blocks[pdPtr->first];
+    int e;
+
+    Tcl_DeleteTaskGroup(blockPtr->group);
+    blockPtr->group = NULL;
+    pdPtr->first = (pdPtr->first + 1) % pdPtr->numBlocks;
+    pdPtr->numBusy--;
+    if (pdPtr->error != Z_OK) {
+	return pdPtr->error;
+    }
+    if (blockPtr->error != Z_OK) {
+	pdPtr->error = blockPtr->error;
+	return pdPtr->error;
+    }
+
+    if (pdPtr->indexObj && blockPtr->dataLen > 0 && blockPtr->dictLen == 0) {
+	Tcl_ListObjAppendElement(NULL, pdPtr->indexObj,
+		Tcl_NewWideIntObj((Tcl_WideInt) pdPtr->totalIn));
+	Tcl_ListObjAppendElement(NULL, pdPtr->indexObj,
+		Tcl_NewWideIntObj((Tcl_WideInt) pdPtr->totalOut));
+    }
+    e = ParallelDeflateWrite(pdPtr, blockPtr->out, blockPtr->outLen);
+    if (e != Z_OK) {
+	return e;
+    }
+    if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	pdPtr->check = crc32_combine(pdPtr->check, blockPtr->check,
+		(z_off_t) blockPtr->dataLen);
+    } else if (pdPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+	pdPtr->check = adler32_combine(pdPtr->check, blockPtr->check,
+		(z_off_t) blockPtr->dataLen);
+    }
+    pdPtr->totalIn += blockPtr->dataLen;
+    return Z_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateWriteHeader, ParallelDeflateWrite --
+ *
+ *	Write out the header of the stream, and bytes of the stream.
+ *
+ * Results:
+ *	A zlib result code, Z_ERRNO if writing out failed.
+ *
+ * Side effects:
+ *	Calls the output procedure of the compressor.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelDeflateWriteHeader(
+    ParallelDeflate *pdPtr)
+{
+    z_stream stream;
+    unsigned char *buffer;
+    size_t size = 32, written = 0;
+    int e;
+
+    pdPtr->started = 1;
+    if (pdPtr->format == TCL_ZLIB_FORMAT_RAW) {
+	return Z_OK;
+    }
+
+    /*
+     * Let zlib make the header, exactly as for an ordinary stream: a block
+     * flush at the start of a stream writes the header and nothing else.
+     */
+
+    if (pdPtr->headerPtr != NULL) {
+	if (pdPtr->headerPtr->name != NULL) {
+	    size += strlen((char *) pdPtr->headerPtr->name) + 1;
+	}
+	if (pdPtr->headerPtr->comment != NULL) {
+	    size += strlen((char *) pdPtr->headerPtr->comment) + 1;
+	}
+    }
+    memset(&stream, 0, sizeof(z_stream));
+    e = deflateInit2(&stream, pdPtr->level, Z_DEFLATED,
+	    (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) ? WBITS_GZIP : WBITS_ZLIB,
+	    MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    if (e != Z_OK) {
+	pdPtr->error = e;
+	return e;
+    }
+    if (pdPtr->headerPtr != NULL) {
+	e = deflateSetHeader(&stream, pdPtr->headerPtr);
+    }
+    if (e == Z_OK && pdPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+	e = SetDeflateDictionary(&stream, pdPtr->compDictObj);
+    }
+    buffer = (unsigned char *) Tcl_Alloc(size);
+    if (e == Z_OK) {
+	e = Deflate(&stream, buffer, size, Z_BLOCK, &written);
+    }
+    deflateEnd(&stream);
+    if (e == Z_OK) {
+	e = ParallelDeflateWrite(pdPtr, buffer, written);
+    } else {
+	pdPtr->error = e;
+    }
+    Tcl_Free(buffer);
+    return e;
+}
+
+static int
+ParallelDeflateWrite(
+    ParallelDeflate *pdPtr,
+    const unsigned char *bytes,
+    size_t length)
+{
+    if (length > 0 && pdPtr->outputProc(pdPtr->clientData, bytes,
+	    length) != TCL_OK) {
+	pdPtr->error = Z_ERRNO;
+	return Z_ERRNO;
+    }
+    pdPtr->totalOut += length;
+    return Z_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -810,6 +1499,8 @@ Tcl_ZlibStreamInit(
     zshPtr->compDictObj = NULL;
     zshPtr->flags = 0;
     zshPtr->gzHeaderPtr = gzHeaderPtr;
+    zshPtr->threads = 1;
+    zshPtr->parallelPtr = NULL;
     memset(&zshPtr->stream, 0, sizeof(z_stream));
     zshPtr->stream.adler = 1;
 
@@ -1012,6 +1703,9 @@ ZlibStreamCleanup(
     if (zshPtr->compDictObj) {
 	Tcl_DecrRefCount(zshPtr->compDictObj);
     }
+    if (zshPtr->parallelPtr) {
+	ParallelDeflateDelete(zshPtr->parallelPtr);
+    }
     if (zshPtr->gzHeaderPtr) {
 	Tcl_Free(zshPtr->gzHeaderPtr);
     }
@@ -1019,6 +1713,47 @@ ZlibStreamCleanup(
     Tcl_Free(zshPtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ZlibStreamStartThreads --
+ *
+ *	Make a compressing stream compress its data in blocks, with several
+ *	threads, instead of with its own zlib stream.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Creates the compressor in blocks, that appends to the output buffer.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+AppendToStreamOutput(
+    void *clientData,
+    const unsigned char *bytes,
+    size_t length)
+{
+    ZlibStreamHandle *zshPtr = (ZlibStreamHandle *) clientData;
+
+    AppendByteArray(zshPtr->outData, (void *) bytes, length);
+    return TCL_OK;
+}
+
+static void
+ZlibStreamStartThreads(
+    ZlibStreamHandle *zshPtr,
+    int threads)		/* Number of blocks to compress at once. */
+{
+    zshPtr->threads = threads;
+    zshPtr->parallelPtr = ParallelDeflateCreate(zshPtr->format,
+	    zshPtr->level, threads, (zshPtr->gzHeaderPtr
+	    ? &zshPtr->gzHeaderPtr->header : NULL), 0,
+	    AppendToStreamOutput, zshPtr);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1059,6 +1794,13 @@ Tcl_ZlibStreamReset(
     zshPtr->outPos = 0;
     zshPtr->streamEnd = 0;
     memset(&zshPtr->stream, 0, sizeof(z_stream));
+    if (zshPtr->parallelPtr) {
+	ParallelDeflateDelete(zshPtr->parallelPtr);
+	ZlibStreamStartThreads(zshPtr, zshPtr->threads);
+	if (zshPtr->compDictObj) {
+	    zshPtr->flags |= DICT_TO_SET;
+	}
+    }
 
     /*
      * No output buffer available yet.
@@ -1171,6 +1913,9 @@ Tcl_ZlibStreamChecksum(
 {
     ZlibStreamHandle *zshPtr = (ZlibStreamHandle *)zshandle;
 
+    if (zshPtr->parallelPtr) {
+	return zshPtr->parallelPtr->check;
+    }
     return zshPtr->stream.adler;
 }
 
@@ -1267,6 +2012,24 @@ Tcl_ZlibStreamPut(
 	    return TCL_OK;
 	}
 
+	if (zshPtr->parallelPtr) {
+	    if (HaveDictToSet(zshPtr)) {
+		e = ParallelDeflateSetDictionary(zshPtr->parallelPtr,
+			zshPtr->compDictObj);
+		if (e != Z_OK) {
+		    ConvertError(zshPtr->interp, e, 0);
+		    return TCL_ERROR;
+		}
+		zshPtr->flags &= ~DICT_TO_SET;
+	    }
+	    e = ParallelDeflatePut(zshPtr->parallelPtr, bytes, size, flush);
+	    if (e != Z_OK) {
+		ConvertError(zshPtr->interp, e, 0);
+		return TCL_ERROR;
+	    }
+	    return TCL_OK;
+	}
+
 	if (HaveDictToSet(zshPtr)) {
 	    e = SetDeflateDictionary(&zshPtr->stream, zshPtr->compDictObj);
 	    if (e != Z_OK) {
@@ -1757,6 +2520,82 @@ Tcl_ZlibDeflate(
     return TCL_ERROR;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ZlibParallelDeflate --
+ *
+ *	Compress the contents of Tcl_Obj *data like Tcl_ZlibDeflate, in blocks
+ *	that are compressed by several threads, producing the compressed data
+ *	in the interpreter result. With a block index, the blocks are
+ *	compressed independently and the index is stored in a variable.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+AppendToByteArray(
+    void *clientData,
+    const unsigned char *bytes,
+    size_t length)
+{
+    TclAppendBytesToByteArray((Tcl_Obj *) clientData, bytes, length);
+    return TCL_OK;
+}
+
+static int
+ZlibParallelDeflate(
+    Tcl_Interp *interp,
+    int format,
+    Tcl_Obj *data,
+    int level,
+    Tcl_Obj *gzipHeaderDictObj,
+    int threads,		/* Number of blocks to compress at once. */
+    Tcl_Obj *indexVarObj)	/* Name of the variable to store the block
+				 * index in, or NULL for no index. */
+{
+    Tcl_Size inLen = 0;
+    unsigned char *inData;
+    GzipHeader header;
+    gz_header *headerPtr = NULL;
+    ParallelDeflate *pdPtr;
+    Tcl_Obj *obj;
+    int e;
+
+    inData = Tcl_GetBytesFromObj(interp, data, &inLen);
+    if (inData == NULL) {
+	return TCL_ERROR;
+    }
+    if (gzipHeaderDictObj) {
+	headerPtr = &header.header;
+	memset(headerPtr, 0, sizeof(gz_header));
+	if (GenerateHeader(interp, gzipHeaderDictObj, &header,
+		NULL) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+
+    obj = Tcl_NewByteArrayObj(NULL, 0);
+    pdPtr = ParallelDeflateCreate(format, level, threads, headerPtr,
+	    indexVarObj != NULL, AppendToByteArray, obj);
+    e = ParallelDeflatePut(pdPtr, inData, inLen, Z_FINISH);
+    if (e != Z_OK) {
+	ParallelDeflateDelete(pdPtr);
+	ConvertError(interp, e, 0);
+	TclDecrRefCount(obj);
+	return TCL_ERROR;
+    }
+    if (indexVarObj && Tcl_ObjSetVar2(interp, indexVarObj, NULL,
+	    pdPtr->indexObj, TCL_LEAVE_ERR_MSG) == NULL) {
+	ParallelDeflateDelete(pdPtr);
+	TclDecrRefCount(obj);
+	return TCL_ERROR;
+    }
+    ParallelDeflateDelete(pdPtr);
+    Tcl_SetObjResult(interp, obj);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2018,6 +2857,48 @@ GetLevelFromObj(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetThreadsFromObj --
+ *
+ *	Helper for getting the number of blocks to compress at once from a
+ *	-threads option: 1 (the default) compresses in a single stream, 0
+ *	compresses as many blocks as the task pool runs tasks at once.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+GetThreadsFromObj(
+    Tcl_Interp *interp,		/* Where to put error messages. NULLable. */
+    Tcl_Obj *threadsObj,	/* Value to parse. NULL for default. */
+    int *threadsPtr)		/* Where to write the number of threads. */
+{
+    int threads;
+
+    if (threadsObj == NULL) {
+	*threadsPtr = 1;
+	return TCL_OK;
+    }
+    if (TclGetIntFromObj(interp, threadsObj, &threads) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (threads < 0 || threads > MAX_DEFLATE_THREADS) {
+	if (interp) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "number of threads must be 0 to %d",
+		    MAX_DEFLATE_THREADS));
+	    Tcl_SetErrorCode(interp, "TCL", "VALUE", "THREADS", (char *)NULL);
+	}
+	return TCL_ERROR;
+    }
+    if (threads == 0) {
+	threads = Tcl_GetTaskPoolSize();
+    }
+    *threadsPtr = threads;
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2148,10 +3029,14 @@ ZlibDeflateCmd(
 {
     int level;
 
-    if (objc < 2 || objc > 3) {
-	Tcl_WrongNumArgs(interp, 1, objv, "data ?level?");
+    if (objc < 2 || (objc > 3 && (objc & 1))) {
+	Tcl_WrongNumArgs(interp, 1, objv,
+		"data ?-level level? ?-threads count? ?-blockindex varName?");
 	return TCL_ERROR;
     }
+    if (objc > 3) {
+	return ZlibDeflateWithOptions(interp, TCL_ZLIB_FORMAT_RAW, objc, objv);
+    }
     if (GetLevelFromObj(interp, (objc > 2 ? objv[2] : NULL), &level) != TCL_OK) {
 	return TCL_ERROR;
     }
@@ -2176,10 +3061,14 @@ ZlibCompressCmd(
 {
     int level;
 
-    if (objc < 2 || objc > 3) {
-	Tcl_WrongNumArgs(interp, 1, objv, "data ?level?");
+    if (objc < 2 || (objc > 3 && (objc & 1))) {
+	Tcl_WrongNumArgs(interp, 1, objv,
+		"data ?-level level? ?-threads count? ?-blockindex varName?");
 	return TCL_ERROR;
     }
+    if (objc > 3) {
+	return ZlibDeflateWithOptions(interp, TCL_ZLIB_FORMAT_ZLIB, objc, objv);
+    }
     if (GetLevelFromObj(interp, (objc > 2 ? objv[2] : NULL), &level) != TCL_OK) {
 	return TCL_ERROR;
     }
@@ -2202,11 +3091,7 @@ ZlibGzipCmd(
     Tcl_Size objc,
     Tcl_Obj *const *objv)
 {
-    static const char *const gzipopts[] = {
-	"-header", "-level", NULL
-    };
-    Tcl_Obj *headerDictObj = NULL;
-    int level = Z_DEFAULT_COMPRESSION, i, option;
+    int level;
 
     /*
      * Legacy argument format support.
@@ -2221,32 +3106,88 @@ ZlibGzipCmd(
 		level, NULL);
     }
 
-    if (objc < 2 || objc > 6 || (objc & 1)) {
-	Tcl_WrongNumArgs(interp, 1, objv,
-		"data ?-level level? ?-header header?");
+    if (objc < 2 || (objc & 1)) {
+	Tcl_WrongNumArgs(interp, 1, objv, "data ?-level level? "
+		"?-header header? ?-threads count? ?-blockindex varName?");
 	return TCL_ERROR;
     }
+    return ZlibDeflateWithOptions(interp, TCL_ZLIB_FORMAT_GZIP, objc, objv);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ZlibDeflateWithOptions --
+ *
+ *	Shared implementation of the option forms of the [zlib compress],
+ *	[zlib deflate] and [zlib gzip] commands.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+ZlibDeflateWithOptions(
+    Tcl_Interp *interp,
+    int format,			/* Flags from the TCL_ZLIB_FORMAT_* set. */
+    Tcl_Size objc,
+    Tcl_Obj *const *objv)
+{
+    enum deflateOptionsEnum {doBlockIndex, doHeader, doLevel, doThreads};
+    typedef struct {
+	const char *name;
+	enum deflateOptionsEnum option;
+    } OptDescriptor;
+    static const OptDescriptor deflateOpts[] = {
+	{ "-blockindex", doBlockIndex },
+	{ "-level",	 doLevel },
+	{ "-threads",	 doThreads },
+	{ NULL, doBlockIndex }
+    };
+    static const OptDescriptor gzipOpts[] = {
+	{ "-blockindex", doBlockIndex },
+	{ "-header",	 doHeader },
+	{ "-level",	 doLevel },
+	{ "-threads",	 doThreads },
+	{ NULL, doBlockIndex }
+    };
+    const OptDescriptor *desc =
+	    (format == TCL_ZLIB_FORMAT_GZIP) ? gzipOpts : deflateOpts;
+    Tcl_Obj *headerDictObj = NULL, *indexVarObj = NULL;
+    int level = Z_DEFAULT_COMPRESSION, threads = 1, option;
+    Tcl_Size i;
+
     for (i=2 ; i<objc ; i+=2) {
-	if (Tcl_GetIndexFromObj(interp, objv[i], gzipopts, "option", 0,
-		&option) != TCL_OK) {
+	if (Tcl_GetIndexFromObjStruct(interp, objv[i], desc,
+		sizeof(OptDescriptor), "option", 0, &option) != TCL_OK) {
 	    return TCL_ERROR;
 	}
-	switch (option) {
-	case 0:		// -header
+	switch (desc[option].option) {
+	case doBlockIndex:
+	    indexVarObj = objv[i + 1];
+	    break;
+	case doHeader:
 	    headerDictObj = objv[i + 1];
 	    break;
-	case 1:		// -level
+	case doLevel:
 	    if (GetLevelFromObj(interp, objv[i + 1], &level) != TCL_OK) {
 		Tcl_AddErrorInfo(interp, "\n    (in -level option)");
 		return TCL_ERROR;
 	    }
 	    break;
+	case doThreads:
+	    if (GetThreadsFromObj(interp, objv[i + 1], &threads) != TCL_OK) {
+		Tcl_AddErrorInfo(interp, "\n    (in -threads option)");
+		return TCL_ERROR;
+	    }
+	    break;
 	default:
 	    TCL_UNREACHABLE();
 	}
     }
-    return Tcl_ZlibDeflate(interp, TCL_ZLIB_FORMAT_GZIP, objv[1], level,
-	    headerDictObj);
+    if (threads == 1 && indexVarObj == NULL) {
+	return Tcl_ZlibDeflate(interp, format, objv[1], level, headerDictObj);
+    }
+    return ZlibParallelDeflate(interp, format, objv[1], level, headerDictObj,
+	    threads, indexVarObj);
 }
 
 /*
@@ -2390,17 +3331,19 @@ ZlibStreamCmd(
 	FMT_COMPRESS, FMT_DECOMPRESS, FMT_DEFLATE, FMT_GUNZIP, FMT_GZIP,
 	FMT_INFLATE
     } fmt;
-    int i, format, mode = 0, option, level;
+    int i, format, mode = 0, option, level, threads;
     enum objIndices {
 	OPT_COMPRESSION_DICTIONARY = 0,
 	OPT_GZIP_HEADER = 1,
 	OPT_COMPRESSION_LEVEL = 2,
+	OPT_THREADS = 3,
 	OPT_END = -1
     };
-    Tcl_Obj *obj[3] = { NULL, NULL, NULL };
+    Tcl_Obj *obj[4] = { NULL, NULL, NULL, NULL };
 #define compDictObj	obj[OPT_COMPRESSION_DICTIONARY]
 #define gzipHeaderObj	obj[OPT_GZIP_HEADER]
 #define levelObj	obj[OPT_COMPRESSION_LEVEL]
+#define threadsObj	obj[OPT_THREADS]
     typedef struct {
 	const char *name;
 	enum objIndices offset;
@@ -2408,11 +3351,13 @@ ZlibStreamCmd(
     static const OptDescriptor compressionOpts[] = {
 	{ "-dictionary", OPT_COMPRESSION_DICTIONARY },
 	{ "-level",	 OPT_COMPRESSION_LEVEL },
+	{ "-threads",	 OPT_THREADS },
 	{ NULL, OPT_END }
     };
     static const OptDescriptor gzipOpts[] = {
 	{ "-header",	 OPT_GZIP_HEADER },
 	{ "-level",	 OPT_COMPRESSION_LEVEL },
+	{ "-threads",	 OPT_THREADS },
 	{ NULL, OPT_END }
     };
     static const OptDescriptor expansionOpts[] = {
@@ -2495,6 +3440,10 @@ ZlibStreamCmd(
 	Tcl_AddErrorInfo(interp, "\n    (in -level option)");
 	return TCL_ERROR;
     }
+    if (GetThreadsFromObj(interp, threadsObj, &threads) != TCL_OK) {
+	Tcl_AddErrorInfo(interp, "\n    (in -threads option)");
+	return TCL_ERROR;
+    }
 
     if (compDictObj) {
 	if (NULL == Tcl_GetBytesFromObj(interp, compDictObj, (Tcl_Size *)NULL)) {
@@ -2513,11 +3462,15 @@ ZlibStreamCmd(
     if (compDictObj != NULL) {
 	Tcl_ZlibStreamSetCompressionDictionary(zh, compDictObj);
     }
+    if (threads > 1) {
+	ZlibStreamStartThreads((ZlibStreamHandle *) zh, threads);
+    }
     Tcl_SetObjResult(interp, Tcl_ZlibStreamGetCommandName(zh));
     return TCL_OK;
 #undef compDictObj
 #undef gzipHeaderObj
 #undef levelObj
+#undef threadsObj
 }
 
 /*
@@ -2545,17 +3498,32 @@ ZlibPushCmd(
 	FMT_INFLATE
     } fmt;
     Tcl_Channel chan;
-    int chanMode, format, mode = 0, level, i;
-    static const char *const pushCompressOptions[] = {
-	"-dictionary", "-header", "-level", NULL
+    int chanMode, format, mode = 0, level, i, index;
+    enum pushOptionsEnum {
+	poBlockIndex, poDictionary, poHeader, poLevel, poLimit, poThreads
+    } option;
+    typedef struct {
+	const char *name;
+	enum pushOptionsEnum option;
+    } OptDescriptor;
+    static const OptDescriptor pushCompressOptions[] = {
+	{ "-blockindex", poBlockIndex },
+	{ "-dictionary", poDictionary },
+	{ "-header",	 poHeader },
+	{ "-level",	 poLevel },
+	{ "-threads",	 poThreads },
+	{ NULL, poBlockIndex }
     };
-    static const char *const pushDecompressOptions[] = {
-	"-dictionary", "-header", "-level", "-limit", NULL
+    static const OptDescriptor pushDecompressOptions[] = {
+	{ "-dictionary", poDictionary },
+	{ "-header",	 poHeader },
+	{ "-level",	 poLevel },
+	{ "-limit",	 poLimit },
+	{ NULL, poBlockIndex }
     };
-    const char *const *pushOptions = pushDecompressOptions;
-    enum pushOptionsEnum {poDictionary, poHeader, poLevel, poLimit} option;
+    const OptDescriptor *pushOptions = pushDecompressOptions;
     Tcl_Obj *headerObj = NULL, *compDictObj = NULL;
-    int limit = DEFAULT_BUFFER_SIZE;
+    int limit = DEFAULT_BUFFER_SIZE, threads = 1, withIndex = 0;
     Tcl_Size dummy;
 
     if (objc < 3) {
@@ -2628,17 +3596,28 @@ ZlibPushCmd(
 
     level = Z_DEFAULT_COMPRESSION;
     for (i=3 ; i<objc ; i++) {
-	if (Tcl_GetIndexFromObj(interp, objv[i], pushOptions, "option", 0,
-		&option) != TCL_OK) {
+	if (Tcl_GetIndexFromObjStruct(interp, objv[i], pushOptions,
+		sizeof(OptDescriptor), "option", 0, &index) != TCL_OK) {
 	    return TCL_ERROR;
 	}
+	option = pushOptions[index].option;
 	if (++i > objc - 1) {
 	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
-		    "value missing for %s option", pushOptions[option]));
+		    "value missing for %s option", pushOptions[index].name));
 	    Tcl_SetErrorCode(interp, "TCL", "ZIP", "NOVAL", (char *)NULL);
 	    return TCL_ERROR;
 	}
 	switch (option) {
+	case poBlockIndex:	/* -blockindex boolean */
+	    if (Tcl_GetBooleanFromObj(interp, objv[i], &withIndex) != TCL_OK) {
+		goto genericOptionError;
+	    }
+	    break;
+	case poThreads:		/* -threads count */
+	    if (GetThreadsFromObj(interp, objv[i], &threads) != TCL_OK) {
+		goto genericOptionError;
+	    }
+	    break;
 	case poHeader:		/* -header headerDict */
 	    headerObj = objv[i];
 	    if (Tcl_DictObjSize(interp, headerObj, &dummy) != TCL_OK) {
@@ -2683,7 +3662,7 @@ ZlibPushCmd(
     }
 
     if (ZlibStackChannelTransform(interp, mode, format, level, limit, chan,
-	    headerObj, compDictObj) == NULL) {
+	    headerObj, compDictObj, threads, withIndex) == NULL) {
 	return TCL_ERROR;
     }
     Tcl_SetObjResult(interp, objv[2]);
@@ -2691,7 +3670,7 @@ ZlibPushCmd(
 
   genericOptionError:
     Tcl_AddErrorInfo(interp, "\n    (in ");
-    Tcl_AddErrorInfo(interp, pushOptions[option]);
+    Tcl_AddErrorInfo(interp, pushOptions[index].name);
     Tcl_AddErrorInfo(interp, " option)");
     return TCL_ERROR;
 }
@@ -3128,7 +4107,24 @@ ZlibTransformClose(
      * Flush any data waiting to be compressed.
      */
 
-    if (chanDataPtr->mode == TCL_ZLIB_STREAM_DEFLATE) {
+    if (chanDataPtr->parallelPtr) {
+	e = ParallelDeflatePut(chanDataPtr->parallelPtr, NULL, 0, Z_FINISH);
+	if (e == Z_ERRNO) {
+	    if (!TclInThreadExit() && interp) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"error while finalizing file: %s",
+			Tcl_PosixError(interp)));
+	    }
+	    result = TCL_ERROR;
+	} else if (e != Z_OK) {
+	    if (!TclInThreadExit()) {
+		ConvertError(interp, e, chanDataPtr->parallelPtr->check);
+	    }
+	    result = TCL_ERROR;
+	}
+	ParallelDeflateDelete(chanDataPtr->parallelPtr);
+	chanDataPtr->parallelPtr = NULL;
+    } else if (chanDataPtr->mode == TCL_ZLIB_STREAM_DEFLATE) {
 	chanDataPtr->outStream.avail_in = 0;
 	do {
 	    e = Deflate(&chanDataPtr->outStream, chanDataPtr->outBuffer,
@@ -3373,6 +4369,27 @@ ZlibTransformOutput(
 	return 0;
     }
 
+    if (chanDataPtr->parallelPtr) {
+	e = ParallelDeflatePut(chanDataPtr->parallelPtr,
+		(const unsigned char *) buf, toWrite, Z_NO_FLUSH);
+	if (e == Z_OK) {
+	    return toWrite;
+	} else if (e == Z_ERRNO) {
+	    *errorCodePtr = Tcl_GetErrno();
+	    return -1;
+	}
+	errObj = Tcl_NewListObj(0, NULL);
+	Tcl_ListObjAppendElement(NULL, errObj, Tcl_NewStringObj(
+		"-errorcode", TCL_AUTO_LENGTH));
+	Tcl_ListObjAppendElement(NULL, errObj,
+		ConvertErrorToList(e, chanDataPtr->parallelPtr->check));
+	Tcl_ListObjAppendElement(NULL, errObj,
+		Tcl_NewStringObj(zError(e), TCL_AUTO_LENGTH));
+	Tcl_SetChannelError(chanDataPtr->parent, errObj);
+	*errorCodePtr = EINVAL;
+	return -1;
+    }
+
     chanDataPtr->outStream.next_in = (Bytef *) buf;
     chanDataPtr->outStream.avail_in = toWrite;
     while (chanDataPtr->outStream.avail_in > 0) {
@@ -3423,6 +4440,20 @@ ZlibTransformFlush(
     int e;
     size_t len;
 
+    if (chanDataPtr->parallelPtr) {
+	e = ParallelDeflatePut(chanDataPtr->parallelPtr, NULL, 0, flushType);
+	if (e == Z_ERRNO) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "problem flushing channel: %s",
+		    Tcl_PosixError(interp)));
+	    return TCL_ERROR;
+	} else if (e != Z_OK) {
+	    ConvertError(interp, e, chanDataPtr->parallelPtr->check);
+	    return TCL_ERROR;
+	}
+	return TCL_OK;
+    }
+
     chanDataPtr->outStream.avail_in = 0;
     do {
 	/*
@@ -3502,7 +4533,14 @@ ZlibTransformSetOption(			/* not used */
 	}
 	chanDataPtr->compDictObj = compDictObj;
 	code = Z_OK;
-	if (chanDataPtr->mode == TCL_ZLIB_STREAM_DEFLATE) {
+	if (chanDataPtr->parallelPtr) {
+	    code = ParallelDeflateSetDictionary(chanDataPtr->parallelPtr,
+		    compDictObj);
+	    if (code != Z_OK) {
+		ConvertError(interp, code, chanDataPtr->parallelPtr->check);
+		return TCL_ERROR;
+	    }
+	} else if (chanDataPtr->mode == TCL_ZLIB_STREAM_DEFLATE) {
 	    code = SetDeflateDictionary(&chanDataPtr->outStream, compDictObj);
 	    if (code != Z_OK) {
 		ConvertError(interp, code, chanDataPtr->outStream.adler);
@@ -3600,6 +4638,27 @@ ZlibTransformGetOption(
     static const char *gzipChanOptions = "checksum";
     static const char *decompressChanOptions = "checksum dictionary limit";
     static const char *gunzipChanOptions = "checksum header limit";
+    static const char *indexedCompressChanOptions =
+	    "blockindex checksum dictionary";
+    static const char *indexedGzipChanOptions = "blockindex checksum";
+    Tcl_Obj *indexObj = (chanDataPtr->parallelPtr
+	    ? chanDataPtr->parallelPtr->indexObj : NULL);
+
+    /*
+     * The "blockindex" option, only valid on compressing channels pushed
+     * with -blockindex, reports where the blocks written so far start.
+     */
+
+    if (indexObj && (optionName == NULL
+	    || strcmp(optionName, "-blockindex") == 0)) {
+	if (optionName == NULL) {
+	    Tcl_DStringAppendElement(dsPtr, "-blockindex");
+	    Tcl_DStringAppendElement(dsPtr, TclGetString(indexObj));
+	} else {
+	    TclDStringAppendObj(dsPtr, indexObj);
+	    return TCL_OK;
+	}
+    }
 
     /*
      * The "crc" option reports the current CRC (calculated with the Adler32
@@ -3611,7 +4670,9 @@ ZlibTransformGetOption(
 	uLong crc;
 	char buf[12];
 
-	if (chanDataPtr->mode == TCL_ZLIB_STREAM_DEFLATE) {
+	if (chanDataPtr->parallelPtr) {
+	    crc = chanDataPtr->parallelPtr->check;
+	} else if (chanDataPtr->mode == TCL_ZLIB_STREAM_DEFLATE) {
 	    crc = chanDataPtr->outStream.adler;
 	} else {
 	    crc = chanDataPtr->inStream.adler;
@@ -3688,12 +4749,13 @@ ZlibTransformGetOption(
     }
     if (chanDataPtr->format == TCL_ZLIB_FORMAT_GZIP) {
 	return Tcl_BadChannelOption(interp, optionName,
-		(chanDataPtr->mode == TCL_ZLIB_STREAM_DEFLATE)
-		? gzipChanOptions : gunzipChanOptions);
+		(chanDataPtr->mode != TCL_ZLIB_STREAM_DEFLATE) ? gunzipChanOptions
+		: indexObj ? indexedGzipChanOptions : gzipChanOptions);
     } else {
 	return Tcl_BadChannelOption(interp, optionName,
-		(chanDataPtr->mode == TCL_ZLIB_STREAM_DEFLATE)
-		? compressChanOptions : decompressChanOptions);
+		(chanDataPtr->mode != TCL_ZLIB_STREAM_DEFLATE)
+		? decompressChanOptions : indexObj
+		? indexedCompressChanOptions : compressChanOptions);
     }
 }
 
@@ -3842,9 +4904,15 @@ ZlibStackChannelTransform(
     Tcl_Obj *gzipHeaderDictPtr,	/* A description of header to use, or NULL to
 				 * use a default. Ignored if not compressing
 				 * to produce gzip-format data. */
-    Tcl_Obj *compDictObj)	/* Byte-array object containing compression
+    Tcl_Obj *compDictObj,	/* Byte-array object containing compression
 				 * dictionary (not dictObj!) to use if
 				 * necessary. */
+    int threads,		/* Number of blocks to compress at once, 1 to
+				 * compress in a single stream. Ignored for
+				 * decompressing transforms. */
+    int withIndex)		/* Whether to compress in independent blocks
+				 * and list where they start. Ignored for
+				 * decompressing transforms. */
 {
     ZlibChannelData *chanDataPtr = (ZlibChannelData *)
 	    Tcl_Alloc(sizeof(ZlibChannelData));
@@ -3929,6 +4997,17 @@ ZlibStackChannelTransform(
 		goto error;
 	    }
 	}
+    } else if (threads > 1 || withIndex) {
+	chanDataPtr->parallelPtr = ParallelDeflateCreate(format, level,
+		threads, (HaveFlag(chanDataPtr, OUT_HEADER)
+		? &chanDataPtr->outHeader.header : NULL), withIndex,
+		WriteToParent, chanDataPtr);
+	if (chanDataPtr->compDictObj) {
+	    if (ParallelDeflateSetDictionary(chanDataPtr->parallelPtr,
+		    chanDataPtr->compDictObj) != Z_OK) {
+		goto error;
+	    }
+	}
     } else {
 	if (deflateInit2(&chanDataPtr->outStream, level, Z_DEFLATED, wbits,
 		MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
@@ -3970,6 +5049,9 @@ ZlibStackChannelTransform(
 	Tcl_Free(chanDataPtr->outBuffer);
 	deflateEnd(&chanDataPtr->outStream);
     }
+    if (chanDataPtr->parallelPtr) {
+	ParallelDeflateDelete(chanDataPtr->parallelPtr);
+    }
     if (chanDataPtr->compDictObj) {
 	Tcl_DecrRefCount(chanDataPtr->compDictObj);
     }
@@ -3977,6 +5059,35 @@ ZlibStackChannelTransform(
     return NULL;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * WriteToParent --
+ *
+ *	Output procedure of the compressor in blocks of a compressing
+ *	transform, that writes to the underlying channel.
+ *
+ * Results:
+ *	TCL_OK, or TCL_ERROR with the error in errno.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+WriteToParent(
+    void *clientData,
+    const unsigned char *bytes,
+    size_t length)
+{
+    ZlibChannelData *chanDataPtr = (ZlibChannelData *) clientData;
+
+    if (Tcl_WriteRaw(chanDataPtr->parent, (const char *) bytes,
+	    length) == TCL_IO_FAILURE) {
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -21,7 +21,7 @@ namespace eval tcltest {
     # When the version number changes, be sure to update the pkgIndex.tcl file,
     # and the install directory in the Makefiles.  When the minor version
     # changes (new feature) be sure to update the man page as well.
-    variable Version 2.6.0
+    variable Version 2.7.0
 
     # Compatibility support for dumb variables defined in tcltest 1
     # Do not use these.  Call [package require] and [info patchlevel]
@@ -48,6 +48,7 @@ namespace eval tcltest {
     }
     namespace export debug		;#	[configure -debug]
     namespace export errorFile		;#	[configure -errfile]
+    namespace export jobs		;#	[configure -jobs]
     namespace export limitConstraints	;#	[configure -limitconstraints]
     namespace export loadFile		;#	[configure -loadfile]
     namespace export loadScript		;#	[configure -load]
@@ -58,6 +59,7 @@ namespace eval tcltest {
     namespace export normalizePath	;#	[file normalize] (8.4)
     namespace export outputFile		;#	[configure -outfile]
     namespace export preserveCore	;#	[configure -preservecore]
+    namespace export reportFile		;#	[configure -reportfile]
     namespace export singleProcess	;#	[configure -singleproc]
     namespace export skip		;#	[configure -skip]
     namespace export skipFiles		;#	[configure -notfile]
@@ -753,6 +755,30 @@ namespace eval tcltest {
 	whether to run all tests in one process
     } AcceptBoolean singleProcess
 
+    proc AcceptJobs { count } {
+	set count [AcceptInteger $count]
+	if {$count < 1} {
+	    return -code error "expected a positive integer but got \"$count\""
+	}
+	return $count
+    }
+
+    # Default is to run one test file at a time
+    Option -jobs 1 {
+	number of test files to run at once, each in its own process
+    } AcceptJobs jobs
+
+    proc AcceptReportFile { file } {
+	if {$file eq {}} {return $file}
+	return [file join [temporaryDirectory] $file]
+    }
+
+    # No machine-readable report of individual tests by default
+    Option -reportfile {} {
+	Append a JSON record of each test result and its run time to the
+	specified file.
+    } AcceptReportFile reportFile
+
     # Default is to run each test once
     Option -iterations 1 {
 	number of times to run each test
@@ -2073,7 +2099,7 @@ proc tcltest::TestOnce {name description args} {
     if {$processTest && !$setupFailure} {
 
 	# Register startup time
-	if {[IsVerbose msec] || [IsVerbose usec]} {
+	if {[IsVerbose msec] || [IsVerbose usec] || [reportFile] ne ""} {
 	    set timeStart [clock microseconds]
 	}
 
@@ -2195,7 +2221,8 @@ proc tcltest::TestOnce {name description args} {
 	}
     }
 
-    if {[IsVerbose msec] || [IsVerbose usec]} {
+    set t {}
+    if {[info exists timeStart]} {
 	set t [expr {[clock microseconds] - $timeStart}]
 	if {[IsVerbose usec]} {
 	    puts [outputChannel] "++++ $name took $t \xB5s"
@@ -2218,6 +2245,7 @@ proc tcltest::TestOnce {name description args} {
 	    || $errorCodeFailure || $scriptFailure)} {
 	if {$testLevel == 1} {
 	    incr numTests(Passed)
+	    ReportTest $name passed $t
 	    if {[IsVerbose pass]} {
 		puts [outputChannel] "++++ $name PASSED"
 	    }
@@ -2229,6 +2257,7 @@ proc tcltest::TestOnce {name description args} {
     # We know the test failed, tally it...
     if {$testLevel == 1} {
 	incr numTests(Failed)
+	ReportTest $name failed $t
     }
 
     # ... then report according to the type of failure
@@ -2379,9 +2408,62 @@ proc tcltest::_noticeSkipped {name reason} {
     if {$testLevel == 1} {
 	incr numTests(Skipped)
 	AddToSkippedBecause $reason
+	ReportTest $name skipped
+    }
+}
+
+
+# ReportTest --
+#
+# Appends a one-line JSON record describing the outcome of a test to the
+# file named by [configure -reportfile], if any.  The file is opened for
+# appending for each record and closed again, so that it never shows up in
+# [file channels] of the tests and so that the child processes started by
+# runAllTests can all write to it as their tests finish.
+#
+# Arguments:
+#	name	Name of the test.
+#	result	One of "passed", "failed" or "skipped".
+#	usec	Wall time taken by the test in microseconds, if known.
+#
+# Side Effects:  None.
+#
+proc tcltest::ReportTest {name result {usec {}}} {
+    set file [reportFile]
+    if {$file eq ""} {
+	return
+    }
+    set record [list "\"file\":[JsonString [file tail [info script]]]" \
+	    "\"test\":[JsonString $name]" "\"result\":\"$result\""]
+    if {$usec ne ""} {
+	lappend record "\"usec\":$usec"
     }
+    set chan [open $file {WRONLY APPEND CREAT}]
+    fconfigure $chan -encoding utf-8 -translation lf
+    puts $chan "\{[join $record ,]\}"
+    close $chan
 }
 
+# JsonString --
+#
+# Quotes a string as a JSON string literal.
+#
+proc tcltest::JsonString {string} {
+    set string [string map {\\ \\\\ \" \\\"} $string]
+    if {[regexp {[\x00-\x1F]} $string]} {
+	set quoted ""
+	foreach char [split $string ""] {
+	    scan $char %c code
+	    if {$code < 0x20} {
+		append quoted [format \\u%04x $code]
+	    } else {
+		append quoted $char
+	    }
+	}
+	set string $quoted
+    }
+    return "\"$string\""
+}
 
 # Skipped --
 #
@@ -2430,6 +2512,7 @@ proc tcltest::Skipped {name constraints} {
 	    AddToSkippedBecause userSpecifiedLimitConstraint
 	    if {$testLevel == 1} {
 		incr numTests(Skipped)
+		ReportTest $name skipped
 	    }
 	    return 1
 	}
@@ -2887,8 +2970,6 @@ proc tcltest::runAllTests { {shell ""} } {
     variable testSingleFile
     variable numTestFiles
     variable numTests
-    variable failFiles
-    variable DefaultValue
     variable fullutf
 
     FillFilesExisted
@@ -2917,6 +2998,9 @@ proc tcltest::runAllTests { {shell ""} } {
     if {[singleProcess]} {
 	puts [outputChannel] \
 		"Test files sourced into current interpreter"
+    } elseif {[jobs] > 1} {
+	puts [outputChannel] \
+		"Test files run in separate interpreters, [jobs] at a time"
     } else {
 	puts [outputChannel] \
 		"Test files run in separate interpreters"
@@ -2939,7 +3023,15 @@ proc tcltest::runAllTests { {shell ""} } {
     puts [outputChannel] "Tests began at [eval $timeCmd]"
 
     # Run each of the specified tests
-    foreach file [lsort [GetMatchingFiles]] {
+    set files [lsort [GetMatchingFiles]]
+    if {![singleProcess] && [jobs] > 1} {
+	set failed [RunChildrenInParallel $shell $files testFileFailures]
+	if {$failed} {
+	    set failFilesSet 1
+	}
+	set files {}
+    }
+    foreach file $files {
 	set tail [file tail $file]
 	puts [outputChannel] $tail
 	flush [outputChannel]
@@ -2958,20 +3050,7 @@ proc tcltest::runAllTests { {shell ""} } {
 		set failFilesSet 1
 	    }
 	} else {
-	    # Pass along our configuration to the child processes.
-	    # EXCEPT for the -outfile, because the parent process
-	    # needs to read and process output of children.
-	    set childargv [list]
-	    foreach opt [Configure] {
-		if {$opt eq "-outfile"} {continue}
-		set value [Configure $opt]
-		# Don't bother passing default configuration options
-		if {$value eq $DefaultValue($opt)} {
-			continue
-		}
-		lappend childargv $opt $value
-	    }
-	    set cmd [linsert $childargv 0 | $shell $file]
+	    set cmd [linsert [ChildArguments] 0 | $shell $file]
 	    if {[catch {
 		incr numTestFiles
 		set pipeFd [open $cmd "r"]
@@ -2979,31 +3058,8 @@ proc tcltest::runAllTests { {shell ""} } {
 		    fconfigure $pipeFd -profile tcl8 -encoding utf-8
 		}
 		while {[gets $pipeFd line] >= 0} {
-		    if {[regexp [join {
-			    {^([^:]+):\t}
-			    {Total\t([0-9]+)\t}
-			    {Passed\t([0-9]+)\t}
-			    {Skipped\t([0-9]+)\t}
-			    {Failed\t([0-9]+)}
-			    } ""] $line null testFile \
-			    Total Passed Skipped Failed]} {
-			foreach index {Total Passed Skipped Failed} {
-			    incr numTests($index) [set $index]
-			}
-			if {$Failed > 0} {
-			    lappend failFiles $testFile
-			    set failFilesSet 1
-			}
-		    } elseif {[regexp [join {
-			    {^Number of tests skipped }
-			    {for each constraint:}
-			    {|^\t(\d+)\t(.+)$}
-			    } ""] $line match skipped constraint]} {
-			if {[string match \t* $match]} {
-			    AddToSkippedBecause $constraint $skipped
-			}
-		    } else {
-			puts [outputChannel] $line
+		    if {[ProcessChildLine $line]} {
+			set failFilesSet 1
 		    }
 		}
 		close $pipeFd
@@ -3042,6 +3098,205 @@ proc tcltest::runAllTests { {shell ""} } {
     return [expr {[info exists testFileFailures] || [info exists failFilesSet]}]
 }
 
+# tcltest::ChildArguments --
+#
+#	Builds the command line arguments that pass our configuration along
+#	to the child processes that run test files, EXCEPT for the -outfile,
+#	because the parent process needs to read and process output of
+#	children.
+#
+# Arguments:
+#	None.
+#
+# Results:
+#	A list of option/value pairs.
+#
+# Side effects:
+#	None.
+
+proc tcltest::ChildArguments {} {
+    variable DefaultValue
+
+    set childargv [list]
+    foreach opt [Configure] {
+	if {$opt eq "-outfile"} {continue}
+	set value [Configure $opt]
+	# Don't bother passing default configuration options
+	if {$value eq $DefaultValue($opt)} {
+		continue
+	}
+	lappend childargv $opt $value
+    }
+    return $childargv
+}
+
+# tcltest::ProcessChildLine --
+#
+#	Handles one line of output from a child process running a test file.
+#	The summary lines are added to the totals of this process; any other
+#	line is passed on to the output channel.
+#
+# Arguments:
+#	line	The line of output.
+#	outVar	If given, name of a variable in the caller to which lines
+#		that are to be shown are appended instead of being written to
+#		the output channel.
+#
+# Results:
+#	1 if the line reports failed tests, 0 otherwise.
+#
+# Side effects:
+#	Updates numTests, failFiles and the skipped constraint counts.
+
+proc tcltest::ProcessChildLine {line {outVar {}}} {
+    variable numTests
+    variable failFiles
+
+    if {[regexp [join {
+	    {^([^:]+):\t}
+	    {Total\t([0-9]+)\t}
+	    {Passed\t([0-9]+)\t}
+	    {Skipped\t([0-9]+)\t}
+	    {Failed\t([0-9]+)}
+	    } ""] $line null testFile \
+	    Total Passed Skipped Failed]} {
+	foreach index {Total Passed Skipped Failed} {
+	    incr numTests($index) [set $index]
+	}
+	if {$Failed > 0} {
+	    lappend failFiles $testFile
+	    return 1
+	}
+    } elseif {[regexp [join {
+	    {^Number of tests skipped }
+	    {for each constraint:}
+	    {|^\t(\d+)\t(.+)$}
+	    } ""] $line match skipped constraint]} {
+	if {[string match \t* $match]} {
+	    AddToSkippedBecause $constraint $skipped
+	}
+    } elseif {$outVar ne ""} {
+	upvar 1 $outVar out
+	append out $line \n
+    } else {
+	puts [outputChannel] $line
+    }
+    return 0
+}
+
+# tcltest::RunChildrenInParallel --
+#
+#	Runs test files in child processes, up to [jobs] of them at a time.
+#	Test files commonly create scratch files with fixed names, so each
+#	child gets a subdirectory of [temporaryDirectory] of its own, both as
+#	its working directory and as its -tmpdir.  The output of each child is
+#	gathered while it runs and written to the output channel in one piece
+#	once it exits, so the reports of different files are not interleaved;
+#	the summary lines are tallied as they arrive.
+#
+# Arguments:
+#	shell		The interpreter to run the test files with.
+#	files		The test files to run.
+#	failuresVar	Name of a variable in the caller to which the names of
+#			files that could not be run are appended.
+#
+# Results:
+#	1 if any test failed, 0 otherwise.
+#
+# Side effects:
+#	Updates the test totals; see ProcessChildLine.  The subdirectories
+#	are deleted afterwards.
+
+proc tcltest::RunChildrenInParallel {shell files failuresVar} {
+    variable numTestFiles
+    variable fullutf
+    variable ParallelState
+    upvar 1 $failuresVar testFileFailures
+
+    array unset ParallelState
+    set ParallelState(running) 0
+    set ParallelState(failed) 0
+    set ParallelState(free) {}
+    set childargv [dict remove [ChildArguments] -tmpdir]
+    set dirs {}
+    for {set slot 0} {$slot < [jobs]} {incr slot} {
+	lappend ParallelState(free) $slot
+	lappend dirs [file join [temporaryDirectory] tcltest-job$slot]
+    }
+
+    while {[llength $files] || $ParallelState(running)} {
+	while {[llength $files] && [llength $ParallelState(free)]} {
+	    set files [lassign $files file]
+	    set ParallelState(free) [lassign $ParallelState(free) slot]
+	    set dir [lindex $dirs $slot]
+	    incr numTestFiles
+	    set cwd [pwd]
+	    set code [catch {
+		file mkdir $dir
+		cd $dir
+		open [linsert $childargv 0 | $shell $file -tmpdir $dir] "r"
+	    } pipeFd]
+	    cd $cwd
+	    if {$code} {
+		puts [outputChannel] [file tail $file]
+		puts [outputChannel] "Test file error: $pipeFd"
+		lappend testFileFailures $file
+		lappend ParallelState(free) $slot
+		continue
+	    }
+	    if {$fullutf} {
+		fconfigure $pipeFd -profile tcl8 -encoding utf-8
+	    }
+	    fconfigure $pipeFd -blocking 0
+	    set ParallelState(file,$pipeFd) $file
+	    set ParallelState(slot,$pipeFd) $slot
+	    set ParallelState(out,$pipeFd) ""
+	    fileevent $pipeFd readable \
+		    [namespace code [list ParallelChildReadable $pipeFd]]
+	    incr ParallelState(running)
+	}
+	vwait [namespace which -variable ParallelState](running)
+    }
+    if {[info exists ParallelState(errors)]} {
+	lappend testFileFailures {*}$ParallelState(errors)
+    }
+    set failed $ParallelState(failed)
+    array unset ParallelState
+    file delete -force {*}$dirs
+    return $failed
+}
+
+# tcltest::ParallelChildReadable --
+#
+#	File event handler for the output of a child process started by
+#	RunChildrenInParallel.
+
+proc tcltest::ParallelChildReadable {pipeFd} {
+    variable ParallelState
+
+    while {[gets $pipeFd line] >= 0} {
+	if {[ProcessChildLine $line ParallelState(out,$pipeFd)]} {
+	    set ParallelState(failed) 1
+	}
+    }
+    if {![eof $pipeFd]} {
+	return
+    }
+    set file $ParallelState(file,$pipeFd)
+    puts [outputChannel] [file tail $file]
+    puts -nonewline [outputChannel] $ParallelState(out,$pipeFd)
+    fconfigure $pipeFd -blocking 1
+    if {[catch {close $pipeFd} msg]} {
+	puts [outputChannel] "Test file error: $msg"
+	lappend ParallelState(errors) $file
+    }
+    flush [outputChannel]
+    lappend ParallelState(free) $ParallelState(slot,$pipeFd)
+    unset ParallelState(file,$pipeFd) ParallelState(slot,$pipeFd) \
+	    ParallelState(out,$pipeFd)
+    incr ParallelState(running) -1
+}
+
 #####################################################################
 
 # Test utility procs - not used in tcltest, but may be useful for
@@ -105,6 +105,35 @@ proc test-access {{reptime {1000 5000}}} {
   }]
 }
 
+proc test-scale {{reptime {1000 10000}}} {
+  set howmuch [lindex $reptime 1]
+
+  puts "*** with $howmuch timers pending ***"
+  _test_run $reptime [string map [list \{*\}\$reptime $reptime \$howmuch $howmuch] {
+    # arm $howmuch timeouts spread over 1 .. 3600 seconds (like one per connection):
+    setup {set i -1; while {[incr i] < $howmuch} {set ev($i) [after [expr {1000 + int(rand()*3600000)}] {set foo bar}]}}
+    # arm and cancel one more timeout (before the others):
+    {after cancel [after 500 {set foo bar}]}
+    # arm and cancel one more timeout (in between the others):
+    {after cancel [after [expr {1000 + int(rand()*3600000)}] {set foo bar}]}
+    # arm and cancel one more timeout (after the others):
+    {after cancel [after 4000000 {set foo bar}]}
+    # re-arm a random timeout (cancel + arm, like activity on a connection):
+    {set j [expr {int(rand()*$howmuch)}]; after cancel $ev($j); set ev($j) [after [expr {1000 + int(rand()*3600000)}] {set foo bar}]}
+    # event random access: after info of a random timeout:
+    {after info $ev([expr {int(rand()*$howmuch)}])}
+    # service the timer queue (nothing due):
+    {update}
+    # cancel up to $howmuch timeouts:
+    setup {set i -1}
+    {after cancel $ev([incr i]); if {$i >= $howmuch - 1} break}
+    cleanup {foreach i [after info] {after cancel $i}; unset -nocomplain ev}
+
+    # end $howmuch events.
+    cleanup {if [llength [after info]] {error "unexpected: [llength [after info]] events are still there."}}
+  }]
+}
+
 proc test-exec {{reptime 1000}} {
   _test_run $reptime {
     # after idle + after cancel
@@ -165,6 +194,11 @@ proc test {{reptime 1000}} {
     test-queue [list $reptime $howmuch]
   }
 
+  puts ""
+  foreach howmuch { 1000 10000 100000 } {
+    test-scale [list $reptime $howmuch]
+  }
+
   puts \n**OK**
 }
 
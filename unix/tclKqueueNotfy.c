@@ -41,7 +41,6 @@ typedef struct FileHandler {
     Tcl_FileProc *proc;		/* Function to call, in the style of
 				 * Tcl_CreateFileHandler. */
     void *clientData;		/* Argument to pass to proc. */
-    struct FileHandler *nextPtr;/* Next in list of all files we care about. */
     LIST_ENTRY(FileHandler) readyNode;
 				/* Next/previous in list of FileHandlers asso-
 				 * ciated with regular files (S_IFREG) that are
@@ -86,8 +85,9 @@ typedef struct {
 
 LIST_HEAD(PlatformReadyFileHandlerList, FileHandler);
 typedef struct ThreadSpecificData {
-    FileHandler *firstFileHandlerPtr;
-				/* Pointer to head of file handler list. */
+    Tcl_HashTable fileHandlerTable;
+				/* Maps the fds we care about to their
+				 * FileHandler. */
     struct PlatformReadyFileHandlerList firstReadyFileHandlerPtr;
 				/* Pointer to head of list of FileHandlers
 				 * associated with regular files (S_IFREG)
@@ -294,6 +294,7 @@ TclpFinalizeNotifier(
 	Tcl_Free(tsdPtr->readyEvents);
 	tsdPtr->maxReadyEvents = 0;
     }
+    Tcl_DeleteHashTable(&tsdPtr->fileHandlerTable);
     pthread_mutex_unlock(&tsdPtr->notifierMutex);
     if ((errno = pthread_mutex_destroy(&tsdPtr->notifierMutex))) {
 	Tcl_Panic("pthread_mutex_destroy: %s", strerror(errno));
@@ -368,6 +369,7 @@ TclpInitNotifier(void)
 		tsdPtr->maxReadyEvents * sizeof(tsdPtr->readyEvents[0]));
     }
     LIST_INIT(&tsdPtr->firstReadyFileHandlerPtr);
+    Tcl_InitHashTable(&tsdPtr->fileHandlerTable, TCL_ONE_WORD_KEYS);
 
     return tsdPtr;
 }
@@ -520,21 +522,34 @@ TclpCreateFileHandler(
     void *clientData)		/* Arbitrary data to pass to proc. */
 {
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
-    FileHandler *filePtr = LookUpFileHandler(tsdPtr, fd, NULL);
-    bool isNew = (filePtr == NULL);
+    FileHandler *filePtr;
+    int isNew;
+    Tcl_HashEntry *hPtr = Tcl_CreateHashEntry(&tsdPtr->fileHandlerTable,
+	    INT2PTR(fd), &isNew);
 
     if (isNew) {
 	filePtr = (FileHandler *) Tcl_Alloc(sizeof(FileHandler));
 	filePtr->fd = fd;
 	filePtr->readyMask = 0;
-	filePtr->nextPtr = tsdPtr->firstFileHandlerPtr;
-	tsdPtr->firstFileHandlerPtr = filePtr;
+	Tcl_SetHashValue(hPtr, filePtr);
+    } else {
+	filePtr = (FileHandler *) Tcl_GetHashValue(hPtr);
     }
     filePtr->proc = proc;
     filePtr->clientData = clientData;
+
+    /*
+     * Channels set their file handler again whenever their interest might
+     * have changed, which is several times per event on a busy socket. Only
+     * tell the kernel when it actually has.
+     */
+
+    if (!isNew && (filePtr->mask == mask)) {
+	return;
+    }
     filePtr->mask = mask;
 
-    PlatformEventsControl(filePtr, tsdPtr, EV_ADD, isNew);
+    PlatformEventsControl(filePtr, tsdPtr, EV_ADD, isNew != 0);
 }
 
 /*
@@ -562,17 +577,19 @@ TclpDeleteFileHandler(
     int fd)			/* Stream id for which to remove callback
 				 * function. */
 {
+    FileHandler *filePtr;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
-    FileHandler *filePtr, *prevPtr;
+    Tcl_HashEntry *hPtr;
 
     /*
      * Find the entry for the given file (and return if there isn't one).
      */
 
-    filePtr = LookUpFileHandler(tsdPtr, fd, &prevPtr);
-    if (filePtr == NULL) {
+    hPtr = Tcl_FindHashEntry(&tsdPtr->fileHandlerTable, INT2PTR(fd));
+    if (hPtr == NULL) {
 	return;
     }
+    filePtr = (FileHandler *) Tcl_GetHashValue(hPtr);
 
     /*
      * Update the check masks for this file.
@@ -587,11 +604,7 @@ TclpDeleteFileHandler(
      * Clean up information in the callback record.
      */
 
-    if (prevPtr == NULL) {
-	tsdPtr->firstFileHandlerPtr = filePtr->nextPtr;
-    } else {
-	prevPtr->nextPtr = filePtr->nextPtr;
-    }
+    Tcl_DeleteHashEntry(hPtr);
     Tcl_Free(filePtr);
 }
 
@@ -11,10 +11,20 @@
  * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE		/* For splice(2) and pipe2(2) */
+#endif
 #include "tclInt.h"	/* Internal definitions for Tcl. */
 #include "tclFileSystem.h"
 #include "tclIO.h"	/* To get Channel type declaration. */
 
+#ifdef __linux__
+#   include <poll.h>
+#   include <sys/ioctl.h>
+#   include <sys/sendfile.h>
+#   include <sys/syscall.h>
+#endif /* __linux__ */
+
 #if defined(HAVE_TERMIOS_H)
 #   include <termios.h>
 #   ifdef HAVE_SYS_IOCTL_H
@@ -107,6 +117,41 @@ typedef struct {
 
 #endif	/* HAVE_TERMIOS_H */
 
+#ifdef __linux__
+
+/*
+ * The following structure describes a zero-copy transfer between two
+ * channels, as set up by TclpSpliceOpen for [chan copy]. The kernel moves
+ * the data; nothing passes through user space.
+ */
+
+enum SpliceMethods {
+    SPLICE_COPY_RANGE,		/* copy_file_range(2): file to file. */
+    SPLICE_SENDFILE,		/* sendfile(2): file to anything. */
+    SPLICE_DIRECT,		/* splice(2): one side is a pipe. */
+    SPLICE_PIPE			/* splice(2) through a private pipe. */
+};
+
+typedef struct {
+    int inFd;			/* Descriptor data is read from. */
+    int outFd;			/* Descriptor data is written to. */
+    int method;			/* One of the SpliceMethods. */
+    int pipeFds[2];		/* Private pipe for SPLICE_PIPE, or -1. */
+    size_t pending;		/* Bytes sitting in the private pipe. */
+    bool moved;			/* Whether any data has been moved yet. While
+				 * not, unsupported methods can be abandoned
+				 * in favour of the next one. */
+} SpliceState;
+
+/*
+ * Largest amount of data moved by one call of TclpSplice. Keeps background
+ * copies from starving the event loop.
+ */
+
+#define SPLICE_CHUNK	(1 << 20)
+
+#endif /* __linux__ */
+
 #define UNSUPPORTED_OPTION(detail) \
     if (interp) {							\
 	Tcl_SetObjResult(interp, Tcl_ObjPrintf(				\
@@ -2138,6 +2183,347 @@ Tcl_GetOpenFile(
     return TCL_ERROR;
 }
 
+#ifdef __linux__
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetSpliceFd --
+ *
+ *	Gets the descriptor of a channel that the kernel may move data to or
+ *	from on behalf of TclpSplice. Only the core file, socket and pipe
+ *	drivers qualify, and only for regular files, sockets and pipes; the
+ *	other drivers may interpret the data.
+ *
+ * Results:
+ *	The descriptor, or -1 if the channel does not qualify.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetSpliceFd(
+    Tcl_Channel chan,		/* Channel to get the descriptor of. */
+    int direction,		/* TCL_READABLE or TCL_WRITABLE. */
+    Tcl_StatBuf *statPtr)	/* Where to store the status of the
+				 * descriptor. */
+{
+    const Tcl_ChannelType *chanTypePtr = Tcl_GetChannelType(chan);
+    void *data;
+    int fd;
+
+    if (chanTypePtr != &fileChannelType
+	    && strcmp(chanTypePtr->typeName, "pipe") != 0) {
+	Tcl_DString ds;
+	int connecting;
+
+	if (strcmp(chanTypePtr->typeName, "tcp") != 0) {
+	    return -1;
+	}
+
+	/*
+	 * Leave sockets that are still connecting to the driver, which knows
+	 * how to wait for them and how to try the next address.
+	 */
+
+	Tcl_DStringInit(&ds);
+	connecting = Tcl_GetChannelOption(NULL, chan, "-connecting", &ds)
+		!= TCL_OK || strcmp(Tcl_DStringValue(&ds), "0") != 0;
+	Tcl_DStringFree(&ds);
+	if (connecting) {
+	    return -1;
+	}
+    }
+    if (Tcl_GetChannelHandle(chan, direction, &data) != TCL_OK) {
+	return -1;
+    }
+    fd = PTR2INT(data);
+    if (TclOSfstat(fd, statPtr) != 0 || !(S_ISREG(statPtr->st_mode)
+	    || S_ISSOCK(statPtr->st_mode) || S_ISFIFO(statPtr->st_mode))) {
+	return -1;
+    }
+    return fd;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpSpliceOpen --
+ *
+ *	Prepares for copying data between two unstacked channels in binary
+ *	mode without passing it through user space. Regular files are copied
+ *	with copy_file_range(2) or sent with sendfile(2); everything else goes
+ *	through splice(2), using a private pipe when neither side is one.
+ *
+ * Results:
+ *	A token to pass to TclpSplice and TclpSpliceClose, or NULL if the
+ *	channels must be copied the ordinary way.
+ *
+ * Side effects:
+ *	May create a pipe.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void *
+TclpSpliceOpen(
+    Tcl_Channel inChan,		/* Channel to read from. */
+    Tcl_Channel outChan)	/* Channel to write to. */
+{
+    SpliceState *spPtr;
+    Tcl_StatBuf inStat, outStat;
+    int inFd, outFd, flags;
+
+    inFd = GetSpliceFd(inChan, TCL_READABLE, &inStat);
+    if (inFd < 0) {
+	return NULL;
+    }
+    outFd = GetSpliceFd(outChan, TCL_WRITABLE, &outStat);
+    if (outFd < 0 || outFd == inFd) {
+	return NULL;
+    }
+
+    /*
+     * None of the system calls append, so leave append-mode files alone.
+     */
+
+    flags = fcntl(outFd, F_GETFL);
+    if (flags == -1 || (flags & O_APPEND)) {
+	return NULL;
+    }
+
+    spPtr = (SpliceState *)Tcl_Alloc(sizeof(SpliceState));
+    spPtr->inFd = inFd;
+    spPtr->outFd = outFd;
+    spPtr->pipeFds[0] = spPtr->pipeFds[1] = -1;
+    spPtr->pending = 0;
+    spPtr->moved = false;
+    if (S_ISREG(inStat.st_mode)) {
+	spPtr->method = S_ISREG(outStat.st_mode)
+		? SPLICE_COPY_RANGE : SPLICE_SENDFILE;
+    } else if (S_ISFIFO(inStat.st_mode) || S_ISFIFO(outStat.st_mode)) {
+	spPtr->method = SPLICE_DIRECT;
+    } else {
+	spPtr->method = SPLICE_PIPE;
+    }
+    return spPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpSplice --
+ *
+ *	Moves up to toCopy bytes (all of them if toCopy is negative) from the
+ *	input to the output of a splice set up by TclpSpliceOpen. Blocks only
+ *	if the descriptors are in blocking mode.
+ *
+ * Results:
+ *	The number of bytes written, which is positive, or 0 at the end of the
+ *	input. Otherwise -1 with an error code in *errorCodePtr: EAGAIN if a
+ *	descriptor would block, or EOPNOTSUPP if the kernel cannot move this
+ *	data and the caller should copy it the ordinary way. The latter only
+ *	happens before any data has moved. In all cases *maskPtr is set to
+ *	the direction (TCL_READABLE or TCL_WRITABLE) to wait for before the
+ *	next call, or that failed.
+ *
+ * Side effects:
+ *	Reads and writes the descriptors and moves their offsets.
+ *
+ *----------------------------------------------------------------------
+ */
+
+long long
+TclpSplice(
+    void *splicePtr,		/* Token returned by TclpSpliceOpen. */
+    long long toCopy,		/* Bytes left to copy, or -1 for all. */
+    int *maskPtr,		/* Where to store the direction to wait for
+				 * before the next call. */
+    int *errorCodePtr)		/* Where to store the error code. */
+{
+    SpliceState *spPtr = (SpliceState *)splicePtr;
+    size_t want = SPLICE_CHUNK;
+    ssize_t n;
+
+    if (toCopy >= 0 && toCopy < SPLICE_CHUNK) {
+	want = (size_t) toCopy;
+    }
+    *maskPtr = TCL_READABLE;
+
+    switch (spPtr->method) {
+    case SPLICE_COPY_RANGE:
+#ifdef __NR_copy_file_range
+	n = syscall(__NR_copy_file_range, spPtr->inFd, NULL, spPtr->outFd,
+		NULL, want, 0);
+	if (n >= 0 || spPtr->moved || (errno != EXDEV && errno != EINVAL
+		&& errno != ENOSYS && errno != EOPNOTSUPP)) {
+	    break;
+	}
+#endif /* __NR_copy_file_range */
+	spPtr->method = SPLICE_SENDFILE;
+	TCL_FALLTHROUGH();
+    case SPLICE_SENDFILE:
+	n = sendfile(spPtr->outFd, spPtr->inFd, NULL, want);
+	if (n >= 0 || spPtr->moved || (errno != EINVAL && errno != ENOSYS)) {
+	    *maskPtr = TCL_WRITABLE;
+	    break;
+	}
+	spPtr->method = SPLICE_PIPE;
+	TCL_FALLTHROUGH();
+    case SPLICE_PIPE:
+	if (spPtr->pipeFds[0] < 0) {
+	    if (pipe2(spPtr->pipeFds, O_CLOEXEC) != 0) {
+		*errorCodePtr = errno;
+		return -1;
+	    }
+#ifdef F_SETPIPE_SZ
+	    (void) fcntl(spPtr->pipeFds[1], F_SETPIPE_SZ, SPLICE_CHUNK);
+#endif /* F_SETPIPE_SZ */
+	}
+	if (spPtr->pending == 0) {
+	    n = splice(spPtr->inFd, NULL, spPtr->pipeFds[1], NULL, want,
+		    SPLICE_F_MOVE);
+	    if (n <= 0) {
+		break;
+	    }
+	    spPtr->pending = (size_t) n;
+	}
+	n = splice(spPtr->pipeFds[0], NULL, spPtr->outFd, NULL,
+		spPtr->pending, SPLICE_F_MOVE);
+	if (n > 0) {
+	    spPtr->pending -= (size_t) n;
+	}
+	if (n < 0 || spPtr->pending > 0) {
+	    *maskPtr = TCL_WRITABLE;
+	}
+	break;
+    default:
+	n = splice(spPtr->inFd, NULL, spPtr->outFd, NULL, want,
+		SPLICE_F_MOVE);
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+	    struct pollfd pfd;
+
+	    /*
+	     * Either side may be the one that is not ready. Wait for the
+	     * output if there is input, or we would spin.
+	     */
+
+	    pfd.fd = spPtr->inFd;
+	    pfd.events = POLLIN;
+	    if (poll(&pfd, 1, 0) > 0) {
+		*maskPtr = TCL_WRITABLE;
+	    }
+	    errno = EAGAIN;
+	} else if (n < 0 && errno == EPIPE) {
+	    struct pollfd pfd;
+	    int avail = 0;
+
+	    /*
+	     * splice(2) checks the output before the input. An input at its
+	     * end with nothing left to write is not an error.
+	     */
+
+	    pfd.fd = spPtr->inFd;
+	    pfd.events = POLLIN;
+	    if (poll(&pfd, 1, 0) > 0 && ioctl(spPtr->inFd, FIONREAD, &avail) == 0
+		    && avail == 0) {
+		n = 0;
+	    } else {
+		errno = EPIPE;
+	    }
+	}
+	break;
+    }
+
+    if (n < 0) {
+	if (errno == EPIPE || errno == ENOSPC || errno == EFBIG) {
+	    *maskPtr = TCL_WRITABLE;
+	}
+	if (errno == EWOULDBLOCK) {
+	    *errorCodePtr = EAGAIN;
+	} else if (!spPtr->moved && spPtr->pending == 0 && (errno == EINVAL
+		|| errno == ENOSYS)) {
+	    *errorCodePtr = EOPNOTSUPP;
+	} else {
+	    *errorCodePtr = errno;
+	}
+	return -1;
+    }
+    if (n > 0) {
+	spPtr->moved = true;
+    }
+    return n;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpSpliceClose --
+ *
+ *	Releases a splice set up by TclpSpliceOpen.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Closes the private pipe, discarding any data left in it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclpSpliceClose(
+    void *splicePtr)		/* Token returned by TclpSpliceOpen. */
+{
+    SpliceState *spPtr = (SpliceState *)splicePtr;
+
+    if (spPtr->pipeFds[0] >= 0) {
+	close(spPtr->pipeFds[0]);
+	close(spPtr->pipeFds[1]);
+    }
+    Tcl_Free(spPtr);
+}
+
+#else /* !__linux__ */
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpSpliceOpen, TclpSplice, TclpSpliceClose --
+ *
+ *	Zero-copy transfers between channels are only implemented on Linux;
+ *	elsewhere [chan copy] always moves the data through its buffers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void *
+TclpSpliceOpen(
+    TCL_UNUSED(Tcl_Channel),
+    TCL_UNUSED(Tcl_Channel))
+{
+    return NULL;
+}
+
+long long
+TclpSplice(
+    TCL_UNUSED(void *),
+    TCL_UNUSED(long long),
+    TCL_UNUSED(int *),
+    int *errorCodePtr)
+{
+    *errorCodePtr = EOPNOTSUPP;
+    return -1;
+}
+
+void
+TclpSpliceClose(
+    TCL_UNUSED(void *))
+{
+}
+#endif /* __linux__ */
+
 /*
  *----------------------------------------------------------------------
  *
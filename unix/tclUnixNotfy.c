@@ -142,6 +142,7 @@ TclpAlertNotifier(
 #endif /* NOTIFIER_SELECT */
 }
 
+#ifdef NOTIFIER_SELECT
 /*
  *----------------------------------------------------------------------
  *
@@ -192,6 +193,7 @@ LookUpFileHandler(
     }
     return filePtr;
 }
+#endif /* NOTIFIER_SELECT */
 
 /*
  *----------------------------------------------------------------------
@@ -284,26 +286,32 @@ FileHandlerEventProc(
     FileHandler *filePtr;
     FileHandlerEvent *fileEvPtr = (FileHandlerEvent *) evPtr;
     ThreadSpecificData *tsdPtr;
+#ifndef NOTIFIER_SELECT
+    Tcl_HashEntry *hPtr;
+#endif /* !NOTIFIER_SELECT */
 
     if (!(flags & TCL_FILE_EVENTS)) {
 	return 0;
     }
 
     /*
-     * Search through the file handlers to find the one whose handle matches
-     * the event. We do this rather than keeping a pointer to the file handler
-     * directly in the event, so that the handler can be deleted while the
-     * event is queued without leaving a dangling pointer.
+     * Look up the file handler whose handle matches the event. We do this
+     * rather than keeping a pointer to the file handler directly in the
+     * event, so that the handler can be deleted while the event is queued
+     * without leaving a dangling pointer. The epoll and kqueue notifiers,
+     * which serve many files, keep their handlers in a hash table.
      */
 
     tsdPtr = TCL_TSD_INIT(&dataKey);
+#ifdef NOTIFIER_SELECT
+    filePtr = LookUpFileHandler(tsdPtr, fileEvPtr->fd, NULL);
+#else
+    hPtr = Tcl_FindHashEntry(&tsdPtr->fileHandlerTable,
+	    INT2PTR(fileEvPtr->fd));
+    filePtr = hPtr ? (FileHandler *) Tcl_GetHashValue(hPtr) : NULL;
+#endif /* NOTIFIER_SELECT */
 
-    for (filePtr = tsdPtr->firstFileHandlerPtr; filePtr != NULL;
-	    filePtr = filePtr->nextPtr) {
-	if (filePtr->fd != fileEvPtr->fd) {
-	    continue;
-	}
-
+    if (filePtr != NULL) {
 	/*
 	 * The code is tricky for two reasons:
 	 * 1. The file handler's desired events could have changed since the
@@ -321,7 +329,6 @@ FileHandlerEventProc(
 	if (mask != 0) {
 	    filePtr->proc(filePtr->clientData, mask);
 	}
-	break;
     }
     return 1;
 }
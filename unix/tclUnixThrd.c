@@ -11,7 +11,14 @@
  * this file, and for a DISCLAIMER OF ALL WARRANTIES.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE		/* For sched_getaffinity(2) */
+#endif
 #include "tclInt.h"
+#include <sys/mman.h>
+#ifdef __linux__
+#   include <sched.h>
+#endif /* __linux__ */
 
 #if TCL_THREADS
 
@@ -340,6 +347,158 @@ TclpThreadExit(
 #endif /* TCL_THREADS */
 }
 
+#ifdef __linux__
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReadCgroupFile, GetCgroupCPULimit --
+ *
+ *	Read a small file of the cgroup file system, and find how many
+ *	processors' worth of time the cgroups of the process may use: the
+ *	quota of the cpu.max files of its cgroup v2 and of the parents of
+ *	that cgroup, or of the cpu.cfs_quota_us file of cgroup v1, divided by
+ *	their period and rounded up.
+ *
+ * Results:
+ *	ReadCgroupFile returns the number of bytes read into buf, which it
+ *	terminates with a NUL, or -1. GetCgroupCPULimit returns the lowest
+ *	limit found, or 0 when there is none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ssize_t
+ReadCgroupFile(
+    const char *path,
+    char *buf,
+    size_t size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    ssize_t length;
+
+    if (fd < 0) {
+	return -1;
+    }
+    length = read(fd, buf, size - 1);
+    close(fd);
+    if (length >= 0) {
+	buf[length] = '\0';
+    }
+    return length;
+}
+
+static long
+GetCgroupCPULimit(void)
+{
+    char cgroup[PATH_MAX], path[PATH_MAX + 32], buf[64];
+    char *p, *end;
+    long quota, period, count, limit = 0;
+
+    /*
+     * cgroup v2: the line "0::/path" of /proc/self/cgroup names the cgroup
+     * of the process, each of whose ancestors may have a limit too.
+     */
+
+    if (ReadCgroupFile("/proc/self/cgroup", cgroup, sizeof(cgroup)) > 0) {
+	p = strstr(cgroup, "0::/");
+	if ((p != NULL) && ((p == cgroup) || (p[-1] == '\n'))) {
+	    p += 3;
+	    end = strchr(p, '\n');
+	    if (end != NULL) {
+		*end = '\0';
+	    }
+	    memmove(cgroup, p, strlen(p) + 1);
+	    while (1) {
+		snprintf(path, sizeof(path), "/sys/fs/cgroup%s/cpu.max",
+			(strcmp(cgroup, "/") ? cgroup : ""));
+		if ((ReadCgroupFile(path, buf, sizeof(buf)) > 0)
+			&& (sscanf(buf, "%ld %ld", &quota, &period) == 2)
+			&& (quota > 0) && (period > 0)) {
+		    count = (quota + period - 1) / period;
+		    if ((limit == 0) || (count < limit)) {
+			limit = count;
+		    }
+		}
+		end = strrchr(cgroup, '/');
+		if ((end == NULL) || (end == cgroup && cgroup[1] == '\0')) {
+		    break;
+		}
+		end[(end == cgroup)] = '\0';
+	    }
+	}
+    }
+
+    /*
+     * cgroup v1, as seen from inside a container.
+     */
+
+    if ((ReadCgroupFile("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", buf,
+	    sizeof(buf)) > 0) && (sscanf(buf, "%ld", &quota) == 1)
+	    && (quota > 0)
+	    && (ReadCgroupFile("/sys/fs/cgroup/cpu/cpu.cfs_period_us", buf,
+	    sizeof(buf)) > 0) && (sscanf(buf, "%ld", &period) == 1)
+	    && (period > 0)) {
+	count = (quota + period - 1) / period;
+	if ((limit == 0) || (count < limit)) {
+	    limit = count;
+	}
+    }
+    return limit;
+}
+#endif /* __linux__ */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpGetNumberOfCPUs --
+ *
+ *	This procedure returns the number of processors that the process may
+ *	use: those that are online, and on Linux only those of its affinity
+ *	mask and no more than the CPU quota of its cgroups allows.
+ *
+ * Results:
+ *	The number of processors, at least 1.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclpGetNumberOfCPUs(void)
+{
+    long count = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) {
+	count = 1;
+    }
+#endif /* _SC_NPROCESSORS_ONLN */
+#ifdef __linux__
+    {
+	cpu_set_t cpuSet;
+	long limit;
+
+	if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0) {
+	    limit = CPU_COUNT(&cpuSet);
+	    if ((limit > 0) && (limit < count)) {
+		count = limit;
+	    }
+	}
+	limit = GetCgroupCPULimit();
+	if ((limit > 0) && (limit < count)) {
+	    count = limit;
+	}
+    }
+#endif /* __linux__ */
+    return (count > INT_MAX) ? INT_MAX : (int) count;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -853,6 +1012,35 @@ TclpSetAllocCache(
 {
     pthread_setspecific(key, arg);
 }
+
+/*
+ * Tell the system that the whole pages in a range of free memory held by the
+ * thread allocator are not needed for now. They read back as zeros when they
+ * are next touched.
+ */
+
+void
+TclpReleaseAllocPages(
+    void *ptr,
+    size_t size)
+{
+#ifdef MADV_DONTNEED
+    static size_t pageSize = 0;
+    uintptr_t start, end;
+
+    if (pageSize == 0) {
+	pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    }
+    start = ((uintptr_t) ptr + pageSize - 1) & ~(uintptr_t)(pageSize - 1);
+    end = ((uintptr_t) ptr + size) & ~(uintptr_t)(pageSize - 1);
+    if (start < end) {
+	madvise((void *) start, end - start, MADV_DONTNEED);
+    }
+#else
+    (void) ptr;
+    (void) size;
+#endif
+}
 #endif /* USE_THREAD_ALLOC */
 
 void *
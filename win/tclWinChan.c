@@ -1494,6 +1494,42 @@ TclWinFlushDirtyChannels(void)
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpSpliceOpen, TclpSplice, TclpSpliceClose --
+ *
+ *	Zero-copy transfers between channels are not implemented on Windows;
+ *	[chan copy] always moves the data through its buffers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void *
+TclpSpliceOpen(
+    TCL_UNUSED(Tcl_Channel),
+    TCL_UNUSED(Tcl_Channel))
+{
+    return NULL;
+}
+
+long long
+TclpSplice(
+    TCL_UNUSED(void *),
+    TCL_UNUSED(long long),
+    TCL_UNUSED(int *),
+    int *errorCodePtr)
+{
+    *errorCodePtr = EOPNOTSUPP;
+    return -1;
+}
+
+void
+TclpSpliceClose(
+    TCL_UNUSED(void *))
+{
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -240,6 +240,45 @@ TclpThreadExit(
 #endif
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpGetNumberOfCPUs --
+ *
+ *	This procedure returns the number of processors that the process may
+ *	use: those of its affinity mask, or of the system when the mask cannot
+ *	be read.
+ *
+ * Results:
+ *	The number of processors, at least 1.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclpGetNumberOfCPUs(void)
+{
+    SYSTEM_INFO systemInfo;
+    DWORD_PTR processMask, systemMask;
+    int count = 0;
+
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processMask,
+	    &systemMask)) {
+	for (; processMask != 0; processMask &= processMask - 1) {
+	    count++;
+	}
+    }
+    if (count > 0) {
+	return count;
+    }
+    GetSystemInfo(&systemInfo);
+    return (systemInfo.dwNumberOfProcessors > 0)
+	    ? (int) systemInfo.dwNumberOfProcessors : 1;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -814,6 +853,18 @@ TclpSetAllocCache(
     }
 }
 
+/*
+ * Pages of free memory held by the thread allocator are only given back to
+ * the system on Unix; the heap owns them here.
+ */
+
+void
+TclpReleaseAllocPages(
+    TCL_UNUSED(void *),
+    TCL_UNUSED(size_t))
+{
+}
+
 void
 TclpFreeAllocCache(
     void *ptr)